@@ -0,0 +1,89 @@
+/* Benchmarks for decoding genotypes. */
+#include "benchlib.h"
+
+#define NUM_SUBSET_SAMPLES 100
+#define MATRIX_BLOCK_SITES 256
+
+typedef struct {
+    const tsk_treeseq_t *ts;
+    tsk_variant_t *variant;
+    int8_t *matrix;
+} genotypes_params_t;
+
+static int
+bench_variant_decode(void *params, tsk_size_t *num_ops)
+{
+    genotypes_params_t *p = (genotypes_params_t *) params;
+    int ret = 0;
+    tsk_id_t j;
+    const tsk_id_t num_sites = (tsk_id_t) tsk_treeseq_get_num_sites(p->ts);
+
+    for (j = 0; j < num_sites; j++) {
+        ret = tsk_variant_decode(p->variant, j, 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    *num_ops = (tsk_size_t) num_sites;
+out:
+    return ret;
+}
+
+static int
+bench_variant_decode_matrix(void *params, tsk_size_t *num_ops)
+{
+    genotypes_params_t *p = (genotypes_params_t *) params;
+    int ret = 0;
+    tsk_id_t start, stop;
+    const tsk_id_t num_sites = (tsk_id_t) tsk_treeseq_get_num_sites(p->ts);
+
+    for (start = 0; start < num_sites; start = stop) {
+        stop = TSK_MIN(start + MATRIX_BLOCK_SITES, num_sites);
+        ret = tsk_variant_decode_matrix_int8(p->variant, start, stop, 0, 0, p->matrix);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    *num_ops = (tsk_size_t) num_sites;
+out:
+    return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+    tsk_treeseq_t ts;
+    tsk_variant_t variant, subset_variant;
+    tsk_id_t subset[NUM_SUBSET_SAMPLES];
+    tsk_size_t j, num_subset;
+    genotypes_params_t params;
+
+    bench_get_tree_sequence(argc, argv, &ts);
+    num_subset = TSK_MIN(NUM_SUBSET_SAMPLES, tsk_treeseq_get_num_samples(&ts));
+    for (j = 0; j < num_subset; j++) {
+        subset[j] = tsk_treeseq_get_samples(&ts)[j];
+    }
+    ret = tsk_variant_init(&variant, &ts, NULL, 0, NULL, 0);
+    check_tsk_error(ret);
+    ret = tsk_variant_init(&subset_variant, &ts, subset, num_subset, NULL, 0);
+    check_tsk_error(ret);
+    params.ts = &ts;
+    params.variant = &variant;
+    params.matrix
+        = malloc(MATRIX_BLOCK_SITES * tsk_treeseq_get_num_samples(&ts) * sizeof(int8_t));
+    if (params.matrix == NULL) {
+        errx(EXIT_FAILURE, "Out of memory");
+    }
+
+    bench_run("variant_decode", bench_variant_decode, &params);
+    bench_run("variant_decode_matrix_int8", bench_variant_decode_matrix, &params);
+    params.variant = &subset_variant;
+    bench_run("variant_decode_subset", bench_variant_decode, &params);
+
+    free(params.matrix);
+    tsk_variant_free(&variant);
+    tsk_variant_free(&subset_variant);
+    tsk_treeseq_free(&ts);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* Benchmarks for the Li and Stephens HMM. */
+#include "benchlib.h"
+
+#define NUM_HAPLOTYPES 8
+
+typedef struct {
+    const tsk_treeseq_t *ts;
+    tsk_ls_hmm_t *hmms;
+    int32_t *haplotypes;
+    tsk_compressed_matrix_t *forward;
+    tsk_viterbi_matrix_t *viterbi;
+} ls_params_t;
+
+static int
+bench_forward(void *params, tsk_size_t *num_ops)
+{
+    ls_params_t *p = (ls_params_t *) params;
+
+    *num_ops = tsk_treeseq_get_num_sites(p->ts);
+    return tsk_ls_hmm_forward(&p->hmms[0], p->haplotypes, &p->forward[0], 0);
+}
+
+static int
+bench_viterbi(void *params, tsk_size_t *num_ops)
+{
+    ls_params_t *p = (ls_params_t *) params;
+
+    *num_ops = tsk_treeseq_get_num_sites(p->ts);
+    return tsk_ls_hmm_viterbi(&p->hmms[0], p->haplotypes, &p->viterbi[0], 0);
+}
+
+static int
+bench_forward_batch(void *params, tsk_size_t *num_ops)
+{
+    ls_params_t *p = (ls_params_t *) params;
+
+    *num_ops = NUM_HAPLOTYPES * tsk_treeseq_get_num_sites(p->ts);
+    return tsk_ls_hmm_forward_batch(
+        p->hmms, NUM_HAPLOTYPES, p->haplotypes, p->forward, 0);
+}
+
+static int
+bench_viterbi_batch(void *params, tsk_size_t *num_ops)
+{
+    ls_params_t *p = (ls_params_t *) params;
+
+    *num_ops = NUM_HAPLOTYPES * tsk_treeseq_get_num_sites(p->ts);
+    return tsk_ls_hmm_viterbi_batch(
+        p->hmms, NUM_HAPLOTYPES, p->haplotypes, p->viterbi, 0);
+}
+
+/* Make query haplotypes by copying sample genotypes and flipping a few */
+static void
+make_haplotypes(const tsk_treeseq_t *ts, int32_t *haplotypes)
+{
+    int ret;
+    tsk_size_t j, k;
+    tsk_variant_t variant;
+    const tsk_size_t num_sites = tsk_treeseq_get_num_sites(ts);
+    const tsk_size_t num_samples = tsk_treeseq_get_num_samples(ts);
+    tsk_size_t sources[NUM_HAPLOTYPES];
+    int32_t *h;
+
+    for (k = 0; k < NUM_HAPLOTYPES; k++) {
+        sources[k] = bench_random_index(num_samples);
+    }
+    ret = tsk_variant_init(&variant, ts, NULL, 0, NULL, 0);
+    check_tsk_error(ret);
+    for (j = 0; j < num_sites; j++) {
+        ret = tsk_variant_decode(&variant, (tsk_id_t) j, 0);
+        check_tsk_error(ret);
+        for (k = 0; k < NUM_HAPLOTYPES; k++) {
+            h = haplotypes + k * num_sites;
+            h[j] = variant.genotypes[sources[k]];
+            if (bench_random_uniform() < 0.01) {
+                h[j] = (int32_t) variant.num_alleles - 1 - h[j];
+            }
+        }
+    }
+    tsk_variant_free(&variant);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+    tsk_size_t j;
+    tsk_treeseq_t ts;
+    tsk_size_t num_sites;
+    double *recombination_rate, *mutation_rate;
+    tsk_ls_hmm_t hmms[NUM_HAPLOTYPES];
+    tsk_compressed_matrix_t forward[NUM_HAPLOTYPES];
+    tsk_viterbi_matrix_t viterbi[NUM_HAPLOTYPES];
+    ls_params_t params;
+
+    bench_get_tree_sequence(argc, argv, &ts);
+    num_sites = tsk_treeseq_get_num_sites(&ts);
+    recombination_rate = malloc(num_sites * sizeof(*recombination_rate));
+    mutation_rate = malloc(num_sites * sizeof(*mutation_rate));
+    params.haplotypes = malloc(NUM_HAPLOTYPES * num_sites * sizeof(*params.haplotypes));
+    if (recombination_rate == NULL || mutation_rate == NULL
+        || params.haplotypes == NULL) {
+        errx(EXIT_FAILURE, "Out of memory");
+    }
+    for (j = 0; j < num_sites; j++) {
+        recombination_rate[j] = 1e-4;
+        mutation_rate[j] = 1e-3;
+    }
+    make_haplotypes(&ts, params.haplotypes);
+    for (j = 0; j < NUM_HAPLOTYPES; j++) {
+        ret = tsk_ls_hmm_init(&hmms[j], &ts, recombination_rate, mutation_rate, 0);
+        check_tsk_error(ret);
+        ret = tsk_compressed_matrix_init(&forward[j], &ts, 0, 0);
+        check_tsk_error(ret);
+        ret = tsk_viterbi_matrix_init(&viterbi[j], &ts, 0, 0);
+        check_tsk_error(ret);
+    }
+    params.ts = &ts;
+    params.hmms = hmms;
+    params.forward = forward;
+    params.viterbi = viterbi;
+
+    bench_run("ls_hmm_forward", bench_forward, &params);
+    bench_run("ls_hmm_viterbi", bench_viterbi, &params);
+    bench_run("ls_hmm_forward_batch", bench_forward_batch, &params);
+    bench_run("ls_hmm_viterbi_batch", bench_viterbi_batch, &params);
+
+    for (j = 0; j < NUM_HAPLOTYPES; j++) {
+        tsk_ls_hmm_free(&hmms[j]);
+        tsk_compressed_matrix_free(&forward[j]);
+        tsk_viterbi_matrix_free(&viterbi[j]);
+    }
+    free(recombination_rate);
+    free(mutation_rate);
+    free(params.haplotypes);
+    tsk_treeseq_free(&ts);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/* Benchmarks for the statistics. */
+#include <float.h>
+
+#include "benchlib.h"
+
+#define NUM_SAMPLE_SETS 4
+#define NUM_WINDOWS 10
+#define NUM_LD_SITES 200
+#define LD_BAND_WIDTH 50
+#define NUM_GRM_VECTORS 10
+/* The branch mode divergence matrix is quadratic in the number of samples */
+#define MAX_DIVMAT_SAMPLE_SET_SIZE 10
+
+typedef struct {
+    const tsk_treeseq_t *ts;
+    tsk_size_t sample_set_sizes[NUM_SAMPLE_SETS];
+    tsk_size_t divmat_sample_set_sizes[NUM_SAMPLE_SETS];
+    const tsk_id_t *sample_sets;
+    double windows[NUM_WINDOWS + 1];
+    tsk_flags_t options;
+    tsk_id_t ld_sites[NUM_LD_SITES];
+    tsk_size_t num_ld_sites;
+    tsk_ld_calc_t ld_calc;
+    tsk_size_t num_r2_values[NUM_LD_SITES];
+    double *weights;
+    double *result;
+} stats_params_t;
+
+static int
+bench_diversity(void *params, tsk_size_t *num_ops)
+{
+    stats_params_t *p = (stats_params_t *) params;
+
+    *num_ops = 1;
+    return tsk_treeseq_diversity(p->ts, NUM_SAMPLE_SETS, p->sample_set_sizes,
+        p->sample_sets, NUM_WINDOWS, p->windows, p->options, p->result);
+}
+
+static int
+bench_divergence_matrix(void *params, tsk_size_t *num_ops)
+{
+    stats_params_t *p = (stats_params_t *) params;
+
+    *num_ops = 1;
+    return tsk_treeseq_divergence_matrix(p->ts, NUM_SAMPLE_SETS,
+        p->divmat_sample_set_sizes, p->sample_sets, NUM_WINDOWS, p->windows,
+        p->options, p->result);
+}
+
+static int
+bench_r2(void *params, tsk_size_t *num_ops)
+{
+    stats_params_t *p = (stats_params_t *) params;
+
+    *num_ops = p->num_ld_sites * p->num_ld_sites;
+    return tsk_treeseq_r2(p->ts, 1, p->sample_set_sizes, p->sample_sets,
+        p->num_ld_sites, p->ld_sites, p->num_ld_sites, p->ld_sites, p->options,
+        p->result);
+}
+
+/* The forward r2 arrays for each site in the block in turn */
+static int
+bench_ld_calc_r2_arrays(void *params, tsk_size_t *num_ops)
+{
+    int ret = 0;
+    stats_params_t *p = (stats_params_t *) params;
+    tsk_size_t j;
+
+    *num_ops = p->num_ld_sites;
+    for (j = 0; j < p->num_ld_sites; j++) {
+        ret = tsk_ld_calc_get_r2_array(&p->ld_calc, p->ld_sites[j], TSK_DIR_FORWARD,
+            LD_BAND_WIDTH, DBL_MAX, p->result + j * LD_BAND_WIDTH,
+            p->num_r2_values + j);
+        if (ret != 0) {
+            break;
+        }
+    }
+    return ret;
+}
+
+/* The same values as bench_ld_calc_r2_arrays in a single banded scan */
+static int
+bench_ld_calc_r2_band(void *params, tsk_size_t *num_ops)
+{
+    stats_params_t *p = (stats_params_t *) params;
+
+    *num_ops = p->num_ld_sites;
+    return tsk_ld_calc_get_r2_band(&p->ld_calc, p->ld_sites[0],
+        p->ld_sites[0] + (tsk_id_t) p->num_ld_sites, LD_BAND_WIDTH, DBL_MAX,
+        p->result, p->num_r2_values);
+}
+
+static int
+bench_genetic_relatedness_vector(void *params, tsk_size_t *num_ops)
+{
+    stats_params_t *p = (stats_params_t *) params;
+
+    *num_ops = 1;
+    return tsk_treeseq_genetic_relatedness_vector(p->ts, NUM_GRM_VECTORS, p->weights,
+        NUM_WINDOWS, p->windows, p->result, p->options);
+}
+
+int
+main(int argc, char **argv)
+{
+    tsk_treeseq_t ts;
+    tsk_size_t j, num_samples, num_sites;
+    stats_params_t params;
+
+    bench_get_tree_sequence(argc, argv, &ts);
+    num_samples = tsk_treeseq_get_num_samples(&ts);
+    num_sites = tsk_treeseq_get_num_sites(&ts);
+    if (num_samples < NUM_SAMPLE_SETS) {
+        errx(EXIT_FAILURE, "Need at least %d samples", NUM_SAMPLE_SETS);
+    }
+    params.ts = &ts;
+    params.sample_sets = tsk_treeseq_get_samples(&ts);
+    for (j = 0; j < NUM_SAMPLE_SETS; j++) {
+        params.sample_set_sizes[j] = num_samples / NUM_SAMPLE_SETS;
+        params.divmat_sample_set_sizes[j]
+            = TSK_MIN(MAX_DIVMAT_SAMPLE_SET_SIZE, params.sample_set_sizes[j]);
+    }
+    for (j = 0; j <= NUM_WINDOWS; j++) {
+        params.windows[j]
+            = tsk_treeseq_get_sequence_length(&ts) * (double) j / NUM_WINDOWS;
+    }
+    /* A contiguous block of sites from the middle of the sequence */
+    params.num_ld_sites = TSK_MIN(NUM_LD_SITES, num_sites);
+    for (j = 0; j < params.num_ld_sites; j++) {
+        params.ld_sites[j] = (tsk_id_t) ((num_sites - params.num_ld_sites) / 2 + j);
+    }
+    params.weights = malloc(num_samples * NUM_GRM_VECTORS * sizeof(*params.weights));
+    /* Big enough for the node mode stats and the relatedness vectors */
+    params.result = malloc(NUM_WINDOWS
+                           * TSK_MAX(tsk_treeseq_get_num_nodes(&ts) * NUM_SAMPLE_SETS,
+                               TSK_MAX(num_samples * NUM_GRM_VECTORS,
+                                   NUM_LD_SITES * NUM_LD_SITES))
+                           * sizeof(*params.result));
+    if (params.weights == NULL || params.result == NULL) {
+        errx(EXIT_FAILURE, "Out of memory");
+    }
+    if (tsk_ld_calc_init(&params.ld_calc, &ts) != 0) {
+        errx(EXIT_FAILURE, "Cannot initialise LD calculator");
+    }
+    for (j = 0; j < num_samples * NUM_GRM_VECTORS; j++) {
+        params.weights[j] = bench_random_uniform() - 0.5;
+    }
+
+    params.options = TSK_STAT_SITE;
+    bench_run("diversity_site", bench_diversity, &params);
+    bench_run("divergence_matrix_site", bench_divergence_matrix, &params);
+    bench_run("r2_site", bench_r2, &params);
+    bench_run("ld_calc_r2_arrays", bench_ld_calc_r2_arrays, &params);
+    bench_run("ld_calc_r2_band", bench_ld_calc_r2_band, &params);
+    params.options = TSK_STAT_BRANCH;
+    bench_run("diversity_branch", bench_diversity, &params);
+    bench_run("divergence_matrix_branch", bench_divergence_matrix, &params);
+    bench_run("genetic_relatedness_vector_branch", bench_genetic_relatedness_vector,
+        &params);
+    params.options = TSK_STAT_NODE;
+    bench_run("diversity_node", bench_diversity, &params);
+
+    tsk_ld_calc_free(&params.ld_calc);
+    free(params.weights);
+    free(params.result);
+    tsk_treeseq_free(&ts);
+    return 0;
+}
@@ -0,0 +1,361 @@
+/* Benchmarks for loading, dumping, sorting and simplifying tables. */
+#include <float.h>
+
+#include "benchlib.h"
+
+typedef struct {
+    const tsk_table_collection_t *tables;
+    const tsk_table_collection_t *unsorted;
+    const char *filename;
+    tsk_flags_t options;
+    const tsk_id_t *samples;
+    tsk_size_t num_samples;
+} tables_params_t;
+
+static int
+bench_dump(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+
+    *num_ops = 1;
+    return tsk_table_collection_dump(p->tables, p->filename, p->options);
+}
+
+static int
+bench_load(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_table_collection_t tables;
+    int ret;
+
+    ret = tsk_table_collection_load(&tables, p->filename, p->options);
+    tsk_table_collection_free(&tables);
+    *num_ops = 1;
+    return ret;
+}
+
+static int
+bench_treeseq_load(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_treeseq_t ts;
+    int ret;
+
+    ret = tsk_treeseq_load(&ts, p->filename, p->options);
+    tsk_treeseq_free(&ts);
+    *num_ops = 1;
+    return ret;
+}
+
+static int
+bench_copy(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_table_collection_t tables;
+    int ret;
+
+    ret = tsk_table_collection_copy(p->unsorted, &tables, 0);
+    tsk_table_collection_free(&tables);
+    *num_ops = 1;
+    return ret;
+}
+
+/* Time includes copying the unsorted tables, see the copy benchmark */
+static int
+bench_sort(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_table_collection_t tables;
+    int ret;
+
+    ret = tsk_table_collection_copy(p->unsorted, &tables, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_sort(&tables, NULL, p->options);
+    *num_ops = 1;
+out:
+    tsk_table_collection_free(&tables);
+    return ret;
+}
+
+static int
+bench_build_index(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_table_collection_t tables;
+    int ret;
+
+    ret = tsk_table_collection_copy(p->tables, &tables, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_build_index(&tables, 0);
+    *num_ops = 1;
+out:
+    tsk_table_collection_free(&tables);
+    return ret;
+}
+
+static int
+bench_simplify(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_table_collection_t tables;
+    int ret;
+
+    ret = tsk_table_collection_copy(p->tables, &tables, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_table_collection_simplify(
+        &tables, p->samples, p->num_samples, p->options, NULL);
+    *num_ops = 1;
+out:
+    tsk_table_collection_free(&tables);
+    return ret;
+}
+
+/* Subsets to all of the nodes in reverse order, so that every row is kept */
+static int
+bench_subset(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_table_collection_t tables;
+    tsk_size_t num_nodes = p->tables->nodes.num_rows;
+    tsk_id_t *nodes = malloc(num_nodes * sizeof(*nodes));
+    tsk_size_t j;
+    int ret;
+
+    ret = tsk_table_collection_copy(p->tables, &tables, 0);
+    if (ret != 0 || nodes == NULL) {
+        goto out;
+    }
+    for (j = 0; j < num_nodes; j++) {
+        nodes[j] = (tsk_id_t)(num_nodes - j - 1);
+    }
+    ret = tsk_table_collection_subset(&tables, nodes, num_nodes, p->options);
+    *num_ops = 1;
+out:
+    tsk_table_collection_free(&tables);
+    free(nodes);
+    return ret;
+}
+
+/* Unions the tables with a copy of themselves sharing no nodes, as when
+ * merging independent simulations. */
+static int
+bench_union(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_table_collection_t tables;
+    tsk_size_t num_nodes = p->tables->nodes.num_rows;
+    tsk_id_t *node_mapping = malloc(num_nodes * sizeof(*node_mapping));
+    tsk_size_t j;
+    int ret;
+
+    ret = tsk_table_collection_copy(p->tables, &tables, 0);
+    if (ret != 0 || node_mapping == NULL) {
+        goto out;
+    }
+    for (j = 0; j < num_nodes; j++) {
+        node_mapping[j] = TSK_NULL;
+    }
+    ret = tsk_table_collection_union(&tables, p->tables, node_mapping, p->options);
+    *num_ops = 1;
+out:
+    tsk_table_collection_free(&tables);
+    free(node_mapping);
+    return ret;
+}
+
+/* Finds IBD between the samples, counting each segment as an operation.
+ * Short segments are ignored to keep the memory needed for the result
+ * reasonable when segments are stored. */
+static int
+bench_ibd_within(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    tsk_identity_segments_t result;
+    int ret;
+
+    ret = tsk_table_collection_ibd_within(p->tables, &result, p->samples,
+        p->num_samples, p->tables->sequence_length / 100, DBL_MAX, p->options);
+    if (ret != 0) {
+        goto out;
+    }
+    *num_ops = tsk_identity_segments_get_num_segments(&result);
+out:
+    tsk_identity_segments_free(&result);
+    return ret;
+}
+
+/* Builds a copy of the edge table one row at a time */
+static int
+bench_edge_add_row(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    const tsk_edge_table_t *source = &p->tables->edges;
+    tsk_edge_table_t edges;
+    tsk_size_t j;
+    tsk_id_t ret_id;
+    int ret;
+
+    ret = tsk_edge_table_init(&edges, p->options);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < source->num_rows; j++) {
+        ret_id = tsk_edge_table_add_row(&edges, source->left[j], source->right[j],
+            source->parent[j], source->child[j], NULL, 0);
+        if (ret_id < 0) {
+            ret = (int) ret_id;
+            goto out;
+        }
+    }
+    *num_ops = source->num_rows;
+out:
+    tsk_edge_table_free(&edges);
+    return ret;
+}
+
+/* Builds a copy of the edge table by writing the rows in place */
+static int
+bench_edge_append_in_place(void *params, tsk_size_t *num_ops)
+{
+    tables_params_t *p = (tables_params_t *) params;
+    const tsk_edge_table_t *source = &p->tables->edges;
+    tsk_edge_table_t edges;
+    tsk_size_t j, k;
+    tsk_id_t start;
+    int ret;
+
+    ret = tsk_edge_table_init(&edges, p->options);
+    if (ret != 0) {
+        goto out;
+    }
+    start = tsk_edge_table_append_begin(&edges, source->num_rows, 0);
+    if (start < 0) {
+        ret = (int) start;
+        goto out;
+    }
+    k = (tsk_size_t) start;
+    for (j = 0; j < source->num_rows; j++) {
+        edges.left[k + j] = source->left[j];
+        edges.right[k + j] = source->right[j];
+        edges.parent[k + j] = source->parent[j];
+        edges.child[k + j] = source->child[j];
+    }
+    ret = tsk_edge_table_append_commit(&edges, source->num_rows);
+    *num_ops = source->num_rows;
+out:
+    tsk_edge_table_free(&edges);
+    return ret;
+}
+
+/* Shuffle the edges, sites and mutations so that sorting has work to do */
+static void
+shuffle_tables(tsk_table_collection_t *tables)
+{
+    int ret;
+    tsk_size_t j, k;
+    tsk_edge_table_t *edges = &tables->edges;
+    tsk_mutation_table_t *mutations = &tables->mutations;
+    double tmp_double;
+    tsk_id_t tmp_id;
+
+    for (j = edges->num_rows; j > 1; j--) {
+        k = bench_random_index(j);
+        tmp_double = edges->left[j - 1];
+        edges->left[j - 1] = edges->left[k];
+        edges->left[k] = tmp_double;
+        tmp_double = edges->right[j - 1];
+        edges->right[j - 1] = edges->right[k];
+        edges->right[k] = tmp_double;
+        tmp_id = edges->parent[j - 1];
+        edges->parent[j - 1] = edges->parent[k];
+        edges->parent[k] = tmp_id;
+        tmp_id = edges->child[j - 1];
+        edges->child[j - 1] = edges->child[k];
+        edges->child[k] = tmp_id;
+    }
+    /* Mutations have one byte derived states, so we can shuffle them by site */
+    for (j = mutations->num_rows; j > 1; j--) {
+        k = bench_random_index(j);
+        tmp_id = mutations->site[j - 1];
+        mutations->site[j - 1] = mutations->site[k];
+        mutations->site[k] = tmp_id;
+        tmp_id = mutations->node[j - 1];
+        mutations->node[j - 1] = mutations->node[k];
+        mutations->node[k] = tmp_id;
+        tmp_double = mutations->time[j - 1];
+        mutations->time[j - 1] = mutations->time[k];
+        mutations->time[k] = tmp_double;
+    }
+    ret = tsk_table_collection_drop_index(tables, 0);
+    check_tsk_error(ret);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+    tsk_treeseq_t ts;
+    tsk_table_collection_t unsorted;
+    tables_params_t params;
+
+    bench_get_tree_sequence(argc, argv, &ts);
+    ret = tsk_table_collection_copy(ts.tables, &unsorted, 0);
+    check_tsk_error(ret);
+    shuffle_tables(&unsorted);
+
+    params.tables = ts.tables;
+    params.unsorted = &unsorted;
+    params.filename = bench_temp_file();
+    params.samples = tsk_treeseq_get_samples(&ts);
+    params.num_samples = tsk_treeseq_get_num_samples(&ts) / 2;
+
+    params.options = 0;
+    bench_run("table_collection_dump", bench_dump, &params);
+    bench_run("table_collection_load", bench_load, &params);
+    params.options = TSK_LOAD_MMAP;
+    bench_run("table_collection_load_mmap", bench_load, &params);
+    params.options = 0;
+    bench_run("treeseq_load", bench_treeseq_load, &params);
+    params.options = TSK_NO_CHECK_INTEGRITY;
+    bench_run("treeseq_load_no_check_integrity", bench_treeseq_load, &params);
+    params.options = TSK_DUMP_COMPRESS_OFFSETS;
+    bench_run("table_collection_dump_compress_offsets", bench_dump, &params);
+    params.options = 0;
+    bench_run("table_collection_load_compressed_offsets", bench_load, &params);
+
+    params.options = 0;
+    bench_run("table_collection_copy", bench_copy, &params);
+    bench_run("table_collection_sort", bench_sort, &params);
+    bench_run("table_collection_build_index", bench_build_index, &params);
+    bench_run("table_collection_simplify", bench_simplify, &params);
+    params.options = TSK_SIMPLIFY_KEEP_UNARY;
+    bench_run("table_collection_simplify_keep_unary", bench_simplify, &params);
+
+    bench_run("table_collection_subset", bench_subset, &params);
+    bench_run("table_collection_union", bench_union, &params);
+    params.options = TSK_UNION_NO_CHECK_SHARED;
+    bench_run("table_collection_union_no_check_shared", bench_union, &params);
+
+    params.options = TSK_IBD_STORE_PAIRS;
+    bench_run("table_collection_ibd_within_pairs", bench_ibd_within, &params);
+    params.options = TSK_IBD_STORE_SEGMENTS;
+    bench_run("table_collection_ibd_within_segments", bench_ibd_within, &params);
+
+    params.options = 0;
+    bench_run("edge_table_add_row", bench_edge_add_row, &params);
+    bench_run("edge_table_append_in_place", bench_edge_append_in_place, &params);
+    params.options = TSK_TABLE_NO_METADATA;
+    bench_run("edge_table_add_row_no_metadata", bench_edge_add_row, &params);
+    bench_run("edge_table_append_in_place_no_metadata", bench_edge_append_in_place,
+        &params);
+
+    tsk_table_collection_free(&unsorted);
+    tsk_treeseq_free(&ts);
+    return 0;
+}
@@ -0,0 +1,207 @@
+/* Benchmarks for tree iteration, seeking and parsimony. */
+#include "benchlib.h"
+
+#define NUM_SEEKS 1000
+#define NUM_MAP_SITES 100
+
+typedef struct {
+    const tsk_treeseq_t *ts;
+    tsk_tree_t *tree;
+    double *positions;
+    int32_t *genotypes;
+} trees_params_t;
+
+static int
+bench_tree_next(void *params, tsk_size_t *num_ops)
+{
+    trees_params_t *p = (trees_params_t *) params;
+    int ret;
+
+    for (ret = tsk_tree_first(p->tree); ret == TSK_TREE_OK;
+         ret = tsk_tree_next(p->tree)) {
+        (*num_ops)++;
+    }
+    return ret;
+}
+
+static int
+bench_tree_prev(void *params, tsk_size_t *num_ops)
+{
+    trees_params_t *p = (trees_params_t *) params;
+    int ret;
+
+    for (ret = tsk_tree_last(p->tree); ret == TSK_TREE_OK;
+         ret = tsk_tree_prev(p->tree)) {
+        (*num_ops)++;
+    }
+    return ret;
+}
+
+static int
+bench_tree_seek(void *params, tsk_size_t *num_ops)
+{
+    trees_params_t *p = (trees_params_t *) params;
+    int ret = 0;
+    tsk_size_t j;
+
+    for (j = 0; j < NUM_SEEKS; j++) {
+        ret = tsk_tree_seek(p->tree, p->positions[j], 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    *num_ops = NUM_SEEKS;
+out:
+    return ret;
+}
+
+static int
+bench_tree_seek_from_null(void *params, tsk_size_t *num_ops)
+{
+    trees_params_t *p = (trees_params_t *) params;
+    int ret = 0;
+    tsk_size_t j;
+
+    for (j = 0; j < NUM_SEEKS; j++) {
+        ret = tsk_tree_clear(p->tree);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_tree_seek(p->tree, p->positions[j], 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    *num_ops = NUM_SEEKS;
+out:
+    return ret;
+}
+
+static int
+bench_tree_preorder(void *params, tsk_size_t *num_ops)
+{
+    trees_params_t *p = (trees_params_t *) params;
+    int ret = 0;
+    tsk_size_t num_nodes;
+    /* The tree's size bound depends on its current state, so use the number
+     * of nodes in the tree sequence instead. */
+    tsk_id_t *nodes = malloc(tsk_treeseq_get_num_nodes(p->ts) * sizeof(*nodes));
+
+    if (nodes == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    for (ret = tsk_tree_first(p->tree); ret == TSK_TREE_OK;
+         ret = tsk_tree_next(p->tree)) {
+        ret = tsk_tree_preorder(p->tree, nodes, &num_nodes);
+        if (ret != 0) {
+            goto out;
+        }
+        *num_ops += num_nodes;
+    }
+out:
+    free(nodes);
+    return ret;
+}
+
+static int
+bench_map_mutations(void *params, tsk_size_t *num_ops)
+{
+    trees_params_t *p = (trees_params_t *) params;
+    const tsk_size_t num_samples = tsk_treeseq_get_num_samples(p->ts);
+    int ret = 0;
+    tsk_size_t j, num_transitions;
+    tsk_state_transition_t *transitions;
+    int32_t ancestral_state;
+
+    for (j = 0; j < NUM_MAP_SITES; j++) {
+        ret = tsk_tree_map_mutations(p->tree, p->genotypes + j * num_samples, NULL, 0,
+            &ancestral_state, &num_transitions, &transitions);
+        if (ret != 0) {
+            goto out;
+        }
+        free(transitions);
+    }
+    *num_ops = NUM_MAP_SITES;
+out:
+    return ret;
+}
+
+static int
+bench_map_mutations_batch(void *params, tsk_size_t *num_ops)
+{
+    trees_params_t *p = (trees_params_t *) params;
+    int ret;
+    int32_t ancestral_states[NUM_MAP_SITES];
+    tsk_size_t transitions_offset[NUM_MAP_SITES + 1];
+    tsk_state_transition_t *transitions;
+
+    ret = tsk_tree_map_mutations_batch(p->tree, NUM_MAP_SITES, p->genotypes, NULL, 0,
+        ancestral_states, transitions_offset, &transitions);
+    if (ret != 0) {
+        goto out;
+    }
+    free(transitions);
+    *num_ops = NUM_MAP_SITES;
+out:
+    return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+    tsk_size_t j;
+    tsk_treeseq_t ts;
+    tsk_tree_t tree, sample_lists_tree;
+    double positions[NUM_SEEKS];
+    trees_params_t params;
+    int32_t *genotypes;
+
+    bench_get_tree_sequence(argc, argv, &ts);
+    /* Sites with a minor allele at frequency 0.1 on average */
+    genotypes = malloc(NUM_MAP_SITES * tsk_treeseq_get_num_samples(&ts)
+                       * sizeof(*genotypes));
+    if (genotypes == NULL) {
+        errx(EXIT_FAILURE, "Out of memory");
+    }
+    for (j = 0; j < NUM_MAP_SITES * tsk_treeseq_get_num_samples(&ts); j++) {
+        genotypes[j] = bench_random_uniform() < 0.1;
+    }
+    for (j = 0; j < NUM_SEEKS; j++) {
+        positions[j] = bench_random_uniform() * tsk_treeseq_get_sequence_length(&ts);
+    }
+    ret = tsk_tree_init(&tree, &ts, 0);
+    check_tsk_error(ret);
+    ret = tsk_tree_init(&sample_lists_tree, &ts, TSK_SAMPLE_LISTS);
+    check_tsk_error(ret);
+    params.ts = &ts;
+    params.tree = &tree;
+    params.positions = positions;
+    params.genotypes = genotypes;
+
+    bench_run("tree_next", bench_tree_next, &params);
+    bench_run("tree_prev", bench_tree_prev, &params);
+    bench_run("tree_seek", bench_tree_seek, &params);
+    bench_run("tree_seek_from_null", bench_tree_seek_from_null, &params);
+    bench_run("tree_preorder", bench_tree_preorder, &params);
+    params.tree = &sample_lists_tree;
+    bench_run("tree_next_sample_lists", bench_tree_next, &params);
+
+    ret = tsk_treeseq_build_seek_index(&ts, 0, 0);
+    check_tsk_error(ret);
+    params.tree = &tree;
+    bench_run("tree_seek_indexed", bench_tree_seek, &params);
+    bench_run("tree_seek_from_null_indexed", bench_tree_seek_from_null, &params);
+
+    ret = tsk_tree_seek(&tree, tsk_treeseq_get_sequence_length(&ts) / 2, 0);
+    check_tsk_error(ret);
+    bench_run("tree_map_mutations", bench_map_mutations, &params);
+    bench_run("tree_map_mutations_batch", bench_map_mutations_batch, &params);
+
+    tsk_tree_free(&tree);
+    tsk_tree_free(&sample_lists_tree);
+    tsk_treeseq_free(&ts);
+    free(genotypes);
+    return 0;
+}
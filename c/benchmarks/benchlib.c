@@ -0,0 +1,272 @@
+/* Support code for the tskit C benchmarks. This uses POSIX functions for
+ * timing and memory usage, and so isn't as portable as the library itself. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "benchlib.h"
+
+/* Keep running an operation until it has taken at least this long */
+#define BENCH_MIN_TIME_NS 250000000LL
+#define BENCH_MAX_REPETITIONS 100000
+
+static const char *bench_source = "synthetic";
+static uint64_t bench_random_state = 1;
+static char bench_temp_path[] = "/tmp/tsk_bench_XXXXXX";
+
+void
+bench_random_seed(uint64_t seed)
+{
+    /* The xorshift state must be nonzero */
+    bench_random_state = seed == 0 ? 1 : seed;
+}
+
+/* xorshift64*, see Vigna (2016) https://arxiv.org/abs/1402.6246 */
+static uint64_t
+bench_random_next(void)
+{
+    uint64_t x = bench_random_state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    bench_random_state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+double
+bench_random_uniform(void)
+{
+    /* The top 53 bits give a uniform double in [0, 1) */
+    return (double) (bench_random_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+tsk_size_t
+bench_random_index(tsk_size_t n)
+{
+    return (tsk_size_t) (bench_random_uniform() * (double) n);
+}
+
+static long long
+bench_time_ns(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        err(EXIT_FAILURE, "clock_gettime");
+    }
+    return (long long) ts.tv_sec * 1000000000LL + (long long) ts.tv_nsec;
+}
+
+/* The peak resident set size of the process. Note that this is in KiB on
+ * Linux, but in bytes on macOS. */
+static long
+bench_peak_rss(void)
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        err(EXIT_FAILURE, "getrusage");
+    }
+    return usage.ru_maxrss;
+}
+
+static void
+bench_remove_temp_file(void)
+{
+    unlink(bench_temp_path);
+}
+
+const char *
+bench_temp_file(void)
+{
+    int fd = mkstemp(bench_temp_path);
+
+    if (fd == -1) {
+        err(EXIT_FAILURE, "mkstemp");
+    }
+    close(fd);
+    atexit(bench_remove_temp_file);
+    return bench_temp_path;
+}
+
+static void
+bench_print_json_string(const char *s)
+{
+    putchar('"');
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            putchar('\\');
+        }
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+void
+bench_run(const char *name, bench_func_t *f, void *params)
+{
+    int ret;
+    long long start, elapsed;
+    tsk_size_t repetitions = 0;
+    tsk_size_t ops, total_ops = 0;
+
+    start = bench_time_ns();
+    do {
+        ops = 0;
+        ret = f(params, &ops);
+        check_tsk_error(ret);
+        total_ops += ops;
+        repetitions++;
+        elapsed = bench_time_ns() - start;
+    } while (elapsed < BENCH_MIN_TIME_NS && repetitions < BENCH_MAX_REPETITIONS);
+
+    printf("{\"benchmark\": ");
+    bench_print_json_string(name);
+    printf(", \"source\": ");
+    bench_print_json_string(bench_source);
+    printf(", \"repetitions\": %llu, \"ops\": %llu, \"total_ns\": %lld, "
+           "\"ns_per_op\": %.3f, \"peak_rss\": %ld}\n",
+        (unsigned long long) repetitions, (unsigned long long) total_ops, elapsed,
+        total_ops == 0 ? 0.0 : (double) elapsed / (double) total_ops, bench_peak_rss());
+    fflush(stdout);
+}
+
+static void
+bench_add_sites(tsk_table_collection_t *tables, double sites_per_tree)
+{
+    int ret;
+    tsk_treeseq_t ts;
+    tsk_tree_t tree;
+    tsk_id_t *nodes;
+    tsk_size_t j, num_nodes, num_sites;
+    double left, span, position;
+    tsk_id_t site, u;
+
+    ret = tsk_treeseq_init(&ts, tables, TSK_TS_INIT_BUILD_INDEXES);
+    check_tsk_error(ret);
+    ret = tsk_tree_init(&tree, &ts, 0);
+    check_tsk_error(ret);
+    nodes = malloc(tsk_treeseq_get_num_nodes(&ts) * sizeof(*nodes));
+    if (nodes == NULL) {
+        errx(EXIT_FAILURE, "Out of memory");
+    }
+    for (ret = tsk_tree_first(&tree); ret == TSK_TREE_OK; ret = tsk_tree_next(&tree)) {
+        ret = tsk_tree_preorder(&tree, nodes, &num_nodes);
+        check_tsk_error(ret);
+        num_sites = (tsk_size_t) sites_per_tree;
+        if (bench_random_uniform() < sites_per_tree - (double) num_sites) {
+            num_sites++;
+        }
+        left = tree.interval.left;
+        span = tree.interval.right - left;
+        for (j = 0; j < num_sites; j++) {
+            /* Put mutations above any node except the root */
+            u = nodes[1 + bench_random_index(num_nodes - 1)];
+            position = left + bench_random_uniform() * span;
+            site = tsk_site_table_add_row(&tables->sites, position, "0", 1, NULL, 0);
+            check_tsk_error(site);
+            ret = tsk_mutation_table_add_row(&tables->mutations, site, u, TSK_NULL,
+                TSK_UNKNOWN_TIME, "1", 1, NULL, 0);
+            check_tsk_error(ret);
+        }
+    }
+    check_tsk_error(ret);
+    free(nodes);
+    tsk_tree_free(&tree);
+    tsk_treeseq_free(&ts);
+
+    ret = tsk_table_collection_sort(tables, NULL, 0);
+    check_tsk_error(ret);
+}
+
+void
+bench_simulate(tsk_table_collection_t *tables, tsk_size_t N, tsk_size_t T,
+    double sites_per_tree, uint64_t seed)
+{
+    const tsk_size_t simplify_interval = 100;
+    tsk_id_t *buffer, *parents, *children, left_parent, right_parent;
+    double breakpoint;
+    tsk_size_t j, t;
+    int ret, b;
+
+    bench_random_seed(seed);
+    buffer = malloc(2 * N * sizeof(*buffer));
+    if (buffer == NULL) {
+        errx(EXIT_FAILURE, "Out of memory");
+    }
+    ret = tsk_table_collection_clear(tables, 0);
+    check_tsk_error(ret);
+    tables->sequence_length = 1e6;
+    parents = buffer;
+    for (j = 0; j < N; j++) {
+        parents[j] = tsk_node_table_add_row(
+            &tables->nodes, 0, (double) T, TSK_NULL, TSK_NULL, NULL, 0);
+        check_tsk_error(parents[j]);
+    }
+    b = 0;
+    for (t = T; t > 0; t--) {
+        parents = buffer + (b * (int) N);
+        b = (b + 1) % 2;
+        children = buffer + (b * (int) N);
+        for (j = 0; j < N; j++) {
+            children[j] = tsk_node_table_add_row(
+                &tables->nodes, 0, (double) (t - 1), TSK_NULL, TSK_NULL, NULL, 0);
+            check_tsk_error(children[j]);
+            left_parent = parents[bench_random_index(N)];
+            right_parent = parents[bench_random_index(N)];
+            do {
+                breakpoint = bench_random_uniform() * tables->sequence_length;
+            } while (breakpoint == 0);
+            ret = tsk_edge_table_add_row(
+                &tables->edges, 0, breakpoint, left_parent, children[j], NULL, 0);
+            check_tsk_error(ret);
+            ret = tsk_edge_table_add_row(&tables->edges, breakpoint,
+                tables->sequence_length, right_parent, children[j], NULL, 0);
+            check_tsk_error(ret);
+        }
+        if ((t - 1) % simplify_interval == 0) {
+            ret = tsk_table_collection_sort(tables, NULL, 0);
+            check_tsk_error(ret);
+            ret = tsk_table_collection_simplify(tables, children, N, 0, NULL);
+            check_tsk_error(ret);
+            for (j = 0; j < N; j++) {
+                children[j] = (tsk_id_t) j;
+            }
+        }
+    }
+    free(buffer);
+    /* Mark the final generation as samples */
+    for (j = 0; j < N; j++) {
+        tables->nodes.flags[j] = TSK_NODE_IS_SAMPLE;
+    }
+    bench_add_sites(tables, sites_per_tree);
+}
+
+void
+bench_get_tree_sequence(int argc, char **argv, tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_table_collection_t tables;
+
+    if (argc > 2) {
+        errx(EXIT_FAILURE, "usage: %s [input.trees]", argv[0]);
+    }
+    if (argc == 2) {
+        bench_source = argv[1];
+        ret = tsk_treeseq_load(ts, argv[1], 0);
+        check_tsk_error(ret);
+    } else {
+        ret = tsk_table_collection_init(&tables, 0);
+        check_tsk_error(ret);
+        bench_simulate(&tables, 1000, 1000, 2.0, 42);
+        ret = tsk_treeseq_init(ts, &tables, TSK_TS_INIT_BUILD_INDEXES);
+        check_tsk_error(ret);
+        tsk_table_collection_free(&tables);
+    }
+    /* Seed the workloads in the benchmarks themselves */
+    bench_random_seed(1234);
+}
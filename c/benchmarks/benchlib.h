@@ -0,0 +1,44 @@
+#ifndef TSK_BENCHLIB_H
+#define TSK_BENCHLIB_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <err.h>
+
+#include <tskit.h>
+
+#define check_tsk_error(val)                                                            \
+    if ((val) < 0) {                                                                    \
+        errx(EXIT_FAILURE, "line %d: %s", __LINE__, tsk_strerror((int) (val)));        \
+    }
+
+/* A benchmarked operation. Each call does some amount of work and sets
+ * num_ops to the number of operations it did, so that we can report the
+ * time per operation. Returns a tskit error code. */
+typedef int bench_func_t(void *params, tsk_size_t *num_ops);
+
+/* Repeatedly runs f until the minimum time has elapsed, and writes the
+ * results as a single line JSON object to stdout. */
+void bench_run(const char *name, bench_func_t *f, void *params);
+
+/* Loads the tree sequence in the file given as the single command line
+ * argument, or simulates the default deterministic workload if there is none. */
+void bench_get_tree_sequence(int argc, char **argv, tsk_treeseq_t *ts);
+
+/* Simulates a haploid Wright-Fisher population of size N for T generations,
+ * with sites added at the specified density. The output depends only on the
+ * parameters and the seed. */
+void bench_simulate(tsk_table_collection_t *tables, tsk_size_t N, tsk_size_t T,
+    double sites_per_tree, uint64_t seed);
+
+/* Returns the path of a newly created temporary file, which is removed when
+ * the program exits. */
+const char *bench_temp_file(void);
+
+/* Deterministic random numbers, independent of the C library. */
+void bench_random_seed(uint64_t seed);
+double bench_random_uniform(void);
+tsk_size_t bench_random_index(tsk_size_t n);
+
+#endif
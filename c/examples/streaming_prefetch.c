@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <tskit.h>
+
+#define check_tsk_error(val)                                                            \
+    if (val < 0) {                                                                      \
+        fprintf(stderr, "Error: line %d: %s\n", __LINE__, tsk_strerror(val));           \
+        exit(EXIT_FAILURE);                                                             \
+    }
+
+#define QUEUE_SIZE 4
+
+/* A bounded queue of table collections. The reader thread loads into the
+ * slots in order, and the main thread processes them in the same order,
+ * returning each slot to the reader when it's done with it. */
+typedef struct {
+    tsk_table_collection_t tables[QUEUE_SIZE];
+    /* The total number of collections loaded and processed */
+    unsigned long num_loaded;
+    unsigned long num_processed;
+    /* The return value of the final load, TSK_ERR_EOF at the end of the stream */
+    int load_ret;
+    FILE *file;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} queue_t;
+
+static void *
+reader_thread(void *arg)
+{
+    queue_t *queue = (queue_t *) arg;
+    tsk_table_collection_t *tables;
+    int ret = 0;
+
+    while (ret == 0) {
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->num_loaded - queue->num_processed == QUEUE_SIZE) {
+            pthread_cond_wait(&queue->cond, &queue->mutex);
+        }
+        tables = &queue->tables[queue->num_loaded % QUEUE_SIZE];
+        pthread_mutex_unlock(&queue->mutex);
+
+        /* The slot isn't visible to the main thread until we've incremented
+         * num_loaded, so we can load into it without holding the lock. We clear
+         * the previous contents first so that nothing is left over if the next
+         * store doesn't contain some of the optional items. */
+        ret = tsk_table_collection_clear(tables, TSK_CLEAR_METADATA_SCHEMAS
+                                                     | TSK_CLEAR_TS_METADATA_AND_SCHEMA
+                                                     | TSK_CLEAR_PROVENANCE);
+        if (ret == 0) {
+            ret = tsk_table_collection_loadf(tables, queue->file, TSK_NO_INIT);
+        }
+
+        pthread_mutex_lock(&queue->mutex);
+        if (ret == 0) {
+            queue->num_loaded++;
+        } else {
+            queue->load_ret = ret;
+        }
+        pthread_cond_signal(&queue->cond);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+    return NULL;
+}
+
+static void
+process_tables(tsk_table_collection_t *tables, unsigned long j)
+{
+    int ret;
+    tsk_treeseq_t ts;
+
+    ret = tsk_treeseq_init(&ts, tables, 0);
+    check_tsk_error(ret);
+    printf("Tree sequence %lu had %lld trees and %lld mutations\n", j,
+        (long long) tsk_treeseq_get_num_trees(&ts),
+        (long long) tsk_treeseq_get_num_mutations(&ts));
+    tsk_treeseq_free(&ts);
+}
+
+int
+main(void)
+{
+    int ret, j;
+    queue_t queue;
+    pthread_t thread;
+    tsk_table_collection_t *tables;
+
+    queue.num_loaded = 0;
+    queue.num_processed = 0;
+    queue.load_ret = 0;
+    queue.file = stdin;
+    for (j = 0; j < QUEUE_SIZE; j++) {
+        ret = tsk_table_collection_init(&queue.tables[j], 0);
+        check_tsk_error(ret);
+    }
+    if (pthread_mutex_init(&queue.mutex, NULL) != 0
+        || pthread_cond_init(&queue.cond, NULL) != 0
+        || pthread_create(&thread, NULL, reader_thread, &queue) != 0) {
+        fprintf(stderr, "Error: failed to start the reader thread\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (true) {
+        pthread_mutex_lock(&queue.mutex);
+        while (queue.num_processed == queue.num_loaded && queue.load_ret == 0) {
+            pthread_cond_wait(&queue.cond, &queue.mutex);
+        }
+        if (queue.num_processed == queue.num_loaded) {
+            /* The reader has stopped and we've processed everything it loaded */
+            pthread_mutex_unlock(&queue.mutex);
+            break;
+        }
+        tables = &queue.tables[queue.num_processed % QUEUE_SIZE];
+        pthread_mutex_unlock(&queue.mutex);
+
+        /* This overlaps with the reader loading later collections */
+        process_tables(tables, queue.num_processed);
+
+        pthread_mutex_lock(&queue.mutex);
+        queue.num_processed++;
+        pthread_cond_signal(&queue.cond);
+        pthread_mutex_unlock(&queue.mutex);
+    }
+    pthread_join(thread, NULL);
+    if (queue.load_ret != TSK_ERR_EOF) {
+        check_tsk_error(queue.load_ret);
+    }
+
+    for (j = 0; j < QUEUE_SIZE; j++) {
+        tsk_table_collection_free(&queue.tables[j]);
+    }
+    pthread_mutex_destroy(&queue.mutex);
+    pthread_cond_destroy(&queue.cond);
+    return EXIT_SUCCESS;
+}
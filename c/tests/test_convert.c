@@ -115,12 +115,184 @@ test_single_tree_newick_errors(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+verify_newick_treeseq(tsk_treeseq_t *ts, unsigned int precision, tsk_flags_t options)
+{
+    int ret;
+    tsk_tree_t t;
+    tsk_id_t root;
+    size_t buffer_size = 1024;
+    char newick[buffer_size];
+    char expected[8192];
+    char output[8192];
+    size_t expected_length = 0;
+    size_t output_length;
+    FILE *f;
+
+    ret = tsk_tree_init(&t, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (ret = tsk_tree_first(&t); ret == TSK_TREE_OK; ret = tsk_tree_next(&t)) {
+        for (root = tsk_tree_get_left_root(&t); root != TSK_NULL;
+             root = t.right_sib[root]) {
+            if (options & TSK_NEWICK_SPAN_PREFIX) {
+                expected_length += (size_t) snprintf(expected + expected_length,
+                    sizeof(expected) - expected_length, "[%.*f]", (int) precision,
+                    t.interval.right - t.interval.left);
+            }
+            ret = tsk_convert_newick(&t, root, precision, options, buffer_size, newick);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            expected_length += (size_t) snprintf(expected + expected_length,
+                sizeof(expected) - expected_length, "%s\n", newick);
+            CU_ASSERT_FATAL(expected_length < sizeof(expected));
+        }
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = tsk_convert_newick_treeseq(ts, precision, options, f);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    rewind(f);
+    output_length = fread(output, 1, sizeof(output), f);
+    CU_ASSERT_EQUAL_FATAL(output_length, expected_length);
+    CU_ASSERT_EQUAL(memcmp(output, expected, expected_length), 0);
+    fclose(f);
+
+    tsk_tree_free(&t);
+}
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t length;
+    int num_calls;
+    int fail_at;
+} newick_output_t;
+
+static int
+newick_output_write(const char *text, size_t length, void *params)
+{
+    newick_output_t *output = (newick_output_t *) params;
+
+    if (output->num_calls == output->fail_at) {
+        return -12345;
+    }
+    output->num_calls++;
+    CU_ASSERT_FATAL(output->length + length < output->size);
+    memcpy(output->buffer + output->length, text, length);
+    output->length += length;
+    output->buffer[output->length] = '\0';
+    return 0;
+}
+
+static void
+test_newick_trees_range(void)
+{
+    int ret;
+    tsk_treeseq_t ts;
+    tsk_id_t j, num_trees;
+    char whole[8192];
+    char parts[8192];
+    newick_output_t whole_output = { whole, sizeof(whole), 0, 0, -1 };
+    newick_output_t parts_output = { parts, sizeof(parts), 0, 0, -1 };
+    newick_output_t fail_output = { parts, sizeof(parts), 0, 0, 1 };
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, NULL, NULL,
+        paper_ex_individuals, NULL, 0);
+    num_trees = (tsk_id_t) tsk_treeseq_get_num_trees(&ts);
+    CU_ASSERT_FATAL(num_trees > 1);
+
+    ret = tsk_convert_newick_trees(&ts, 0, num_trees, 3, TSK_NEWICK_SPAN_PREFIX,
+        newick_output_write, &whole_output);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(whole_output.num_calls, num_trees);
+
+    /* Converting each tree separately gives the same output */
+    for (j = 0; j < num_trees; j++) {
+        ret = tsk_convert_newick_trees(&ts, j, j + 1, 3, TSK_NEWICK_SPAN_PREFIX,
+            newick_output_write, &parts_output);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+    CU_ASSERT_STRING_EQUAL(whole, parts);
+
+    /* Empty ranges produce no output */
+    ret = tsk_convert_newick_trees(&ts, 1, 1, 3, 0, newick_output_write, &fail_output);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(fail_output.num_calls, 0);
+
+    /* Errors from the write function are returned */
+    ret = tsk_convert_newick_trees(
+        &ts, 0, num_trees, 3, 0, newick_output_write, &fail_output);
+    CU_ASSERT_EQUAL_FATAL(ret, -12345);
+    CU_ASSERT_EQUAL(fail_output.num_calls, 1);
+
+    ret = tsk_convert_newick_trees(&ts, -1, 1, 3, 0, newick_output_write, &parts_output);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_convert_newick_trees(
+        &ts, 0, num_trees + 1, 3, 0, newick_output_write, &parts_output);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_convert_newick_trees(&ts, 2, 1, 3, 0, newick_output_write, &parts_output);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    tsk_treeseq_free(&ts);
+}
+
+static void
+test_newick_treeseq(void)
+{
+    int ret;
+    tsk_treeseq_t ts;
+    FILE *f;
+    char output[1024];
+    size_t output_length;
+
+    tsk_treeseq_from_text(&ts, 1, multiple_tree_ex_nodes, multiple_tree_ex_edges, NULL,
+        NULL, NULL, NULL, NULL, 0);
+    verify_newick_treeseq(&ts, 0, 0);
+    verify_newick_treeseq(&ts, 3, 0);
+    verify_newick_treeseq(&ts, 12, TSK_NEWICK_LEGACY_MS_LABELS);
+    verify_newick_treeseq(&ts, 2, TSK_NEWICK_SPAN_PREFIX | TSK_NEWICK_LEGACY_MS_LABELS);
+
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = tsk_convert_newick_treeseq(
+        &ts, 2, TSK_NEWICK_SPAN_PREFIX | TSK_NEWICK_LEGACY_MS_LABELS, f);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    rewind(f);
+    output_length = fread(output, 1, sizeof(output) - 1, f);
+    output[output_length] = '\0';
+    CU_ASSERT_STRING_EQUAL(output, "[0.75](3:4.00,(1:2.00,2:2.00):2.00);\n"
+                                   "[0.25](1:3.00,(2:1.00,3:1.00):2.00);\n");
+    fclose(f);
+
+    /* Writing to a read-only stream fails */
+    f = fopen(_tmp_file_name, "r");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = tsk_convert_newick_treeseq(&ts, 0, 0, f);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IO);
+    fclose(f);
+    tsk_treeseq_free(&ts);
+
+    tsk_treeseq_from_text(&ts, 10, multiroot_ex_nodes, multiroot_ex_edges, NULL, NULL,
+        NULL, NULL, NULL, 0);
+    verify_newick_treeseq(&ts, 1, 0);
+    verify_newick_treeseq(&ts, 4, TSK_NEWICK_SPAN_PREFIX);
+    tsk_treeseq_free(&ts);
+
+    tsk_treeseq_from_text(
+        &ts, 10, unary_ex_nodes, unary_ex_edges, NULL, NULL, NULL, NULL, NULL, 0);
+    verify_newick_treeseq(&ts, 5, 0);
+    tsk_treeseq_free(&ts);
+}
+
 int
 main(int argc, char **argv)
 {
     CU_TestInfo tests[] = {
         { "test_single_tree_newick", test_single_tree_newick },
         { "test_single_tree_newick_errors", test_single_tree_newick_errors },
+        { "test_newick_treeseq", test_newick_treeseq },
+        { "test_newick_trees_range", test_newick_trees_range },
         { NULL, NULL },
     };
     return test_main(tests, argc, argv);
@@ -388,6 +388,71 @@ test_debug_stream(void)
     fclose(f);
 }
 
+static void
+test_counters(void)
+{
+    int ret;
+    tsk_counters_t counters;
+    tsk_treeseq_t ts, loaded;
+    tsk_tree_t tree;
+    tsk_blkalloc_t alloc;
+    tsk_size_t num_trees = 0;
+    tsk_size_t sample_set_size = 4;
+    double pi;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL,
+        paper_ex_sites, paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    tsk_reset_counters();
+
+    ret = tsk_tree_init(&tree, &ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (ret = tsk_tree_first(&tree); ret == TSK_TREE_OK; ret = tsk_tree_next(&tree)) {
+        num_trees++;
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_tree_free(&tree);
+    ret = tsk_blkalloc_init(&alloc, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FATAL(tsk_blkalloc_get(&alloc, 1) != NULL);
+    CU_ASSERT_FATAL(tsk_blkalloc_get(&alloc, 1) != NULL);
+    tsk_blkalloc_free(&alloc);
+    ret = tsk_treeseq_diversity(&ts, 1, &sample_set_size, ts.samples, 0, NULL, 0, &pi);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_dump(&ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_load(&loaded, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_treeseq_free(&loaded);
+
+    ret = tsk_get_counters(&counters);
+#ifdef TSK_INSTRUMENT
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(counters.edges_inserted, tsk_treeseq_get_num_edges(&ts));
+    CU_ASSERT_TRUE(counters.edges_removed > 0);
+    CU_ASSERT_TRUE(counters.edges_removed < counters.edges_inserted);
+    CU_ASSERT_EQUAL(counters.trees_visited, num_trees);
+    CU_ASSERT_TRUE(counters.summary_func_calls > 0);
+    CU_ASSERT_EQUAL(counters.blkalloc_chunks, 2);
+    CU_ASSERT_TRUE(counters.bytes_written > 0);
+    CU_ASSERT_EQUAL(counters.bytes_read, counters.bytes_written);
+    CU_ASSERT_TRUE(counters.load_time >= 0);
+    CU_ASSERT_TRUE(counters.dump_time >= 0);
+    CU_ASSERT_TRUE(counters.stats_time >= 0);
+#else
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_OPERATION);
+    CU_ASSERT_EQUAL(counters.edges_inserted, 0);
+    CU_ASSERT_EQUAL(counters.trees_visited, 0);
+    CU_ASSERT_EQUAL(counters.bytes_written, 0);
+#endif
+
+    tsk_reset_counters();
+    tsk_get_counters(&counters);
+    CU_ASSERT_EQUAL(counters.edges_inserted, 0);
+    CU_ASSERT_EQUAL(counters.bytes_read, 0);
+    CU_ASSERT_EQUAL(counters.load_time, 0);
+    tsk_treeseq_free(&ts);
+}
+
 static int
 validate_avl_node(tsk_avl_node_int_t *node)
 {
@@ -529,63 +594,67 @@ test_avl_random(void)
 static void
 test_bit_arrays(void)
 {
-    // NB: This test is only valid for the 32 bit implementation of bit arrays. If we
+    // NB: This test is only valid for the 64 bit implementation of bit arrays. If we
     //     were to change the chunk size of a bit array, we'd need to update these tests
     tsk_bit_array_t arr;
     tsk_bit_array_init(&arr, 90, 1);
+    CU_ASSERT_EQUAL_FATAL(arr.size, 2);
     for (tsk_bit_array_value_t i = 0; i < 20; i++) {
         tsk_bit_array_add_bit(&arr, i);
     }
     tsk_bit_array_add_bit(&arr, 63);
     tsk_bit_array_add_bit(&arr, 65);
 
-    // these assertions are only valid for 32-bit values
-    CU_ASSERT_EQUAL_FATAL(arr.data[0], 1048575);
-    CU_ASSERT_EQUAL_FATAL(arr.data[1], 2147483648);
-    CU_ASSERT_EQUAL_FATAL(arr.data[2], 2);
+    // these assertions are only valid for 64-bit values
+    CU_ASSERT_EQUAL_FATAL(arr.data[0], 9223372036855824383ULL);
+    CU_ASSERT_EQUAL_FATAL(arr.data[1], 2);
 
     // verify our assumptions about bit array counting
     CU_ASSERT_EQUAL_FATAL(tsk_bit_array_count(&arr), 22);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_intersect_count(&arr, &arr), 22);
 
     tsk_bit_array_free(&arr);
 
-    // create a length-2 array with 64 bit capacity
-    tsk_bit_array_init(&arr, 64, 2);
+    // create a length-2 array with 128 bit capacity
+    tsk_bit_array_init(&arr, 128, 2);
     tsk_bit_array_t arr_row1, arr_row2;
 
     // select the first and second row
     tsk_bit_array_get_row(&arr, 0, &arr_row1);
     tsk_bit_array_get_row(&arr, 1, &arr_row2);
 
-    // fill the first 50 bits of the first row
-    for (tsk_bit_array_value_t i = 0; i < 50; i++) {
+    // fill the first 80 bits of the first row
+    for (tsk_bit_array_value_t i = 0; i < 80; i++) {
         tsk_bit_array_add_bit(&arr_row1, i);
     }
-    // fill bits 20-40 of the second row
-    for (tsk_bit_array_value_t i = 20; i < 40; i++) {
+    // fill bits 50-70 of the second row
+    for (tsk_bit_array_value_t i = 50; i < 70; i++) {
         tsk_bit_array_add_bit(&arr_row2, i);
     }
 
     // verify our assumptions about row selection
-    CU_ASSERT_EQUAL_FATAL(arr.data[0], 4294967295);
-    CU_ASSERT_EQUAL_FATAL(arr.data[1], 262143);
-    CU_ASSERT_EQUAL_FATAL(arr_row1.data[0], 4294967295);
-    CU_ASSERT_EQUAL_FATAL(arr_row1.data[1], 262143);
+    CU_ASSERT_EQUAL_FATAL(arr.data[0], 18446744073709551615ULL);
+    CU_ASSERT_EQUAL_FATAL(arr.data[1], 65535);
+    CU_ASSERT_EQUAL_FATAL(arr_row1.data[0], 18446744073709551615ULL);
+    CU_ASSERT_EQUAL_FATAL(arr_row1.data[1], 65535);
 
-    CU_ASSERT_EQUAL_FATAL(arr.data[2], 4293918720);
-    CU_ASSERT_EQUAL_FATAL(arr.data[3], 255);
-    CU_ASSERT_EQUAL_FATAL(arr_row2.data[0], 4293918720);
-    CU_ASSERT_EQUAL_FATAL(arr_row2.data[1], 255);
+    CU_ASSERT_EQUAL_FATAL(arr.data[2], 18445618173802708992ULL);
+    CU_ASSERT_EQUAL_FATAL(arr.data[3], 63);
+    CU_ASSERT_EQUAL_FATAL(arr_row2.data[0], 18445618173802708992ULL);
+    CU_ASSERT_EQUAL_FATAL(arr_row2.data[1], 63);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_intersect_count(&arr_row1, &arr_row2), 20);
 
     // subtract the second from the first row, store in first
     tsk_bit_array_subtract(&arr_row1, &arr_row2);
 
     // verify our assumptions about subtraction
-    CU_ASSERT_EQUAL_FATAL(arr_row1.data[0], 1048575);
-    CU_ASSERT_EQUAL_FATAL(arr_row1.data[1], 261888);
+    CU_ASSERT_EQUAL_FATAL(arr_row1.data[0], 1125899906842623ULL);
+    CU_ASSERT_EQUAL_FATAL(arr_row1.data[1], 65472);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_count(&arr_row1), 60);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_intersect_count(&arr_row1, &arr_row2), 0);
 
     tsk_bit_array_t int_result;
-    tsk_bit_array_init(&int_result, 64, 1);
+    tsk_bit_array_init(&int_result, 128, 1);
 
     // their intersection should be zero
     tsk_bit_array_intersect(&arr_row1, &arr_row2, &int_result);
@@ -595,15 +664,52 @@ test_bit_arrays(void)
     // now, add them back together, storing back in a
     tsk_bit_array_add(&arr_row1, &arr_row2);
 
-    // now, their intersection should be the subtracted chunk (20-40)
+    // now, their intersection should be the subtracted chunk (50-70)
     tsk_bit_array_intersect(&arr_row1, &arr_row2, &int_result);
-    CU_ASSERT_EQUAL_FATAL(int_result.data[0], 4293918720);
-    CU_ASSERT_EQUAL_FATAL(int_result.data[1], 255);
+    CU_ASSERT_EQUAL_FATAL(int_result.data[0], 18445618173802708992ULL);
+    CU_ASSERT_EQUAL_FATAL(int_result.data[1], 63);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_count(&int_result), 20);
 
     tsk_bit_array_free(&int_result);
     tsk_bit_array_free(&arr);
 }
 
+static void
+test_bit_array_count(void)
+{
+    tsk_bit_array_t a, b;
+    tsk_size_t num_bits = 1000;
+    tsk_size_t j, count_a, count_b, count_ab;
+
+    tsk_bit_array_init(&a, num_bits, 1);
+    tsk_bit_array_init(&b, num_bits, 1);
+    count_a = 0;
+    count_b = 0;
+    count_ab = 0;
+    for (j = 0; j < num_bits; j++) {
+        if (j % 3 == 0) {
+            tsk_bit_array_add_bit(&a, (tsk_bit_array_value_t) j);
+            count_a++;
+        }
+        if (j % 7 == 0 || j % 11 == 0) {
+            tsk_bit_array_add_bit(&b, (tsk_bit_array_value_t) j);
+            count_b++;
+            count_ab += j % 3 == 0;
+        }
+    }
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_count(&a), count_a);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_count(&b), count_b);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_intersect_count(&a, &b), count_ab);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_intersect_count(&b, &a), count_ab);
+
+    tsk_memset(a.data, 0xff, a.size * sizeof(*a.data));
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_count(&a), a.size * TSK_BIT_ARRAY_NUM_BITS);
+    CU_ASSERT_EQUAL_FATAL(tsk_bit_array_intersect_count(&a, &b), count_b);
+
+    tsk_bit_array_free(&a);
+    tsk_bit_array_free(&b);
+}
+
 static void
 test_meson_version(void)
 {
@@ -628,11 +734,13 @@ main(int argc, char **argv)
         { "test_malloc_zero", test_malloc_zero },
         { "test_malloc_overflow", test_malloc_overflow },
         { "test_debug_stream", test_debug_stream },
+        { "test_counters", test_counters },
         { "test_avl_empty", test_avl_empty },
         { "test_avl_sequential", test_avl_sequential },
         { "test_avl_interleaved", test_avl_interleaved },
         { "test_avl_random", test_avl_random },
         { "test_bit_arrays", test_bit_arrays },
+        { "test_bit_array_count", test_bit_array_count },
         { "test_meson_version", test_meson_version },
         { NULL, NULL },
     };
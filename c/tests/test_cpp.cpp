@@ -0,0 +1,391 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Tskit Developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Tests for the header-only C++ interface in tskit.hpp */
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include <tskit.hpp>
+
+using namespace std;
+
+/* Two trees over [0, 10) with four samples:
+ *
+ *       6          6
+ *     /   \      /   \
+ *    4     5    4     5
+ *   / \   / \  / \   / \
+ *  0   1 2   3 0  2 1   3
+ */
+static tskit::tree_sequence
+make_tree_sequence()
+{
+    tskit::table_collection tables(10);
+    tsk_table_collection_t *t = tables.get();
+    int j;
+
+    for (j = 0; j < 4; j++) {
+        tskit::check(tsk_node_table_add_row(
+            &t->nodes, TSK_NODE_IS_SAMPLE, 0, TSK_NULL, TSK_NULL, NULL, 0));
+    }
+    for (j = 1; j <= 3; j++) {
+        tskit::check(
+            tsk_node_table_add_row(&t->nodes, 0, j, TSK_NULL, TSK_NULL, NULL, 0));
+    }
+    tskit::check(tsk_edge_table_add_row(&t->edges, 0, 10, 4, 0, NULL, 0));
+    tskit::check(tsk_edge_table_add_row(&t->edges, 0, 5, 4, 1, NULL, 0));
+    tskit::check(tsk_edge_table_add_row(&t->edges, 5, 10, 4, 2, NULL, 0));
+    tskit::check(tsk_edge_table_add_row(&t->edges, 0, 5, 5, 2, NULL, 0));
+    tskit::check(tsk_edge_table_add_row(&t->edges, 5, 10, 5, 1, NULL, 0));
+    tskit::check(tsk_edge_table_add_row(&t->edges, 0, 10, 5, 3, NULL, 0));
+    tskit::check(tsk_edge_table_add_row(&t->edges, 0, 10, 6, 4, NULL, 0));
+    tskit::check(tsk_edge_table_add_row(&t->edges, 0, 10, 6, 5, NULL, 0));
+    tskit::check(tsk_site_table_add_row(&t->sites, 1, "A", 1, NULL, 0));
+    tskit::check(tsk_site_table_add_row(&t->sites, 7, "A", 1, NULL, 0));
+    tskit::check(tsk_mutation_table_add_row(
+        &t->mutations, 0, 0, TSK_NULL, TSK_UNKNOWN_TIME, "T", 1, NULL, 0));
+    tskit::check(tsk_mutation_table_add_row(
+        &t->mutations, 1, 5, TSK_NULL, TSK_UNKNOWN_TIME, "G", 1, NULL, 0));
+    tables.sort();
+    return tskit::tree_sequence(std::move(tables));
+}
+
+static void
+test_load_error()
+{
+    std::cout << "test_load_error" << endl;
+    bool raised = false;
+    try {
+        tskit::tree_sequence::load("no such file");
+    } catch (const tskit::error &e) {
+        raised = true;
+        assert(e.code() == TSK_ERR_IO);
+        assert(string(e.what()) == string(tsk_strerror(TSK_ERR_IO)));
+    }
+    assert(raised);
+}
+
+static void
+test_move()
+{
+    std::cout << "test_move" << endl;
+    tskit::tree_sequence ts = make_tree_sequence();
+    const tsk_treeseq_t *c_ts = ts.get();
+    tskit::tree_sequence other(std::move(ts));
+    assert(other.get() == c_ts);
+    assert(ts.get() == NULL);
+
+    tskit::tree tree(other);
+    tskit::tree moved = std::move(tree);
+    assert(moved.first());
+    assert(moved.index() == 0);
+}
+
+static void
+test_columns()
+{
+    std::cout << "test_columns" << endl;
+    tskit::tree_sequence ts = make_tree_sequence();
+    const tsk_table_collection_t &tables = ts.tables();
+    double total = 0;
+    size_t j = 0;
+
+    assert(ts.num_nodes() == 7);
+    assert(ts.num_edges() == 8);
+    assert(ts.num_samples() == 4);
+    assert(ts.samples().size() == 4);
+    for (tsk_id_t u : ts.samples()) {
+        assert(u == (tsk_id_t) j);
+        j++;
+    }
+    assert(ts.node_time().size() == tables.nodes.num_rows);
+    assert(ts.node_time().data() == tables.nodes.time);
+    for (double t : ts.node_time()) {
+        total += t;
+    }
+    assert(total == 6);
+    assert(ts.edge_parent().size() == 8);
+    assert(ts.edge_child()[0] == tables.edges.child[0]);
+    assert(ts.site_position()[1] == 7);
+    assert(ts.mutation_node()[1] == 5);
+    assert(ts.breakpoints().size() == 3);
+    assert(ts.breakpoints()[1] == 5);
+}
+
+static void
+test_trees()
+{
+    std::cout << "test_trees" << endl;
+    tskit::tree_sequence ts = make_tree_sequence();
+    tsk_tree_t c_tree;
+    tsk_id_t *nodes = (tsk_id_t *) malloc(ts.num_nodes() * sizeof(*nodes));
+    tsk_size_t num_nodes, j;
+    vector<tsk_id_t> children;
+    int ret, index = 0;
+
+    assert(nodes != NULL);
+    ret = tsk_tree_init(&c_tree, ts.get(), 0);
+    assert(ret == 0);
+    ret = tsk_tree_first(&c_tree);
+    for (const tskit::tree &tree : ts.trees()) {
+        assert(ret == TSK_TREE_OK);
+        assert(tree.index() == index);
+        assert(tree.left() == c_tree.interval.left);
+        assert(tree.right() == c_tree.interval.right);
+        assert(tree.num_roots() == 1);
+        for (tsk_id_t root : tree.roots()) {
+            assert(root == 6);
+        }
+
+        ret = tsk_tree_preorder(&c_tree, nodes, &num_nodes);
+        assert(ret == 0);
+        assert(num_nodes == 7);
+        j = 0;
+        for (tsk_id_t u : tree.preorder()) {
+            assert(u == nodes[j]);
+            j++;
+        }
+        assert(j == num_nodes);
+
+        ret = tsk_tree_preorder_from(&c_tree, 4, nodes, &num_nodes);
+        assert(ret == 0);
+        j = 0;
+        for (tsk_id_t u : tree.preorder(4)) {
+            assert(u == nodes[j]);
+            j++;
+        }
+        assert(j == num_nodes);
+
+        children.clear();
+        for (tsk_id_t u : tree.children(4)) {
+            assert(tree.parent(u) == 4);
+            children.push_back(u);
+        }
+        assert(children.size() == 2);
+        assert(children[0] == 0);
+        assert(children[1] == (index == 0 ? 1 : 2));
+        for (tsk_id_t u : tree.children(0)) {
+            (void) u;
+            assert(false);
+        }
+
+        index++;
+        ret = tsk_tree_next(&c_tree);
+    }
+    assert(ret == 0);
+    assert(index == 2);
+
+    tskit::tree tree(ts);
+    assert(tree.last());
+    assert(tree.index() == 1);
+    assert(tree.prev());
+    assert(tree.index() == 0);
+    assert(!tree.prev());
+    tree.seek(7);
+    assert(tree.index() == 1);
+    assert(tree.left() == 5);
+    assert(tree.span() == 5);
+
+    tsk_tree_free(&c_tree);
+    free(nodes);
+}
+
+static void
+test_variants()
+{
+    std::cout << "test_variants" << endl;
+    tskit::tree_sequence ts = make_tree_sequence();
+    int32_t genotypes[2][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 1 } };
+    const char *derived[2] = { "T", "G" };
+    size_t j = 0;
+    size_t k;
+
+    for (const tskit::variant &var : ts.variants()) {
+        assert(var.site().id == (tsk_id_t) j);
+        assert(var.num_alleles() == 2);
+        assert(var.allele(0) == "A");
+        assert(var.allele(1) == derived[j]);
+        assert(!var.has_missing_data());
+        assert(var.genotypes().size() == 4);
+        k = 0;
+        for (int32_t g : var.genotypes()) {
+            assert(g == genotypes[j][k]);
+            k++;
+        }
+        j++;
+    }
+    assert(j == 2);
+}
+
+static void
+test_edge_diffs()
+{
+    std::cout << "test_edge_diffs" << endl;
+    tskit::tree_sequence ts = make_tree_sequence();
+    size_t num_in[2] = { 6, 2 };
+    size_t num_out[2] = { 0, 2 };
+    size_t j = 0;
+    size_t n;
+
+    for (const tskit::edge_diff &diff : ts.edge_diffs()) {
+        assert(diff.left == ts.breakpoints()[j]);
+        assert(diff.right == ts.breakpoints()[j + 1]);
+        n = 0;
+        for (const tsk_edge_t &edge : diff.inserted()) {
+            assert(edge.left == diff.left);
+            n++;
+        }
+        assert(n == num_in[j]);
+        n = 0;
+        for (const tsk_edge_t &edge : diff.removed()) {
+            assert(edge.right == diff.left);
+            n++;
+        }
+        assert(n == num_out[j]);
+        j++;
+    }
+    assert(j == 2);
+}
+
+static int
+c_summary_func(tsk_size_t state_dim, const double *state, tsk_size_t result_dim,
+    double *result, void *params)
+{
+    (void) state_dim;
+    (void) result_dim;
+    (void) params;
+    result[0] = state[0] * (4 - state[0]);
+    result[1] = state[1] > 0;
+    return 0;
+}
+
+static void
+verify_general_stat(const tskit::tree_sequence &ts, const vector<double> &windows,
+    tsk_flags_t options)
+{
+    vector<double> weights = { 1, 1, 1, 0, 1, 1, 1, 0 };
+    size_t num_windows = windows.empty() ? 1 : windows.size() - 1;
+    vector<double> c_result(num_windows * 2);
+    vector<double> result;
+    size_t j;
+    int ret;
+
+    ret = tsk_treeseq_general_stat(ts.get(), 2, weights.data(), 2, c_summary_func, NULL,
+        windows.empty() ? 0 : num_windows, windows.empty() ? NULL : windows.data(),
+        options, c_result.data());
+    assert(ret == 0);
+    result = tskit::general_stat(
+        ts, 2, weights, 2,
+        [](const double *state, double *out) {
+            out[0] = state[0] * (4 - state[0]);
+            out[1] = state[1] > 0;
+        },
+        windows, options);
+    assert(result.size() == c_result.size());
+    for (j = 0; j < result.size(); j++) {
+        assert(fabs(result[j] - c_result[j]) < 1e-12);
+    }
+}
+
+static void
+test_general_stat()
+{
+    std::cout << "test_general_stat" << endl;
+    tskit::tree_sequence ts = make_tree_sequence();
+    vector<vector<double>> windows = { {}, { 0, 10 }, { 0, 2, 5, 7.5, 10 }, { 3, 6 } };
+    tsk_flags_t options[]
+        = { TSK_STAT_BRANCH, TSK_STAT_BRANCH | TSK_STAT_POLARISED,
+              TSK_STAT_BRANCH | TSK_STAT_SPAN_NORMALISE, TSK_STAT_SITE,
+              TSK_STAT_SITE | TSK_STAT_POLARISED | TSK_STAT_SPAN_NORMALISE };
+
+    for (const vector<double> &w : windows) {
+        for (tsk_flags_t o : options) {
+            verify_general_stat(ts, w, o);
+        }
+    }
+}
+
+static void
+test_general_stat_errors()
+{
+    std::cout << "test_general_stat_errors" << endl;
+    tskit::tree_sequence ts = make_tree_sequence();
+    vector<double> weights(4, 1.0);
+    auto f = [](const double *state, double *out) { out[0] = state[0]; };
+    bool raised;
+
+    raised = false;
+    try {
+        tskit::general_stat(ts, 1, weights, 1, f, { 0, 11 }, TSK_STAT_BRANCH);
+    } catch (const tskit::error &e) {
+        raised = e.code() == TSK_ERR_BAD_WINDOWS;
+    }
+    assert(raised);
+
+    raised = false;
+    try {
+        tskit::general_stat(ts, 2, weights, 1, f, {}, TSK_STAT_BRANCH);
+    } catch (const tskit::error &e) {
+        raised = e.code() == TSK_ERR_BAD_PARAM_VALUE;
+    }
+    assert(raised);
+
+    raised = false;
+    try {
+        tskit::general_stat(ts, 1, weights, 0, f, {}, TSK_STAT_BRANCH);
+    } catch (const tskit::error &e) {
+        raised = e.code() == TSK_ERR_BAD_RESULT_DIMS;
+    }
+    assert(raised);
+
+    /* Exceptions thrown by the summary function pass through the C code */
+    raised = false;
+    try {
+        tskit::general_stat(
+            ts, 1, weights, 1,
+            [](const double *, double *) { throw std::logic_error("summary"); }, {},
+            TSK_STAT_SITE);
+    } catch (const std::logic_error &e) {
+        raised = string(e.what()) == "summary";
+    }
+    assert(raised);
+}
+
+int
+main()
+{
+    test_load_error();
+    test_move();
+    test_columns();
+    test_trees();
+    test_variants();
+    test_edge_diffs();
+    test_general_stat();
+    test_general_stat_errors();
+    return 0;
+}
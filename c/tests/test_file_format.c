@@ -518,6 +518,139 @@ test_force_offset_64(void)
     free(ts);
 }
 
+static void
+verify_bad_compressed_offset_column(
+    tsk_treeseq_t *ts, const uint8_t *data, size_t len, int expected)
+{
+    int ret;
+    kastore_t store;
+    tsk_table_collection_t tables;
+    const char *offset_col = "nodes/metadata_offset";
+
+    copy_store_drop_columns(ts, 1, &offset_col, _tmp_file_name);
+    ret = kastore_open(&store, _tmp_file_name, "a", 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_puts(&store, offset_col, data, len, KAS_UINT8, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = kastore_close(&store);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&tables, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, expected);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+test_compress_offsets(void)
+{
+    int ret;
+    tsk_treeseq_t *ts = caterpillar_tree(5, 3, 3);
+    tsk_table_collection_t t1, t2;
+    kastore_t store;
+    kaitem_t *item;
+    const char *suffix;
+    const char *offset_str = "_offset";
+    char metadata[1000];
+    uint8_t bad_data[16];
+    size_t j, version_len, size_32 = 0, size_compressed = 0;
+    uint32_t *version;
+    tsk_size_t num_nodes = tsk_treeseq_get_num_nodes(ts);
+
+    ret = tsk_treeseq_copy_tables(ts, &t1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    /* Long metadata gives offset differences that need several bytes */
+    tsk_memset(metadata, 'x', sizeof(metadata));
+    ret = tsk_population_table_add_row(&t1.populations, metadata, sizeof(metadata));
+    CU_ASSERT_FATAL(ret >= 0);
+    ret = tsk_population_table_add_row(&t1.populations, metadata, 150);
+    CU_ASSERT_FATAL(ret >= 0);
+    ret = tsk_population_table_add_row(&t1.populations, NULL, 0);
+    CU_ASSERT_FATAL(ret >= 0);
+
+    for (j = 0; j < 2; j++) {
+        ret = tsk_table_collection_dump(
+            &t1, _tmp_file_name, j == 0 ? 0 : TSK_DUMP_COMPRESS_OFFSETS);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = kastore_open(&store, _tmp_file_name, "r", 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = kastore_gets_uint32(&store, "format/version", &version, &version_len);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(version_len, 2);
+        CU_ASSERT_EQUAL(version[0], TSK_FILE_FORMAT_VERSION_MAJOR);
+        CU_ASSERT_EQUAL(version[1],
+            j == 0 ? TSK_FILE_FORMAT_VERSION_MINOR
+                   : TSK_FILE_FORMAT_VERSION_MINOR_COMPRESSED_OFFSETS);
+        for (item = store.items; item < store.items + store.num_items; item++) {
+            if (item->key_len > strlen(offset_str)) {
+                suffix = item->key + (item->key_len - strlen(offset_str));
+                if (strncmp(suffix, offset_str, strlen(offset_str)) == 0) {
+                    if (j == 0) {
+                        CU_ASSERT_EQUAL(item->type, KAS_UINT32);
+                        size_32 += item->array_len * sizeof(uint32_t);
+                    } else {
+                        CU_ASSERT_EQUAL(item->type, KAS_UINT8);
+                        size_compressed += item->array_len;
+                    }
+                }
+            }
+        }
+        kastore_close(&store);
+
+        ret = tsk_table_collection_load(&t2, _tmp_file_name, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+        tsk_table_collection_free(&t2);
+
+        ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+        tsk_table_collection_free(&t2);
+
+        /* The population table only has ragged columns */
+        ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_SKIP_METADATA);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(t2.populations.num_rows, t1.populations.num_rows);
+        CU_ASSERT_EQUAL(t2.populations.metadata_length, 0);
+        tsk_table_collection_free(&t2);
+    }
+    CU_ASSERT_TRUE(size_compressed > 0);
+    CU_ASSERT_TRUE(size_compressed < size_32 / 3);
+
+    ret = tsk_table_collection_dump(
+        &t1, _tmp_file_name, TSK_DUMP_COMPRESS_OFFSETS | TSK_DUMP_FORCE_OFFSET_64);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    tsk_table_collection_free(&t2);
+
+    tsk_memset(bad_data, 0, sizeof(bad_data));
+    CU_ASSERT_FATAL(num_nodes + 1 <= sizeof(bad_data));
+    verify_bad_compressed_offset_column(ts, bad_data, 0, TSK_ERR_FILE_FORMAT);
+    verify_bad_compressed_offset_column(ts, bad_data, num_nodes, TSK_ERR_FILE_FORMAT);
+    /* Offsets must finish at the end of the metadata */
+    verify_bad_compressed_offset_column(ts, bad_data, num_nodes + 1, TSK_ERR_BAD_OFFSET);
+    /* Truncated varint */
+    bad_data[1] = 0x80;
+    verify_bad_compressed_offset_column(ts, bad_data, 2, TSK_ERR_FILE_FORMAT);
+    /* Varint that is too long */
+    tsk_memset(bad_data, 0x80, sizeof(bad_data));
+    bad_data[sizeof(bad_data) - 1] = 0;
+    verify_bad_compressed_offset_column(
+        ts, bad_data, sizeof(bad_data), TSK_ERR_FILE_FORMAT);
+    /* Offsets that overflow */
+    tsk_memset(bad_data, 0xFF, sizeof(bad_data));
+    bad_data[9] = 0x01;
+    bad_data[10] = 0x01;
+    verify_bad_compressed_offset_column(ts, bad_data, 11, TSK_ERR_BAD_OFFSET);
+    /* Varint with bits beyond 64 */
+    bad_data[9] = 0x02;
+    verify_bad_compressed_offset_column(ts, bad_data, 10, TSK_ERR_FILE_FORMAT);
+
+    tsk_table_collection_free(&t1);
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
 static void
 test_missing_indexes(void)
 {
@@ -1399,6 +1532,367 @@ test_skip_reference_sequence(void)
     free(ts1);
 }
 
+static void
+test_load_mmap(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_size_t j;
+    tsk_bookmark_t reserve = { .nodes = 100, .edges = 100, .mutations = 100 };
+    tsk_treeseq_t *ts1 = caterpillar_tree(5, 3, 3);
+    tsk_treeseq_t ts2;
+    tsk_table_collection_t t1, t2;
+    tsk_table_collection_t *tables;
+    tsk_flags_t dump_flags[]
+        = { 0, TSK_DUMP_FORCE_OFFSET_64, TSK_DUMP_COMPRESS_OFFSETS };
+    int fds[2];
+    FILE *f;
+
+    ret = tsk_treeseq_copy_tables(ts1, &t1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < 3; j++) {
+        ret = tsk_table_collection_dump(&t1, _tmp_file_name, dump_flags[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+        /* Columns point directly into the mapping */
+        CU_ASSERT_FATAL(t2.file_map.addr != NULL);
+        CU_ASSERT_TRUE((char *) t2.edges.left > (char *) t2.file_map.addr);
+        CU_ASSERT_TRUE((char *) t2.edges.left
+                       < (char *) t2.file_map.addr + t2.file_map.size);
+        /* Cannot load over the top of a mapped table collection */
+        ret = tsk_table_collection_load(
+            &t2, _tmp_file_name, TSK_LOAD_MMAP | TSK_NO_INIT);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+        tsk_table_collection_free(&t2);
+        CU_ASSERT_EQUAL(t2.file_map.addr, NULL);
+    }
+
+    /* Combine with the other load options */
+    ret = tsk_table_collection_load(
+        &t2, _tmp_file_name, TSK_LOAD_MMAP | TSK_LOAD_SKIP_TABLES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, TSK_CMP_IGNORE_TABLES));
+    CU_ASSERT_EQUAL(t2.nodes.num_rows, 0);
+    tsk_table_collection_free(&t2);
+    ret = tsk_table_collection_load(
+        &t2, _tmp_file_name, TSK_LOAD_MMAP | TSK_LOAD_SKIP_REFERENCE_SEQUENCE);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(
+        &t1, &t2, TSK_CMP_IGNORE_REFERENCE_SEQUENCE));
+    CU_ASSERT_FALSE(tsk_table_collection_has_reference_sequence(&t2));
+    tsk_table_collection_free(&t2);
+
+    /* The mapped tables can be owned by a tree sequence */
+    ret = tsk_treeseq_load(&ts2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts2.tables, 0));
+    CU_ASSERT_EQUAL(tsk_treeseq_get_num_trees(&ts2), tsk_treeseq_get_num_trees(ts1));
+    tsk_treeseq_free(&ts2);
+
+    /* Indexes can be rebuilt on mapped tables */
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_drop_index(&t2, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FALSE(tsk_table_collection_has_index(&t2, 0));
+    ret = tsk_table_collection_build_index(&t2, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    CU_ASSERT_FATAL(t2.file_map.addr != NULL);
+    tsk_table_collection_free(&t2);
+    tables = tsk_malloc(sizeof(*tables));
+    CU_ASSERT_FATAL(tables != NULL);
+    ret = tsk_table_collection_load(tables, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_init(
+        &ts2, tables, TSK_TAKE_OWNERSHIP | TSK_TS_INIT_BUILD_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts2.tables, 0));
+    tsk_treeseq_free(&ts2);
+
+    /* Operations that modify mapped tables copy them out of the mapping first */
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_sort(&t2, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t2.file_map.addr, NULL);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    tsk_table_collection_free(&t2);
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_reserve(&t2, &reserve);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t2.file_map.addr, NULL);
+    CU_ASSERT_TRUE(t2.nodes.max_rows >= reserve.nodes);
+    ret_id = tsk_node_table_add_row(&t2.nodes, 0, 0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, (tsk_id_t) t1.nodes.num_rows);
+    tsk_table_collection_free(&t2);
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_compute_mutation_parents(&t2, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t2.file_map.addr, NULL);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    tsk_table_collection_free(&t2);
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_clear(&t2, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t2.file_map.addr, NULL);
+    CU_ASSERT_EQUAL(t2.nodes.num_rows, 0);
+    tsk_table_collection_free(&t2);
+    /* Replacing the top-level metadata leaves the columns mapped */
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_set_metadata(&t2, "x", 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FATAL(t2.file_map.addr != NULL);
+    CU_ASSERT_EQUAL(t2.metadata_length, 1);
+    tsk_table_collection_free(&t2);
+
+    /* Table-level functions can't modify the mapped columns */
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret_id = tsk_node_table_add_row(&t2.nodes, 0, 0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, TSK_ERR_TABLE_MAPPED);
+    ret_id = tsk_edge_table_add_row(&t2.edges, 0, 1, 0, 1, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_site_table_reserve(&t2.sites, t2.sites.num_rows + 1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_node_table_update_row(&t2.nodes, 0, 0, 0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_edge_table_keep_rows(&t2.edges, NULL, 0, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_edge_table_squash(&t2.edges);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_mutation_table_extend(&t2.mutations, &t1.mutations, 1, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_population_table_set_columns(&t2.populations, 0, NULL, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_provenance_table_takeset_columns(
+        &t2.provenances, 0, NULL, NULL, NULL, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_reference_sequence_set_data(&t2.reference_sequence, "A", 1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    /* The interval functions may run concurrently, so can't copy the mapping */
+    ret = tsk_table_collection_compute_mutation_parents_interval(
+        &t2, 0, t2.sequence_length, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    ret = tsk_table_collection_compute_mutation_times_interval(
+        &t2, NULL, 0, t2.sequence_length, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_MAPPED);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+    /* Truncating only changes the row counts */
+    ret = tsk_node_table_truncate(&t2.nodes, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t2.nodes.num_rows, 1);
+    /* Once the collection has been copied out of the mapping the tables can be
+     * modified directly */
+    ret = tsk_table_collection_clear(&t2, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret_id = tsk_node_table_add_row(&t2.nodes, 0, 0, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret = tsk_reference_sequence_set_data(&t2.reference_sequence, "A", 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_table_collection_free(&t2);
+
+    /* Copies of mapped tables own their memory */
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_init(&ts2, &t2, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_table_collection_free(&t2);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts2.tables, 0));
+    tsk_treeseq_free(&ts2);
+
+    /* Multiple stores can be mapped sequentially from one file */
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_FATAL(f != NULL);
+    for (j = 0; j < 3; j++) {
+        ret = tsk_table_collection_dumpf(&t1, f, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+    fseek(f, 0, SEEK_SET);
+    for (j = 0; j < 3; j++) {
+        ret = tsk_treeseq_loadf(&ts2, f, TSK_LOAD_MMAP);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, ts2.tables, 0));
+        tsk_treeseq_free(&ts2);
+    }
+    ret = tsk_table_collection_loadf(&t2, f, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_EOF);
+    tsk_table_collection_free(&t2);
+    fclose(f);
+
+    /* Stores that don't start on an 8 byte boundary can't be used in place,
+     * and are read normally */
+    f = fopen(_tmp_file_name, "w+");
+    CU_ASSERT_FATAL(f != NULL);
+    for (j = 0; j < 3; j++) {
+        ret = tsk_table_collection_dumpf(&t1, f, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        /* Misalign the next store */
+        CU_ASSERT_EQUAL_FATAL(fputc(0, f), 0);
+    }
+    fseek(f, 0, SEEK_SET);
+    for (j = 0; j < 3; j++) {
+        ret = tsk_table_collection_loadf(&t2, f, TSK_LOAD_MMAP);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&t1, &t2, 0));
+        CU_ASSERT_EQUAL((uintptr_t) t2.nodes.time % sizeof(double), 0);
+        CU_ASSERT_EQUAL((uintptr_t) t2.edges.left % sizeof(double), 0);
+        /* Only the first store is aligned */
+        CU_ASSERT_EQUAL(t2.file_map.addr != NULL, j == 0);
+        tsk_table_collection_free(&t2);
+        CU_ASSERT_EQUAL_FATAL(fgetc(f), 0);
+    }
+    /* Partial loads leave the file at the end of each store whether or not
+     * it could be mapped */
+    fseek(f, 0, SEEK_SET);
+    for (j = 0; j < 3; j++) {
+        ret = tsk_table_collection_loadf(
+            &t2, f, TSK_LOAD_MMAP | TSK_LOAD_SKIP_SITES | TSK_LOAD_SKIP_PROVENANCES);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_node_table_equals(&t1.nodes, &t2.nodes, 0));
+        CU_ASSERT_TRUE(tsk_edge_table_equals(&t1.edges, &t2.edges, 0));
+        CU_ASSERT_EQUAL(t2.sites.num_rows, 0);
+        CU_ASSERT_EQUAL(t2.provenances.num_rows, 0);
+        CU_ASSERT_EQUAL(t2.file_map.addr != NULL, j == 0);
+        tsk_table_collection_free(&t2);
+        CU_ASSERT_EQUAL_FATAL(fgetc(f), 0);
+    }
+    ret = tsk_table_collection_loadf(&t2, f, TSK_LOAD_MMAP | TSK_LOAD_SKIP_SITES);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_EOF);
+    tsk_table_collection_free(&t2);
+    fclose(f);
+
+    /* A truncated file is detected */
+    ret = tsk_table_collection_dump(&t1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    f = fopen(_tmp_file_name, "r");
+    CU_ASSERT_FATAL(f != NULL);
+    fseek(f, 0, SEEK_END);
+    ret = truncate(_tmp_file_name, ftell(f) - 8);
+    fclose(f);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_load(&t2, _tmp_file_name, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_FILE_FORMAT);
+    tsk_table_collection_free(&t2);
+
+    /* Streams that aren't regular files can't be mapped */
+    ret = pipe(fds);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    f = fdopen(fds[1], "w");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = tsk_table_collection_dumpf(&t1, f, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    fclose(f);
+    f = fdopen(fds[0], "r");
+    CU_ASSERT_FATAL(f != NULL);
+    ret = tsk_table_collection_loadf(&t2, f, TSK_LOAD_MMAP);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_OPERATION);
+    tsk_table_collection_free(&t2);
+    fclose(f);
+
+    tsk_table_collection_free(&t1);
+    tsk_treeseq_free(ts1);
+    free(ts1);
+}
+
+static void
+test_load_skip_columns(void)
+{
+    int ret;
+    tsk_size_t j;
+    tsk_treeseq_t *ts1 = caterpillar_tree(5, 3, 3);
+    tsk_treeseq_t ts2;
+    tsk_table_collection_t t1;
+    const tsk_table_collection_t *t2;
+    tsk_flags_t mmap_options[] = { 0, TSK_LOAD_MMAP };
+
+    CU_ASSERT_TRUE_FATAL(ts1->tables->migrations.num_rows > 0);
+    CU_ASSERT_TRUE_FATAL(ts1->tables->provenances.num_rows > 0);
+    ret = tsk_treeseq_dump(ts1, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    for (j = 0; j < 2; j++) {
+        ret = tsk_treeseq_load(
+            &ts2, _tmp_file_name, TSK_LOAD_SKIP_METADATA | mmap_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        t2 = ts2.tables;
+        CU_ASSERT_TRUE(tsk_table_collection_equals(ts1->tables, t2,
+            TSK_CMP_IGNORE_METADATA | TSK_CMP_IGNORE_REFERENCE_SEQUENCE));
+        CU_ASSERT_FALSE(tsk_table_collection_equals(
+            ts1->tables, t2, TSK_CMP_IGNORE_REFERENCE_SEQUENCE));
+        CU_ASSERT_EQUAL(t2->metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->metadata_schema_length, 0);
+        CU_ASSERT_EQUAL(t2->nodes.metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->nodes.metadata_schema_length, 0);
+        CU_ASSERT_EQUAL(t2->populations.num_rows, ts1->tables->populations.num_rows);
+        CU_ASSERT_EQUAL(t2->populations.metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->individuals.metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->edges.metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->sites.metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->mutations.metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->migrations.metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->reference_sequence.metadata_length, 0);
+        CU_ASSERT_EQUAL(t2->reference_sequence.metadata_schema_length, 0);
+        CU_ASSERT_EQUAL(t2->reference_sequence.data_length,
+            ts1->tables->reference_sequence.data_length);
+        tsk_treeseq_free(&ts2);
+
+        ret = tsk_treeseq_load(
+            &ts2, _tmp_file_name, TSK_LOAD_SKIP_PROVENANCES | mmap_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(ts2.tables->provenances.num_rows, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(
+            ts1->tables, ts2.tables, TSK_CMP_IGNORE_PROVENANCE));
+        tsk_treeseq_free(&ts2);
+
+        ret = tsk_treeseq_load(
+            &ts2, _tmp_file_name, TSK_LOAD_SKIP_MIGRATIONS | mmap_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(ts2.tables->migrations.num_rows, 0);
+        CU_ASSERT_EQUAL(
+            ts2.tables->nodes.num_rows, ts1->tables->nodes.num_rows);
+        tsk_treeseq_free(&ts2);
+
+        ret = tsk_treeseq_load(
+            &ts2, _tmp_file_name, TSK_LOAD_SKIP_MUTATIONS | mmap_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(ts2.tables->mutations.num_rows, 0);
+        CU_ASSERT_TRUE(tsk_site_table_equals(
+            &ts1->tables->sites, &ts2.tables->sites, 0));
+        tsk_treeseq_free(&ts2);
+
+        /* Skipping sites also skips mutations */
+        ret = tsk_treeseq_load(&ts2, _tmp_file_name,
+            TSK_LOAD_SKIP_SITES | TSK_LOAD_SKIP_METADATA | TSK_LOAD_SKIP_PROVENANCES
+                | TSK_LOAD_SKIP_MIGRATIONS | mmap_options[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(ts2.tables->sites.num_rows, 0);
+        CU_ASSERT_EQUAL(ts2.tables->mutations.num_rows, 0);
+        CU_ASSERT_EQUAL(ts2.tables->provenances.num_rows, 0);
+        CU_ASSERT_EQUAL(ts2.tables->migrations.num_rows, 0);
+        CU_ASSERT_TRUE(tsk_edge_table_equals(
+            &ts1->tables->edges, &ts2.tables->edges, TSK_CMP_IGNORE_METADATA));
+        CU_ASSERT_EQUAL(tsk_treeseq_get_num_trees(&ts2), tsk_treeseq_get_num_trees(ts1));
+        tsk_treeseq_free(&ts2);
+    }
+
+    /* Options that skip columns work with the table collection API too */
+    ret = tsk_table_collection_load(&t1, _tmp_file_name, TSK_LOAD_SKIP_METADATA);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(ts1->tables, &t1,
+        TSK_CMP_IGNORE_METADATA | TSK_CMP_IGNORE_REFERENCE_SEQUENCE));
+    tsk_table_collection_free(&t1);
+
+    tsk_treeseq_free(ts1);
+    free(ts1);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1413,6 +1907,7 @@ main(int argc, char **argv)
         { "test_missing_required_column_pairs", test_missing_required_column_pairs },
         { "test_bad_offset_columns", test_bad_offset_columns },
         { "test_force_offset_64", test_force_offset_64 },
+        { "test_compress_offsets", test_compress_offsets },
         { "test_metadata_schemas_optional", test_metadata_schemas_optional },
         { "test_load_node_table_errors", test_load_node_table_errors },
         { "test_load_bad_file_formats", test_load_bad_file_formats },
@@ -1424,6 +1919,8 @@ main(int argc, char **argv)
         { "test_copy_store_drop_columns", test_copy_store_drop_columns },
         { "test_skip_tables", test_skip_tables },
         { "test_skip_reference_sequence", test_skip_reference_sequence },
+        { "test_load_mmap", test_load_mmap },
+        { "test_load_skip_columns", test_load_skip_columns },
         { NULL, NULL },
     };
 
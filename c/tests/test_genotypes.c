@@ -932,6 +932,342 @@ test_multiple_variant_decode(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+test_variant_decode_matrix(void)
+{
+    int ret = 0;
+    tsk_size_t j, k;
+    tsk_treeseq_t ts;
+    tsk_variant_t var, var2;
+    tsk_id_t samples[] = { 0, 1, 3 };
+    int32_t genos[12];
+    int8_t genos8[12];
+    int32_t genos_expected[] = { 0, 0, 1, 0, 1, 0, 0, 0, 0, 1, 1, 1 };
+    int32_t genos_subset[9];
+    int32_t genos_expected_subset[] = { 0, 0, 0, 1, 0, 0, 0, 1, 1 };
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
+        paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(tsk_treeseq_get_num_sites(&ts), 3);
+
+    ret = tsk_variant_init(&var, &ts, NULL, 0, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Site-major */
+    ret = tsk_variant_decode_matrix(&var, 0, 3, 0, 0, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(0, memcmp(genos, genos_expected, sizeof(genos_expected)));
+    CU_ASSERT_EQUAL(var.site.id, 2);
+    ret = tsk_variant_decode_matrix_int8(&var, 0, 3, 0, 0, genos8);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < 12; j++) {
+        CU_ASSERT_EQUAL(genos8[j], genos_expected[j]);
+    }
+
+    /* Sample-major */
+    ret = tsk_variant_decode_matrix(&var, 0, 3, 0, TSK_GENOTYPES_SAMPLE_MAJOR, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_variant_decode_matrix_int8(
+        &var, 0, 3, 0, TSK_GENOTYPES_SAMPLE_MAJOR, genos8);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < 3; j++) {
+        for (k = 0; k < 4; k++) {
+            CU_ASSERT_EQUAL(genos[k * 3 + j], genos_expected[j * 4 + k]);
+            CU_ASSERT_EQUAL(genos8[k * 3 + j], genos_expected[j * 4 + k]);
+        }
+    }
+
+    /* Decode in chunks with separate variants into the same matrices */
+    ret = tsk_variant_init(&var2, &ts, NULL, 0, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    memset(genos, 0xff, sizeof(genos));
+    ret = tsk_variant_decode_matrix(&var2, 2, 3, 0, 0, genos + 8);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_variant_decode_matrix(&var, 0, 2, 0, 0, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(0, memcmp(genos, genos_expected, sizeof(genos_expected)));
+
+    memset(genos, 0xff, sizeof(genos));
+    ret = tsk_variant_decode_matrix(
+        &var2, 1, 3, 3, TSK_GENOTYPES_SAMPLE_MAJOR, genos + 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_variant_decode_matrix(&var, 0, 1, 3, TSK_GENOTYPES_SAMPLE_MAJOR, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < 3; j++) {
+        for (k = 0; k < 4; k++) {
+            CU_ASSERT_EQUAL(genos[k * 3 + j], genos_expected[j * 4 + k]);
+        }
+    }
+
+    /* A padded site-major matrix leaves the padding alone */
+    memset(genos, 0xff, sizeof(genos));
+    ret = tsk_variant_decode_matrix(&var, 1, 3, 6, 0, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (k = 0; k < 4; k++) {
+        CU_ASSERT_EQUAL(genos[k], genos_expected[4 + k]);
+        CU_ASSERT_EQUAL(genos[6 + k], genos_expected[8 + k]);
+    }
+    CU_ASSERT_EQUAL(genos[4], -1);
+    CU_ASSERT_EQUAL(genos[5], -1);
+
+    /* Empty ranges are fine */
+    ret = tsk_variant_decode_matrix(&var, 3, 3, 0, 0, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_variant_decode_matrix(&var, 1, 1, 0, TSK_GENOTYPES_SAMPLE_MAJOR, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Errors */
+    ret = tsk_variant_decode_matrix(&var, -1, 3, 0, 0, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SITE_OUT_OF_BOUNDS);
+    ret = tsk_variant_decode_matrix(&var, 0, 4, 0, 0, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SITE_OUT_OF_BOUNDS);
+    ret = tsk_variant_decode_matrix_int8(&var, 2, 1, 0, 0, genos8);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SITE_OUT_OF_BOUNDS);
+    ret = tsk_variant_decode_matrix(&var, 0, 3, 3, 0, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_variant_decode_matrix_int8(
+        &var, 0, 3, 2, TSK_GENOTYPES_SAMPLE_MAJOR, genos8);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    tsk_variant_free(&var);
+    tsk_variant_free(&var2);
+
+    /* Sample subset */
+    ret = tsk_variant_init(&var, &ts, samples, 3, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_variant_decode_matrix(&var, 0, 3, 0, 0, genos_subset);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(
+        0, memcmp(genos_subset, genos_expected_subset, sizeof(genos_expected_subset)));
+
+    /* Variant copies can't be decoded */
+    ret = tsk_variant_restricted_copy(&var, &var2);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_variant_decode_matrix(&var2, 0, 3, 0, 0, genos_subset);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_VARIANT_CANT_DECODE_COPY);
+    tsk_variant_free(&var);
+    tsk_variant_free(&var2);
+
+    tsk_treeseq_free(&ts);
+}
+
+/* Decode a single site with the specified number of alleles, the ancestral
+ * state and one for each mutation in a chain above sample 0. */
+static void
+verify_decode_matrix_int8_num_alleles(tsk_size_t num_alleles, int expected_ret)
+{
+    int ret = 0;
+    tsk_id_t ret_id;
+    tsk_treeseq_t ts;
+    tsk_variant_t var;
+    tsk_id_t j;
+    char alleles[256];
+    int32_t genos[4];
+    int8_t genos8[4];
+    tsk_table_collection_t tables;
+
+    CU_ASSERT_FATAL(num_alleles <= sizeof(alleles));
+    tsk_treeseq_from_text(&ts, 1, single_tree_ex_nodes, single_tree_ex_edges, NULL, NULL,
+        NULL, NULL, NULL, 0);
+    ret = tsk_treeseq_copy_tables(&ts, &tables, 0);
+    CU_ASSERT_FATAL(ret == 0);
+    tsk_treeseq_free(&ts);
+    tsk_memset(alleles, 'X', sizeof(alleles));
+    ret_id = tsk_site_table_add_row(&tables.sites, 0, "Y", 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    for (j = 0; j < (tsk_id_t) num_alleles - 1; j++) {
+        ret_id = tsk_mutation_table_add_row(&tables.mutations, 0, 0, j - 1,
+            TSK_UNKNOWN_TIME, alleles, (tsk_size_t) j, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    ret = tsk_treeseq_init(&ts, &tables, TSK_TS_INIT_BUILD_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_variant_init(&var, &ts, NULL, 0, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_variant_decode_matrix(&var, 0, 1, 0, 0, genos);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(var.num_alleles, num_alleles);
+    CU_ASSERT_EQUAL(genos[0], (int32_t) num_alleles - 1);
+    ret = tsk_variant_decode_matrix_int8(&var, 0, 1, 0, 0, genos8);
+    CU_ASSERT_EQUAL_FATAL(ret, expected_ret);
+    if (expected_ret == 0) {
+        CU_ASSERT_EQUAL(genos8[0], (int8_t) (num_alleles - 1));
+        CU_ASSERT_EQUAL(genos8[1], 0);
+    }
+    tsk_variant_free(&var);
+
+    tsk_treeseq_free(&ts);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+test_variant_decode_matrix_int8_many_alleles(void)
+{
+    verify_decode_matrix_int8_num_alleles(127, 0);
+    verify_decode_matrix_int8_num_alleles(128, 0);
+    verify_decode_matrix_int8_num_alleles(129, TSK_ERR_TOO_MANY_ALLELES);
+    verify_decode_matrix_int8_num_alleles(131, TSK_ERR_TOO_MANY_ALLELES);
+}
+
+static void
+test_variant_decode_packed(void)
+{
+    int ret = 0;
+    tsk_id_t s;
+    tsk_size_t k;
+    tsk_treeseq_t ts;
+    tsk_variant_t var;
+    tsk_bit_array_t genotypes, missing, row, missing_row, small;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
+        paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    ret = tsk_variant_init(&var, &ts, NULL, 0, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_bit_array_init(&genotypes, var.num_samples, 3);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_bit_array_init(&missing, var.num_samples, 3);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_memset(genotypes.data, 0xff, 3 * genotypes.size * sizeof(*genotypes.data));
+    tsk_memset(missing.data, 0xff, 3 * missing.size * sizeof(*missing.data));
+
+    for (s = 0; s < 3; s++) {
+        tsk_bit_array_get_row(&genotypes, (tsk_size_t) s, &row);
+        tsk_bit_array_get_row(&missing, (tsk_size_t) s, &missing_row);
+        ret = tsk_variant_decode_packed(&var, s, 0, &row, &missing_row);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (k = 0; k < var.num_samples; k++) {
+            CU_ASSERT_EQUAL(tsk_bit_array_contains(&row, (tsk_bit_array_value_t) k),
+                var.genotypes[k] == 1);
+            CU_ASSERT_FALSE(
+                tsk_bit_array_contains(&missing_row, (tsk_bit_array_value_t) k));
+        }
+        CU_ASSERT_EQUAL(tsk_bit_array_count(&row), s == 2 ? 3 : 1);
+        CU_ASSERT_EQUAL(tsk_bit_array_count(&missing_row), 0);
+        /* The missing mask is optional */
+        ret = tsk_variant_decode_packed(&var, s, 0, &row, NULL);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+
+    /* Too small */
+    small.size = 0;
+    small.data = genotypes.data;
+    ret = tsk_variant_decode_packed(&var, 0, 0, &small, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_variant_decode_packed(&var, 0, 0, &row, &small);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_variant_decode_packed(&var, 3, 0, &row, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SITE_OUT_OF_BOUNDS);
+
+    tsk_bit_array_free(&genotypes);
+    tsk_bit_array_free(&missing);
+    tsk_variant_free(&var);
+    tsk_treeseq_free(&ts);
+}
+
+static void
+test_variant_decode_packed_missing_data(void)
+{
+    /* 70 samples, so that we need more than one chunk. The first 65 are
+     * joined by an edge; the rest are isolated. */
+    tsk_treeseq_t ts;
+    tsk_table_collection_t tables;
+    tsk_variant_t var;
+    tsk_bit_array_t genotypes, missing;
+    tsk_id_t parent, ret_id;
+    tsk_size_t k;
+    int ret;
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 1;
+    for (k = 0; k < 70; k++) {
+        ret_id = tsk_node_table_add_row(
+            &tables.nodes, TSK_NODE_IS_SAMPLE, 0, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    parent = tsk_node_table_add_row(&tables.nodes, 0, 1, TSK_NULL, TSK_NULL, NULL, 0);
+    CU_ASSERT_FATAL(parent >= 0);
+    for (k = 0; k < 65; k++) {
+        ret_id = tsk_edge_table_add_row(
+            &tables.edges, 0, 1, parent, (tsk_id_t) k, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    ret_id = tsk_site_table_add_row(&tables.sites, 0.5, "A", 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    /* Mutations over sample 33 and isolated sample 68 */
+    ret_id = tsk_mutation_table_add_row(
+        &tables.mutations, 0, 33, TSK_NULL, TSK_UNKNOWN_TIME, "T", 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_mutation_table_add_row(
+        &tables.mutations, 0, 68, TSK_NULL, TSK_UNKNOWN_TIME, "T", 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret = tsk_table_collection_sort(&tables, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_init(&ts, &tables, TSK_TS_INIT_BUILD_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_variant_init(&var, &ts, NULL, 0, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_bit_array_init(&genotypes, var.num_samples, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_bit_array_init(&missing, var.num_samples, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FATAL(genotypes.size > 1);
+
+    ret = tsk_variant_decode_packed(&var, 0, 0, &genotypes, &missing);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(var.has_missing_data);
+    for (k = 0; k < 70; k++) {
+        CU_ASSERT_EQUAL(tsk_bit_array_contains(&genotypes, (tsk_bit_array_value_t) k),
+            k == 33 || k == 68);
+        CU_ASSERT_EQUAL(tsk_bit_array_contains(&missing, (tsk_bit_array_value_t) k),
+            k >= 65 && k != 68);
+    }
+    CU_ASSERT_EQUAL(tsk_bit_array_count(&genotypes), 2);
+    CU_ASSERT_EQUAL(tsk_bit_array_count(&missing), 4);
+    tsk_variant_free(&var);
+
+    ret = tsk_variant_init(&var, &ts, NULL, 0, NULL, TSK_ISOLATED_NOT_MISSING);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_variant_decode_packed(&var, 0, 0, &genotypes, &missing);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(tsk_bit_array_count(&genotypes), 2);
+    CU_ASSERT_EQUAL(tsk_bit_array_count(&missing), 0);
+    tsk_variant_free(&var);
+
+    tsk_bit_array_free(&genotypes);
+    tsk_bit_array_free(&missing);
+    tsk_treeseq_free(&ts);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+test_variant_decode_packed_not_biallelic(void)
+{
+    int ret = 0;
+    tsk_treeseq_t ts;
+    tsk_variant_t var;
+    tsk_bit_array_t genotypes;
+    const char *sites = "0.5    0\n";
+    const char *mutations = "0    0     1   -1\n"
+                            "0    1     2   -1\n";
+
+    tsk_treeseq_from_text(&ts, 1, single_tree_ex_nodes, single_tree_ex_edges, NULL,
+        sites, mutations, NULL, NULL, 0);
+    ret = tsk_variant_init(&var, &ts, NULL, 0, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_bit_array_init(&genotypes, var.num_samples, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_variant_decode_packed(&var, 0, 0, &genotypes, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_NOT_BIALLELIC);
+    CU_ASSERT_EQUAL(var.num_alleles, 3);
+
+    tsk_bit_array_free(&genotypes);
+    tsk_variant_free(&var);
+    tsk_treeseq_free(&ts);
+}
+
 static void
 test_variant_decode_errors(void)
 {
@@ -1129,6 +1465,14 @@ main(int argc, char **argv)
         { "test_single_tree_many_alleles", test_single_tree_many_alleles },
         { "test_single_tree_silent_mutations", test_single_tree_silent_mutations },
         { "test_multiple_variant_decode", test_multiple_variant_decode },
+        { "test_variant_decode_matrix", test_variant_decode_matrix },
+        { "test_variant_decode_matrix_int8_many_alleles",
+            test_variant_decode_matrix_int8_many_alleles },
+        { "test_variant_decode_packed", test_variant_decode_packed },
+        { "test_variant_decode_packed_missing_data",
+            test_variant_decode_packed_missing_data },
+        { "test_variant_decode_packed_not_biallelic",
+            test_variant_decode_packed_not_biallelic },
         { "test_variant_decode_errors", test_variant_decode_errors },
         { "test_variant_copy", test_variant_copy },
         { "test_variant_copy_long_alleles", test_variant_copy_long_alleles },
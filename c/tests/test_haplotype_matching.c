@@ -503,6 +503,100 @@ test_multi_tree_errors(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+test_multi_tree_batch(void)
+{
+    int ret = 0;
+    tsk_treeseq_t ts, other_ts;
+    tsk_ls_hmm_t ls_hmm[4];
+    tsk_compressed_matrix_t forward[4], single_forward;
+    tsk_viterbi_matrix_t viterbi[4], single_viterbi;
+    double rho[] = { 0.0, 0.25, 0.25 };
+    double mu[] = { 0.125, 0.125, 0.125 };
+    int32_t h[4][3] = { { 1, 0, 0 }, { 0, 1, 1 }, { 1, 1, 0 }, { 0, 0, 1 } };
+    double batch_decoded[3][4], single_decoded[3][4];
+    tsk_id_t batch_path[3], single_path[3];
+    tsk_size_t j, k, num_haplotypes = 4;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
+        paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(tsk_treeseq_get_num_sites(&ts), 3);
+    CU_ASSERT_EQUAL_FATAL(tsk_treeseq_get_num_samples(&ts), 4);
+
+    for (k = 0; k < num_haplotypes; k++) {
+        ret = tsk_ls_hmm_init(&ls_hmm[k], &ts, rho, mu, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+    ret = tsk_ls_hmm_forward_batch(ls_hmm, num_haplotypes, (int32_t *) h, forward, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_ls_hmm_viterbi_batch(ls_hmm, num_haplotypes, (int32_t *) h, viterbi, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_ls_hmm_print_state(&ls_hmm[1], _devnull);
+
+    /* Each HMM in the batch must give the same result as the single versions */
+    for (k = 0; k < num_haplotypes; k++) {
+        ret = tsk_ls_hmm_forward(&ls_hmm[0], h[k], &single_forward, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_compressed_matrix_decode(&single_forward, (double *) single_decoded);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_compressed_matrix_decode(&forward[k], (double *) batch_decoded);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (j = 0; j < 12; j++) {
+            CU_ASSERT_DOUBLE_EQUAL(((double *) batch_decoded)[j],
+                ((double *) single_decoded)[j], 1e-12);
+        }
+        for (j = 0; j < 3; j++) {
+            CU_ASSERT_DOUBLE_EQUAL(forward[k].normalisation_factor[j],
+                single_forward.normalisation_factor[j], 1e-12);
+        }
+
+        ret = tsk_ls_hmm_viterbi(&ls_hmm[0], h[k], &single_viterbi, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_viterbi_matrix_traceback(&single_viterbi, single_path, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_viterbi_matrix_traceback(&viterbi[k], batch_path, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (j = 0; j < 3; j++) {
+            CU_ASSERT_EQUAL(batch_path[j], single_path[j]);
+        }
+        tsk_compressed_matrix_free(&single_forward);
+        tsk_viterbi_matrix_free(&single_viterbi);
+    }
+
+    /* We can reuse the outputs, and the empty batch is a no-op */
+    ret = tsk_ls_hmm_forward_batch(
+        ls_hmm, num_haplotypes, (int32_t *) h, forward, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_ls_hmm_viterbi_batch(
+        ls_hmm, num_haplotypes, (int32_t *) h, viterbi, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_ls_hmm_forward_batch(ls_hmm, 0, NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_ls_hmm_viterbi_batch(ls_hmm, 0, NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* All HMMs in the batch must be for the same tree sequence */
+    tsk_treeseq_from_text(&other_ts, 10, paper_ex_nodes, paper_ex_edges, NULL,
+        paper_ex_sites, paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    tsk_ls_hmm_free(&ls_hmm[3]);
+    ret = tsk_ls_hmm_init(&ls_hmm[3], &other_ts, rho, mu, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_ls_hmm_forward_batch(
+        ls_hmm, num_haplotypes, (int32_t *) h, forward, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_ls_hmm_viterbi_batch(
+        ls_hmm, num_haplotypes, (int32_t *) h, viterbi, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    for (k = 0; k < num_haplotypes; k++) {
+        tsk_ls_hmm_free(&ls_hmm[k]);
+        tsk_compressed_matrix_free(&forward[k]);
+        tsk_viterbi_matrix_free(&viterbi[k]);
+    }
+    tsk_treeseq_free(&ts);
+    tsk_treeseq_free(&other_ts);
+}
+
 static void
 test_caterpillar_tree_many_values(void)
 {
@@ -570,6 +664,7 @@ main(int argc, char **argv)
 
         { "test_multi_tree_exact_match", test_multi_tree_exact_match },
         { "test_multi_tree_errors", test_multi_tree_errors },
+        { "test_multi_tree_batch", test_multi_tree_batch },
 
         { "test_caterpillar_tree_many_values", test_caterpillar_tree_many_values },
         { NULL, NULL },
@@ -46,6 +46,93 @@ multi_mutations_exist(tsk_treeseq_t *ts, tsk_id_t start, tsk_id_t end)
     return false;
 }
 
+static void
+verify_ld_band(tsk_treeseq_t *ts, tsk_size_t max_sites, double max_distance)
+{
+    int ret;
+    tsk_size_t num_sites = tsk_treeseq_get_num_sites(ts);
+    tsk_ld_calc_t ld_calc;
+    double *band = tsk_malloc((num_sites * max_sites + 1) * sizeof(*band));
+    double *band_chunk = tsk_malloc((num_sites * max_sites + 1) * sizeof(*band));
+    double *r2 = tsk_malloc((num_sites + 1) * sizeof(*r2));
+    tsk_size_t *num_band_values = tsk_malloc((num_sites + 1) * sizeof(tsk_size_t));
+    tsk_size_t *num_chunk_values = tsk_malloc((num_sites + 1) * sizeof(tsk_size_t));
+    tsk_size_t num_r2_values, k;
+    tsk_id_t a, split;
+
+    CU_ASSERT_FATAL(band != NULL);
+    CU_ASSERT_FATAL(band_chunk != NULL);
+    CU_ASSERT_FATAL(r2 != NULL);
+    CU_ASSERT_FATAL(num_band_values != NULL);
+    CU_ASSERT_FATAL(num_chunk_values != NULL);
+
+    ret = tsk_ld_calc_init(&ld_calc, ts);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_ld_calc_get_r2_band(&ld_calc, 0, (tsk_id_t) num_sites, max_sites,
+        max_distance, band, num_band_values);
+    if (multi_mutations_exist(ts, 0, (tsk_id_t) num_sites)) {
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_ONLY_INFINITE_SITES);
+        goto out;
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Each row is the same as the forward r2 array for that site */
+    for (a = 0; a < (tsk_id_t) num_sites; a++) {
+        ret = tsk_ld_calc_get_r2_array(&ld_calc, a, TSK_DIR_FORWARD, max_sites,
+            max_distance, r2, &num_r2_values);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(num_band_values[a], num_r2_values);
+        for (k = 0; k < max_sites; k++) {
+            if (k < num_r2_values) {
+                CU_ASSERT_DOUBLE_EQUAL_FATAL(band[(tsk_size_t) a * max_sites + k],
+                    r2[k], 1e-12);
+            } else {
+                CU_ASSERT_FATAL(tsk_isnan(band[(tsk_size_t) a * max_sites + k]));
+            }
+        }
+    }
+
+    /* Splitting the focal sites into chunks gives the same values */
+    split = (tsk_id_t) num_sites / 2;
+    ret = tsk_ld_calc_get_r2_band(
+        &ld_calc, 0, split, max_sites, max_distance, band_chunk, num_chunk_values);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_ld_calc_get_r2_band(&ld_calc, split, (tsk_id_t) num_sites, max_sites,
+        max_distance, band_chunk + (tsk_size_t) split * max_sites,
+        num_chunk_values + split);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (a = 0; a < (tsk_id_t) num_sites; a++) {
+        CU_ASSERT_EQUAL_FATAL(num_band_values[a], num_chunk_values[a]);
+        for (k = 0; k < num_band_values[a]; k++) {
+            CU_ASSERT_EQUAL_FATAL(band[(tsk_size_t) a * max_sites + k],
+                band_chunk[(tsk_size_t) a * max_sites + k]);
+        }
+    }
+
+    /* Empty ranges are fine */
+    ret = tsk_ld_calc_get_r2_band(
+        &ld_calc, split, split, max_sites, max_distance, band, num_band_values);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_ld_calc_get_r2_band(&ld_calc, -1, 0, max_sites, max_distance, band,
+        num_band_values);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SITE_OUT_OF_BOUNDS);
+    ret = tsk_ld_calc_get_r2_band(&ld_calc, 0, (tsk_id_t) num_sites + 1, max_sites,
+        max_distance, band, num_band_values);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SITE_OUT_OF_BOUNDS);
+    ret = tsk_ld_calc_get_r2_band(
+        &ld_calc, 1, 0, max_sites, max_distance, band, num_band_values);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SITE_OUT_OF_BOUNDS);
+out:
+    tsk_ld_calc_free(&ld_calc);
+    free(band);
+    free(band_chunk);
+    free(r2);
+    free(num_band_values);
+    free(num_chunk_values);
+}
+
 static void
 verify_ld(tsk_treeseq_t *ts)
 {
@@ -180,6 +267,133 @@ verify_ld(tsk_treeseq_t *ts)
     free(r2_prime);
     free(sites);
     free(num_site_mutations);
+
+    verify_ld_band(ts, num_sites, DBL_MAX);
+    verify_ld_band(ts, 1, DBL_MAX);
+    verify_ld_band(ts, 3, DBL_MAX);
+    verify_ld_band(ts, 0, DBL_MAX);
+    if (num_sites > 1) {
+        verify_ld_band(ts, 5, tsk_treeseq_get_sequence_length(ts) / 4);
+    }
+}
+
+/* Check that summing the interval GNN results over a partition of the genome
+ * and normalising gives the result A for the whole genome. */
+static void
+verify_genealogical_nearest_neighbours_intervals(tsk_treeseq_t *ts,
+    const tsk_id_t *focal, tsk_size_t num_focal, const tsk_id_t *const *sample_sets,
+    const tsk_size_t *sample_set_size, const double *A)
+{
+    int ret;
+    tsk_size_t j, k, num_chunks;
+    double L = tsk_treeseq_get_sequence_length(ts);
+    double *sum = tsk_malloc(2 * num_focal * sizeof(double));
+    double *length = tsk_malloc(num_focal * sizeof(double));
+    double *B = tsk_malloc(2 * num_focal * sizeof(double));
+    double *B_length = tsk_malloc(num_focal * sizeof(double));
+    double left, right;
+
+    CU_ASSERT_FATAL(sum != NULL && length != NULL && B != NULL && B_length != NULL);
+
+    for (num_chunks = 1; num_chunks <= 5; num_chunks += 2) {
+        tsk_memset(sum, 0, 2 * num_focal * sizeof(double));
+        tsk_memset(length, 0, num_focal * sizeof(double));
+        for (j = 0; j < num_chunks; j++) {
+            left = (double) j * L / (double) num_chunks;
+            right = j == num_chunks - 1 ? L : (double) (j + 1) * L / (double) num_chunks;
+            ret = tsk_treeseq_genealogical_nearest_neighbours_interval(ts, focal,
+                num_focal, sample_sets, sample_set_size, 2, left, right, 0, B,
+                B_length);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            for (k = 0; k < num_focal; k++) {
+                CU_ASSERT_FATAL(B_length[k] <= right - left);
+                length[k] += B_length[k];
+                sum[2 * k] += B[2 * k];
+                sum[2 * k + 1] += B[2 * k + 1];
+            }
+        }
+        for (k = 0; k < num_focal; k++) {
+            if (length[k] > 0) {
+                sum[2 * k] /= length[k];
+                sum[2 * k + 1] /= length[k];
+            }
+            CU_ASSERT_DOUBLE_EQUAL_FATAL(sum[2 * k], A[2 * k], 1e-9);
+            CU_ASSERT_DOUBLE_EQUAL_FATAL(sum[2 * k + 1], A[2 * k + 1], 1e-9);
+        }
+    }
+
+    ret = tsk_treeseq_genealogical_nearest_neighbours_interval(ts, focal, num_focal,
+        sample_sets, sample_set_size, 2, -1, L, 0, B, B_length);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_treeseq_genealogical_nearest_neighbours_interval(ts, focal, num_focal,
+        sample_sets, sample_set_size, 2, 0, L + 1, 0, B, B_length);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_treeseq_genealogical_nearest_neighbours_interval(ts, focal, num_focal,
+        sample_sets, sample_set_size, 2, L / 2, L / 2, 0, B, B_length);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    free(sum);
+    free(length);
+    free(B);
+    free(B_length);
+}
+
+/* Check that summing the interval mean descendants results over a partition
+ * of the genome and normalising gives the result C for the whole genome. */
+static void
+verify_mean_descendants_intervals(tsk_treeseq_t *ts,
+    const tsk_id_t *const *sample_sets, const tsk_size_t *sample_set_size,
+    const double *C)
+{
+    int ret;
+    tsk_size_t j, k, num_chunks;
+    tsk_size_t num_nodes = tsk_treeseq_get_num_nodes(ts);
+    double L = tsk_treeseq_get_sequence_length(ts);
+    double *sum = tsk_malloc(2 * num_nodes * sizeof(double));
+    double *length = tsk_malloc(num_nodes * sizeof(double));
+    double *D = tsk_malloc(2 * num_nodes * sizeof(double));
+    double *D_length = tsk_malloc(num_nodes * sizeof(double));
+    double left, right;
+
+    CU_ASSERT_FATAL(sum != NULL && length != NULL && D != NULL && D_length != NULL);
+
+    for (num_chunks = 1; num_chunks <= 5; num_chunks += 2) {
+        tsk_memset(sum, 0, 2 * num_nodes * sizeof(double));
+        tsk_memset(length, 0, num_nodes * sizeof(double));
+        for (j = 0; j < num_chunks; j++) {
+            left = (double) j * L / (double) num_chunks;
+            right = j == num_chunks - 1 ? L : (double) (j + 1) * L / (double) num_chunks;
+            ret = tsk_treeseq_mean_descendants_interval(
+                ts, sample_sets, sample_set_size, 2, left, right, 0, D, D_length);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            for (k = 0; k < num_nodes; k++) {
+                CU_ASSERT_FATAL(D_length[k] <= right - left);
+                length[k] += D_length[k];
+                sum[2 * k] += D[2 * k];
+                sum[2 * k + 1] += D[2 * k + 1];
+            }
+        }
+        for (k = 0; k < num_nodes; k++) {
+            if (length[k] > 0) {
+                sum[2 * k] /= length[k];
+                sum[2 * k + 1] /= length[k];
+            }
+            CU_ASSERT_DOUBLE_EQUAL_FATAL(sum[2 * k], C[2 * k], 1e-9);
+            CU_ASSERT_DOUBLE_EQUAL_FATAL(sum[2 * k + 1], C[2 * k + 1], 1e-9);
+        }
+    }
+
+    ret = tsk_treeseq_mean_descendants_interval(
+        ts, sample_sets, sample_set_size, 2, -1, L, 0, D, D_length);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_treeseq_mean_descendants_interval(
+        ts, sample_sets, sample_set_size, 2, L, L, 0, D, D_length);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    free(sum);
+    free(length);
+    free(D);
+    free(D_length);
 }
 
 /* FIXME: this test is weak and should check the return value somehow.
@@ -208,6 +422,8 @@ verify_genealogical_nearest_neighbours(tsk_treeseq_t *ts)
     ret = tsk_treeseq_genealogical_nearest_neighbours(
         ts, samples, num_samples, sample_sets, sample_set_size, 2, 0, A);
     CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_genealogical_nearest_neighbours_intervals(
+        ts, samples, num_samples, sample_sets, sample_set_size, A);
 
     sample_sets[0] = samples;
     sample_set_size[0] = 1;
@@ -217,6 +433,8 @@ verify_genealogical_nearest_neighbours(tsk_treeseq_t *ts)
     ret = tsk_treeseq_genealogical_nearest_neighbours(
         ts, samples, num_samples, sample_sets, sample_set_size, 2, 0, A);
     CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_genealogical_nearest_neighbours_intervals(
+        ts, samples, num_samples, sample_sets, sample_set_size, A);
 
     free(A);
 }
@@ -247,6 +465,7 @@ verify_mean_descendants(tsk_treeseq_t *ts)
 
     ret = tsk_treeseq_mean_descendants(ts, sample_sets, sample_set_size, 2, 0, C);
     CU_ASSERT_EQUAL_FATAL(ret, 0);
+    verify_mean_descendants_intervals(ts, sample_sets, sample_set_size, C);
 
     /* Check some error conditions */
     ret = tsk_treeseq_mean_descendants(ts, sample_sets, sample_set_size, 0, 0, C);
@@ -304,6 +523,84 @@ verify_divergence_matrix(tsk_treeseq_t *ts, tsk_flags_t options)
     }
 }
 
+/* Check the divergence matrix with windows and sample sets of size two
+ * against the stats API equivalent code.
+ */
+static void
+verify_divergence_matrix_windows(tsk_treeseq_t *ts, tsk_size_t num_windows,
+    const double *windows, tsk_flags_t options)
+{
+    int ret;
+    const tsk_size_t n = tsk_treeseq_get_num_samples(ts) / 2;
+    const tsk_id_t *samples = tsk_treeseq_get_samples(ts);
+    tsk_size_t sample_set_sizes[n];
+    tsk_id_t index_tuples[2 * n * n];
+    double D1[num_windows * n * n], D2[num_windows * n * n];
+    tsk_size_t j, k;
+
+    for (j = 0; j < n; j++) {
+        sample_set_sizes[j] = 2;
+        for (k = 0; k < n; k++) {
+            index_tuples[2 * (j * n + k)] = (tsk_id_t) j;
+            index_tuples[2 * (j * n + k) + 1] = (tsk_id_t) k;
+        }
+    }
+    ret = tsk_treeseq_divergence(ts, n, sample_set_sizes, samples, n * n, index_tuples,
+        num_windows, windows, options, D1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_treeseq_divergence_matrix(
+        ts, n, sample_set_sizes, samples, num_windows, windows, options, D2);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    assert_arrays_almost_equal(num_windows * n * n, D1, D2);
+}
+
+/* Check the GRM-vector product against the product of the weights with the
+ * full matrix, computed by genetic_relatedness_weighted. */
+static void
+verify_genetic_relatedness_vector(tsk_treeseq_t *ts, tsk_size_t num_weights,
+    tsk_size_t num_windows, const double *windows, tsk_flags_t options)
+{
+    int ret;
+    const tsk_size_t n = tsk_treeseq_get_num_samples(ts);
+    const tsk_size_t w = windows == NULL ? 1 : num_windows;
+    double weights[n * num_weights];
+    double identity[n * n];
+    tsk_id_t index_tuples[2 * n * n];
+    double grm[w * n * n];
+    double expected[w * n * num_weights], result[w * n * num_weights];
+    tsk_size_t i, j, k, l;
+
+    for (j = 0; j < n; j++) {
+        for (k = 0; k < num_weights; k++) {
+            weights[j * num_weights + k] = (double) ((j * 7 + k * 3) % 5) - 1.5;
+        }
+        for (k = 0; k < n; k++) {
+            identity[j * n + k] = j == k;
+            index_tuples[2 * (j * n + k)] = (tsk_id_t) j;
+            index_tuples[2 * (j * n + k) + 1] = (tsk_id_t) k;
+        }
+    }
+    ret = tsk_treeseq_genetic_relatedness_weighted(ts, n, identity, n * n,
+        index_tuples, num_windows, windows, grm, options | TSK_STAT_BRANCH);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_memset(expected, 0, sizeof(expected));
+    for (l = 0; l < w; l++) {
+        for (i = 0; i < n; i++) {
+            for (j = 0; j < n; j++) {
+                for (k = 0; k < num_weights; k++) {
+                    expected[(l * n + i) * num_weights + k]
+                        += grm[(l * n + i) * n + j] * weights[j * num_weights + k];
+                }
+            }
+        }
+    }
+    ret = tsk_treeseq_genetic_relatedness_vector(
+        ts, num_weights, weights, num_windows, windows, result, options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    assert_arrays_almost_equal(w * n * num_weights, result, expected);
+}
+
 typedef struct {
     int call_count;
     int error_on;
@@ -808,6 +1105,252 @@ verify_general_stat_windows(
     free(windows);
 }
 
+static void
+verify_general_stat_window_chunks(
+    tsk_treeseq_t *ts, tsk_size_t num_windows, tsk_flags_t options)
+{
+    int ret;
+    tsk_size_t num_samples = tsk_treeseq_get_num_samples(ts);
+    tsk_size_t K = 2;
+    tsk_size_t M = 3;
+    tsk_size_t row_size = M;
+    double *W = tsk_malloc(K * num_samples * sizeof(double));
+    double *windows = tsk_malloc((num_windows + 1) * sizeof(*windows));
+    double *sigma, *sigma_chunks;
+    double L = tsk_treeseq_get_sequence_length(ts);
+    tsk_size_t j, k, split;
+    CU_ASSERT_FATAL(W != NULL);
+    CU_ASSERT_FATAL(windows != NULL);
+
+    if (options & TSK_STAT_NODE) {
+        row_size = M * tsk_treeseq_get_num_nodes(ts);
+    }
+    sigma = tsk_calloc(row_size * num_windows, sizeof(double));
+    sigma_chunks = tsk_calloc(row_size * num_windows, sizeof(double));
+    CU_ASSERT_FATAL(sigma != NULL);
+    CU_ASSERT_FATAL(sigma_chunks != NULL);
+
+    for (j = 0; j < num_samples; j++) {
+        for (k = 0; k < K; k++) {
+            W[j * K + k] = (double) ((j + k) % 3);
+        }
+    }
+    /* Windows that don't line up with tree boundaries */
+    windows[0] = 0;
+    windows[num_windows] = L;
+    for (j = 1; j < num_windows; j++) {
+        windows[j] = ((double) j) * L / (double) num_windows + 0.1 * L / 3;
+    }
+    ret = tsk_treeseq_general_stat(
+        ts, K, W, M, general_stat_sum, NULL, num_windows, windows, options, sigma);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Computing each window on its own gives the same values */
+    for (j = 0; j < num_windows; j++) {
+        ret = tsk_treeseq_general_stat(ts, K, W, M, general_stat_sum, NULL, 1,
+            windows + j, options, sigma_chunks + j * row_size);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+    for (j = 0; j < num_windows * row_size; j++) {
+        CU_ASSERT_DOUBLE_EQUAL_FATAL(sigma[j], sigma_chunks[j], 1e-8);
+    }
+
+    /* As does splitting the windows into two contiguous chunks */
+    split = num_windows / 2;
+    if (split > 0) {
+        tsk_memset(sigma_chunks, 0, row_size * num_windows * sizeof(double));
+        ret = tsk_treeseq_general_stat(ts, K, W, M, general_stat_sum, NULL, split,
+            windows, options, sigma_chunks);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_treeseq_general_stat(ts, K, W, M, general_stat_sum, NULL,
+            num_windows - split, windows + split, options,
+            sigma_chunks + split * row_size);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (j = 0; j < num_windows * row_size; j++) {
+            CU_ASSERT_DOUBLE_EQUAL_FATAL(sigma[j], sigma_chunks[j], 1e-8);
+        }
+    }
+
+    free(W);
+    free(windows);
+    free(sigma);
+    free(sigma_chunks);
+}
+
+static void
+verify_branch_general_stat_time_windows_identity(tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_size_t num_samples = tsk_treeseq_get_num_samples(ts);
+    tsk_size_t num_trees = tsk_treeseq_get_num_trees(ts);
+    double max_time = ts->max_time;
+    double time_windows[] = { 0, max_time / 3, max_time / 2, INFINITY };
+    tsk_size_t num_time_windows = 3;
+    double *W = tsk_malloc(num_samples * sizeof(double));
+    tsk_id_t *nodes = tsk_malloc(tsk_treeseq_get_num_nodes(ts) * sizeof(*nodes));
+    double *sigma = tsk_malloc(num_trees * num_time_windows * sizeof(*sigma));
+    const double *node_time = ts->tables->nodes.time;
+    tsk_id_t u, v;
+    tsk_size_t num_nodes;
+    double s, lower, upper;
+    tsk_tree_t tree;
+    tsk_size_t j, t;
+    CU_ASSERT_FATAL(W != NULL);
+    CU_ASSERT_FATAL(nodes != NULL);
+    CU_ASSERT_FATAL(sigma != NULL);
+
+    for (j = 0; j < num_samples; j++) {
+        W[j] = 1;
+    }
+    ret = tsk_treeseq_general_stat_time_windows(ts, 1, W, 1, general_stat_identity,
+        NULL, num_trees, tsk_treeseq_get_breakpoints(ts), num_time_windows,
+        time_windows, TSK_STAT_BRANCH | TSK_STAT_POLARISED | TSK_STAT_SPAN_NORMALISE,
+        sigma);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_tree_init(&tree, ts, 0);
+    CU_ASSERT_EQUAL(ret, 0);
+    for (ret = tsk_tree_first(&tree); ret == TSK_TREE_OK; ret = tsk_tree_next(&tree)) {
+        ret = tsk_tree_preorder(&tree, nodes, &num_nodes);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (t = 0; t < num_time_windows; t++) {
+            s = 0;
+            for (j = 0; j < num_nodes; j++) {
+                u = nodes[j];
+                v = tree.parent[u];
+                if (v != TSK_NULL) {
+                    lower = TSK_MAX(node_time[u], time_windows[t]);
+                    upper = TSK_MIN(node_time[v], time_windows[t + 1]);
+                    if (upper > lower) {
+                        s += (upper - lower) * (double) tree.num_samples[u];
+                    }
+                }
+            }
+            CU_ASSERT_DOUBLE_EQUAL_FATAL(
+                sigma[(tsk_size_t) tree.index * num_time_windows + t], s, 1e-6);
+        }
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    free(nodes);
+    tsk_tree_free(&tree);
+    free(W);
+    free(sigma);
+}
+
+static void
+verify_general_stat_time_windows(
+    tsk_treeseq_t *ts, tsk_size_t num_windows, tsk_flags_t options)
+{
+    int ret;
+    tsk_size_t num_samples = tsk_treeseq_get_num_samples(ts);
+    tsk_size_t K = 2;
+    tsk_size_t M = 3;
+    double max_time = ts->max_time;
+    double time_windows[] = { 0, max_time / 4, max_time / 2, max_time, INFINITY };
+    tsk_size_t num_time_windows = 4;
+    double *W = tsk_malloc(K * num_samples * sizeof(double));
+    double *windows = tsk_malloc((num_windows + 1) * sizeof(*windows));
+    double *sigma = tsk_calloc(num_windows * M, sizeof(double));
+    double *sigma_time = tsk_calloc(num_windows * num_time_windows * M, sizeof(double));
+    double *sigma_single = tsk_calloc(num_windows * M, sizeof(double));
+    double L = tsk_treeseq_get_sequence_length(ts);
+    double total;
+    tsk_size_t j, k, m, t;
+    CU_ASSERT_FATAL(W != NULL);
+    CU_ASSERT_FATAL(windows != NULL);
+    CU_ASSERT_FATAL(sigma != NULL);
+    CU_ASSERT_FATAL(sigma_time != NULL);
+    CU_ASSERT_FATAL(sigma_single != NULL);
+
+    options |= TSK_STAT_BRANCH;
+    for (j = 0; j < num_samples; j++) {
+        for (k = 0; k < K; k++) {
+            W[j * K + k] = (double) ((j + k) % 3);
+        }
+    }
+    windows[0] = 0;
+    windows[num_windows] = L;
+    for (j = 1; j < num_windows; j++) {
+        windows[j] = ((double) j) * L / (double) num_windows;
+    }
+    ret = tsk_treeseq_general_stat(
+        ts, K, W, M, general_stat_sum, NULL, num_windows, windows, options, sigma);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_general_stat_time_windows(ts, K, W, M, general_stat_sum, NULL,
+        num_windows, windows, num_time_windows, time_windows, options, sigma_time);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* The time windows cover all node times, so they sum to the total */
+    for (j = 0; j < num_windows; j++) {
+        for (m = 0; m < M; m++) {
+            total = 0;
+            for (t = 0; t < num_time_windows; t++) {
+                total += sigma_time[(j * num_time_windows + t) * M + m];
+            }
+            CU_ASSERT_DOUBLE_EQUAL_FATAL(total, sigma[j * M + m], 1e-8);
+        }
+    }
+
+    /* Each time window on its own gives the same values */
+    for (t = 0; t < num_time_windows; t++) {
+        ret = tsk_treeseq_general_stat_time_windows(ts, K, W, M, general_stat_sum, NULL,
+            num_windows, windows, 1, time_windows + t, options, sigma_single);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (j = 0; j < num_windows; j++) {
+            for (m = 0; m < M; m++) {
+                CU_ASSERT_DOUBLE_EQUAL_FATAL(sigma_single[j * M + m],
+                    sigma_time[(j * num_time_windows + t) * M + m], 1e-8);
+            }
+        }
+    }
+
+    /* NULL time windows are the same as the untimed stat */
+    ret = tsk_treeseq_general_stat_time_windows(ts, K, W, M, general_stat_sum, NULL,
+        num_windows, windows, 0, NULL, options, sigma_single);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(tsk_memcmp(sigma, sigma_single, num_windows * M * sizeof(double)), 0);
+
+    free(W);
+    free(windows);
+    free(sigma);
+    free(sigma_time);
+    free(sigma_single);
+}
+
+static void
+verify_general_stat_time_windows_errors(tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_size_t num_samples = tsk_treeseq_get_num_samples(ts);
+    double *W = tsk_calloc(num_samples, sizeof(double));
+    double sigma[10];
+    double time_windows[] = { 0, 1, 1, INFINITY };
+    double nan_time_windows[] = { 0, NAN };
+    CU_ASSERT_FATAL(W != NULL);
+
+    ret = tsk_treeseq_general_stat_time_windows(ts, 1, W, 1, general_stat_sum, NULL, 0,
+        NULL, 0, time_windows, TSK_STAT_BRANCH, sigma);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_TIME_WINDOWS);
+    ret = tsk_treeseq_general_stat_time_windows(ts, 1, W, 1, general_stat_sum, NULL, 0,
+        NULL, 3, time_windows, TSK_STAT_BRANCH, sigma);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_TIME_WINDOWS);
+    ret = tsk_treeseq_general_stat_time_windows(ts, 1, W, 1, general_stat_sum, NULL, 0,
+        NULL, 1, nan_time_windows, TSK_STAT_BRANCH, sigma);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_TIME_WINDOWS);
+    ret = tsk_treeseq_general_stat_time_windows(ts, 1, W, 1, general_stat_sum, NULL, 0,
+        NULL, 1, time_windows, TSK_STAT_SITE, sigma);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+    ret = tsk_treeseq_general_stat_time_windows(ts, 1, W, 1, general_stat_sum, NULL, 0,
+        NULL, 1, time_windows, TSK_STAT_NODE, sigma);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+    ret = tsk_treeseq_general_stat_time_windows(ts, 1, W, 1, general_stat_sum, NULL, 0,
+        NULL, 1, time_windows, 0, sigma);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+
+    free(W);
+}
+
 static void
 verify_default_general_stat(tsk_treeseq_t *ts)
 {
@@ -858,6 +1401,118 @@ verify_general_stat(tsk_treeseq_t *ts, tsk_flags_t mode)
     verify_general_stat_windows(ts, 10, mode | TSK_STAT_SPAN_NORMALISE);
     verify_general_stat_windows(ts, 100, mode);
     verify_general_stat_windows(ts, 100, mode | TSK_STAT_SPAN_NORMALISE);
+    verify_general_stat_window_chunks(ts, 1, mode);
+    verify_general_stat_window_chunks(ts, 3, mode);
+    verify_general_stat_window_chunks(ts, 3, mode | TSK_STAT_POLARISED);
+    verify_general_stat_window_chunks(ts, 10, mode | TSK_STAT_SPAN_NORMALISE);
+}
+
+static void
+verify_sparse_afs_options(tsk_treeseq_t *ts, tsk_size_t num_sample_sets,
+    const tsk_size_t *sample_set_sizes, const tsk_id_t *samples,
+    tsk_size_t num_windows, const double *windows, tsk_flags_t options)
+{
+    int ret;
+    tsk_size_t j, k, e, offset, afs_size, n_windows;
+    tsk_size_t *projection = tsk_malloc(num_sample_sets * sizeof(*projection));
+    double *result, *sparse_result, total, sparse_total;
+    tsk_sparse_afs_t afs;
+
+    CU_ASSERT_FATAL(projection != NULL);
+    n_windows = num_windows == 0 ? 1 : num_windows;
+    afs_size = 1;
+    for (k = 0; k < num_sample_sets; k++) {
+        afs_size *= sample_set_sizes[k] + 1;
+    }
+    result = tsk_malloc(n_windows * afs_size * sizeof(*result));
+    sparse_result = tsk_calloc(n_windows * afs_size, sizeof(*sparse_result));
+    CU_ASSERT_FATAL(result != NULL && sparse_result != NULL);
+
+    ret = tsk_treeseq_allele_frequency_spectrum(ts, num_sample_sets, sample_set_sizes,
+        samples, num_windows, windows, options, result);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_sparse_allele_frequency_spectrum(ts, num_sample_sets,
+        sample_set_sizes, samples, NULL, num_windows, windows, options, &afs);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    /* tsk_sparse_afs_print_state(&afs, stdout); */
+    CU_ASSERT_EQUAL_FATAL(afs.num_sample_sets, num_sample_sets);
+    CU_ASSERT_EQUAL_FATAL(afs.num_windows, n_windows);
+    CU_ASSERT_EQUAL_FATAL(afs.window_offset[0], 0);
+    CU_ASSERT_EQUAL_FATAL(afs.window_offset[n_windows], afs.num_entries);
+    for (j = 0; j < n_windows; j++) {
+        CU_ASSERT_FATAL(afs.window_offset[j] <= afs.window_offset[j + 1]);
+        for (e = afs.window_offset[j]; e < afs.window_offset[j + 1]; e++) {
+            offset = 0;
+            for (k = 0; k < num_sample_sets; k++) {
+                CU_ASSERT_EQUAL_FATAL(afs.shape[k], sample_set_sizes[k] + 1);
+                CU_ASSERT_FATAL(afs.coordinates[e * num_sample_sets + k] < afs.shape[k]);
+                offset = offset * afs.shape[k] + afs.coordinates[e * num_sample_sets + k];
+            }
+            /* Each cell is stored at most once */
+            CU_ASSERT_EQUAL_FATAL(sparse_result[j * afs_size + offset], 0);
+            CU_ASSERT_FATAL(afs.values[e] != 0);
+            sparse_result[j * afs_size + offset] = afs.values[e];
+        }
+    }
+    for (j = 0; j < n_windows * afs_size; j++) {
+        CU_ASSERT_DOUBLE_EQUAL_FATAL(result[j], sparse_result[j], 1e-9);
+    }
+    tsk_sparse_afs_free(&afs);
+
+    /* Projecting to the sample set sizes is the identity */
+    ret = tsk_treeseq_sparse_allele_frequency_spectrum(ts, num_sample_sets,
+        sample_set_sizes, samples, sample_set_sizes, num_windows, windows, options,
+        &afs);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(afs.window_offset[n_windows], afs.num_entries);
+    tsk_sparse_afs_free(&afs);
+
+    /* Projection preserves the total in each window */
+    for (k = 0; k < num_sample_sets; k++) {
+        projection[k] = sample_set_sizes[k] / 2;
+    }
+    ret = tsk_treeseq_sparse_allele_frequency_spectrum(ts, num_sample_sets,
+        sample_set_sizes, samples, projection, num_windows, windows, options, &afs);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < n_windows; j++) {
+        total = 0;
+        for (e = 0; e < afs_size; e++) {
+            total += result[j * afs_size + e];
+        }
+        sparse_total = 0;
+        for (e = afs.window_offset[j]; e < afs.window_offset[j + 1]; e++) {
+            for (k = 0; k < num_sample_sets; k++) {
+                CU_ASSERT_FATAL(
+                    afs.coordinates[e * num_sample_sets + k] <= projection[k]);
+            }
+            sparse_total += afs.values[e];
+        }
+        CU_ASSERT_DOUBLE_EQUAL_FATAL(total, sparse_total, 1e-9);
+    }
+    tsk_sparse_afs_free(&afs);
+
+    free(result);
+    free(sparse_result);
+    free(projection);
+}
+
+static void
+verify_sparse_afs(tsk_treeseq_t *ts, tsk_size_t num_sample_sets,
+    const tsk_size_t *sample_set_sizes, const tsk_id_t *samples)
+{
+    double L = tsk_treeseq_get_sequence_length(ts);
+    double windows[] = { 0, L / 4, L / 2, L };
+    tsk_flags_t options[] = { 0, TSK_STAT_POLARISED,
+        TSK_STAT_POLARISED | TSK_STAT_SPAN_NORMALISE, TSK_STAT_BRANCH,
+        TSK_STAT_BRANCH | TSK_STAT_POLARISED | TSK_STAT_SPAN_NORMALISE };
+    tsk_size_t j;
+
+    for (j = 0; j < sizeof(options) / sizeof(*options); j++) {
+        verify_sparse_afs_options(
+            ts, num_sample_sets, sample_set_sizes, samples, 0, NULL, options[j]);
+        verify_sparse_afs_options(
+            ts, num_sample_sets, sample_set_sizes, samples, 3, windows, options[j]);
+    }
 }
 
 static void
@@ -893,6 +1548,9 @@ verify_afs(tsk_treeseq_t *ts)
         NULL, TSK_STAT_BRANCH | TSK_STAT_SPAN_NORMALISE, result);
     CU_ASSERT_EQUAL_FATAL(ret, 0);
 
+    verify_sparse_afs(ts, 2, sample_set_sizes, samples);
+    verify_sparse_afs(ts, 1, &n, samples);
+
     free(result);
 }
 
@@ -1048,6 +1706,7 @@ test_single_tree_general_stat_errors(void)
     verify_branch_general_stat_errors(&ts);
     verify_site_general_stat_errors(&ts);
     verify_node_general_stat_errors(&ts);
+    verify_general_stat_time_windows_errors(&ts);
     tsk_treeseq_free(&ts);
 }
 
@@ -1284,10 +1943,14 @@ test_paper_ex_general_stat(void)
     tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
         paper_ex_mutations, paper_ex_individuals, NULL, 0);
     verify_branch_general_stat_identity(&ts);
+    verify_branch_general_stat_time_windows_identity(&ts);
     verify_default_general_stat(&ts);
     verify_general_stat(&ts, TSK_STAT_BRANCH);
     verify_general_stat(&ts, TSK_STAT_SITE);
     verify_general_stat(&ts, TSK_STAT_NODE);
+    verify_general_stat_time_windows(&ts, 1, 0);
+    verify_general_stat_time_windows(&ts, 3, TSK_STAT_POLARISED);
+    verify_general_stat_time_windows(&ts, 4, TSK_STAT_SPAN_NORMALISE);
     tsk_treeseq_free(&ts);
 }
 
@@ -1321,7 +1984,8 @@ test_paper_ex_diversity(void)
     tsk_treeseq_t ts;
     tsk_id_t samples[] = { 0, 1, 2, 3 };
     tsk_size_t sample_set_sizes = 4;
-    double pi;
+    double time_windows[] = { 0, 0.1, INFINITY };
+    double pi, pi_time[2];
     int ret;
 
     tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
@@ -1332,6 +1996,17 @@ test_paper_ex_diversity(void)
     CU_ASSERT_EQUAL_FATAL(ret, 0);
     CU_ASSERT_DOUBLE_EQUAL_FATAL(pi, 1.5, 1e-6);
 
+    /* The time windowed branch diversity sums to the branch diversity */
+    ret = tsk_treeseq_diversity(
+        &ts, 1, &sample_set_sizes, samples, 0, NULL, TSK_STAT_BRANCH, &pi);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_diversity_time_windows(&ts, 1, &sample_set_sizes, samples, 0,
+        NULL, 2, time_windows, TSK_STAT_BRANCH, pi_time);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT(pi_time[0] > 0);
+    CU_ASSERT(pi_time[1] > 0);
+    CU_ASSERT_DOUBLE_EQUAL_FATAL(pi_time[0] + pi_time[1], pi, 1e-8);
+
     /* A sample set size of 1 leads to NaN */
     sample_set_sizes = 1;
     ret = tsk_treeseq_diversity(
@@ -1550,7 +2225,8 @@ test_paper_ex_divergence(void)
     tsk_id_t samples[] = { 0, 1, 2, 3 };
     tsk_size_t sample_set_sizes[] = { 2, 2 };
     tsk_id_t set_indexes[] = { 0, 1 };
-    double result;
+    double time_windows[] = { 0, 0.1, INFINITY };
+    double result, result_time[2];
     int ret;
 
     tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
@@ -1560,6 +2236,18 @@ test_paper_ex_divergence(void)
         NULL, TSK_STAT_SITE, &result);
     CU_ASSERT_EQUAL_FATAL(ret, 0);
 
+    /* The time windowed branch divergence sums to the branch divergence */
+    ret = tsk_treeseq_divergence(&ts, 2, sample_set_sizes, samples, 1, set_indexes, 0,
+        NULL, TSK_STAT_BRANCH, &result);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_divergence_time_windows(&ts, 2, sample_set_sizes, samples, 1,
+        set_indexes, 0, NULL, 2, time_windows, TSK_STAT_BRANCH, result_time);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_DOUBLE_EQUAL_FATAL(result_time[0] + result_time[1], result, 1e-8);
+    ret = tsk_treeseq_divergence_time_windows(&ts, 2, sample_set_sizes, samples, 1,
+        set_indexes, 0, NULL, 2, time_windows, TSK_STAT_SITE, result_time);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+
     /* sample_set[0] size = 1 with indexes = (0, 0) leads to NaN */
     sample_set_sizes[0] = 1;
     set_indexes[1] = 0;
@@ -1571,6 +2259,44 @@ test_paper_ex_divergence(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+test_paper_ex_divergence_matrix_windows(void)
+{
+    tsk_treeseq_t ts;
+    /* Windows ending inside trees and on the breakpoints at 2 and 7 */
+    double windows[] = { 0, 0.5, 2, 6, 7, 7.5, 10 };
+    double sub_windows[] = { 1, 2.5, 4, 9 };
+    tsk_flags_t options[]
+        = { TSK_STAT_BRANCH, TSK_STAT_BRANCH | TSK_STAT_SPAN_NORMALISE, TSK_STAT_SITE };
+    tsk_size_t j;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
+        paper_ex_mutations, paper_ex_individuals, NULL, 0);
+
+    for (j = 0; j < sizeof(options) / sizeof(*options); j++) {
+        verify_divergence_matrix_windows(&ts, 1, windows + 5, options[j]);
+        verify_divergence_matrix_windows(&ts, 6, windows, options[j]);
+        verify_divergence_matrix_windows(&ts, 3, sub_windows, options[j]);
+    }
+    tsk_treeseq_free(&ts);
+}
+
+static void
+test_nonbinary_ex_divergence_matrix_windows(void)
+{
+    tsk_treeseq_t ts;
+    double windows[] = { 0, 17, 50, 100 };
+
+    tsk_treeseq_from_text(&ts, 100, nonbinary_ex_nodes, nonbinary_ex_edges, NULL,
+        nonbinary_ex_sites, nonbinary_ex_mutations, NULL, NULL, 0);
+
+    verify_divergence_matrix(&ts, TSK_STAT_BRANCH);
+    verify_divergence_matrix_windows(&ts, 3, windows, TSK_STAT_BRANCH);
+    verify_divergence_matrix_windows(
+        &ts, 3, windows, TSK_STAT_BRANCH | TSK_STAT_SPAN_NORMALISE);
+    tsk_treeseq_free(&ts);
+}
+
 static void
 test_paper_ex_genetic_relatedness(void)
 {
@@ -1629,6 +2355,77 @@ test_paper_ex_genetic_relatedness_weighted(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+test_paper_ex_genetic_relatedness_vector(void)
+{
+    tsk_treeseq_t ts;
+    double windows[] = { 0, 2.5, 7, 10 };
+    tsk_flags_t options[] = { TSK_STAT_BRANCH,
+        TSK_STAT_SPAN_NORMALISE | TSK_STAT_BRANCH, TSK_STAT_POLARISED | TSK_STAT_BRANCH };
+    tsk_size_t j, k;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
+        paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    for (j = 0; j < sizeof(options) / sizeof(*options); j++) {
+        for (k = 1; k < 4; k++) {
+            verify_genetic_relatedness_vector(&ts, k, 0, NULL, options[j]);
+            verify_genetic_relatedness_vector(&ts, k, 3, windows, options[j]);
+            verify_genetic_relatedness_vector(&ts, k, 2, windows + 1, options[j]);
+        }
+    }
+    tsk_treeseq_free(&ts);
+}
+
+static void
+test_nonbinary_ex_genetic_relatedness_vector(void)
+{
+    tsk_treeseq_t ts;
+    double windows[] = { 0, 17, 50, 100 };
+
+    tsk_treeseq_from_text(&ts, 100, nonbinary_ex_nodes, nonbinary_ex_edges, NULL,
+        nonbinary_ex_sites, nonbinary_ex_mutations, NULL, NULL, 0);
+    verify_genetic_relatedness_vector(&ts, 1, 0, NULL, TSK_STAT_BRANCH);
+    verify_genetic_relatedness_vector(&ts, 5, 3, windows, TSK_STAT_BRANCH);
+    verify_genetic_relatedness_vector(
+        &ts, 2, 3, windows, TSK_STAT_SPAN_NORMALISE | TSK_STAT_BRANCH);
+    tsk_treeseq_free(&ts);
+}
+
+static void
+test_paper_ex_genetic_relatedness_vector_errors(void)
+{
+    tsk_treeseq_t ts;
+    double weights[4] = { 1, 2, 3, 4 };
+    double bad_windows[] = { 0, 11 };
+    double result[4];
+    int ret;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
+        paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    ret = tsk_treeseq_genetic_relatedness_vector(
+        &ts, 1, weights, 0, NULL, result, TSK_STAT_SITE);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+    ret = tsk_treeseq_genetic_relatedness_vector(
+        &ts, 1, weights, 0, NULL, result, TSK_STAT_NODE);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+    /* There is no default mode */
+    ret = tsk_treeseq_genetic_relatedness_vector(&ts, 1, weights, 0, NULL, result, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+    ret = tsk_treeseq_genetic_relatedness_vector(
+        &ts, 1, weights, 0, NULL, result, TSK_STAT_BRANCH | TSK_STAT_SITE);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+    ret = tsk_treeseq_genetic_relatedness_vector(
+        &ts, 0, weights, 0, NULL, result, TSK_STAT_BRANCH);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_INSUFFICIENT_WEIGHTS);
+    ret = tsk_treeseq_genetic_relatedness_vector(
+        &ts, 1, weights, 1, bad_windows, result, TSK_STAT_BRANCH);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_WINDOWS);
+    ret = tsk_treeseq_genetic_relatedness_vector(
+        &ts, 1, weights, 0, bad_windows, result, TSK_STAT_BRANCH);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_NUM_WINDOWS);
+    tsk_treeseq_free(&ts);
+}
+
 static void
 test_paper_ex_genetic_relatedness_weighted_errors(void)
 {
@@ -1831,6 +2628,9 @@ test_paper_ex_afs_errors(void)
     tsk_size_t sample_set_sizes[] = { 2, 2 };
     tsk_id_t samples[] = { 0, 1, 2, 3 };
     double result[10]; /* not thinking too hard about the actual value needed */
+    double windows[] = { 0, 5 };
+    tsk_size_t projection[] = { 2, 3 };
+    tsk_sparse_afs_t afs;
     int ret;
 
     tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
@@ -1846,6 +2646,21 @@ test_paper_ex_afs_errors(void)
         NULL, TSK_STAT_BRANCH | TSK_STAT_SITE, result);
     CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_MULTIPLE_STAT_MODES);
 
+    ret = tsk_treeseq_sparse_allele_frequency_spectrum(
+        &ts, 2, sample_set_sizes, samples, NULL, 0, NULL, TSK_STAT_NODE, &afs);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNSUPPORTED_STAT_MODE);
+    tsk_sparse_afs_free(&afs);
+
+    ret = tsk_treeseq_sparse_allele_frequency_spectrum(
+        &ts, 2, sample_set_sizes, samples, NULL, 1, windows, 0, &afs);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_WINDOWS);
+    tsk_sparse_afs_free(&afs);
+
+    ret = tsk_treeseq_sparse_allele_frequency_spectrum(
+        &ts, 2, sample_set_sizes, samples, projection, 0, NULL, 0, &afs);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_AFS_PROJECTION);
+    tsk_sparse_afs_free(&afs);
+
     tsk_treeseq_free(&ts);
 }
 
@@ -1855,7 +2670,10 @@ test_paper_ex_afs(void)
     tsk_treeseq_t ts;
     tsk_id_t samples[] = { 0, 1, 2, 3 };
     tsk_size_t sample_set_sizes[] = { 4, 0 };
+    tsk_size_t projection[] = { 2 };
     double result[25];
+    tsk_sparse_afs_t afs;
+    tsk_size_t j;
     int ret;
 
     tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
@@ -1878,6 +2696,22 @@ test_paper_ex_afs(void)
     CU_ASSERT_EQUAL_FATAL(result[3], 1.0);
     CU_ASSERT_EQUAL_FATAL(result[4], 0);
 
+    /* Projecting to two samples, each singleton gives half a singleton and each
+     * tripleton gives half a singleton and half a doubleton */
+    ret = tsk_treeseq_sparse_allele_frequency_spectrum(&ts, 1, sample_set_sizes,
+        samples, projection, 0, NULL, TSK_STAT_POLARISED, &afs);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(afs.shape[0], 3);
+    CU_ASSERT_EQUAL_FATAL(afs.num_entries, 3);
+    tsk_memset(result, 0, sizeof(result));
+    for (j = 0; j < afs.num_entries; j++) {
+        result[afs.coordinates[j]] = afs.values[j];
+    }
+    CU_ASSERT_DOUBLE_EQUAL_FATAL(result[0], 1.0, 1e-12);
+    CU_ASSERT_DOUBLE_EQUAL_FATAL(result[1], 1.5, 1e-12);
+    CU_ASSERT_DOUBLE_EQUAL_FATAL(result[2], 0.5, 1e-12);
+    tsk_sparse_afs_free(&afs);
+
     verify_afs(&ts);
     tsk_treeseq_free(&ts);
 }
@@ -1987,6 +2821,86 @@ test_caterpillar_tree_ld(void)
     free(ts);
 }
 
+static void
+test_caterpillar_tree_sparse_afs(void)
+{
+    tsk_treeseq_t *ts = caterpillar_tree(50, 20, 1);
+    const tsk_id_t *all_samples = tsk_treeseq_get_samples(ts);
+    tsk_size_t sample_set_sizes[] = { 17, 17, 16 };
+    tsk_id_t samples[50];
+    tsk_size_t j, k, l;
+
+    /* Interleave the sample sets along the caterpillar so that the projected
+     * counts cover enough cells for the accumulator table to grow */
+    l = 0;
+    for (k = 0; k < 3; k++) {
+        for (j = k; j < 50; j += 3) {
+            samples[l] = all_samples[j];
+            l++;
+        }
+    }
+    verify_sparse_afs(ts, 3, sample_set_sizes, samples);
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
+static void
+test_caterpillar_tree_two_site_blocks(void)
+{
+    tsk_treeseq_t *ts = caterpillar_tree(50, 20, 1);
+    tsk_size_t num_sites = tsk_treeseq_get_num_sites(ts);
+    tsk_size_t num_samples = tsk_treeseq_get_num_samples(ts);
+    tsk_size_t block_size = 5;
+    tsk_size_t max_dist = 3;
+    tsk_size_t j, r, c, num_rows, num_cols;
+    tsk_id_t *sites = tsk_malloc(num_sites * sizeof(*sites));
+    double *full = tsk_malloc(num_sites * num_sites * sizeof(*full));
+    double *block = tsk_malloc(num_sites * num_sites * sizeof(*block));
+    tsk_id_t row_start, col_start;
+    int ret;
+
+    CU_ASSERT_FATAL(sites != NULL && full != NULL && block != NULL);
+    for (j = 0; j < num_sites; j++) {
+        sites[j] = (tsk_id_t) j;
+    }
+    /* The output doesn't need to be initialised */
+    tsk_memset(full, 0xff, num_sites * num_sites * sizeof(*full));
+    ret = tsk_treeseq_r2(ts, 1, &num_samples, tsk_treeseq_get_samples(ts), num_sites,
+        sites, num_sites, sites, 0, full);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < num_sites; j++) {
+        CU_ASSERT_DOUBLE_EQUAL_FATAL(full[j * num_sites + j], 1, 1e-12);
+    }
+
+    /* Compute a band of the matrix using a series of independent calls on
+     * blocks of rows, with the columns restricted to the band. Each entry must
+     * match the corresponding entry of the full matrix. */
+    for (row_start = 0; row_start < (tsk_id_t) num_sites;
+         row_start += (tsk_id_t) block_size) {
+        num_rows = TSK_MIN(block_size, num_sites - (tsk_size_t) row_start);
+        col_start = TSK_MAX(0, row_start - (tsk_id_t) max_dist);
+        num_cols = TSK_MIN(num_sites, (tsk_size_t) row_start + num_rows + max_dist)
+                   - (tsk_size_t) col_start;
+        ret = tsk_treeseq_r2(ts, 1, &num_samples, tsk_treeseq_get_samples(ts),
+            num_rows, sites + row_start, num_cols, sites + col_start, 0, block);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (r = 0; r < num_rows; r++) {
+            for (c = 0; c < num_cols; c++) {
+                CU_ASSERT_DOUBLE_EQUAL_FATAL(block[r * num_cols + c],
+                    full[((tsk_size_t) row_start + r) * num_sites
+                         + (tsk_size_t) col_start + c],
+                    1e-12);
+            }
+        }
+    }
+
+    free(sites);
+    free(full);
+    free(block);
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
 static void
 test_ld_multi_mutations(void)
 {
@@ -2842,6 +3756,12 @@ main(int argc, char **argv)
             test_paper_ex_genetic_relatedness_weighted },
         { "test_paper_ex_genetic_relatedness_weighted_errors",
             test_paper_ex_genetic_relatedness_weighted_errors },
+        { "test_paper_ex_genetic_relatedness_vector",
+            test_paper_ex_genetic_relatedness_vector },
+        { "test_nonbinary_ex_genetic_relatedness_vector",
+            test_nonbinary_ex_genetic_relatedness_vector },
+        { "test_paper_ex_genetic_relatedness_vector_errors",
+            test_paper_ex_genetic_relatedness_vector_errors },
         { "test_paper_ex_Y2_errors", test_paper_ex_Y2_errors },
         { "test_paper_ex_Y2", test_paper_ex_Y2 },
         { "test_paper_ex_f2_errors", test_paper_ex_f2_errors },
@@ -2855,6 +3775,10 @@ main(int argc, char **argv)
         { "test_paper_ex_afs_errors", test_paper_ex_afs_errors },
         { "test_paper_ex_afs", test_paper_ex_afs },
         { "test_paper_ex_divergence_matrix", test_paper_ex_divergence_matrix },
+        { "test_paper_ex_divergence_matrix_windows",
+            test_paper_ex_divergence_matrix_windows },
+        { "test_nonbinary_ex_divergence_matrix_windows",
+            test_nonbinary_ex_divergence_matrix_windows },
 
         { "test_nonbinary_ex_ld", test_nonbinary_ex_ld },
         { "test_nonbinary_ex_mean_descendants", test_nonbinary_ex_mean_descendants },
@@ -2865,6 +3789,9 @@ main(int argc, char **argv)
             test_nonbinary_ex_general_stat_errors },
 
         { "test_caterpillar_tree_ld", test_caterpillar_tree_ld },
+        { "test_caterpillar_tree_sparse_afs", test_caterpillar_tree_sparse_afs },
+        { "test_caterpillar_tree_two_site_blocks",
+            test_caterpillar_tree_two_site_blocks },
         { "test_ld_multi_mutations", test_ld_multi_mutations },
         { "test_ld_silent_mutations", test_ld_silent_mutations },
 
@@ -1409,6 +1409,92 @@ test_node_table_takeset(void)
     CU_ASSERT_EQUAL(ret, 0);
 }
 
+static void
+test_node_table_append_in_place(void)
+{
+    int ret;
+    tsk_id_t ret_id, start;
+    tsk_node_table_t table, source;
+    tsk_size_t j, k;
+    const tsk_size_t num_rows = 100;
+
+    ret = tsk_node_table_init(&table, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_node_table_init(&source, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret_id = tsk_node_table_add_row(&table, 1, 0, 0, 0, "x", 1);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret_id = tsk_node_table_add_row(&source, 1, 0, 0, 0, "x", 1);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    for (j = 0; j < num_rows; j++) {
+        ret_id = tsk_node_table_add_row(&source, (tsk_flags_t) j, (double) j,
+            (tsk_id_t) j, TSK_NULL, "abc", j % 2 == 0 ? 3 : 0);
+        CU_ASSERT_EQUAL_FATAL(ret_id, (tsk_id_t) j + 1);
+    }
+
+    start = tsk_node_table_append_begin(&table, num_rows, 3 * num_rows);
+    CU_ASSERT_EQUAL_FATAL(start, 1);
+    k = (tsk_size_t) start;
+    CU_ASSERT_FATAL(table.max_rows >= k + num_rows);
+    CU_ASSERT_EQUAL_FATAL(table.num_rows, 1);
+    for (j = 0; j < num_rows; j++) {
+        table.flags[k + j] = (tsk_flags_t) j;
+        table.time[k + j] = (double) j;
+        table.population[k + j] = (tsk_id_t) j;
+        table.individual[k + j] = TSK_NULL;
+        table.metadata_offset[k + j + 1] = table.metadata_offset[k + j];
+        if (j % 2 == 0) {
+            tsk_memcpy(table.metadata + table.metadata_offset[k + j], "abc", 3);
+            table.metadata_offset[k + j + 1] += 3;
+        }
+    }
+    ret = tsk_node_table_append_commit(&table, num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_node_table_equals(&table, &source, 0));
+
+    /* Committing fewer rows than reserved leaves the rest out */
+    start = tsk_node_table_append_begin(&table, 10, 0);
+    CU_ASSERT_EQUAL_FATAL(start, (tsk_id_t) num_rows + 1);
+    k = (tsk_size_t) start;
+    for (j = 0; j < 10; j++) {
+        table.flags[k + j] = 0;
+        table.time[k + j] = -1;
+        table.population[k + j] = TSK_NULL;
+        table.individual[k + j] = TSK_NULL;
+    }
+    ret = tsk_node_table_append_commit(&table, 5);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(table.num_rows, num_rows + 6);
+    CU_ASSERT_EQUAL_FATAL(table.metadata_length, source.metadata_length);
+    ret = tsk_node_table_truncate(&table, num_rows + 1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_node_table_equals(&table, &source, 0));
+
+    /* Bad offsets are caught at commit time */
+    start = tsk_node_table_append_begin(&table, 2, 1);
+    CU_ASSERT_EQUAL_FATAL(start, (tsk_id_t) num_rows + 1);
+    k = (tsk_size_t) start;
+    table.metadata_offset[k + 1] = table.metadata_length + 2;
+    ret = tsk_node_table_append_commit(&table, 2);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_OFFSET);
+    table.metadata_offset[k + 1] = table.metadata_length + table.max_metadata_length;
+    table.metadata_offset[k + 2] = table.metadata_offset[k + 1];
+    ret = tsk_node_table_append_commit(&table, 2);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_OFFSET);
+    ret = tsk_node_table_append_commit(&table, table.max_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    CU_ASSERT_TRUE(tsk_node_table_equals(&table, &source, 0));
+
+    ret_id = tsk_node_table_append_begin(
+        &table, TSK_MAX_ID + (tsk_size_t) 1 - table.num_rows, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, TSK_ERR_TABLE_OVERFLOW);
+    ret_id = tsk_node_table_append_begin(&table, 1, TSK_MAX_SIZE);
+    CU_ASSERT_EQUAL_FATAL(ret_id, TSK_ERR_COLUMN_OVERFLOW);
+
+    tsk_node_table_free(&table);
+    tsk_node_table_free(&source);
+}
+
 static void
 test_node_table_update_row(void)
 {
@@ -2456,6 +2542,75 @@ test_edge_table_takeset(void)
     test_edge_table_takeset_with_options(0);
 }
 
+static void
+test_edge_table_append_in_place_with_options(tsk_flags_t table_options)
+{
+    int ret;
+    tsk_id_t ret_id, start;
+    tsk_edge_table_t table, source;
+    tsk_size_t j, k;
+    const tsk_size_t num_rows = 100;
+
+    ret = tsk_edge_table_init(&table, table_options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_edge_table_init(&source, table_options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < num_rows; j++) {
+        ret_id = tsk_edge_table_add_row(&source, (double) j, (double) j + 1,
+            (tsk_id_t) j, (tsk_id_t) j + 1, NULL, 0);
+        CU_ASSERT_EQUAL_FATAL(ret_id, (tsk_id_t) j);
+    }
+
+    start = tsk_edge_table_append_begin(&table, num_rows, 0);
+    CU_ASSERT_EQUAL_FATAL(start, 0);
+    k = (tsk_size_t) start;
+    for (j = 0; j < num_rows; j++) {
+        table.left[k + j] = (double) j;
+        table.right[k + j] = (double) j + 1;
+        table.parent[k + j] = (tsk_id_t) j;
+        table.child[k + j] = (tsk_id_t) j + 1;
+    }
+    ret = tsk_edge_table_append_commit(&table, num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_edge_table_equals(&table, &source, 0));
+
+    ret = tsk_edge_table_append_commit(&table, table.max_rows - table.num_rows + 1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_edge_table_append_commit(&table, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_edge_table_equals(&table, &source, 0));
+
+    if (table_options & TSK_TABLE_NO_METADATA) {
+        ret_id = tsk_edge_table_append_begin(&table, 1, 1);
+        CU_ASSERT_EQUAL_FATAL(ret_id, TSK_ERR_METADATA_DISABLED);
+    } else {
+        ret_id = tsk_edge_table_add_row(&source, 0, 1, 2, 3, "abcd", 4);
+        CU_ASSERT_EQUAL_FATAL(ret_id, (tsk_id_t) num_rows);
+        start = tsk_edge_table_append_begin(&table, 1, 4);
+        CU_ASSERT_EQUAL_FATAL(start, (tsk_id_t) num_rows);
+        k = (tsk_size_t) start;
+        table.left[k] = 0;
+        table.right[k] = 1;
+        table.parent[k] = 2;
+        table.child[k] = 3;
+        tsk_memcpy(table.metadata + table.metadata_offset[k], "abcd", 4);
+        table.metadata_offset[k + 1] = table.metadata_offset[k] + 4;
+        ret = tsk_edge_table_append_commit(&table, 1);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_edge_table_equals(&table, &source, 0));
+    }
+
+    tsk_edge_table_free(&table);
+    tsk_edge_table_free(&source);
+}
+
+static void
+test_edge_table_append_in_place(void)
+{
+    test_edge_table_append_in_place_with_options(0);
+    test_edge_table_append_in_place_with_options(TSK_TABLE_NO_METADATA);
+}
+
 static void
 test_edge_table_copy_semantics(void)
 {
@@ -3152,6 +3307,53 @@ test_site_table_takeset(void)
     CU_ASSERT_EQUAL(ret, 0);
 }
 
+static void
+test_site_table_append_in_place(void)
+{
+    int ret;
+    tsk_id_t ret_id, start;
+    tsk_site_table_t table, source;
+    tsk_size_t j, k, offset;
+    const tsk_size_t num_rows = 100;
+
+    ret = tsk_site_table_init(&table, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_site_table_init(&source, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < num_rows; j++) {
+        ret_id = tsk_site_table_add_row(&source, (double) j, "AC", 1 + j % 2, NULL, 0);
+        CU_ASSERT_EQUAL_FATAL(ret_id, (tsk_id_t) j);
+    }
+
+    start = tsk_site_table_append_begin(&table, num_rows, 2 * num_rows, 0);
+    CU_ASSERT_EQUAL_FATAL(start, 0);
+    k = (tsk_size_t) start;
+    for (j = 0; j < num_rows; j++) {
+        table.position[k + j] = (double) j;
+        offset = table.ancestral_state_offset[k + j];
+        tsk_memcpy(table.ancestral_state + offset, "AC", 1 + j % 2);
+        table.ancestral_state_offset[k + j + 1] = offset + 1 + j % 2;
+    }
+    ret = tsk_site_table_append_commit(&table, num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_site_table_equals(&table, &source, 0));
+
+    start = tsk_site_table_append_begin(&table, 1, 1, 1);
+    CU_ASSERT_EQUAL_FATAL(start, (tsk_id_t) num_rows);
+    k = (tsk_size_t) start;
+    table.ancestral_state_offset[k] = 0;
+    ret = tsk_site_table_append_commit(&table, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_OFFSET);
+    table.ancestral_state_offset[k] = table.ancestral_state_length;
+    table.metadata_offset[k + 1] = table.max_metadata_length + 1;
+    ret = tsk_site_table_append_commit(&table, 1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_OFFSET);
+    CU_ASSERT_TRUE(tsk_site_table_equals(&table, &source, 0));
+
+    tsk_site_table_free(&table);
+    tsk_site_table_free(&source);
+}
+
 static void
 test_site_table_update_row(void)
 {
@@ -3911,6 +4113,59 @@ test_mutation_table_takeset(void)
     CU_ASSERT_EQUAL(ret, 0);
 }
 
+static void
+test_mutation_table_append_in_place(void)
+{
+    int ret;
+    tsk_id_t ret_id, start;
+    tsk_mutation_table_t table, source;
+    tsk_size_t j, k, offset;
+    const tsk_size_t num_rows = 100;
+
+    ret = tsk_mutation_table_init(&table, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_mutation_table_init(&source, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < num_rows; j++) {
+        ret_id = tsk_mutation_table_add_row(&source, (tsk_id_t) j, (tsk_id_t) j,
+            TSK_NULL, (double) j, "T", 1, "md", j % 3 == 0 ? 2 : 0);
+        CU_ASSERT_EQUAL_FATAL(ret_id, (tsk_id_t) j);
+    }
+
+    start = tsk_mutation_table_append_begin(&table, num_rows, num_rows, 2 * num_rows);
+    CU_ASSERT_EQUAL_FATAL(start, 0);
+    k = (tsk_size_t) start;
+    for (j = 0; j < num_rows; j++) {
+        table.site[k + j] = (tsk_id_t) j;
+        table.node[k + j] = (tsk_id_t) j;
+        table.parent[k + j] = TSK_NULL;
+        table.time[k + j] = (double) j;
+        table.derived_state[k + j] = 'T';
+        table.derived_state_offset[k + j + 1] = k + j + 1;
+        offset = table.metadata_offset[k + j];
+        if (j % 3 == 0) {
+            tsk_memcpy(table.metadata + offset, "md", 2);
+            offset += 2;
+        }
+        table.metadata_offset[k + j + 1] = offset;
+    }
+    ret = tsk_mutation_table_append_commit(&table, num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_mutation_table_equals(&table, &source, 0));
+
+    start = tsk_mutation_table_append_begin(&table, 2, 2, 0);
+    CU_ASSERT_EQUAL_FATAL(start, (tsk_id_t) num_rows);
+    k = (tsk_size_t) start;
+    table.derived_state_offset[k + 1] = table.derived_state_length + 2;
+    table.derived_state_offset[k + 2] = table.derived_state_length + 1;
+    ret = tsk_mutation_table_append_commit(&table, 2);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_OFFSET);
+    CU_ASSERT_TRUE(tsk_mutation_table_equals(&table, &source, 0));
+
+    tsk_mutation_table_free(&table);
+    tsk_mutation_table_free(&source);
+}
+
 static void
 test_mutation_table_update_row(void)
 {
@@ -7496,6 +7751,119 @@ test_table_expansion(void)
     tsk_table_collection_free(&tables2);
 }
 
+static void
+test_table_reserve(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_table_collection_t tables;
+    tsk_bookmark_t num_rows;
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Reserving space for a known number of rows allocates exactly that */
+    ret = tsk_node_table_reserve(&tables.nodes, 5000);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.max_rows, 5000);
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.num_rows, 0);
+
+    /* Reserving fewer rows than we have space for is a no-op */
+    ret = tsk_node_table_reserve(&tables.nodes, 10);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.max_rows, 5000);
+
+    /* Adding rows up to the reserved size doesn't grow the table */
+    for (ret_id = 0; ret_id < 5000; ret_id++) {
+        CU_ASSERT_EQUAL_FATAL(
+            tsk_node_table_add_row(&tables.nodes, 0, 0, TSK_NULL, TSK_NULL, NULL, 0),
+            ret_id);
+    }
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.max_rows, 5000);
+    ret = tsk_node_table_reserve(&tables.nodes, 5000);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.max_rows, 5000);
+
+    /* Reserving a small number of extra rows uses the usual strategy */
+    ret = tsk_node_table_reserve(&tables.nodes, 5001);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.max_rows, 10000);
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.num_rows, 5000);
+
+    ret = tsk_node_table_reserve(&tables.nodes, TSK_MAX_ID + (tsk_size_t) 2);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLE_OVERFLOW);
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.max_rows, 10000);
+
+    num_rows.individuals = 11;
+    num_rows.nodes = 12;
+    num_rows.edges = 13;
+    num_rows.migrations = 14;
+    num_rows.sites = 15;
+    num_rows.mutations = 16;
+    num_rows.populations = 17;
+    num_rows.provenances = 18;
+    ret = tsk_table_collection_reserve(&tables, &num_rows);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    /* Small reservations are subject to the minimum allocation size */
+    CU_ASSERT_EQUAL(tables.individuals.max_rows, 1024);
+    CU_ASSERT_EQUAL(tables.nodes.max_rows, 10000);
+    CU_ASSERT_EQUAL(tables.edges.max_rows, 1024);
+    CU_ASSERT_EQUAL(tables.migrations.max_rows, 1024);
+    CU_ASSERT_EQUAL(tables.sites.max_rows, 1024);
+    CU_ASSERT_EQUAL(tables.mutations.max_rows, 1024);
+    CU_ASSERT_EQUAL(tables.populations.max_rows, 1024);
+    CU_ASSERT_EQUAL(tables.provenances.max_rows, 1024);
+    CU_ASSERT_EQUAL(tables.edges.num_rows, 0);
+
+    /* The tables are still usable after reserving */
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0, 1, 0, 1, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret_id = tsk_population_table_add_row(&tables.populations, "x", 1);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret_id = tsk_provenance_table_add_row(&tables.provenances, "a", 1, "b", 1);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret_id = tsk_individual_table_add_row(
+        &tables.individuals, 0, NULL, 0, NULL, 0, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret_id = tsk_site_table_add_row(&tables.sites, 0, "A", 1, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret_id = tsk_mutation_table_add_row(
+        &tables.mutations, 0, 0, TSK_NULL, TSK_UNKNOWN_TIME, "T", 1, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+    ret_id = tsk_migration_table_add_row(&tables.migrations, 0, 1, 0, 0, 1, 0, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret_id, 0);
+
+    tsk_table_collection_free(&tables);
+}
+
+static void
+test_table_geometric_expansion(void)
+{
+    int ret;
+    tsk_population_table_t table;
+
+    ret = tsk_population_table_init(&table, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Below ~8 million rows we add at most 2^21 rows at a time */
+    ret = tsk_population_table_reserve(&table, 8000000);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(table.max_rows, 8000000);
+    ret = tsk_population_table_reserve(&table, 8000001);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(table.max_rows, 8000000 + 2097152);
+
+    /* Above this, the table grows by 25% */
+    ret = tsk_population_table_reserve(&table, 10097153);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(table.max_rows, 10097152 + 2524288);
+    ret = tsk_population_table_reserve(&table, 12621441);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(table.max_rows, 12621440 + 3155360);
+
+    tsk_population_table_free(&table);
+}
+
 static void
 test_ragged_expansion(void)
 {
@@ -7872,29 +8240,28 @@ verify_ibd_result(tsk_identity_segments_t *result)
         = tsk_malloc(2 * tsk_identity_segments_get_num_pairs(result) * sizeof(*pairs));
     tsk_identity_segment_list_t **lists
         = tsk_malloc(tsk_identity_segments_get_num_pairs(result) * sizeof(*lists));
-    tsk_avl_node_int_t **avl_nodes
-        = tsk_malloc(result->pair_map.size * sizeof(*avl_nodes));
+    tsk_identity_segment_list_t *list;
 
     CU_ASSERT_FATAL(pairs != NULL);
     CU_ASSERT_FATAL(pairs2 != NULL);
-    CU_ASSERT_FATAL(avl_nodes != NULL);
     CU_ASSERT_FATAL(lists != NULL);
-    CU_ASSERT_EQUAL_FATAL(num_pairs, result->pair_map.size);
+    CU_ASSERT_EQUAL_FATAL(num_pairs, result->num_pairs);
+    CU_ASSERT_FATAL(2 * num_pairs <= result->pair_table_size);
     tsk_identity_segments_print_state(result, _devnull);
 
     ret = tsk_identity_segments_get_keys(result, pairs);
     CU_ASSERT_EQUAL_FATAL(ret, 0);
-    ret = tsk_avl_tree_int_ordered_nodes(&result->pair_map, avl_nodes);
-    CU_ASSERT_EQUAL_FATAL(ret, 0);
 
     for (j = 0; j < num_pairs; j++) {
         a = pairs[2 * j];
         b = pairs[2 * j + 1];
         index = a * (int64_t) result->num_nodes + b;
         CU_ASSERT(a < b);
-        CU_ASSERT_EQUAL(tsk_avl_tree_int_search(&result->pair_map, index), avl_nodes[j]);
-        index = b * (int64_t) result->num_nodes + a;
-        CU_ASSERT_EQUAL(tsk_avl_tree_int_search(&result->pair_map, index), NULL);
+        CU_ASSERT_EQUAL(result->pairs[j].key, index);
+        if (j > 0) {
+            /* Keys are returned in increasing order */
+            CU_ASSERT(result->pairs[j - 1].key < index);
+        }
     }
 
     ret = tsk_identity_segments_get_items(result, pairs2, lists);
@@ -7902,6 +8269,12 @@ verify_ibd_result(tsk_identity_segments_t *result)
     for (j = 0; j < num_pairs; j++) {
         CU_ASSERT_EQUAL_FATAL(pairs[2 * j], pairs2[2 * j]);
         CU_ASSERT_EQUAL_FATAL(pairs[2 * j + 1], pairs2[2 * j + 1]);
+        ret = tsk_identity_segments_get(result, pairs[2 * j], pairs[2 * j + 1], &list);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(list, lists[j]);
+        ret = tsk_identity_segments_get(result, pairs[2 * j + 1], pairs[2 * j], &list);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(list, lists[j]);
         verify_ibd_segment_list(lists[j], result->num_nodes);
         total_segments += lists[j]->num_segments;
         total_span += lists[j]->total_span;
@@ -7912,7 +8285,6 @@ verify_ibd_result(tsk_identity_segments_t *result)
     free(pairs);
     free(pairs2);
     free(lists);
-    free(avl_nodes);
 }
 
 static void
@@ -8573,6 +8945,382 @@ test_ibd_segments_odd_topologies(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+verify_ibd_segments_equal(tsk_identity_segments_t *r1, tsk_identity_segments_t *r2)
+{
+    int ret;
+    tsk_size_t j;
+    tsk_size_t num_pairs = tsk_identity_segments_get_num_pairs(r1);
+    tsk_id_t *pairs1 = tsk_malloc((2 * num_pairs + 1) * sizeof(*pairs1));
+    tsk_id_t *pairs2 = tsk_malloc((2 * num_pairs + 1) * sizeof(*pairs2));
+    tsk_identity_segment_list_t **lists1 = tsk_malloc((num_pairs + 1) * sizeof(*lists1));
+    tsk_identity_segment_list_t **lists2 = tsk_malloc((num_pairs + 1) * sizeof(*lists2));
+    tsk_identity_segment_t *seg1, *seg2;
+
+    CU_ASSERT_FATAL(pairs1 != NULL && pairs2 != NULL);
+    CU_ASSERT_FATAL(lists1 != NULL && lists2 != NULL);
+    CU_ASSERT_EQUAL_FATAL(tsk_identity_segments_get_num_segments(r1), r2->num_segments);
+    CU_ASSERT_DOUBLE_EQUAL_FATAL(
+        tsk_identity_segments_get_total_span(r1), r2->total_span, 1e-9);
+    if (r1->store_pairs) {
+        CU_ASSERT_EQUAL_FATAL(num_pairs, tsk_identity_segments_get_num_pairs(r2));
+        ret = tsk_identity_segments_get_items(r1, pairs1, lists1);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_identity_segments_get_items(r2, pairs2, lists2);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (j = 0; j < num_pairs; j++) {
+            CU_ASSERT_EQUAL_FATAL(pairs1[2 * j], pairs2[2 * j]);
+            CU_ASSERT_EQUAL_FATAL(pairs1[2 * j + 1], pairs2[2 * j + 1]);
+            CU_ASSERT_EQUAL_FATAL(lists1[j]->num_segments, lists2[j]->num_segments);
+            CU_ASSERT_DOUBLE_EQUAL_FATAL(
+                lists1[j]->total_span, lists2[j]->total_span, 1e-9);
+            seg2 = lists2[j]->head;
+            for (seg1 = lists1[j]->head; seg1 != NULL; seg1 = seg1->next) {
+                CU_ASSERT_FATAL(seg2 != NULL);
+                CU_ASSERT_EQUAL_FATAL(seg1->left, seg2->left);
+                CU_ASSERT_EQUAL_FATAL(seg1->right, seg2->right);
+                CU_ASSERT_EQUAL_FATAL(seg1->node, seg2->node);
+                seg2 = seg2->next;
+            }
+            CU_ASSERT_EQUAL_FATAL(seg2, NULL);
+        }
+    }
+    free(pairs1);
+    free(pairs2);
+    free(lists1);
+    free(lists2);
+}
+
+/* Split the samples into chunks and check that merging the results for
+ * the pairs within and between chunks gives the same result as the full run. */
+static void
+verify_ibd_segments_merge(tsk_treeseq_t *ts, tsk_size_t num_chunks, tsk_flags_t options)
+{
+    int ret;
+    tsk_size_t j, k;
+    const tsk_id_t *samples = tsk_treeseq_get_samples(ts);
+    tsk_size_t num_samples = tsk_treeseq_get_num_samples(ts);
+    tsk_size_t chunk_size = (num_samples + num_chunks - 1) / num_chunks;
+    tsk_size_t *chunk_start = tsk_malloc((num_chunks + 1) * sizeof(*chunk_start));
+    tsk_id_t *sample_sets = tsk_malloc((num_samples + 1) * sizeof(*sample_sets));
+    tsk_size_t sample_set_sizes[2];
+    tsk_identity_segments_t full, merged, part;
+
+    CU_ASSERT_FATAL(chunk_start != NULL && sample_sets != NULL);
+    for (j = 0; j <= num_chunks; j++) {
+        chunk_start[j] = TSK_MIN(j * chunk_size, num_samples);
+    }
+
+    ret = tsk_table_collection_ibd_within(
+        ts->tables, &full, NULL, 0, 0.0, DBL_MAX, options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_table_collection_ibd_within(ts->tables, &merged, samples + chunk_start[0],
+        chunk_start[1] - chunk_start[0], 0.0, DBL_MAX, options);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < num_chunks; j++) {
+        if (j > 0) {
+            ret = tsk_table_collection_ibd_within(ts->tables, &part,
+                samples + chunk_start[j], chunk_start[j + 1] - chunk_start[j], 0.0,
+                DBL_MAX, options);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_identity_segments_merge(&merged, &part);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            tsk_identity_segments_free(&part);
+        }
+        for (k = j + 1; k < num_chunks; k++) {
+            sample_set_sizes[0] = chunk_start[j + 1] - chunk_start[j];
+            sample_set_sizes[1] = chunk_start[k + 1] - chunk_start[k];
+            tsk_memcpy(sample_sets, samples + chunk_start[j],
+                sample_set_sizes[0] * sizeof(*sample_sets));
+            tsk_memcpy(sample_sets + sample_set_sizes[0], samples + chunk_start[k],
+                sample_set_sizes[1] * sizeof(*sample_sets));
+            ret = tsk_table_collection_ibd_between(ts->tables, &part, 2,
+                sample_set_sizes, sample_sets, 0.0, DBL_MAX, options);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret = tsk_identity_segments_merge(&merged, &part);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            tsk_identity_segments_free(&part);
+        }
+    }
+    if (options & TSK_IBD_STORE_SEGMENTS) {
+        verify_ibd_result(&merged);
+    }
+    verify_ibd_segments_equal(&full, &merged);
+
+    tsk_identity_segments_free(&full);
+    tsk_identity_segments_free(&merged);
+    free(chunk_start);
+    free(sample_sets);
+}
+
+static void
+test_ibd_segments_merge(void)
+{
+    int ret;
+    tsk_size_t j, k;
+    tsk_treeseq_t ts;
+    tsk_treeseq_t *cat = caterpillar_tree(16, 1, 1);
+    tsk_identity_segments_t r1, r2;
+    tsk_flags_t options[]
+        = { 0, TSK_IBD_STORE_PAIRS, TSK_IBD_STORE_PAIRS | TSK_IBD_STORE_SEGMENTS };
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, NULL, NULL,
+        paper_ex_individuals, NULL, 0);
+
+    for (j = 0; j < sizeof(options) / sizeof(*options); j++) {
+        for (k = 1; k < 5; k++) {
+            verify_ibd_segments_merge(&ts, k, options[j]);
+            verify_ibd_segments_merge(cat, k, options[j]);
+        }
+    }
+
+    ret = tsk_table_collection_ibd_within(
+        ts.tables, &r1, NULL, 0, 0.0, DBL_MAX, TSK_IBD_STORE_SEGMENTS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_identity_segments_merge(&r1, &r1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    ret = tsk_table_collection_ibd_within(
+        ts.tables, &r2, NULL, 0, 0.0, DBL_MAX, TSK_IBD_STORE_PAIRS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_identity_segments_merge(&r1, &r2);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IBD_SEGMENTS_NOT_STORED);
+    /* Merging more information into less is fine */
+    ret = tsk_identity_segments_merge(&r2, &r1);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(r2.num_segments, 2 * r1.num_segments);
+    tsk_identity_segments_free(&r2);
+
+    ret = tsk_table_collection_ibd_within(ts.tables, &r2, NULL, 0, 0.0, DBL_MAX, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_identity_segments_merge(&r1, &r2);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_IBD_PAIRS_NOT_STORED);
+    tsk_identity_segments_free(&r2);
+
+    ret = tsk_table_collection_ibd_within(cat->tables, &r2, NULL, 0, 0.0, DBL_MAX, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_identity_segments_merge(&r2, &r1);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    tsk_identity_segments_free(&r2);
+    tsk_identity_segments_free(&r1);
+
+    tsk_treeseq_free(&ts);
+    tsk_treeseq_free(cat);
+    free(cat);
+}
+
+static void
+test_ibd_segments_many_pairs(void)
+{
+    int ret;
+    tsk_size_t j, k;
+    tsk_treeseq_t *cat = caterpillar_tree(64, 1, 1);
+    tsk_identity_segments_t r1, r2;
+    tsk_identity_segment_list_t *list;
+    tsk_size_t num_pairs = 64 * 63 / 2;
+
+    /* Enough pairs that the pair table is resized during the search */
+    ret = tsk_table_collection_ibd_within(
+        cat->tables, &r1, NULL, 0, 0.0, DBL_MAX, TSK_IBD_STORE_SEGMENTS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(tsk_identity_segments_get_num_pairs(&r1), num_pairs);
+    verify_ibd_result(&r1);
+
+    /* Merging repeatedly grows the segment array for every pair */
+    for (k = 2; k <= 5; k++) {
+        ret = tsk_table_collection_ibd_within(
+            cat->tables, &r2, NULL, 0, 0.0, DBL_MAX, TSK_IBD_STORE_SEGMENTS);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_identity_segments_merge(&r1, &r2);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        tsk_identity_segments_free(&r2);
+        CU_ASSERT_EQUAL_FATAL(tsk_identity_segments_get_num_pairs(&r1), num_pairs);
+        verify_ibd_result(&r1);
+        for (j = 0; j < 64; j++) {
+            ret = tsk_identity_segments_get(&r1, (tsk_id_t) j, (tsk_id_t)((j + 1) % 64),
+                &list);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_FATAL(list != NULL);
+            CU_ASSERT_EQUAL_FATAL(list->num_segments, k);
+            CU_ASSERT_EQUAL_FATAL(list->tail, list->head + k - 1);
+        }
+    }
+    tsk_identity_segments_free(&r1);
+
+    tsk_treeseq_free(cat);
+    free(cat);
+}
+
+typedef struct {
+    tsk_size_t num_segments;
+    tsk_size_t max_segments;
+    tsk_id_t *pairs;
+    tsk_identity_segment_t *segments;
+    tsk_size_t error_at;
+} ibd_stream_t;
+
+static int
+ibd_stream_func(
+    tsk_id_t a, tsk_id_t b, double left, double right, tsk_id_t node, void *params)
+{
+    ibd_stream_t *stream = (ibd_stream_t *) params;
+    tsk_size_t j = stream->num_segments;
+
+    CU_ASSERT_FATAL(a < b);
+    CU_ASSERT_FATAL(left < right);
+    if (j == stream->error_at) {
+        return -12345;
+    }
+    if (j == stream->max_segments) {
+        stream->max_segments = TSK_MAX(16, 2 * stream->max_segments);
+        stream->pairs = tsk_realloc(
+            stream->pairs, 2 * stream->max_segments * sizeof(*stream->pairs));
+        stream->segments = tsk_realloc(
+            stream->segments, stream->max_segments * sizeof(*stream->segments));
+        CU_ASSERT_FATAL(stream->pairs != NULL && stream->segments != NULL);
+    }
+    stream->pairs[2 * j] = a;
+    stream->pairs[2 * j + 1] = b;
+    stream->segments[j].left = left;
+    stream->segments[j].right = right;
+    stream->segments[j].node = node;
+    stream->num_segments++;
+    return 0;
+}
+
+/* Check the streamed segments are the same as stored ones, in the same order
+ * for each pair. */
+static void
+verify_ibd_stream(ibd_stream_t *stream, tsk_identity_segments_t *result)
+{
+    int ret;
+    tsk_size_t j, k;
+    tsk_size_t num_pairs = tsk_identity_segments_get_num_pairs(result);
+    tsk_id_t *pairs = tsk_malloc((2 * num_pairs + 1) * sizeof(*pairs));
+    tsk_identity_segment_list_t **lists = tsk_malloc((num_pairs + 1) * sizeof(*lists));
+    tsk_identity_segment_t *seg;
+
+    CU_ASSERT_FATAL(pairs != NULL && lists != NULL);
+    CU_ASSERT_EQUAL_FATAL(
+        stream->num_segments, tsk_identity_segments_get_num_segments(result));
+    ret = tsk_identity_segments_get_items(result, pairs, lists);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < num_pairs; j++) {
+        seg = lists[j]->head;
+        for (k = 0; k < stream->num_segments; k++) {
+            if (stream->pairs[2 * k] == pairs[2 * j]
+                && stream->pairs[2 * k + 1] == pairs[2 * j + 1]) {
+                CU_ASSERT_FATAL(seg != NULL);
+                CU_ASSERT_EQUAL_FATAL(seg->left, stream->segments[k].left);
+                CU_ASSERT_EQUAL_FATAL(seg->right, stream->segments[k].right);
+                CU_ASSERT_EQUAL_FATAL(seg->node, stream->segments[k].node);
+                seg = seg->next;
+            }
+        }
+        CU_ASSERT_EQUAL_FATAL(seg, NULL);
+    }
+    free(pairs);
+    free(lists);
+}
+
+static void
+test_ibd_segments_stream(void)
+{
+    int ret;
+    tsk_size_t j;
+    tsk_treeseq_t ts;
+    tsk_treeseq_t *cat = caterpillar_tree(10, 1, 1);
+    tsk_treeseq_t *examples[2];
+    tsk_identity_segments_t result;
+    ibd_stream_t stream;
+    tsk_id_t sample_sets[] = { 0, 1, 2, 3 };
+    tsk_size_t sample_set_sizes[] = { 1, 3 };
+    double min_span[] = { 0, 2 };
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, NULL, NULL,
+        paper_ex_individuals, NULL, 0);
+    examples[0] = &ts;
+    examples[1] = cat;
+
+    for (j = 0; j < 4; j++) {
+        tsk_memset(&stream, 0, sizeof(stream));
+        stream.error_at = TSK_MAX_SIZE - 1;
+        ret = tsk_table_collection_ibd_within(examples[j % 2]->tables, &result, NULL, 0,
+            min_span[j / 2], DBL_MAX, TSK_IBD_STORE_SEGMENTS);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_ibd_within_stream(examples[j % 2]->tables, NULL, 0,
+            min_span[j / 2], DBL_MAX, ibd_stream_func, &stream, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        verify_ibd_stream(&stream, &result);
+        tsk_identity_segments_free(&result);
+
+        stream.num_segments = 0;
+        ret = tsk_table_collection_ibd_between(examples[j % 2]->tables, &result, 2,
+            sample_set_sizes, sample_sets, min_span[j / 2], 1.0,
+            TSK_IBD_STORE_SEGMENTS);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_ibd_between_stream(examples[j % 2]->tables, 2,
+            sample_set_sizes, sample_sets, min_span[j / 2], 1.0, ibd_stream_func,
+            &stream, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        verify_ibd_stream(&stream, &result);
+        tsk_identity_segments_free(&result);
+        free(stream.pairs);
+        free(stream.segments);
+    }
+
+    /* Errors in the callback stop the search */
+    tsk_memset(&stream, 0, sizeof(stream));
+    stream.error_at = 2;
+    ret = tsk_table_collection_ibd_within_stream(
+        ts.tables, NULL, 0, 0.0, DBL_MAX, ibd_stream_func, &stream, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, -12345);
+    CU_ASSERT_EQUAL_FATAL(stream.num_segments, 2);
+    stream.num_segments = 0;
+    ret = tsk_table_collection_ibd_between_stream(ts.tables, 2, sample_set_sizes,
+        sample_sets, 0.0, DBL_MAX, ibd_stream_func, &stream, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, -12345);
+    CU_ASSERT_EQUAL_FATAL(stream.num_segments, 2);
+    free(stream.pairs);
+    free(stream.segments);
+
+    ret = tsk_table_collection_ibd_within_stream(
+        ts.tables, NULL, 0, -1, DBL_MAX, ibd_stream_func, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_table_collection_ibd_between_stream(ts.tables, 2, sample_set_sizes,
+        sample_sets, 0, -1, ibd_stream_func, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_table_collection_ibd_within_stream(
+        ts.tables, NULL, 0, 0.0, DBL_MAX, NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_table_collection_ibd_between_stream(ts.tables, 2, sample_set_sizes,
+        sample_sets, 0.0, DBL_MAX, NULL, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    sample_sets[1] = 0;
+    ret = tsk_table_collection_ibd_between_stream(ts.tables, 2, sample_set_sizes,
+        sample_sets, 0, DBL_MAX, ibd_stream_func, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_DUPLICATE_SAMPLE);
+
+    tsk_set_debug_stream(_devnull);
+    tsk_memset(&stream, 0, sizeof(stream));
+    stream.error_at = TSK_MAX_SIZE - 1;
+    ret = tsk_table_collection_ibd_within_stream(
+        ts.tables, NULL, 0, 0.0, DBL_MAX, ibd_stream_func, &stream, TSK_DEBUG);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    sample_sets[1] = 1;
+    ret = tsk_table_collection_ibd_between_stream(ts.tables, 2, sample_set_sizes,
+        sample_sets, 0.0, DBL_MAX, ibd_stream_func, &stream, TSK_DEBUG);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_set_debug_stream(stdout);
+    free(stream.pairs);
+    free(stream.segments);
+
+    tsk_treeseq_free(&ts);
+    tsk_treeseq_free(cat);
+    free(cat);
+}
+
 static void
 test_simplify_tables_drops_indexes(void)
 {
@@ -8629,6 +9377,88 @@ test_simplify_metadata(void)
     tsk_table_collection_free(&tables);
 }
 
+static void
+test_build_index_parent_order(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_table_collection_t tables;
+    tsk_size_t j;
+    tsk_id_t *I, *O;
+    /* Edges for parents with the same time don't need to be sorted by
+     * parent ID, so these two tables have the same edges in valid orders */
+    double unsorted_left[] = { 0, 0, 0, 5 };
+    double unsorted_right[] = { 10, 5, 10, 10 };
+    tsk_id_t unsorted_parent[] = { 4, 4, 3, 3 };
+    tsk_id_t unsorted_child[] = { 1, 2, 0, 2 };
+    tsk_id_t unsorted_insertion[] = { 2, 0, 1, 3 };
+    tsk_id_t unsorted_removal[] = { 1, 0, 3, 2 };
+    double sorted_left[] = { 0, 5, 0, 0 };
+    double sorted_right[] = { 10, 10, 10, 5 };
+    tsk_id_t sorted_parent[] = { 3, 3, 4, 4 };
+    tsk_id_t sorted_child[] = { 0, 2, 1, 2 };
+    tsk_id_t sorted_insertion[] = { 0, 2, 3, 1 };
+    tsk_id_t sorted_removal[] = { 3, 2, 1, 0 };
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 10;
+    for (j = 0; j < 5; j++) {
+        ret_id = tsk_node_table_add_row(&tables.nodes, j < 3 ? TSK_NODE_IS_SAMPLE : 0,
+            j < 3 ? 0 : 1, TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_EQUAL_FATAL(ret_id, (tsk_id_t) j);
+    }
+
+    ret = tsk_edge_table_set_columns(&tables.edges, 4, unsorted_left, unsorted_right,
+        unsorted_parent, unsorted_child, NULL, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    I = tables.indexes.edge_insertion_order;
+    O = tables.indexes.edge_removal_order;
+    for (j = 0; j < 4; j++) {
+        CU_ASSERT_EQUAL(I[j], unsorted_insertion[j]);
+        CU_ASSERT_EQUAL(O[j], unsorted_removal[j]);
+    }
+    ret = (int) tsk_table_collection_check_integrity(&tables, TSK_CHECK_TREES);
+    CU_ASSERT_EQUAL_FATAL(ret, 2);
+
+    ret = tsk_edge_table_set_columns(&tables.edges, 4, sorted_left, sorted_right,
+        sorted_parent, sorted_child, NULL, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    I = tables.indexes.edge_insertion_order;
+    O = tables.indexes.edge_removal_order;
+    for (j = 0; j < 4; j++) {
+        CU_ASSERT_EQUAL(I[j], sorted_insertion[j]);
+        CU_ASSERT_EQUAL(O[j], sorted_removal[j]);
+    }
+    ret = (int) tsk_table_collection_check_integrity(&tables, TSK_CHECK_TREES);
+    CU_ASSERT_EQUAL_FATAL(ret, 2);
+
+    /* Negative zero coordinates sort the same as zero */
+    tables.edges.left[2] = -0.0;
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    I = tables.indexes.edge_insertion_order;
+    for (j = 0; j < 4; j++) {
+        CU_ASSERT_EQUAL(I[j], sorted_insertion[j]);
+    }
+
+    /* An empty edge table is trivially sorted by parent */
+    ret = tsk_edge_table_clear(&tables.edges);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_sort(&tables, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_has_index(&tables, 0));
+    CU_ASSERT_EQUAL(tables.indexes.num_edges, 0);
+
+    tsk_table_collection_free(&tables);
+}
+
 static void
 test_edge_update_invalidates_index(void)
 {
@@ -8808,6 +9638,107 @@ test_sort_tables_offsets(void)
     free(ts);
 }
 
+static void
+test_sort_tables_merge_edges(void)
+{
+    int ret;
+    tsk_treeseq_t *ts;
+    tsk_table_collection_t tables, sorted, copy;
+    tsk_bookmark_t bookmark;
+    tsk_edge_t edge, other;
+    tsk_id_t j, k, ret_id;
+    tsk_size_t num_prefix;
+
+    ts = caterpillar_tree(10, 5, 5);
+    ret = tsk_treeseq_copy_tables(ts, &sorted, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    insert_edge_metadata(&sorted);
+    ret = tsk_table_collection_copy(&sorted, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Keep the even numbered edges as a sorted prefix, and append the odd
+     * numbered edges in reverse order */
+    ret = tsk_edge_table_clear(&tables.edges);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < (tsk_id_t) sorted.edges.num_rows; j += 2) {
+        ret = tsk_edge_table_get_row(&sorted.edges, j, &edge);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret_id = tsk_edge_table_add_row(&tables.edges, edge.left, edge.right,
+            edge.parent, edge.child, edge.metadata, edge.metadata_length);
+        CU_ASSERT_FATAL(ret_id >= 0);
+    }
+    num_prefix = tables.edges.num_rows;
+    for (j = (tsk_id_t) sorted.edges.num_rows - 1; j >= 0; j--) {
+        if (j % 2 == 1) {
+            ret = tsk_edge_table_get_row(&sorted.edges, j, &edge);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            ret_id = tsk_edge_table_add_row(&tables.edges, edge.left, edge.right,
+                edge.parent, edge.child, edge.metadata, edge.metadata_length);
+            CU_ASSERT_FATAL(ret_id >= 0);
+        }
+    }
+    CU_ASSERT_FATAL(num_prefix > 1);
+    CU_ASSERT_FATAL(tables.edges.num_rows > num_prefix + 1);
+    ret = tsk_table_collection_copy(&tables, &copy, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_memset(&bookmark, 0, sizeof(bookmark));
+    bookmark.edges = num_prefix;
+
+    /* Without merging, only the rows after the bookmark are sorted and the
+     * prefix (including its metadata) is left untouched. */
+    ret = tsk_table_collection_sort(&tables, &bookmark, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FALSE(tsk_table_collection_equals(&tables, &sorted, 0));
+    for (j = 0; j < (tsk_id_t) tables.edges.num_rows; j++) {
+        ret = tsk_edge_table_get_row(&tables.edges, j, &edge);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        if (j < (tsk_id_t) num_prefix) {
+            ret = tsk_edge_table_get_row(&copy.edges, j, &other);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_EQUAL(edge.parent, other.parent);
+            CU_ASSERT_EQUAL(edge.child, other.child);
+            CU_ASSERT_EQUAL(edge.left, other.left);
+            CU_ASSERT_EQUAL_FATAL(edge.metadata_length, other.metadata_length);
+            CU_ASSERT_NSTRING_EQUAL(
+                edge.metadata, other.metadata, other.metadata_length);
+        } else {
+            /* Metadata follows the edges */
+            k = 2 * (j - (tsk_id_t) num_prefix) + 1;
+            ret = tsk_edge_table_get_row(&sorted.edges, k, &other);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_EQUAL_FATAL(edge.metadata_length, other.metadata_length);
+            CU_ASSERT_NSTRING_EQUAL(
+                edge.metadata, other.metadata, other.metadata_length);
+        }
+    }
+
+    /* With merging the result is fully sorted */
+    ret = tsk_table_collection_copy(&copy, &tables, TSK_NO_INIT);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_sort(&tables, &bookmark, TSK_SORT_MERGE_EDGES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, &sorted, 0));
+
+    /* Merging with an empty prefix or suffix is the same as a normal sort */
+    for (j = 0; j < 2; j++) {
+        ret = tsk_table_collection_copy(&copy, &tables, TSK_NO_INIT);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_sort(&tables, NULL, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, &sorted, 0));
+        bookmark.edges = j == 0 ? 0 : tables.edges.num_rows;
+        ret = tsk_table_collection_sort(&tables, &bookmark, TSK_SORT_MERGE_EDGES);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_TRUE(tsk_table_collection_equals(&tables, &sorted, 0));
+    }
+
+    tsk_table_collection_free(&tables);
+    tsk_table_collection_free(&sorted);
+    tsk_table_collection_free(&copy);
+    tsk_treeseq_free(ts);
+    free(ts);
+}
+
 static void
 test_sort_tables_drops_indexes_with_options(tsk_flags_t tc_options)
 {
@@ -8901,6 +9832,46 @@ test_sort_tables_no_edge_metadata(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+test_sort_tables_edge_order(void)
+{
+    int ret;
+    tsk_table_collection_t tables;
+    double node_time[] = { -2, -1, -0.0, 0.0, 0.5, 1e10 };
+    /* The edges in sorted order */
+    double left[] = { 0.5, 0, 0.125, 0.75, 0, 0, 0.3, 0.6 };
+    tsk_id_t parent[] = { 1, 2, 2, 2, 3, 4, 5, 5 };
+    tsk_id_t child[] = { 0, 0, 1, 1, 1, 3, 4, 4 };
+    tsk_size_t num_edges = sizeof(left) / sizeof(*left);
+    tsk_size_t j;
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 1;
+    for (j = 0; j < sizeof(node_time) / sizeof(*node_time); j++) {
+        ret = (int) tsk_node_table_add_row(
+            &tables.nodes, 0, node_time[j], TSK_NULL, TSK_NULL, NULL, 0);
+        CU_ASSERT_FATAL(ret >= 0);
+    }
+    for (j = 0; j < num_edges; j++) {
+        ret = (int) tsk_edge_table_add_row(&tables.edges, left[num_edges - j - 1],
+            left[num_edges - j - 1] + 0.1, parent[num_edges - j - 1],
+            child[num_edges - j - 1], NULL, 0);
+        CU_ASSERT_FATAL(ret >= 0);
+    }
+    ret = tsk_table_collection_sort(&tables, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(tables.edges.num_rows, num_edges);
+    for (j = 0; j < num_edges; j++) {
+        CU_ASSERT_EQUAL(tables.edges.left[j], left[j]);
+        CU_ASSERT_EQUAL(tables.edges.right[j], left[j] + 0.1);
+        CU_ASSERT_EQUAL(tables.edges.parent[j], parent[j]);
+        CU_ASSERT_EQUAL(tables.edges.child[j], child[j]);
+    }
+
+    tsk_table_collection_free(&tables);
+}
+
 static void
 test_sort_tables_errors(void)
 {
@@ -9254,6 +10225,136 @@ test_sort_tables_canonical(void)
     tsk_table_collection_free(&t1);
 }
 
+static void
+verify_renumber_nodes(tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_table_collection_t tables;
+    tsk_treeseq_t renumbered;
+    tsk_tree_t t1, t2;
+    const tsk_size_t num_nodes = tsk_treeseq_get_num_nodes(ts);
+    const tsk_table_collection_t *source = ts->tables;
+    tsk_id_t *node_map = malloc(num_nodes * sizeof(*node_map));
+    bool *seen = calloc(num_nodes, sizeof(*seen));
+    tsk_size_t j;
+    tsk_id_t u, v;
+
+    CU_ASSERT_FATAL(node_map != NULL && seen != NULL);
+    ret = tsk_treeseq_copy_tables(ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_renumber_nodes(&tables, 0, node_map);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FALSE(tsk_table_collection_has_index(&tables, 0));
+
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.num_rows, num_nodes);
+    for (j = 0; j < num_nodes; j++) {
+        v = node_map[j];
+        CU_ASSERT_FATAL(v >= 0 && v < (tsk_id_t) num_nodes);
+        CU_ASSERT_FATAL(!seen[v]);
+        seen[v] = true;
+        CU_ASSERT_EQUAL(tables.nodes.flags[v], source->nodes.flags[j]);
+        CU_ASSERT_EQUAL(tables.nodes.time[v], source->nodes.time[j]);
+        CU_ASSERT_EQUAL(tables.nodes.population[v], source->nodes.population[j]);
+        CU_ASSERT_EQUAL(tables.nodes.individual[v], source->nodes.individual[j]);
+    }
+    CU_ASSERT_TRUE(tsk_site_table_equals(&tables.sites, &source->sites, 0));
+    CU_ASSERT_TRUE(
+        tsk_individual_table_equals(&tables.individuals, &source->individuals, 0));
+    CU_ASSERT_EQUAL_FATAL(tables.mutations.num_rows, source->mutations.num_rows);
+    for (j = 0; j < tables.mutations.num_rows; j++) {
+        CU_ASSERT_EQUAL(tables.mutations.node[j], node_map[source->mutations.node[j]]);
+    }
+    CU_ASSERT_EQUAL_FATAL(tables.migrations.num_rows, source->migrations.num_rows);
+    for (j = 0; j < tables.migrations.num_rows; j++) {
+        CU_ASSERT_EQUAL(
+            tables.migrations.node[j], node_map[source->migrations.node[j]]);
+    }
+
+    /* The trees are the same, up to the node mapping */
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_init(&renumbered, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(
+        tsk_treeseq_get_num_trees(&renumbered), tsk_treeseq_get_num_trees(ts));
+    ret = tsk_tree_init(&t1, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_init(&t2, &renumbered, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (ret = tsk_tree_first(&t1); ret == TSK_TREE_OK; ret = tsk_tree_next(&t1)) {
+        ret = tsk_tree_next(&t2);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+        CU_ASSERT_EQUAL(t1.interval.left, t2.interval.left);
+        CU_ASSERT_EQUAL(t1.interval.right, t2.interval.right);
+        for (u = 0; u < (tsk_id_t) num_nodes; u++) {
+            v = t1.parent[u] == TSK_NULL ? TSK_NULL : node_map[t1.parent[u]];
+            CU_ASSERT_EQUAL(t2.parent[node_map[u]], v);
+        }
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    tsk_tree_free(&t1);
+    tsk_tree_free(&t2);
+    tsk_treeseq_free(&renumbered);
+    tsk_table_collection_free(&tables);
+    free(node_map);
+    free(seen);
+}
+
+static void
+test_renumber_nodes(void)
+{
+    int ret;
+    tsk_treeseq_t ts;
+    tsk_treeseq_t *caterpillar = caterpillar_tree(10, 3, 3);
+    tsk_table_collection_t tables;
+    tsk_id_t node_map[7];
+    /* A preorder of the single tree, starting at the root */
+    tsk_id_t expected_node_map[] = { 2, 3, 5, 6, 1, 4, 0 };
+    tsk_id_t expected_parent[] = { 1, 1, 4, 4, 0, 0 };
+    tsk_id_t expected_child[] = { 2, 3, 5, 6, 1, 4 };
+    tsk_size_t j;
+
+    tsk_treeseq_from_text(&ts, 1, single_tree_ex_nodes, single_tree_ex_edges, NULL,
+        single_tree_ex_sites, single_tree_ex_mutations, NULL, NULL, 0);
+    ret = tsk_treeseq_copy_tables(&ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_renumber_nodes(&tables, 0, node_map);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < 7; j++) {
+        CU_ASSERT_EQUAL(node_map[j], expected_node_map[j]);
+    }
+    CU_ASSERT_EQUAL_FATAL(tables.edges.num_rows, 6);
+    for (j = 0; j < 6; j++) {
+        CU_ASSERT_EQUAL(tables.edges.parent[j], expected_parent[j]);
+        CU_ASSERT_EQUAL(tables.edges.child[j], expected_child[j]);
+    }
+    /* The node map is optional, and renumbering a preorder is the identity */
+    ret = tsk_table_collection_renumber_nodes(&tables, 0, node_map);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (j = 0; j < 7; j++) {
+        CU_ASSERT_EQUAL(node_map[j], (tsk_id_t) j);
+    }
+    ret = tsk_table_collection_renumber_nodes(&tables, 0, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    tables.edges.child[0] = 100;
+    ret = tsk_table_collection_renumber_nodes(&tables, 0, NULL);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_NODE_OUT_OF_BOUNDS);
+    tsk_table_collection_free(&tables);
+
+    verify_renumber_nodes(&ts);
+    verify_renumber_nodes(caterpillar);
+    tsk_treeseq_free(&ts);
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, paper_ex_sites,
+        paper_ex_mutations, paper_ex_individuals, NULL, 0);
+    verify_renumber_nodes(&ts);
+    tsk_treeseq_free(&ts);
+    tsk_treeseq_free(caterpillar);
+    free(caterpillar);
+}
+
 static void
 test_sort_tables_migrations(void)
 {
@@ -10818,6 +11919,77 @@ test_table_collection_subset_unsorted(void)
     tsk_table_collection_free(&tables);
 }
 
+static void
+test_table_collection_subset_removed_references(void)
+{
+    int ret;
+    tsk_id_t ret_id;
+    tsk_table_collection_t tables;
+    tsk_id_t nodes[] = { 1, 0 };
+    tsk_id_t parents_0[] = { 2, TSK_NULL };
+    tsk_id_t parents_1[] = { 0 };
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 1;
+    ret_id = tsk_node_table_add_row(
+        &tables.nodes, TSK_NODE_IS_SAMPLE, 0.0, TSK_NULL, 0, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_node_table_add_row(
+        &tables.nodes, TSK_NODE_IS_SAMPLE, 0.0, TSK_NULL, 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_node_table_add_row(&tables.nodes, 0, 1.0, TSK_NULL, 2, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_individual_table_add_row(
+        &tables.individuals, 0, NULL, 0, parents_0, 2, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_individual_table_add_row(
+        &tables.individuals, 0, NULL, 0, parents_1, 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_individual_table_add_row(
+        &tables.individuals, 0, NULL, 0, NULL, 0, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0.0, 1.0, 2, 0, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_edge_table_add_row(&tables.edges, 0.0, 1.0, 2, 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_site_table_add_row(&tables.sites, 0.5, "A", 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_mutation_table_add_row(
+        &tables.mutations, 0, 2, TSK_NULL, TSK_UNKNOWN_TIME, "B", 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret_id = tsk_mutation_table_add_row(
+        &tables.mutations, 0, 0, 0, TSK_UNKNOWN_TIME, "C", 1, NULL, 0);
+    CU_ASSERT_FATAL(ret_id >= 0);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    ret = tsk_table_collection_subset(&tables, nodes, 2, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FALSE(tsk_table_collection_has_index(&tables, 0));
+    CU_ASSERT_EQUAL_FATAL(tables.nodes.num_rows, 2);
+    CU_ASSERT_EQUAL(tables.nodes.individual[0], 1);
+    CU_ASSERT_EQUAL(tables.nodes.individual[1], 0);
+    /* The removed parent is dropped, but the null parent is kept */
+    CU_ASSERT_EQUAL_FATAL(tables.individuals.num_rows, 2);
+    CU_ASSERT_EQUAL_FATAL(tables.individuals.parents_length, 2);
+    CU_ASSERT_EQUAL(tables.individuals.parents_offset[1], 1);
+    CU_ASSERT_EQUAL(tables.individuals.parents[0], TSK_NULL);
+    CU_ASSERT_EQUAL(tables.individuals.parents[1], 0);
+    CU_ASSERT_EQUAL(tables.edges.num_rows, 0);
+    CU_ASSERT_EQUAL(tables.sites.num_rows, 1);
+    /* The mutation whose parent is removed gets a null parent */
+    CU_ASSERT_EQUAL_FATAL(tables.mutations.num_rows, 1);
+    CU_ASSERT_EQUAL(tables.mutations.site[0], 0);
+    CU_ASSERT_EQUAL(tables.mutations.node[0], 1);
+    CU_ASSERT_EQUAL(tables.mutations.parent[0], TSK_NULL);
+    CU_ASSERT_EQUAL(tables.mutations.derived_state[0], 'C');
+    ret = (int) tsk_table_collection_check_integrity(&tables, 0);
+    CU_ASSERT_EQUAL(ret, 0);
+
+    tsk_table_collection_free(&tables);
+}
+
 static void
 test_table_collection_subset_errors(void)
 {
@@ -11542,6 +12714,7 @@ main(int argc, char **argv)
         { "test_node_table_update_row", test_node_table_update_row },
         { "test_node_table_keep_rows", test_node_table_keep_rows },
         { "test_node_table_takeset", test_node_table_takeset },
+        { "test_node_table_append_in_place", test_node_table_append_in_place },
         { "test_edge_table", test_edge_table },
         { "test_edge_table_update_row", test_edge_table_update_row },
         { "test_edge_table_update_row_no_metadata",
@@ -11550,6 +12723,7 @@ main(int argc, char **argv)
         { "test_edge_table_keep_rows_no_metadata",
             test_edge_table_keep_rows_no_metadata },
         { "test_edge_table_takeset", test_edge_table_takeset },
+        { "test_edge_table_append_in_place", test_edge_table_append_in_place },
         { "test_edge_table_copy_semantics", test_edge_table_copy_semantics },
         { "test_edge_table_squash", test_edge_table_squash },
         { "test_edge_table_squash_multiple_parents",
@@ -11562,9 +12736,11 @@ main(int argc, char **argv)
         { "test_site_table_update_row", test_site_table_update_row },
         { "test_site_table_keep_rows", test_site_table_keep_rows },
         { "test_site_table_takeset", test_site_table_takeset },
+        { "test_site_table_append_in_place", test_site_table_append_in_place },
         { "test_mutation_table", test_mutation_table },
         { "test_mutation_table_update_row", test_mutation_table_update_row },
         { "test_mutation_table_takeset", test_mutation_table_takeset },
+        { "test_mutation_table_append_in_place", test_mutation_table_append_in_place },
         { "test_mutation_table_keep_rows", test_mutation_table_keep_rows },
         { "test_mutation_table_keep_rows_parent_references",
             test_mutation_table_keep_rows_parent_references },
@@ -11588,6 +12764,8 @@ main(int argc, char **argv)
         { "test_provenance_table_takeset", test_provenance_table_takeset },
         { "test_table_size_increments", test_table_size_increments },
         { "test_table_expansion", test_table_expansion },
+        { "test_table_reserve", test_table_reserve },
+        { "test_table_geometric_expansion", test_table_geometric_expansion },
         { "test_ragged_expansion", test_ragged_expansion },
         { "test_table_collection_equals_options", test_table_collection_equals_options },
         { "test_table_collection_simplify_errors",
@@ -11629,9 +12807,13 @@ main(int argc, char **argv)
         { "test_ibd_segments_multiple_ibd_paths", test_ibd_segments_multiple_ibd_paths },
         { "test_ibd_segments_odd_topologies", test_ibd_segments_odd_topologies },
         { "test_ibd_segments_errors", test_ibd_segments_errors },
+        { "test_ibd_segments_merge", test_ibd_segments_merge },
+        { "test_ibd_segments_many_pairs", test_ibd_segments_many_pairs },
+        { "test_ibd_segments_stream", test_ibd_segments_stream },
         { "test_sorter_interface", test_sorter_interface },
         { "test_sort_tables_canonical_errors", test_sort_tables_canonical_errors },
         { "test_sort_tables_canonical", test_sort_tables_canonical },
+        { "test_renumber_nodes", test_renumber_nodes },
         { "test_sort_tables_drops_indexes", test_sort_tables_drops_indexes },
         { "test_sort_tables_edge_metadata", test_sort_tables_edge_metadata },
         { "test_sort_tables_errors", test_sort_tables_errors },
@@ -11639,8 +12821,11 @@ main(int argc, char **argv)
         { "test_sort_tables_mutation_times", test_sort_tables_mutation_times },
         { "test_sort_tables_migrations", test_sort_tables_migrations },
         { "test_sort_tables_no_edge_metadata", test_sort_tables_no_edge_metadata },
+        { "test_sort_tables_edge_order", test_sort_tables_edge_order },
         { "test_sort_tables_offsets", test_sort_tables_offsets },
+        { "test_sort_tables_merge_edges", test_sort_tables_merge_edges },
         { "test_edge_update_invalidates_index", test_edge_update_invalidates_index },
+        { "test_build_index_parent_order", test_build_index_parent_order },
         { "test_copy_table_collection", test_copy_table_collection },
         { "test_dump_unindexed", test_dump_unindexed },
         { "test_dump_load_empty", test_dump_load_empty },
@@ -11661,6 +12846,8 @@ main(int argc, char **argv)
         { "test_table_collection_subset", test_table_collection_subset },
         { "test_table_collection_subset_unsorted",
             test_table_collection_subset_unsorted },
+        { "test_table_collection_subset_removed_references",
+            test_table_collection_subset_removed_references },
         { "test_table_collection_subset_errors", test_table_collection_subset_errors },
         { "test_table_collection_union", test_table_collection_union },
         { "test_table_collection_union_middle_merge",
@@ -81,6 +81,8 @@ check_trees_identical(tsk_tree_t *self, tsk_tree_t *other)
         CU_ASSERT_FATAL(tsk_memcmp(self->num_samples, other->num_samples,
                             N * sizeof(*self->num_samples))
                         == 0);
+    }
+    if (self->num_tracked_samples != NULL) {
         CU_ASSERT_FATAL(tsk_memcmp(self->num_tracked_samples, other->num_tracked_samples,
                             N * sizeof(*self->num_tracked_samples))
                         == 0);
@@ -534,6 +536,112 @@ verify_tree_next_prev(tsk_treeseq_t *ts)
     free(trees);
 }
 
+static void
+verify_edge_diffs_range(tsk_treeseq_t *ts, tsk_id_t start, tsk_id_t stop)
+{
+    int ret;
+    tsk_edge_diffs_t diffs;
+    tsk_tree_t tree;
+    const tsk_edge_table_t *edges = &ts->tables->edges;
+    tsk_size_t num_nodes = tsk_treeseq_get_num_nodes(ts);
+    tsk_id_t *parent = tsk_malloc(num_nodes * sizeof(*parent));
+    tsk_id_t e, index;
+    tsk_size_t j, k;
+
+    CU_ASSERT_FATAL(parent != NULL);
+    tsk_memset(parent, 0xff, num_nodes * sizeof(*parent));
+    ret = tsk_edge_diffs_init(&diffs, ts, start, stop, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_edge_diffs_print_state(&diffs, _devnull);
+    ret = tsk_tree_init(&tree, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    CU_ASSERT_EQUAL(diffs.start_tree, start);
+    CU_ASSERT_EQUAL_FATAL(diffs.num_trees, (tsk_size_t)(stop - start));
+    CU_ASSERT_EQUAL(diffs.edges_in_offset[0], 0);
+    CU_ASSERT_EQUAL(diffs.edges_out_offset[0], 0);
+    CU_ASSERT_EQUAL(diffs.edges_in_offset[diffs.num_trees], diffs.num_edges_in);
+    CU_ASSERT_EQUAL(diffs.edges_out_offset[diffs.num_trees], diffs.num_edges_out);
+    if (diffs.num_trees > 0) {
+        CU_ASSERT_EQUAL(diffs.edges_out_offset[1], 0);
+    }
+    for (j = 0; j < diffs.num_trees; j++) {
+        index = start + (tsk_id_t) j;
+        for (k = diffs.edges_out_offset[j]; k < diffs.edges_out_offset[j + 1]; k++) {
+            e = diffs.edges_out[k];
+            CU_ASSERT_EQUAL(edges->right[e], ts->breakpoints[index]);
+            CU_ASSERT_EQUAL(parent[edges->child[e]], edges->parent[e]);
+            parent[edges->child[e]] = TSK_NULL;
+        }
+        for (k = diffs.edges_in_offset[j]; k < diffs.edges_in_offset[j + 1]; k++) {
+            e = diffs.edges_in[k];
+            CU_ASSERT(edges->left[e] <= ts->breakpoints[index]);
+            CU_ASSERT(edges->right[e] > ts->breakpoints[index]);
+            CU_ASSERT_EQUAL(parent[edges->child[e]], TSK_NULL);
+            parent[edges->child[e]] = edges->parent[e];
+        }
+        ret = tsk_tree_seek_index(&tree, index, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL(
+            tsk_memcmp(parent, tree.parent, num_nodes * sizeof(*parent)), 0);
+    }
+
+    tsk_edge_diffs_free(&diffs);
+    tsk_tree_free(&tree);
+    free(parent);
+}
+
+static void
+verify_edge_diffs(tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_edge_diffs_t diffs;
+    tsk_diff_iter_t iter;
+    tsk_edge_list_t records_out, records_in;
+    tsk_edge_list_node_t *record;
+    const tsk_id_t num_trees = (tsk_id_t) tsk_treeseq_get_num_trees(ts);
+    tsk_id_t start, stop;
+    tsk_size_t j, k_in, k_out;
+    double left, right;
+
+    for (start = 0; start <= num_trees; start++) {
+        for (stop = start; stop <= num_trees; stop++) {
+            verify_edge_diffs_range(ts, start, stop);
+        }
+    }
+
+    /* Over all trees we get the same edges in the same order as the diff iter */
+    ret = tsk_edge_diffs_init(&diffs, ts, 0, num_trees, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_diff_iter_init_from_ts(&iter, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    j = 0;
+    k_in = 0;
+    k_out = 0;
+    while ((ret = tsk_diff_iter_next(&iter, &left, &right, &records_out, &records_in))
+           == TSK_TREE_OK) {
+        CU_ASSERT_EQUAL_FATAL(k_out, diffs.edges_out_offset[j]);
+        for (record = records_out.head; record != NULL; record = record->next) {
+            CU_ASSERT_EQUAL_FATAL(record->edge.id, diffs.edges_out[k_out]);
+            k_out++;
+        }
+        CU_ASSERT_EQUAL_FATAL(k_in, diffs.edges_in_offset[j]);
+        for (record = records_in.head; record != NULL; record = record->next) {
+            CU_ASSERT_EQUAL_FATAL(record->edge.id, diffs.edges_in[k_in]);
+            k_in++;
+        }
+        j++;
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(j, diffs.num_trees);
+    CU_ASSERT_EQUAL(k_in, diffs.num_edges_in);
+    CU_ASSERT_EQUAL(k_out, diffs.num_edges_out);
+    CU_ASSERT_EQUAL(diffs.num_edges_in, tsk_treeseq_get_num_edges(ts));
+
+    tsk_edge_diffs_free(&diffs);
+    tsk_diff_iter_free(&iter);
+}
+
 static void
 verify_tree_diffs(tsk_treeseq_t *ts, tsk_flags_t options)
 {
@@ -4853,6 +4961,148 @@ test_single_tree_compute_mutation_parents(void)
     tsk_table_collection_free(&tables);
 }
 
+static void
+verify_compute_mutation_intervals(
+    tsk_table_collection_t *tables, tsk_size_t num_breaks, const double *breaks)
+{
+    int ret;
+    tsk_size_t j;
+    tsk_size_t num_mutations = tables->mutations.num_rows;
+    tsk_id_t *parent = tsk_malloc(num_mutations * sizeof(*parent));
+    double *time = tsk_malloc(num_mutations * sizeof(*time));
+    double left, right;
+
+    CU_ASSERT_FATAL(parent != NULL);
+    CU_ASSERT_FATAL(time != NULL);
+
+    ret = tsk_table_collection_compute_mutation_parents(tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_memcpy(parent, tables->mutations.parent, num_mutations * sizeof(*parent));
+    ret = tsk_table_collection_compute_mutation_times_interval(
+        tables, NULL, 0, tables->sequence_length, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_memcpy(time, tables->mutations.time, num_mutations * sizeof(*time));
+
+    /* Check once and then compute each interval without checking, as a
+     * threaded caller would */
+    tsk_memset(tables->mutations.parent, 0xff, num_mutations * sizeof(*parent));
+    for (j = 0; j < num_mutations; j++) {
+        tables->mutations.time[j] = TSK_UNKNOWN_TIME;
+    }
+    ret = (int) tsk_table_collection_check_integrity(tables, TSK_CHECK_TREES);
+    CU_ASSERT_FATAL(ret > 0);
+    left = 0;
+    for (j = 0; j <= num_breaks; j++) {
+        right = j < num_breaks ? breaks[j] : tables->sequence_length;
+        ret = tsk_table_collection_compute_mutation_parents_interval(
+            tables, left, right, TSK_NO_CHECK_INTEGRITY);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_table_collection_compute_mutation_times_interval(
+            tables, NULL, left, right, TSK_NO_CHECK_INTEGRITY);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        left = right;
+    }
+    CU_ASSERT_EQUAL(
+        tsk_memcmp(parent, tables->mutations.parent, num_mutations * sizeof(*parent)),
+        0);
+    CU_ASSERT_EQUAL(
+        tsk_memcmp(time, tables->mutations.time, num_mutations * sizeof(*time)), 0);
+
+    /* With checking, the intervals can be done in any order. The times must
+     * be unknown, as the mutations may not be sorted by the computed times. */
+    tsk_memset(tables->mutations.parent, 0xff, num_mutations * sizeof(*parent));
+    for (j = 0; j < num_mutations; j++) {
+        tables->mutations.time[j] = TSK_UNKNOWN_TIME;
+    }
+    for (j = num_breaks + 1; j > 0; j--) {
+        left = j > 1 ? breaks[j - 2] : 0;
+        right = j <= num_breaks ? breaks[j - 1] : tables->sequence_length;
+        ret = tsk_table_collection_compute_mutation_parents_interval(
+            tables, left, right, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+    CU_ASSERT_EQUAL(
+        tsk_memcmp(parent, tables->mutations.parent, num_mutations * sizeof(*parent)),
+        0);
+
+    free(parent);
+    free(time);
+}
+
+static void
+test_multiple_tree_compute_mutation_intervals(void)
+{
+    int ret;
+    tsk_id_t j, u, ret_id;
+    tsk_table_collection_t tables;
+    double breaks_at_trees[] = { 2, 7 };
+    double breaks_between_sites[] = { 0.1, 2.6, 4.3, 9.9 };
+    double breaks_at_sites[] = { 0.25, 1, 5, 9.75 };
+    double every_site[40];
+
+    ret = tsk_table_collection_init(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tables.sequence_length = 10;
+    parse_nodes(paper_ex_nodes, &tables.nodes);
+    parse_edges(paper_ex_edges, &tables.edges);
+    parse_individuals(paper_ex_individuals, &tables.individuals);
+    /* Put several mutations at each site, in decreasing order of node time so
+     * that parents come before their children. */
+    for (j = 0; j < 40; j++) {
+        every_site[j] = j * 0.25;
+        ret_id = tsk_site_table_add_row(&tables.sites, j * 0.25, "0", 1, NULL, 0);
+        CU_ASSERT_FATAL(ret_id >= 0);
+        for (u = 8; u >= 0; u--) {
+            if ((u + j) % 3 != 0) {
+                ret_id = tsk_mutation_table_add_row(&tables.mutations, j, u, TSK_NULL,
+                    TSK_UNKNOWN_TIME, "1", 1, NULL, 0);
+                CU_ASSERT_FATAL(ret_id >= 0);
+            }
+        }
+    }
+    ret = tsk_table_collection_sort(&tables, NULL, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_table_collection_build_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    verify_compute_mutation_intervals(&tables, 0, NULL);
+    verify_compute_mutation_intervals(&tables, 2, breaks_at_trees);
+    verify_compute_mutation_intervals(&tables, 4, breaks_between_sites);
+    verify_compute_mutation_intervals(&tables, 4, breaks_at_sites);
+    verify_compute_mutation_intervals(&tables, 39, every_site + 1);
+
+    /* Bad intervals */
+    ret = tsk_table_collection_compute_mutation_parents_interval(&tables, -1, 1, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_table_collection_compute_mutation_parents_interval(&tables, 1, 1, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_table_collection_compute_mutation_times_interval(
+        &tables, NULL, 0, 11, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_table_collection_compute_mutation_times_interval(
+        &tables, &tables.sequence_length, 0, 1, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    /* Errors from the integrity check are returned */
+    tables.mutations.node[0] = -1;
+    ret = tsk_table_collection_compute_mutation_parents_interval(&tables, 0, 1, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_NODE_OUT_OF_BOUNDS);
+    ret = tsk_table_collection_compute_mutation_times_interval(
+        &tables, NULL, 0, 1, 0);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_NODE_OUT_OF_BOUNDS);
+    tables.mutations.node[0] = 8;
+
+    tsk_table_collection_drop_index(&tables, 0);
+    ret = tsk_table_collection_compute_mutation_parents_interval(
+        &tables, 0, 1, TSK_NO_CHECK_INTEGRITY);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_TABLES_NOT_INDEXED);
+    ret = tsk_table_collection_compute_mutation_times_interval(
+        &tables, NULL, 0, 1, TSK_NO_CHECK_INTEGRITY);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_TABLES_NOT_INDEXED);
+
+    tsk_table_collection_free(&tables);
+}
+
 static void
 test_single_tree_compute_mutation_times(void)
 {
@@ -5383,6 +5633,56 @@ test_single_tree_tracked_samples(void)
     tsk_tree_free(&tree);
 }
 
+static void
+test_single_tree_tracked_samples_lazy(void)
+{
+    tsk_treeseq_t ts;
+    tsk_tree_t tree, copy;
+    tsk_id_t samples[] = { 0, 1 };
+    tsk_size_t n;
+    int ret;
+
+    tsk_treeseq_from_text(&ts, 1, single_tree_ex_nodes, single_tree_ex_edges, NULL,
+        single_tree_ex_sites, single_tree_ex_mutations, NULL, NULL, 0);
+
+    ret = tsk_tree_init(&tree, &ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    /* No space is used for tracked samples until they are set */
+    CU_ASSERT_EQUAL(tree.num_tracked_samples, NULL);
+    ret = tsk_tree_first(&tree);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+    CU_ASSERT_EQUAL(tree.num_tracked_samples, NULL);
+    ret = tsk_tree_get_num_tracked_samples(&tree, 4, &n);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(n, 0);
+
+    ret = tsk_tree_copy(&tree, &copy, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    check_trees_identical(&tree, &copy);
+    tsk_tree_free(&copy);
+
+    /* Setting the tracked samples in a non-null tree counts them in place */
+    ret = tsk_tree_set_tracked_samples(&tree, 2, samples);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_FATAL(tree.num_tracked_samples != NULL);
+    ret = tsk_tree_get_num_tracked_samples(&tree, 4, &n);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(n, 2);
+    ret = tsk_tree_copy(&tree, &copy, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    check_trees_identical(&tree, &copy);
+    tsk_tree_free(&copy);
+
+    ret = tsk_tree_next(&tree);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_get_num_tracked_samples(&tree, tree.virtual_root, &n);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(n, 2);
+
+    tsk_treeseq_free(&ts);
+    tsk_tree_free(&tree);
+}
+
 static void
 test_single_tree_tree_pos(void)
 {
@@ -5933,6 +6233,7 @@ test_simple_diff_iter(void)
 
     verify_tree_diffs(&ts, 0);
     verify_tree_diffs(&ts, TSK_INCLUDE_TERMINAL);
+    verify_edge_diffs(&ts);
 
     ret = tsk_treeseq_free(&ts);
     CU_ASSERT_EQUAL(ret, 0);
@@ -5948,6 +6249,7 @@ test_nonbinary_diff_iter(void)
         NULL, NULL, NULL, 0);
     verify_tree_diffs(&ts, 0);
     verify_tree_diffs(&ts, TSK_INCLUDE_TERMINAL);
+    verify_edge_diffs(&ts);
 
     ret = tsk_treeseq_free(&ts);
     CU_ASSERT_EQUAL(ret, 0);
@@ -5963,6 +6265,7 @@ test_unary_diff_iter(void)
         &ts, 10, unary_ex_nodes, unary_ex_edges, NULL, NULL, NULL, NULL, NULL, 0);
     verify_tree_diffs(&ts, 0);
     verify_tree_diffs(&ts, TSK_INCLUDE_TERMINAL);
+    verify_edge_diffs(&ts);
 
     ret = tsk_treeseq_free(&ts);
     CU_ASSERT_EQUAL(ret, 0);
@@ -5978,6 +6281,7 @@ test_internal_sample_diff_iter(void)
         NULL, NULL, NULL, NULL, NULL, 0);
     verify_tree_diffs(&ts, 0);
     verify_tree_diffs(&ts, TSK_INCLUDE_TERMINAL);
+    verify_edge_diffs(&ts);
 
     ret = tsk_treeseq_free(&ts);
     CU_ASSERT_EQUAL(ret, 0);
@@ -6022,6 +6326,7 @@ test_multiroot_diff_iter(void)
         NULL, NULL, NULL, 0);
     verify_tree_diffs(&ts, 0);
     verify_tree_diffs(&ts, TSK_INCLUDE_TERMINAL);
+    verify_edge_diffs(&ts);
 
     ret = tsk_treeseq_free(&ts);
     CU_ASSERT_EQUAL(ret, 0);
@@ -6037,11 +6342,37 @@ test_empty_diff_iter(void)
         &ts, 10, empty_ex_nodes, empty_ex_edges, NULL, NULL, NULL, NULL, NULL, 0);
     verify_tree_diffs(&ts, 0);
     verify_tree_diffs(&ts, TSK_INCLUDE_TERMINAL);
+    verify_edge_diffs(&ts);
 
     ret = tsk_treeseq_free(&ts);
     CU_ASSERT_EQUAL(ret, 0);
 }
 
+static void
+test_edge_diffs_errors(void)
+{
+    int ret;
+    tsk_treeseq_t ts;
+    tsk_edge_diffs_t diffs;
+    tsk_id_t num_trees;
+
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, NULL, NULL,
+        paper_ex_individuals, NULL, 0);
+    num_trees = (tsk_id_t) tsk_treeseq_get_num_trees(&ts);
+
+    ret = tsk_edge_diffs_init(&diffs, &ts, -1, 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SEEK_OUT_OF_BOUNDS);
+    tsk_edge_diffs_free(&diffs);
+    ret = tsk_edge_diffs_init(&diffs, &ts, 2, 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SEEK_OUT_OF_BOUNDS);
+    tsk_edge_diffs_free(&diffs);
+    ret = tsk_edge_diffs_init(&diffs, &ts, 0, num_trees + 1, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SEEK_OUT_OF_BOUNDS);
+    tsk_edge_diffs_free(&diffs);
+
+    tsk_treeseq_free(&ts);
+}
+
 /*=======================================================
  * Sample sets
  *======================================================*/
@@ -6544,6 +6875,342 @@ test_seek_multi_tree(void)
     tsk_treeseq_free(&ts);
 }
 
+static void
+verify_no_check_integrity(tsk_treeseq_t *ts)
+{
+    int ret, iter_ret;
+    tsk_treeseq_t other;
+    tsk_table_collection_t tables;
+    tsk_tree_t t1, t2;
+    tsk_size_t j;
+
+    ret = tsk_treeseq_copy_tables(ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_init(&other, &tables, TSK_NO_CHECK_INTEGRITY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(other.num_trees, ts->num_trees);
+    for (j = 0; j <= ts->num_trees; j++) {
+        CU_ASSERT_EQUAL(other.breakpoints[j], ts->breakpoints[j]);
+    }
+    CU_ASSERT_EQUAL(other.num_samples, ts->num_samples);
+    CU_ASSERT_EQUAL(other.discrete_genome, ts->discrete_genome);
+    CU_ASSERT_EQUAL(other.discrete_time, ts->discrete_time);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(other.tables, ts->tables, 0));
+
+    ret = tsk_tree_init(&t1, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_init(&t2, &other, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (iter_ret = tsk_tree_first(&t1); iter_ret == TSK_TREE_OK;
+         iter_ret = tsk_tree_next(&t1)) {
+        ret = tsk_tree_next(&t2);
+        CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+        CU_ASSERT_EQUAL(t1.interval.left, t2.interval.left);
+        CU_ASSERT_EQUAL(t1.interval.right, t2.interval.right);
+        CU_ASSERT_EQUAL(t1.num_edges, t2.num_edges);
+        CU_ASSERT_EQUAL(t1.sites_length, t2.sites_length);
+        CU_ASSERT_EQUAL(tsk_memcmp(t1.parent, t2.parent,
+                            (t1.num_nodes + 1) * sizeof(*t1.parent)),
+            0);
+    }
+    CU_ASSERT_EQUAL_FATAL(iter_ret, 0);
+    ret = tsk_tree_next(&t2);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_tree_free(&t1);
+    tsk_tree_free(&t2);
+    tsk_treeseq_free(&other);
+
+    /* The tables must be indexed */
+    ret = tsk_table_collection_drop_index(&tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_init(&other, &tables, TSK_NO_CHECK_INTEGRITY);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_TABLES_NOT_INDEXED);
+    tsk_treeseq_free(&other);
+    ret = tsk_treeseq_init(
+        &other, &tables, TSK_NO_CHECK_INTEGRITY | TSK_TS_INIT_BUILD_INDEXES);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(other.num_trees, ts->num_trees);
+    tsk_treeseq_free(&other);
+
+    /* Loading with the option gives the same tree sequence */
+    ret = tsk_treeseq_dump(ts, _tmp_file_name, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_treeseq_load(&other, _tmp_file_name, TSK_NO_CHECK_INTEGRITY);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(other.num_trees, ts->num_trees);
+    CU_ASSERT_TRUE(tsk_table_collection_equals(other.tables, ts->tables, 0));
+    tsk_treeseq_free(&other);
+    tsk_table_collection_free(&tables);
+}
+
+static void
+test_treeseq_init_no_check_integrity(void)
+{
+    tsk_treeseq_t ts;
+    const char *nodes[]
+        = { paper_ex_nodes, nonbinary_ex_nodes, unary_ex_nodes, internal_sample_ex_nodes,
+              multiroot_ex_nodes, multiple_tree_ex_nodes, empty_ex_nodes };
+    const char *edges[]
+        = { paper_ex_edges, nonbinary_ex_edges, unary_ex_edges, internal_sample_ex_edges,
+              multiroot_ex_edges, multiple_tree_ex_edges, empty_ex_edges };
+    const char *sites[] = { paper_ex_sites, nonbinary_ex_sites, unary_ex_sites,
+        internal_sample_ex_sites, multiroot_ex_sites, NULL, NULL };
+    const char *mutations[] = { paper_ex_mutations, nonbinary_ex_mutations,
+        unary_ex_mutations, internal_sample_ex_mutations, multiroot_ex_mutations, NULL,
+        NULL };
+    const char *individuals[] = { paper_ex_individuals, NULL, NULL, NULL, NULL, NULL,
+        NULL };
+    double sequence_length[] = { 10, 100, 10, 10, 10, 1, 10 };
+    size_t j;
+
+    for (j = 0; j < sizeof(nodes) / sizeof(*nodes); j++) {
+        tsk_treeseq_from_text(&ts, sequence_length[j], nodes[j], edges[j], NULL,
+            sites[j], mutations[j], individuals[j], NULL, 0);
+        verify_no_check_integrity(&ts);
+        tsk_treeseq_free(&ts);
+    }
+}
+
+static void
+verify_map_mutations_batch(tsk_treeseq_t *ts, tsk_flags_t options)
+{
+    int ret;
+    tsk_tree_t tree;
+    const tsk_size_t num_samples = tsk_treeseq_get_num_samples(ts);
+    const tsk_size_t num_sites = 67;
+    int32_t *genotypes = tsk_malloc(num_sites * num_samples * sizeof(*genotypes));
+    int32_t *ancestral_states = tsk_malloc(num_sites * sizeof(*ancestral_states));
+    tsk_size_t *offsets = tsk_malloc((num_sites + 1) * sizeof(*offsets));
+    tsk_state_transition_t *transitions, *site_transitions;
+    tsk_size_t j, k, num_transitions;
+    int32_t ancestral_state;
+
+    CU_ASSERT_FATAL(genotypes != NULL && ancestral_states != NULL && offsets != NULL);
+    ret = tsk_tree_init(&tree, ts, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (ret = tsk_tree_first(&tree); ret == TSK_TREE_OK; ret = tsk_tree_next(&tree)) {
+        /* Cover up to 64 alleles, missing data and varying numbers of alleles */
+        for (k = 0; k < num_sites; k++) {
+            for (j = 0; j < num_samples; j++) {
+                genotypes[k * num_samples + j]
+                    = (int32_t) ((j * 7 + k * 13 + (j * k) % 5) % (k % 5 + 1));
+                if (k == 64) {
+                    genotypes[k * num_samples + j] = (int32_t) (63 - j);
+                } else if ((j + k) % 11 == 0 && j > 0) {
+                    genotypes[k * num_samples + j] = TSK_MISSING_DATA;
+                }
+            }
+            ancestral_states[k] = (int32_t) (k % 3 + (k == 65 ? 60 : 0));
+        }
+        ret = tsk_tree_map_mutations_batch(&tree, num_sites, genotypes, NULL, options,
+            ancestral_states, offsets, &transitions);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_EQUAL_FATAL(offsets[0], 0);
+        for (k = 0; k < num_sites; k++) {
+            CU_ASSERT_FATAL(offsets[k] <= offsets[k + 1]);
+            ancestral_state = (int32_t) (k % 3 + (k == 65 ? 60 : 0));
+            ret = tsk_tree_map_mutations(&tree, genotypes + k * num_samples, NULL,
+                options, &ancestral_state, &num_transitions, &site_transitions);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            CU_ASSERT_EQUAL(ancestral_state, ancestral_states[k]);
+            CU_ASSERT_EQUAL_FATAL(num_transitions, offsets[k + 1] - offsets[k]);
+            for (j = 0; j < num_transitions; j++) {
+                CU_ASSERT_EQUAL(
+                    site_transitions[j].node, transitions[offsets[k] + j].node);
+                CU_ASSERT_EQUAL(
+                    site_transitions[j].parent, transitions[offsets[k] + j].parent);
+                CU_ASSERT_EQUAL(
+                    site_transitions[j].state, transitions[offsets[k] + j].state);
+            }
+            free(site_transitions);
+        }
+        free(transitions);
+    }
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+
+    /* Zero sites */
+    ret = tsk_tree_first(&tree);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+    ret = tsk_tree_map_mutations_batch(
+        &tree, 0, genotypes, NULL, options, ancestral_states, offsets, &transitions);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(offsets[0], 0);
+    free(transitions);
+
+    /* An error at any site is an error for the batch */
+    for (j = 0; j < num_samples; j++) {
+        genotypes[3 * num_samples + j] = TSK_MISSING_DATA;
+    }
+    ret = tsk_tree_map_mutations_batch(&tree, num_sites, genotypes, NULL, options,
+        ancestral_states, offsets, &transitions);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_GENOTYPES_ALL_MISSING);
+    genotypes[3 * num_samples] = 64;
+    ret = tsk_tree_map_mutations_batch(&tree, num_sites, genotypes, NULL, options,
+        ancestral_states, offsets, &transitions);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_GENOTYPE);
+    genotypes[3 * num_samples] = 0;
+    ancestral_states[num_sites - 1] = 64;
+    ret = tsk_tree_map_mutations_batch(&tree, num_sites, genotypes, NULL,
+        TSK_MM_FIXED_ANCESTRAL_STATE, ancestral_states, offsets, &transitions);
+    CU_ASSERT_EQUAL(ret, TSK_ERR_BAD_ANCESTRAL_STATE);
+
+    tsk_tree_free(&tree);
+    free(genotypes);
+    free(ancestral_states);
+    free(offsets);
+}
+
+static void
+test_map_mutations_batch(void)
+{
+    tsk_treeseq_t ts;
+    const char *nodes[] = { paper_ex_nodes, nonbinary_ex_nodes, unary_ex_nodes,
+        internal_sample_ex_nodes, multiroot_ex_nodes, multiple_tree_ex_nodes };
+    const char *edges[] = { paper_ex_edges, nonbinary_ex_edges, unary_ex_edges,
+        internal_sample_ex_edges, multiroot_ex_edges, multiple_tree_ex_edges };
+    const char *individuals[] = { paper_ex_individuals, NULL, NULL, NULL, NULL, NULL };
+    double sequence_length[] = { 10, 100, 10, 10, 10, 1 };
+    size_t j;
+
+    for (j = 0; j < sizeof(nodes) / sizeof(*nodes); j++) {
+        tsk_treeseq_from_text(&ts, sequence_length[j], nodes[j], edges[j], NULL, NULL,
+            NULL, individuals[j], NULL, 0);
+        verify_map_mutations_batch(&ts, 0);
+        verify_map_mutations_batch(&ts, TSK_MM_FIXED_ANCESTRAL_STATE);
+        tsk_treeseq_free(&ts);
+    }
+}
+
+static void
+verify_seek_index(tsk_treeseq_t *ts)
+{
+    int ret;
+    tsk_tree_t *trees, t;
+    tsk_id_t j, k;
+    tsk_size_t l;
+    tsk_id_t num_trees = (tsk_id_t) tsk_treeseq_get_num_trees(ts);
+    tsk_size_t intervals[] = { 0, 1, 2, 3, (tsk_size_t) num_trees + 1 };
+    double x;
+
+    trees = get_tree_list(ts);
+    for (l = 0; l < sizeof(intervals) / sizeof(*intervals); l++) {
+        ret = tsk_treeseq_build_seek_index(ts, intervals[l], 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        CU_ASSERT_FATAL(ts->seek_index.interval > 0);
+        CU_ASSERT_EQUAL_FATAL(ts->seek_index.num_checkpoints,
+            (ts->num_trees + ts->seek_index.interval - 1) / ts->seek_index.interval);
+        if (intervals[l] != 0) {
+            CU_ASSERT_EQUAL_FATAL(ts->seek_index.interval, intervals[l]);
+        }
+
+        /* Seek from the null tree */
+        for (j = 0; j < num_trees; j++) {
+            ret = tsk_tree_init(&t, ts, 0);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            x = (trees[j].interval.left + trees[j].interval.right) / 2;
+            ret = tsk_tree_seek(&t, x, 0);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            check_trees_equal(&t, &trees[j]);
+            ret = tsk_tree_next(&t);
+            if (j < num_trees - 1) {
+                CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+                check_trees_equal(&t, &trees[j + 1]);
+            } else {
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+            }
+            tsk_tree_free(&t);
+        }
+
+        /* Seek between all pairs of trees */
+        ret = tsk_tree_init(&t, ts, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        for (j = 0; j < num_trees; j++) {
+            for (k = 0; k < num_trees; k++) {
+                ret = tsk_tree_seek_index(&t, j, 0);
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+                check_trees_equal(&t, &trees[j]);
+                ret = tsk_tree_seek(&t, trees[k].interval.left, 0);
+                CU_ASSERT_EQUAL_FATAL(ret, 0);
+                check_trees_equal(&t, &trees[k]);
+                ret = tsk_tree_prev(&t);
+                if (k > 0) {
+                    CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+                    check_trees_equal(&t, &trees[k - 1]);
+                } else {
+                    CU_ASSERT_EQUAL_FATAL(ret, 0);
+                }
+            }
+        }
+        tsk_tree_free(&t);
+    }
+
+    for (j = 0; j < num_trees; j++) {
+        ret = tsk_tree_free(&trees[j]);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+    }
+    free(trees);
+}
+
+static void
+test_seek_index(void)
+{
+    int ret;
+    tsk_treeseq_t ts;
+    tsk_tree_t t, other;
+    tsk_table_collection_t tables;
+    tsk_id_t u;
+    const char *nodes[]
+        = { paper_ex_nodes, nonbinary_ex_nodes, unary_ex_nodes, internal_sample_ex_nodes,
+              multiroot_ex_nodes, multiple_tree_ex_nodes, empty_ex_nodes };
+    const char *edges[]
+        = { paper_ex_edges, nonbinary_ex_edges, unary_ex_edges, internal_sample_ex_edges,
+              multiroot_ex_edges, multiple_tree_ex_edges, empty_ex_edges };
+    const char *individuals[] = { paper_ex_individuals, NULL, NULL, NULL, NULL, NULL,
+        NULL };
+    double sequence_length[] = { 10, 100, 10, 10, 10, 1, 10 };
+    size_t j;
+
+    for (j = 0; j < sizeof(nodes) / sizeof(*nodes); j++) {
+        tsk_treeseq_from_text(&ts, sequence_length[j], nodes[j], edges[j], NULL, NULL,
+            NULL, individuals[j], NULL, 0);
+        CU_ASSERT_EQUAL_FATAL(ts.seek_index.interval, 0);
+        verify_seek_index(&ts);
+        tsk_treeseq_free(&ts);
+    }
+
+    /* Build the index with the default interval at init time */
+    tsk_treeseq_from_text(&ts, 10, paper_ex_nodes, paper_ex_edges, NULL, NULL, NULL,
+        paper_ex_individuals, NULL, 0);
+    ret = tsk_treeseq_copy_tables(&ts, &tables, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    tsk_treeseq_free(&ts);
+    ret = tsk_treeseq_init(&ts, &tables, TSK_TS_INIT_SEEK_INDEX);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(ts.seek_index.interval, 2);
+    CU_ASSERT_EQUAL(ts.seek_index.num_checkpoints, 2);
+    ret = tsk_tree_init(&t, &ts, TSK_SAMPLE_LISTS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_seek(&t, 9, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t.index, 2);
+    ret = tsk_tree_seek(&t, 0, 0);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL(t.index, 0);
+    ret = tsk_tree_init(&other, &ts, TSK_SAMPLE_LISTS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_first(&other);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_TREE_OK);
+    check_trees_equal(&t, &other);
+    for (u = 0; u < (tsk_id_t) tsk_treeseq_get_num_nodes(&ts); u++) {
+        CU_ASSERT_EQUAL(t.num_samples[u], other.num_samples[u]);
+        CU_ASSERT_EQUAL(t.left_sample[u] == TSK_NULL, other.left_sample[u] == TSK_NULL);
+    }
+    tsk_tree_free(&t);
+    tsk_tree_free(&other);
+    tsk_treeseq_free(&ts);
+    tsk_table_collection_free(&tables);
+}
+
 static void
 test_seek_errors(void)
 {
@@ -7124,6 +7791,146 @@ test_offset_trees_with_errors_kc(void)
     tsk_treeseq_free(&other);
 }
 
+static double
+brute_force_kc_distance(const tsk_treeseq_t *ts1, const tsk_treeseq_t *ts2,
+    double lambda, double left, double right)
+{
+    int ret;
+    tsk_tree_t t1, t2;
+    double x, next_x, d;
+    double total = 0;
+
+    ret = tsk_tree_init(&t1, ts1, TSK_SAMPLE_LISTS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    ret = tsk_tree_init(&t2, ts2, TSK_SAMPLE_LISTS);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    for (x = left; x < right; x = next_x) {
+        ret = tsk_tree_seek(&t1, x, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        ret = tsk_tree_seek(&t2, x, 0);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        next_x = TSK_MIN(right, TSK_MIN(t1.interval.right, t2.interval.right));
+        ret = tsk_tree_kc_distance(&t1, &t2, lambda, &d);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        total += d * (next_x - x);
+    }
+    tsk_tree_free(&t1);
+    tsk_tree_free(&t2);
+    return total / (right - left);
+}
+
+static void
+test_kc_distance_interval_matrix(void)
+{
+    const char *nodes = "1  0   0\n"
+                        "1  0   0\n"
+                        "1  0   0\n"
+                        "1  0   0\n"
+                        "1  0   0\n"
+                        "0  1   0\n"
+                        "0  2   0\n"
+                        "0  3   0\n"
+                        "0  4   0\n"
+                        "0  5   0\n";
+    const char *edges_0 = "0 10  5 0,1\n"
+                          "0 10  6 3,4\n"
+                          "5 10  7 2,5\n"
+                          "0 5   8 2\n"
+                          "0 10  8 6\n"
+                          "5 10  8 7\n"
+                          "0 5   9 5,8\n";
+    const char *edges_1 = "0 10  5 0,1\n"
+                          "0 10  6 2,3\n"
+                          "0 10  7 4,5\n"
+                          "0 10  8 6,7\n";
+    const char *edges_2 = "0 10  5 0\n"
+                          "3 10  5 1\n"
+                          "0 3   5 2\n"
+                          "7 10  6 2\n"
+                          "0 10  6 3\n"
+                          "0 7   6 4\n"
+                          "0 3   7 1\n"
+                          "3 7   7 2\n"
+                          "7 10  7 4\n"
+                          "0 10  7 6\n"
+                          "0 10  8 5,7\n";
+    const char *edges[] = { edges_0, edges_1, edges_2 };
+    double intervals[][2]
+        = { { 0, 10 }, { 0, 5 }, { 5, 10 }, { 2, 7 }, { 4.5, 5.5 }, { 9, 10 } };
+    double lambdas[] = { 0, 0.5, 1 };
+    tsk_treeseq_t ts[3], unary;
+    const tsk_treeseq_t *treeseqs[3];
+    double matrix[9];
+    double result, full, expected;
+    tsk_size_t j, k, l, m;
+    int ret;
+
+    for (j = 0; j < 3; j++) {
+        tsk_treeseq_from_text(
+            &ts[j], 10, nodes, edges[j], NULL, NULL, NULL, NULL, NULL, 0);
+        treeseqs[j] = &ts[j];
+    }
+
+    for (j = 0; j < sizeof(lambdas) / sizeof(*lambdas); j++) {
+        for (k = 0; k < sizeof(intervals) / sizeof(*intervals); k++) {
+            ret = tsk_treeseq_kc_distance_matrix(
+                treeseqs, 3, lambdas[j], intervals[k][0], intervals[k][1], matrix);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            for (l = 0; l < 3; l++) {
+                CU_ASSERT_EQUAL_FATAL(matrix[l * 3 + l], 0);
+                for (m = 0; m < 3; m++) {
+                    expected = brute_force_kc_distance(treeseqs[l], treeseqs[m],
+                        lambdas[j], intervals[k][0], intervals[k][1]);
+                    ret = tsk_treeseq_kc_distance_interval(treeseqs[l], treeseqs[m],
+                        lambdas[j], intervals[k][0], intervals[k][1], &result);
+                    CU_ASSERT_EQUAL_FATAL(ret, 0);
+                    CU_ASSERT_DOUBLE_EQUAL_FATAL(result, expected, 1e-9);
+                    CU_ASSERT_DOUBLE_EQUAL_FATAL(matrix[l * 3 + m], expected, 1e-9);
+                }
+            }
+        }
+        /* The full distance is the span-weighted mean over intervals */
+        ret = tsk_treeseq_kc_distance(&ts[0], &ts[2], lambdas[j], &full);
+        CU_ASSERT_EQUAL_FATAL(ret, 0);
+        expected = 0;
+        for (k = 0; k < 4; k++) {
+            ret = tsk_treeseq_kc_distance_interval(&ts[0], &ts[2], lambdas[j],
+                (double) k * 2.5, (double) (k + 1) * 2.5, &result);
+            CU_ASSERT_EQUAL_FATAL(ret, 0);
+            expected += result * 2.5 / 10;
+        }
+        CU_ASSERT_DOUBLE_EQUAL_FATAL(full, expected, 1e-9);
+    }
+
+    ret = tsk_treeseq_kc_distance_matrix(treeseqs, 1, 0, 0, 10, matrix);
+    CU_ASSERT_EQUAL_FATAL(ret, 0);
+    CU_ASSERT_EQUAL_FATAL(matrix[0], 0);
+
+    ret = tsk_treeseq_kc_distance_matrix(treeseqs, 0, 0, 0, 10, matrix);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_treeseq_kc_distance_matrix(treeseqs, 3, 0, -1, 10, matrix);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_treeseq_kc_distance_matrix(treeseqs, 3, 0, 0, 11, matrix);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_treeseq_kc_distance_interval(&ts[0], &ts[1], 0, 5, 5, &result);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+    ret = tsk_treeseq_kc_distance_interval(&ts[0], &ts[1], 0, 6, 5, &result);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_BAD_PARAM_VALUE);
+
+    tsk_treeseq_from_text(
+        &unary, 10, unary_ex_nodes, unary_ex_edges, NULL, NULL, NULL, NULL, NULL, 0);
+    ret = tsk_treeseq_kc_distance_interval(&unary, &unary, 0, 0, 10, &result);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_UNARY_NODES);
+    treeseqs[1] = &unary;
+    ret = tsk_treeseq_kc_distance_matrix(treeseqs, 2, 0, 0, 10, matrix);
+    CU_ASSERT_EQUAL_FATAL(ret, TSK_ERR_SAMPLE_SIZE_MISMATCH);
+
+    tsk_treeseq_free(&unary);
+    for (j = 0; j < 3; j++) {
+        tsk_treeseq_free(&ts[j]);
+    }
+}
+
 /*=======================================================
  * Miscellaneous tests.
  *======================================================*/
@@ -8689,6 +9496,8 @@ main(int argc, char **argv)
             test_single_tree_compute_mutation_parents },
         { "test_single_tree_compute_mutation_times",
             test_single_tree_compute_mutation_times },
+        { "test_multiple_tree_compute_mutation_intervals",
+            test_multiple_tree_compute_mutation_intervals },
         { "test_single_tree_mutation_edges", test_single_tree_mutation_edges },
         { "test_single_tree_is_descendant", test_single_tree_is_descendant },
         { "test_single_tree_total_branch_length", test_single_tree_total_branch_length },
@@ -8697,6 +9506,8 @@ main(int argc, char **argv)
         { "test_single_tree_map_mutations_internal_samples",
             test_single_tree_map_mutations_internal_samples },
         { "test_single_tree_tracked_samples", test_single_tree_tracked_samples },
+        { "test_single_tree_tracked_samples_lazy",
+            test_single_tree_tracked_samples_lazy },
         { "test_single_tree_tree_pos", test_single_tree_tree_pos },
 
         /* Multi tree tests */
@@ -8726,6 +9537,7 @@ main(int argc, char **argv)
         { "test_unary_diff_iter", test_unary_diff_iter },
         { "test_internal_sample_diff_iter", test_internal_sample_diff_iter },
         { "test_empty_diff_iter", test_empty_diff_iter },
+        { "test_edge_diffs_errors", test_edge_diffs_errors },
 
         /* Sample sets */
         { "test_simple_sample_sets", test_simple_sample_sets },
@@ -8742,6 +9554,10 @@ main(int argc, char **argv)
 
         /* Seek */
         { "test_seek_multi_tree", test_seek_multi_tree },
+        { "test_treeseq_init_no_check_integrity",
+            test_treeseq_init_no_check_integrity },
+        { "test_map_mutations_batch", test_map_mutations_batch },
+        { "test_seek_index", test_seek_index },
         { "test_seek_errors", test_seek_errors },
 
         /* KC distance tests */
@@ -8758,6 +9574,7 @@ main(int argc, char **argv)
         { "test_unary_nodes_kc", test_unary_nodes_kc },
         { "test_no_sample_lists_kc", test_no_sample_lists_kc },
         { "test_unequal_sequence_lengths_kc", test_unequal_sequence_lengths_kc },
+        { "test_kc_distance_interval_matrix", test_kc_distance_interval_matrix },
         { "test_different_number_trees_kc", test_different_number_trees_kc },
         { "test_offset_trees_with_errors_kc", test_offset_trees_with_errors_kc },
 
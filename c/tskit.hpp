@@ -0,0 +1,1335 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Tskit Developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file tskit.hpp
+ * @brief Header-only C++17 interface to the tskit C API.
+ *
+ * The classes here are move-only owners of the corresponding C structs,
+ * which are freed when the owner is destroyed. Errors from the C API are
+ * thrown as tskit::error. The underlying C struct is always available
+ * through get(), so the C API can be used directly where there is no
+ * wrapper. This interface is experimental and may change.
+ */
+#ifndef __TSKIT_HPP__
+#define __TSKIT_HPP__
+
+#if __cplusplus < 201703L
+#error "tskit.hpp requires C++17"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <tskit.h>
+
+namespace tskit {
+
+/* A tskit error code, thrown by the wrappers when a C function fails. */
+class error : public std::runtime_error {
+  public:
+    explicit error(int code) : std::runtime_error(tsk_strerror(code)), code_(code) {}
+
+    int
+    code() const noexcept
+    {
+        return code_;
+    }
+
+  private:
+    int code_;
+};
+
+/* Throws an error if ret is a (negative) tskit error code, and returns it
+ * otherwise, so that IDs and positive status values pass through. */
+template <typename T>
+inline T
+check(T ret)
+{
+    if (ret < 0) {
+        throw error(static_cast<int>(ret));
+    }
+    return ret;
+}
+
+/* A non-owning view of a contiguous array, such as a table column. This is
+ * a minimal stand-in for std::span, which needs C++20. */
+template <typename T> class column_view {
+  public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = std::size_t;
+    using iterator = T *;
+
+    constexpr column_view() noexcept = default;
+    constexpr column_view(T *data, size_type size) noexcept : data_(data), size_(size)
+    {
+    }
+    template <typename U = value_type,
+        typename = std::enable_if_t<std::is_const_v<T>, U>>
+    column_view(const std::vector<U> &v) noexcept : data_(v.data()), size_(v.size())
+    {
+    }
+
+    constexpr T *
+    data() const noexcept
+    {
+        return data_;
+    }
+    constexpr size_type
+    size() const noexcept
+    {
+        return size_;
+    }
+    constexpr bool
+    empty() const noexcept
+    {
+        return size_ == 0;
+    }
+    constexpr T &
+    operator[](size_type j) const noexcept
+    {
+        return data_[j];
+    }
+    constexpr iterator
+    begin() const noexcept
+    {
+        return data_;
+    }
+    constexpr iterator
+    end() const noexcept
+    {
+        return data_ + size_;
+    }
+
+  private:
+    T *data_ = nullptr;
+    size_type size_ = 0;
+};
+
+namespace detail {
+
+    /* Frees the C struct with its tskit free function and then releases the
+     * memory. The structs are allocated with calloc, and all of the tskit
+     * free functions are safe to call on a zeroed struct. */
+    template <typename T, int (*Free)(T *)> struct c_deleter {
+        void
+        operator()(T *p) const noexcept
+        {
+            Free(p);
+            std::free(p);
+        }
+    };
+
+    template <typename T, int (*Free)(T *)>
+    using c_ptr = std::unique_ptr<T, c_deleter<T, Free>>;
+
+    template <typename T, int (*Free)(T *)>
+    inline c_ptr<T, Free>
+    c_alloc()
+    {
+        T *p = static_cast<T *>(std::calloc(1, sizeof(T)));
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return c_ptr<T, Free>(p);
+    }
+
+    template <typename T>
+    inline column_view<const T>
+    column(const T *data, tsk_size_t size) noexcept
+    {
+        return column_view<const T>(data, static_cast<std::size_t>(size));
+    }
+
+} // namespace detail
+
+class tree_sequence;
+
+/* Owns a tsk_table_collection_t. */
+class table_collection {
+  public:
+    explicit table_collection(double sequence_length = 0, tsk_flags_t options = 0)
+        : tables_(detail::c_alloc<tsk_table_collection_t, tsk_table_collection_free>())
+    {
+        check(tsk_table_collection_init(tables_.get(), options));
+        tables_->sequence_length = sequence_length;
+    }
+
+    static table_collection
+    load(const char *filename, tsk_flags_t options = 0)
+    {
+        table_collection self(detail::c_alloc<tsk_table_collection_t,
+            tsk_table_collection_free>());
+        check(tsk_table_collection_load(self.tables_.get(), filename, options));
+        return self;
+    }
+
+    void
+    dump(const char *filename, tsk_flags_t options = 0) const
+    {
+        check(tsk_table_collection_dump(tables_.get(), filename, options));
+    }
+
+    void
+    sort(tsk_flags_t options = 0)
+    {
+        check(tsk_table_collection_sort(tables_.get(), nullptr, options));
+    }
+
+    void
+    build_index(tsk_flags_t options = 0)
+    {
+        check(tsk_table_collection_build_index(tables_.get(), options));
+    }
+
+    tsk_table_collection_t *
+    get() noexcept
+    {
+        return tables_.get();
+    }
+    const tsk_table_collection_t *
+    get() const noexcept
+    {
+        return tables_.get();
+    }
+    tsk_table_collection_t *
+    operator->() noexcept
+    {
+        return tables_.get();
+    }
+    const tsk_table_collection_t *
+    operator->() const noexcept
+    {
+        return tables_.get();
+    }
+
+  private:
+    friend class tree_sequence;
+    using ptr_t = detail::c_ptr<tsk_table_collection_t, tsk_table_collection_free>;
+
+    explicit table_collection(ptr_t tables) noexcept : tables_(std::move(tables)) {}
+
+    ptr_t tables_;
+};
+
+class tree_range;
+class variant_range;
+class edge_diff_range;
+
+/* Owns a tsk_treeseq_t. */
+class tree_sequence {
+  public:
+    /* Takes ownership of the tables, which must be sorted. The edge indexes
+     * are built if needed. */
+    explicit tree_sequence(
+        table_collection &&tables, tsk_flags_t options = TSK_TS_INIT_BUILD_INDEXES)
+        : ts_(detail::c_alloc<tsk_treeseq_t, tsk_treeseq_free>())
+    {
+        /* TSK_TAKE_OWNERSHIP takes the tables even if tsk_treeseq_init fails */
+        check(tsk_treeseq_init(
+            ts_.get(), tables.tables_.release(), options | TSK_TAKE_OWNERSHIP));
+    }
+
+    static tree_sequence
+    load(const char *filename, tsk_flags_t options = 0)
+    {
+        tree_sequence self(detail::c_alloc<tsk_treeseq_t, tsk_treeseq_free>());
+        check(tsk_treeseq_load(self.ts_.get(), filename, options));
+        return self;
+    }
+
+    void
+    dump(const char *filename, tsk_flags_t options = 0) const
+    {
+        check(tsk_treeseq_dump(ts_.get(), filename, options));
+    }
+
+    const tsk_treeseq_t *
+    get() const noexcept
+    {
+        return ts_.get();
+    }
+    const tsk_table_collection_t &
+    tables() const noexcept
+    {
+        return *ts_->tables;
+    }
+
+    double
+    sequence_length() const noexcept
+    {
+        return tsk_treeseq_get_sequence_length(ts_.get());
+    }
+    std::size_t
+    num_trees() const noexcept
+    {
+        return tsk_treeseq_get_num_trees(ts_.get());
+    }
+    std::size_t
+    num_samples() const noexcept
+    {
+        return tsk_treeseq_get_num_samples(ts_.get());
+    }
+    std::size_t
+    num_nodes() const noexcept
+    {
+        return tsk_treeseq_get_num_nodes(ts_.get());
+    }
+    std::size_t
+    num_edges() const noexcept
+    {
+        return tsk_treeseq_get_num_edges(ts_.get());
+    }
+    std::size_t
+    num_sites() const noexcept
+    {
+        return tsk_treeseq_get_num_sites(ts_.get());
+    }
+    std::size_t
+    num_mutations() const noexcept
+    {
+        return tsk_treeseq_get_num_mutations(ts_.get());
+    }
+
+    column_view<const tsk_id_t>
+    samples() const noexcept
+    {
+        return detail::column(ts_->samples, ts_->num_samples);
+    }
+    column_view<const double>
+    breakpoints() const noexcept
+    {
+        return detail::column(ts_->breakpoints, ts_->num_trees + 1);
+    }
+
+    /* Views of the table columns. */
+    column_view<const tsk_flags_t>
+    node_flags() const noexcept
+    {
+        return detail::column(tables().nodes.flags, tables().nodes.num_rows);
+    }
+    column_view<const double>
+    node_time() const noexcept
+    {
+        return detail::column(tables().nodes.time, tables().nodes.num_rows);
+    }
+    column_view<const tsk_id_t>
+    node_population() const noexcept
+    {
+        return detail::column(tables().nodes.population, tables().nodes.num_rows);
+    }
+    column_view<const tsk_id_t>
+    node_individual() const noexcept
+    {
+        return detail::column(tables().nodes.individual, tables().nodes.num_rows);
+    }
+    column_view<const double>
+    edge_left() const noexcept
+    {
+        return detail::column(tables().edges.left, tables().edges.num_rows);
+    }
+    column_view<const double>
+    edge_right() const noexcept
+    {
+        return detail::column(tables().edges.right, tables().edges.num_rows);
+    }
+    column_view<const tsk_id_t>
+    edge_parent() const noexcept
+    {
+        return detail::column(tables().edges.parent, tables().edges.num_rows);
+    }
+    column_view<const tsk_id_t>
+    edge_child() const noexcept
+    {
+        return detail::column(tables().edges.child, tables().edges.num_rows);
+    }
+    column_view<const double>
+    site_position() const noexcept
+    {
+        return detail::column(tables().sites.position, tables().sites.num_rows);
+    }
+    column_view<const tsk_id_t>
+    mutation_site() const noexcept
+    {
+        return detail::column(tables().mutations.site, tables().mutations.num_rows);
+    }
+    column_view<const tsk_id_t>
+    mutation_node() const noexcept
+    {
+        return detail::column(tables().mutations.node, tables().mutations.num_rows);
+    }
+    column_view<const tsk_id_t>
+    mutation_parent() const noexcept
+    {
+        return detail::column(tables().mutations.parent, tables().mutations.num_rows);
+    }
+    column_view<const double>
+    mutation_time() const noexcept
+    {
+        return detail::column(tables().mutations.time, tables().mutations.num_rows);
+    }
+
+    /* Ranges over the trees, the variants at each site and the edge
+     * differences between adjacent trees. Each range owns the C object
+     * used for the iteration, which is reused at each step, so the
+     * values must be copied if they are needed after moving on. */
+    tree_range trees(tsk_flags_t options = 0) const;
+    variant_range variants(tsk_flags_t options = 0) const;
+    edge_diff_range edge_diffs(tsk_flags_t options = 0) const;
+
+  private:
+    using ptr_t = detail::c_ptr<tsk_treeseq_t, tsk_treeseq_free>;
+
+    explicit tree_sequence(ptr_t ts) noexcept : ts_(std::move(ts)) {}
+
+    ptr_t ts_;
+};
+
+/* Iterates over the nodes in a linked list of siblings. */
+class sibling_range {
+  public:
+    class iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = tsk_id_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const tsk_id_t *;
+        using reference = tsk_id_t;
+
+        iterator(const tsk_id_t *right_sib, tsk_id_t u) noexcept
+            : right_sib_(right_sib), u_(u)
+        {
+        }
+        tsk_id_t
+        operator*() const noexcept
+        {
+            return u_;
+        }
+        iterator &
+        operator++() noexcept
+        {
+            u_ = right_sib_[u_];
+            return *this;
+        }
+        bool
+        operator==(const iterator &other) const noexcept
+        {
+            return u_ == other.u_;
+        }
+        bool
+        operator!=(const iterator &other) const noexcept
+        {
+            return u_ != other.u_;
+        }
+
+      private:
+        const tsk_id_t *right_sib_;
+        tsk_id_t u_;
+    };
+
+    sibling_range(const tsk_id_t *right_sib, tsk_id_t first) noexcept
+        : right_sib_(right_sib), first_(first)
+    {
+    }
+    iterator
+    begin() const noexcept
+    {
+        return iterator(right_sib_, first_);
+    }
+    iterator
+    end() const noexcept
+    {
+        return iterator(right_sib_, TSK_NULL);
+    }
+
+  private:
+    const tsk_id_t *right_sib_;
+    tsk_id_t first_;
+};
+
+/* Iterates over the nodes of a subtree in preorder, following the
+ * parent and sibling pointers so that no memory is allocated. */
+class preorder_range {
+  public:
+    class iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = tsk_id_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const tsk_id_t *;
+        using reference = tsk_id_t;
+
+        iterator(const tsk_tree_t *tree, tsk_id_t root, tsk_id_t u) noexcept
+            : tree_(tree), root_(root), u_(u)
+        {
+        }
+        tsk_id_t
+        operator*() const noexcept
+        {
+            return u_;
+        }
+        iterator &
+        operator++() noexcept
+        {
+            tsk_id_t u = u_;
+
+            if (tree_->left_child[u] != TSK_NULL) {
+                u_ = tree_->left_child[u];
+                return *this;
+            }
+            u_ = TSK_NULL;
+            while (u != root_ && u != TSK_NULL) {
+                if (tree_->right_sib[u] != TSK_NULL) {
+                    u_ = tree_->right_sib[u];
+                    break;
+                }
+                u = tree_->parent[u];
+            }
+            return *this;
+        }
+        bool
+        operator==(const iterator &other) const noexcept
+        {
+            return u_ == other.u_;
+        }
+        bool
+        operator!=(const iterator &other) const noexcept
+        {
+            return u_ != other.u_;
+        }
+
+      private:
+        const tsk_tree_t *tree_;
+        tsk_id_t root_;
+        tsk_id_t u_;
+    };
+
+    preorder_range(const tsk_tree_t *tree, tsk_id_t root, tsk_id_t first) noexcept
+        : tree_(tree), root_(root), first_(first)
+    {
+    }
+    iterator
+    begin() const noexcept
+    {
+        return iterator(tree_, root_, first_);
+    }
+    iterator
+    end() const noexcept
+    {
+        return iterator(tree_, root_, TSK_NULL);
+    }
+
+  private:
+    const tsk_tree_t *tree_;
+    tsk_id_t root_;
+    tsk_id_t first_;
+};
+
+/* Owns a tsk_tree_t. */
+class tree {
+  public:
+    explicit tree(const tree_sequence &ts, tsk_flags_t options = 0)
+        : tree_(detail::c_alloc<tsk_tree_t, tsk_tree_free>())
+    {
+        check(tsk_tree_init(tree_.get(), ts.get(), options));
+    }
+
+    /* These return false when the tree moves off either end of the
+     * sequence and becomes the null tree. */
+    bool
+    first()
+    {
+        return check(tsk_tree_first(tree_.get())) == TSK_TREE_OK;
+    }
+    bool
+    last()
+    {
+        return check(tsk_tree_last(tree_.get())) == TSK_TREE_OK;
+    }
+    bool
+    next()
+    {
+        return check(tsk_tree_next(tree_.get())) == TSK_TREE_OK;
+    }
+    bool
+    prev()
+    {
+        return check(tsk_tree_prev(tree_.get())) == TSK_TREE_OK;
+    }
+    void
+    seek(double position, tsk_flags_t options = 0)
+    {
+        check(tsk_tree_seek(tree_.get(), position, options));
+    }
+    void
+    seek_index(tsk_id_t index, tsk_flags_t options = 0)
+    {
+        check(tsk_tree_seek_index(tree_.get(), index, options));
+    }
+
+    tsk_id_t
+    index() const noexcept
+    {
+        return tree_->index;
+    }
+    double
+    left() const noexcept
+    {
+        return tree_->interval.left;
+    }
+    double
+    right() const noexcept
+    {
+        return tree_->interval.right;
+    }
+    double
+    span() const noexcept
+    {
+        return tree_->interval.right - tree_->interval.left;
+    }
+    std::size_t
+    num_roots() const noexcept
+    {
+        return tsk_tree_get_num_roots(tree_.get());
+    }
+    tsk_id_t
+    virtual_root() const noexcept
+    {
+        return tree_->virtual_root;
+    }
+
+    /* The tree arrays. These are not bounds checked. */
+    tsk_id_t
+    parent(tsk_id_t u) const noexcept
+    {
+        return tree_->parent[u];
+    }
+    tsk_id_t
+    left_child(tsk_id_t u) const noexcept
+    {
+        return tree_->left_child[u];
+    }
+    tsk_id_t
+    right_child(tsk_id_t u) const noexcept
+    {
+        return tree_->right_child[u];
+    }
+    tsk_id_t
+    left_sib(tsk_id_t u) const noexcept
+    {
+        return tree_->left_sib[u];
+    }
+    tsk_id_t
+    right_sib(tsk_id_t u) const noexcept
+    {
+        return tree_->right_sib[u];
+    }
+    tsk_size_t
+    num_samples(tsk_id_t u) const noexcept
+    {
+        return tree_->num_samples[u];
+    }
+
+    sibling_range
+    children(tsk_id_t u) const noexcept
+    {
+        return sibling_range(tree_->right_sib, tree_->left_child[u]);
+    }
+    sibling_range
+    roots() const noexcept
+    {
+        return children(tree_->virtual_root);
+    }
+    /* The nodes below u in preorder, starting with u itself. */
+    preorder_range
+    preorder(tsk_id_t u) const noexcept
+    {
+        return preorder_range(tree_.get(), u, u);
+    }
+    /* The nodes in all of the trees in preorder, as for
+     * tsk_tree_preorder. The virtual root is not included. */
+    preorder_range
+    preorder() const noexcept
+    {
+        return preorder_range(
+            tree_.get(), tree_->virtual_root, tree_->left_child[tree_->virtual_root]);
+    }
+
+    tsk_tree_t *
+    get() noexcept
+    {
+        return tree_.get();
+    }
+    const tsk_tree_t *
+    get() const noexcept
+    {
+        return tree_.get();
+    }
+
+  private:
+    detail::c_ptr<tsk_tree_t, tsk_tree_free> tree_;
+};
+
+/* Iterates over the trees from left to right, giving the same tree
+ * object at each step. */
+class tree_range {
+  public:
+    class iterator {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = tskit::tree;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const tskit::tree *;
+        using reference = const tskit::tree &;
+
+        explicit iterator(tskit::tree *tree) noexcept : tree_(tree) {}
+        const tskit::tree &
+        operator*() const noexcept
+        {
+            return *tree_;
+        }
+        const tskit::tree *
+        operator->() const noexcept
+        {
+            return tree_;
+        }
+        iterator &
+        operator++()
+        {
+            if (!tree_->next()) {
+                tree_ = nullptr;
+            }
+            return *this;
+        }
+        bool
+        operator==(const iterator &other) const noexcept
+        {
+            return tree_ == other.tree_;
+        }
+        bool
+        operator!=(const iterator &other) const noexcept
+        {
+            return tree_ != other.tree_;
+        }
+
+      private:
+        tskit::tree *tree_;
+    };
+
+    tree_range(const tree_sequence &ts, tsk_flags_t options) : tree_(ts, options) {}
+
+    iterator
+    begin()
+    {
+        return iterator(tree_.first() ? &tree_ : nullptr);
+    }
+    iterator
+    end() noexcept
+    {
+        return iterator(nullptr);
+    }
+
+  private:
+    tskit::tree tree_;
+};
+
+/* Owns a tsk_variant_t. */
+class variant {
+  public:
+    explicit variant(const tree_sequence &ts, tsk_flags_t options = 0)
+        : variant_(detail::c_alloc<tsk_variant_t, tsk_variant_free>())
+    {
+        check(tsk_variant_init(variant_.get(), ts.get(), nullptr, 0, nullptr, options));
+    }
+
+    void
+    decode(tsk_id_t site, tsk_flags_t options = 0)
+    {
+        check(tsk_variant_decode(variant_.get(), site, options));
+    }
+
+    const tsk_site_t &
+    site() const noexcept
+    {
+        return variant_->site;
+    }
+    column_view<const int32_t>
+    genotypes() const noexcept
+    {
+        return detail::column<int32_t>(variant_->genotypes, variant_->num_samples);
+    }
+    std::size_t
+    num_alleles() const noexcept
+    {
+        return variant_->num_alleles;
+    }
+    std::string_view
+    allele(std::size_t j) const noexcept
+    {
+        return std::string_view(variant_->alleles[j], variant_->allele_lengths[j]);
+    }
+    bool
+    has_missing_data() const noexcept
+    {
+        return variant_->has_missing_data;
+    }
+
+    tsk_variant_t *
+    get() noexcept
+    {
+        return variant_.get();
+    }
+    const tsk_variant_t *
+    get() const noexcept
+    {
+        return variant_.get();
+    }
+
+  private:
+    detail::c_ptr<tsk_variant_t, tsk_variant_free> variant_;
+};
+
+/* Iterates over the sites, decoding the variant at each one. */
+class variant_range {
+  public:
+    class iterator {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = tskit::variant;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const tskit::variant *;
+        using reference = const tskit::variant &;
+
+        iterator(tskit::variant *var, tsk_id_t site) noexcept : var_(var), site_(site)
+        {
+        }
+        const tskit::variant &
+        operator*() const noexcept
+        {
+            return *var_;
+        }
+        const tskit::variant *
+        operator->() const noexcept
+        {
+            return var_;
+        }
+        iterator &
+        operator++()
+        {
+            site_++;
+            decode();
+            return *this;
+        }
+        bool
+        operator==(const iterator &other) const noexcept
+        {
+            return site_ == other.site_;
+        }
+        bool
+        operator!=(const iterator &other) const noexcept
+        {
+            return site_ != other.site_;
+        }
+
+      private:
+        friend class variant_range;
+
+        void
+        decode()
+        {
+            if (static_cast<tsk_size_t>(site_)
+                < var_->get()->tree_sequence->tables->sites.num_rows) {
+                var_->decode(site_);
+            }
+        }
+
+        tskit::variant *var_;
+        tsk_id_t site_;
+    };
+
+    variant_range(const tree_sequence &ts, tsk_flags_t options)
+        : var_(ts, options), num_sites_(static_cast<tsk_id_t>(ts.num_sites()))
+    {
+    }
+
+    iterator
+    begin()
+    {
+        iterator it(&var_, 0);
+        it.decode();
+        return it;
+    }
+    iterator
+    end() noexcept
+    {
+        return iterator(&var_, num_sites_);
+    }
+
+  private:
+    tskit::variant var_;
+    tsk_id_t num_sites_;
+};
+
+/* The edges in one of the lists of an edge_diff. */
+class edge_list {
+  public:
+    class iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = tsk_edge_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const tsk_edge_t *;
+        using reference = const tsk_edge_t &;
+
+        explicit iterator(const tsk_edge_list_node_t *node) noexcept : node_(node) {}
+        const tsk_edge_t &
+        operator*() const noexcept
+        {
+            return node_->edge;
+        }
+        const tsk_edge_t *
+        operator->() const noexcept
+        {
+            return &node_->edge;
+        }
+        iterator &
+        operator++() noexcept
+        {
+            node_ = node_->next;
+            return *this;
+        }
+        bool
+        operator==(const iterator &other) const noexcept
+        {
+            return node_ == other.node_;
+        }
+        bool
+        operator!=(const iterator &other) const noexcept
+        {
+            return node_ != other.node_;
+        }
+
+      private:
+        const tsk_edge_list_node_t *node_;
+    };
+
+    explicit edge_list(const tsk_edge_list_t &list) noexcept : head_(list.head) {}
+    iterator
+    begin() const noexcept
+    {
+        return iterator(head_);
+    }
+    iterator
+    end() const noexcept
+    {
+        return iterator(nullptr);
+    }
+
+  private:
+    const tsk_edge_list_node_t *head_;
+};
+
+/* The edges removed and inserted to get the tree covering [left, right). */
+struct edge_diff {
+    double left;
+    double right;
+    tsk_edge_list_t edges_out;
+    tsk_edge_list_t edges_in;
+
+    tskit::edge_list
+    removed() const noexcept
+    {
+        return tskit::edge_list(edges_out);
+    }
+    tskit::edge_list
+    inserted() const noexcept
+    {
+        return tskit::edge_list(edges_in);
+    }
+};
+
+/* Iterates over the edge differences between adjacent trees, using a
+ * tsk_diff_iter_t. */
+class edge_diff_range {
+  public:
+    class iterator {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = edge_diff;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const edge_diff *;
+        using reference = const edge_diff &;
+
+        explicit iterator(edge_diff_range *range) noexcept : range_(range) {}
+        const edge_diff &
+        operator*() const noexcept
+        {
+            return range_->diff_;
+        }
+        const edge_diff *
+        operator->() const noexcept
+        {
+            return &range_->diff_;
+        }
+        iterator &
+        operator++()
+        {
+            if (!range_->advance()) {
+                range_ = nullptr;
+            }
+            return *this;
+        }
+        bool
+        operator==(const iterator &other) const noexcept
+        {
+            return range_ == other.range_;
+        }
+        bool
+        operator!=(const iterator &other) const noexcept
+        {
+            return range_ != other.range_;
+        }
+
+      private:
+        edge_diff_range *range_;
+    };
+
+    edge_diff_range(const tree_sequence &ts, tsk_flags_t options)
+        : iter_(detail::c_alloc<tsk_diff_iter_t, tsk_diff_iter_free>()), diff_()
+    {
+        check(tsk_diff_iter_init(iter_.get(), &ts.tables(),
+            static_cast<tsk_id_t>(ts.num_trees()), options));
+    }
+
+    iterator
+    begin()
+    {
+        return iterator(advance() ? this : nullptr);
+    }
+    iterator
+    end() noexcept
+    {
+        return iterator(nullptr);
+    }
+
+  private:
+    bool
+    advance()
+    {
+        return check(tsk_diff_iter_next(iter_.get(), &diff_.left, &diff_.right,
+                   &diff_.edges_out, &diff_.edges_in))
+               > 0;
+    }
+
+    detail::c_ptr<tsk_diff_iter_t, tsk_diff_iter_free> iter_;
+    edge_diff diff_;
+};
+
+inline tree_range
+tree_sequence::trees(tsk_flags_t options) const
+{
+    return tree_range(*this, options);
+}
+
+inline variant_range
+tree_sequence::variants(tsk_flags_t options) const
+{
+    return variant_range(*this, options);
+}
+
+inline edge_diff_range
+tree_sequence::edge_diffs(tsk_flags_t options) const
+{
+    return edge_diff_range(*this, options);
+}
+
+namespace detail {
+
+    /* Calls the summary function, and adds the value for the complement of
+     * the state when the statistic is not polarised. */
+    template <typename F>
+    inline void
+    summarise(F &f, bool polarised, std::size_t state_dim, std::size_t result_dim,
+        const double *state, const double *total_weight, double *tmp_state,
+        double *tmp_result, double *result)
+    {
+        f(state, result);
+        if (!polarised) {
+            for (std::size_t k = 0; k < state_dim; k++) {
+                tmp_state[k] = total_weight[k] - state[k];
+            }
+            f(static_cast<const double *>(tmp_state), tmp_result);
+            for (std::size_t m = 0; m < result_dim; m++) {
+                result[m] += tmp_result[m];
+            }
+        }
+    }
+
+    /* The branch mode general stat, as tsk_treeseq_general_stat with
+     * TSK_STAT_BRANCH, but with the summary function as a template
+     * parameter so that it can be inlined into the loop over nodes. */
+    template <typename F>
+    std::vector<double>
+    branch_general_stat(const tsk_treeseq_t *self, std::size_t state_dim,
+        const double *sample_weights, std::size_t result_dim, F &f,
+        const std::vector<double> &windows, tsk_flags_t options)
+    {
+        const tsk_size_t num_nodes = self->tables->nodes.num_rows;
+        const tsk_id_t num_edges = static_cast<tsk_id_t>(self->tables->edges.num_rows);
+        const tsk_id_t *I = self->tables->indexes.edge_insertion_order;
+        const tsk_id_t *O = self->tables->indexes.edge_removal_order;
+        const double *edge_left = self->tables->edges.left;
+        const double *edge_right = self->tables->edges.right;
+        const tsk_id_t *edge_parent = self->tables->edges.parent;
+        const tsk_id_t *edge_child = self->tables->edges.child;
+        const double *time = self->tables->nodes.time;
+        const std::size_t num_windows = windows.size() - 1;
+        const double stop = windows[num_windows];
+        const bool polarised = !!(options & TSK_STAT_POLARISED);
+        std::vector<tsk_id_t> parent(num_nodes, TSK_NULL);
+        std::vector<double> branch_length(num_nodes, 0.0);
+        std::vector<double> state(num_nodes * state_dim, 0.0);
+        std::vector<double> summary(num_nodes * result_dim, 0.0);
+        std::vector<double> running_sum(result_dim, 0.0);
+        std::vector<double> total_weight(state_dim, 0.0);
+        std::vector<double> tmp_state(state_dim);
+        std::vector<double> tmp_result(result_dim);
+        std::vector<double> result(num_windows * result_dim, 0.0);
+        tsk_id_t tj, tk, h, u, v;
+        std::size_t window_index, k;
+        double t_left, t_right, left, right, scale;
+
+        const auto update_running_sum = [&](tsk_id_t node, double sign) {
+            const double x = sign * branch_length[node];
+            const double *summary_u = summary.data() + node * result_dim;
+            for (std::size_t m = 0; m < result_dim; m++) {
+                running_sum[m] += x * summary_u[m];
+            }
+        };
+        const auto update_node = [&](tsk_id_t node, tsk_id_t child, double sign) {
+            double *state_u = state.data() + node * state_dim;
+            const double *state_c = state.data() + child * state_dim;
+            update_running_sum(node, -1);
+            for (std::size_t j = 0; j < state_dim; j++) {
+                state_u[j] += sign * state_c[j];
+            }
+            summarise(f, polarised, state_dim, result_dim, state_u,
+                total_weight.data(), tmp_state.data(), tmp_result.data(),
+                summary.data() + node * result_dim);
+            update_running_sum(node, +1);
+        };
+
+        for (std::size_t j = 0; j < self->num_samples; j++) {
+            for (k = 0; k < state_dim; k++) {
+                total_weight[k] += sample_weights[j * state_dim + k];
+            }
+        }
+        for (std::size_t j = 0; j < self->num_samples; j++) {
+            u = self->samples[j];
+            double *state_u = state.data() + u * state_dim;
+            for (k = 0; k < state_dim; k++) {
+                state_u[k] = sample_weights[j * state_dim + k];
+            }
+            summarise(f, polarised, state_dim, result_dim, state_u,
+                total_weight.data(), tmp_state.data(), tmp_result.data(),
+                summary.data() + u * result_dim);
+        }
+
+        tj = 0;
+        tk = 0;
+        t_left = windows[0];
+        while (tk < num_edges && edge_right[O[tk]] <= t_left) {
+            tk++;
+        }
+        window_index = 0;
+        while (t_left < stop) {
+            while (tk < num_edges && edge_right[O[tk]] == t_left) {
+                h = O[tk];
+                tk++;
+                u = edge_child[h];
+                update_running_sum(u, -1);
+                parent[u] = TSK_NULL;
+                branch_length[u] = 0;
+                for (v = edge_parent[h]; v != TSK_NULL; v = parent[v]) {
+                    update_node(v, edge_child[h], -1);
+                }
+            }
+            while (tj < num_edges && edge_left[I[tj]] <= t_left) {
+                h = I[tj];
+                tj++;
+                if (edge_right[h] <= t_left) {
+                    continue;
+                }
+                u = edge_child[h];
+                v = edge_parent[h];
+                parent[u] = v;
+                branch_length[u] = time[v] - time[u];
+                update_running_sum(u, +1);
+                for (; v != TSK_NULL; v = parent[v]) {
+                    update_node(v, edge_child[h], +1);
+                }
+            }
+
+            t_right = stop;
+            if (tj < num_edges) {
+                t_right = TSK_MIN(t_right, edge_left[I[tj]]);
+            }
+            if (tk < num_edges) {
+                t_right = TSK_MIN(t_right, edge_right[O[tk]]);
+            }
+            while (windows[window_index] < t_right) {
+                left = TSK_MAX(t_left, windows[window_index]);
+                right = TSK_MIN(t_right, windows[window_index + 1]);
+                scale = right - left;
+                double *result_row = result.data() + window_index * result_dim;
+                for (k = 0; k < result_dim; k++) {
+                    result_row[k] += running_sum[k] * scale;
+                }
+                if (windows[window_index + 1] <= t_right) {
+                    window_index++;
+                } else {
+                    break;
+                }
+            }
+            t_left = t_right;
+        }
+        return result;
+    }
+
+    template <typename F> struct summary_func_params {
+        F *f;
+        std::exception_ptr exception;
+    };
+
+    /* Calls the C++ summary function from the C API, catching any exception
+     * so that it doesn't propagate through the C code. */
+    template <typename F>
+    int
+    summary_func_trampoline(tsk_size_t TSK_UNUSED(state_dim), const double *state,
+        tsk_size_t TSK_UNUSED(result_dim), double *result, void *params)
+    {
+        auto *p = static_cast<summary_func_params<F> *>(params);
+        try {
+            (*p->f)(state, result);
+        } catch (...) {
+            p->exception = std::current_exception();
+            return TSK_ERR_GENERIC;
+        }
+        return 0;
+    }
+
+} // namespace detail
+
+/* Computes a general statistic with the summary function f, which is called
+ * as f(const double *state, double *result) with arrays of state_dim and
+ * result_dim values. The sample weights are a num_samples x state_dim
+ * matrix, and an empty windows vector means a single window covering the
+ * sequence. The options and the layout of the result are as for
+ * tsk_treeseq_general_stat.
+ *
+ * In branch mode the computation is done here, with f inlined into the
+ * loop over the nodes whose state changes at each tree, rather than called
+ * through a function pointer. Other modes call tsk_treeseq_general_stat. */
+template <typename F>
+std::vector<double>
+general_stat(const tree_sequence &ts, std::size_t state_dim,
+    column_view<const double> sample_weights, std::size_t result_dim, F f,
+    std::vector<double> windows = {}, tsk_flags_t options = 0)
+{
+    const tsk_treeseq_t *self = ts.get();
+    const tsk_flags_t modes = TSK_STAT_SITE | TSK_STAT_BRANCH | TSK_STAT_NODE;
+    std::vector<double> result;
+    std::size_t num_windows, row_size, j, k;
+
+    if (windows.empty()) {
+        windows = { 0, ts.sequence_length() };
+    }
+    if (sample_weights.size() != ts.num_samples() * state_dim) {
+        throw error(TSK_ERR_BAD_PARAM_VALUE);
+    }
+    num_windows = windows.size() - 1;
+
+    if ((options & modes) != TSK_STAT_BRANCH) {
+        detail::summary_func_params<F> params{ &f, nullptr };
+        row_size = result_dim;
+        if (options & TSK_STAT_NODE) {
+            row_size *= ts.num_nodes();
+        }
+        result.resize(TSK_MAX(num_windows, 1) * row_size);
+        int ret = tsk_treeseq_general_stat(self, state_dim, sample_weights.data(),
+            result_dim, detail::summary_func_trampoline<F>, &params, num_windows,
+            windows.data(), options, result.data());
+        if (params.exception) {
+            std::rethrow_exception(params.exception);
+        }
+        check(ret);
+        return result;
+    }
+
+    /* Check the arguments as tsk_treeseq_general_stat does */
+    if (state_dim < 1) {
+        throw error(TSK_ERR_BAD_STATE_DIMS);
+    }
+    if (result_dim < 1) {
+        throw error(TSK_ERR_BAD_RESULT_DIMS);
+    }
+    if (num_windows < 1) {
+        throw error(TSK_ERR_BAD_NUM_WINDOWS);
+    }
+    if (windows[0] < 0 || windows[num_windows] > ts.sequence_length()) {
+        throw error(TSK_ERR_BAD_WINDOWS);
+    }
+    for (j = 0; j < num_windows; j++) {
+        if (windows[j] >= windows[j + 1]) {
+            throw error(TSK_ERR_BAD_WINDOWS);
+        }
+    }
+    if (self->time_uncalibrated && !(options & TSK_STAT_ALLOW_TIME_UNCALIBRATED)) {
+        throw error(TSK_ERR_TIME_UNCALIBRATED);
+    }
+
+    result = detail::branch_general_stat(
+        self, state_dim, sample_weights.data(), result_dim, f, windows, options);
+    if (options & TSK_STAT_SPAN_NORMALISE) {
+        for (j = 0; j < num_windows; j++) {
+            for (k = 0; k < result_dim; k++) {
+                result[j * result_dim + k] /= windows[j + 1] - windows[j];
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace tskit
+
+#endif
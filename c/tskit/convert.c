@@ -44,14 +44,120 @@
 typedef struct {
     unsigned int precision;
     tsk_flags_t options;
+    /* The output buffer. If growable is true this is owned by the converter,
+     * and is reallocated as needed to fit the output. */
     char *newick;
+    size_t newick_size;
+    size_t newick_length;
+    bool growable;
     tsk_id_t *traversal_stack;
     const tsk_tree_t *tree;
 } tsk_newick_converter_t;
 
+/* Makes sure that there is space for length more characters and the
+ * terminating NUL in the output buffer. */
 static int
-tsk_newick_converter_run(
-    tsk_newick_converter_t *self, tsk_id_t root, size_t buffer_size, char *buffer)
+tsk_newick_converter_reserve(tsk_newick_converter_t *self, size_t length)
+{
+    int ret = 0;
+    size_t size = self->newick_length + length + 1;
+    char *p;
+
+    if (size > self->newick_size) {
+        if (!self->growable) {
+            ret = TSK_ERR_BUFFER_OVERFLOW;
+            goto out;
+        }
+        size = TSK_MAX(size, 2 * self->newick_size);
+        p = tsk_realloc(self->newick, (tsk_size_t) size);
+        if (p == NULL) {
+            ret = TSK_ERR_NO_MEMORY;
+            goto out;
+        }
+        self->newick = p;
+        self->newick_size = size;
+    }
+out:
+    return ret;
+}
+
+static int
+tsk_newick_converter_append_char(tsk_newick_converter_t *self, char c)
+{
+    int ret = tsk_newick_converter_reserve(self, 1);
+
+    if (ret != 0) {
+        goto out;
+    }
+    self->newick[self->newick_length] = c;
+    self->newick_length++;
+    self->newick[self->newick_length] = '\0';
+out:
+    return ret;
+}
+
+static int
+tsk_newick_converter_append_label(tsk_newick_converter_t *self, int label)
+{
+    int ret = 0;
+    /* Enough for the "n" prefix, a 32 bit int and the NUL */
+    char str[16];
+    int r;
+
+    r = snprintf(str, sizeof(str),
+        self->options & TSK_NEWICK_LEGACY_MS_LABELS ? "%d" : "n%d", label);
+    if (r < 0 || (size_t) r >= sizeof(str)) {
+        ret = TSK_ERR_IO;
+        goto out;
+    }
+    ret = tsk_newick_converter_reserve(self, (size_t) r);
+    if (ret != 0) {
+        goto out;
+    }
+    tsk_memcpy(self->newick + self->newick_length, str, (size_t) r + 1);
+    self->newick_length += (size_t) r;
+out:
+    return ret;
+}
+
+/* Appends a single floating point value printed using the specified format,
+ * which must contain exactly one "%.*f" conversion. */
+static int
+tsk_newick_converter_append_float(
+    tsk_newick_converter_t *self, const char *format, double value)
+{
+    int ret = 0;
+    size_t space = self->newick_size - self->newick_length;
+    int r;
+
+    /* Values can be arbitrarily long, so we try to print into the
+     * available space first and grow the buffer if needed. */
+    r = snprintf(self->newick + self->newick_length, space, format,
+        (int) self->precision, value);
+    if (r < 0) {
+        ret = TSK_ERR_IO;
+        goto out;
+    }
+    if ((size_t) r >= space) {
+        ret = tsk_newick_converter_reserve(self, (size_t) r);
+        if (ret != 0) {
+            goto out;
+        }
+        space = self->newick_size - self->newick_length;
+        r = snprintf(self->newick + self->newick_length, space, format,
+            (int) self->precision, value);
+        if (r < 0 || (size_t) r >= space) {
+            ret = TSK_ERR_IO;
+            goto out;
+        }
+    }
+    self->newick_length += (size_t) r;
+out:
+    return ret;
+}
+
+static int
+tsk_newick_converter_run(tsk_newick_converter_t *self, tsk_id_t root)
 {
     int ret = TSK_ERR_GENERIC;
     const tsk_tree_t *tree = self->tree;
@@ -60,33 +166,29 @@ tsk_newick_converter_run(
     const tsk_flags_t *flags = self->tree->tree_sequence->tables->nodes.flags;
     int stack_top = 0;
     int label;
-    size_t s = 0;
-    int r;
     tsk_id_t u, v, w, root_parent;
-    double branch_length;
     bool ms_labels = self->options & TSK_NEWICK_LEGACY_MS_LABELS;
-    const char *label_format = ms_labels ? "%d" : "n%d";
 
     if (root < 0 || root >= (tsk_id_t) self->tree->num_nodes) {
         ret = TSK_ERR_NODE_OUT_OF_BOUNDS;
         goto out;
     }
-    if (buffer == NULL) {
-        ret = TSK_ERR_BAD_PARAM_VALUE;
+    /* The newick string is appended to whatever is already in the buffer */
+    ret = tsk_newick_converter_reserve(self, 0);
+    if (ret != 0) {
         goto out;
     }
+    self->newick[self->newick_length] = '\0';
     root_parent = tree->parent[root];
     stack[0] = root;
     u = root_parent;
     while (stack_top >= 0) {
         v = stack[stack_top];
         if (tree->left_child[v] != TSK_NULL && v != u) {
-            if (s >= buffer_size) {
-                ret = TSK_ERR_BUFFER_OVERFLOW;
+            ret = tsk_newick_converter_append_char(self, '(');
+            if (ret != 0) {
                 goto out;
             }
-            buffer[s] = '(';
-            s++;
             for (w = tree->right_child[v]; w != TSK_NULL; w = tree->left_sib[w]) {
                 stack_top++;
                 stack[stack_top] = w;
@@ -103,57 +205,33 @@ tsk_newick_converter_run(
                 label = (int) v;
             }
             if (label != -1) {
-                if (s >= buffer_size) {
-                    ret = TSK_ERR_BUFFER_OVERFLOW;
-                    goto out;
-                }
-                r = snprintf(buffer + s, buffer_size - s, label_format, label);
-                if (r < 0) {
-                    ret = TSK_ERR_IO;
-                    goto out;
-                }
-                s += (size_t) r;
-                if (s >= buffer_size) {
-                    ret = TSK_ERR_BUFFER_OVERFLOW;
+                ret = tsk_newick_converter_append_label(self, label);
+                if (ret != 0) {
                     goto out;
                 }
             }
             if (u != root_parent) {
-                branch_length = (time[u] - time[v]);
-                r = snprintf(buffer + s, buffer_size - s, ":%.*f", (int) self->precision,
-                    branch_length);
-                if (r < 0) {
-                    ret = TSK_ERR_IO;
+                ret = tsk_newick_converter_append_float(
+                    self, ":%.*f", time[u] - time[v]);
+                if (ret != 0) {
                     goto out;
                 }
-                s += (size_t) r;
-                if (s >= buffer_size) {
-                    ret = TSK_ERR_BUFFER_OVERFLOW;
+                ret = tsk_newick_converter_append_char(
+                    self, v == tree->right_child[u] ? ')' : ',');
+                if (ret != 0) {
                     goto out;
                 }
-                if (v == tree->right_child[u]) {
-                    buffer[s] = ')';
-                } else {
-                    buffer[s] = ',';
-                }
-                s++;
             }
         }
     }
-    if ((s + 1) >= buffer_size) {
-        ret = TSK_ERR_BUFFER_OVERFLOW;
-        goto out;
-    }
-    buffer[s] = ';';
-    buffer[s + 1] = '\0';
-    ret = 0;
+    ret = tsk_newick_converter_append_char(self, ';');
 out:
     return ret;
 }
 
 static int
 tsk_newick_converter_init(tsk_newick_converter_t *self, const tsk_tree_t *tree,
-    unsigned int precision, tsk_flags_t options)
+    unsigned int precision, tsk_flags_t options, tsk_size_t max_tree_size)
 {
     int ret = 0;
 
@@ -161,8 +239,7 @@ tsk_newick_converter_init(tsk_newick_converter_t *self, const tsk_tree_t *tree,
     self->precision = precision;
     self->options = options;
     self->tree = tree;
-    self->traversal_stack
-        = tsk_malloc(tsk_tree_get_size_bound(tree) * sizeof(*self->traversal_stack));
+    self->traversal_stack = tsk_malloc(max_tree_size * sizeof(*self->traversal_stack));
     if (self->traversal_stack == NULL) {
         ret = TSK_ERR_NO_MEMORY;
         goto out;
@@ -175,6 +252,9 @@ static int
 tsk_newick_converter_free(tsk_newick_converter_t *self)
 {
     tsk_safe_free(self->traversal_stack);
+    if (self->growable) {
+        tsk_safe_free(self->newick);
+    }
     return 0;
 }
 
@@ -185,12 +265,117 @@ tsk_convert_newick(const tsk_tree_t *tree, tsk_id_t root, unsigned int precision
     int ret = 0;
     tsk_newick_converter_t nc;
 
-    ret = tsk_newick_converter_init(&nc, tree, precision, options);
+    ret = tsk_newick_converter_init(
+        &nc, tree, precision, options, tsk_tree_get_size_bound(tree));
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_newick_converter_run(&nc, root, buffer_size, buffer);
+    if (buffer == NULL) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    nc.newick = buffer;
+    nc.newick_size = buffer_size;
+    nc.newick_length = 0;
+    ret = tsk_newick_converter_run(&nc, root);
 out:
     tsk_newick_converter_free(&nc);
     return ret;
 }
+
+int
+tsk_convert_newick_trees(const tsk_treeseq_t *ts, tsk_id_t start, tsk_id_t stop,
+    unsigned int precision, tsk_flags_t options, tsk_newick_write_func_t *write,
+    void *params)
+{
+    int ret = 0;
+    tsk_tree_t tree;
+    tsk_newick_converter_t nc;
+    tsk_id_t root, j;
+    bool nc_initialised = false;
+
+    ret = tsk_tree_init(&tree, ts, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (start < 0 || stop > (tsk_id_t) tsk_treeseq_get_num_trees(ts) || start > stop) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    /* The tree is in the null state here, so we use a bound on the size of
+     * any of the trees in the tree sequence */
+    ret = tsk_newick_converter_init(
+        &nc, &tree, precision, options, tsk_treeseq_get_num_nodes(ts) + 1);
+    nc_initialised = true;
+    if (ret != 0) {
+        goto out;
+    }
+    /* The output buffer is reused for all trees, so it quickly grows to the
+     * size needed for the largest tree and is then not reallocated */
+    nc.growable = true;
+    if (start == stop) {
+        goto out;
+    }
+    ret = tsk_tree_seek_index(&tree, start, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = start; j < stop; j++) {
+        for (root = tsk_tree_get_left_root(&tree); root != TSK_NULL;
+             root = tree.right_sib[root]) {
+            nc.newick_length = 0;
+            if (options & TSK_NEWICK_SPAN_PREFIX) {
+                ret = tsk_newick_converter_append_float(
+                    &nc, "[%.*f]", tree.interval.right - tree.interval.left);
+                if (ret != 0) {
+                    goto out;
+                }
+            }
+            ret = tsk_newick_converter_run(&nc, root);
+            if (ret != 0) {
+                goto out;
+            }
+            ret = tsk_newick_converter_append_char(&nc, '\n');
+            if (ret != 0) {
+                goto out;
+            }
+            ret = write(nc.newick, nc.newick_length, params);
+            if (ret != 0) {
+                goto out;
+            }
+        }
+        if (j + 1 < stop) {
+            ret = tsk_tree_next(&tree);
+            if (ret < 0) {
+                goto out;
+            }
+        }
+    }
+    ret = 0;
+out:
+    if (nc_initialised) {
+        tsk_newick_converter_free(&nc);
+    }
+    tsk_tree_free(&tree);
+    return ret;
+}
+
+static int
+tsk_newick_write_file(const char *text, size_t length, void *params)
+{
+    FILE *out = (FILE *) params;
+    int ret = 0;
+
+    if (fwrite(text, 1, length, out) != length) {
+        ret = TSK_ERR_IO;
+    }
+    return ret;
+}
+
+int
+tsk_convert_newick_treeseq(const tsk_treeseq_t *ts, unsigned int precision,
+    tsk_flags_t options, FILE *out)
+{
+    return tsk_convert_newick_trees(ts, 0, (tsk_id_t) tsk_treeseq_get_num_trees(ts),
+        precision, options, tsk_newick_write_file, out);
+}
@@ -33,10 +33,32 @@ extern "C" {
 #include <tskit/trees.h>
 
 #define TSK_NEWICK_LEGACY_MS_LABELS (1 << 0)
+#define TSK_NEWICK_SPAN_PREFIX (1 << 1)
 
 int tsk_convert_newick(const tsk_tree_t *tree, tsk_id_t root, unsigned int precision,
     tsk_flags_t options, size_t buffer_size, char *buffer);
 
+/* Function called with each line of output from tsk_convert_newick_trees. The
+ * text is not NUL terminated and is only valid for the duration of the call.
+ * A non-zero return value stops the conversion, and is returned to the caller. */
+typedef int tsk_newick_write_func_t(const char *text, size_t length, void *params);
+
+/* Writes the newick representation of the trees with indexes in [start, stop)
+ * to the specified write function, one line per root of each tree. Each call
+ * uses its own tree and output buffer, so disjoint ranges of trees can be
+ * converted concurrently from different threads sharing the same tree
+ * sequence, and the outputs concatenated in order. */
+int tsk_convert_newick_trees(const tsk_treeseq_t *ts, tsk_id_t start, tsk_id_t stop,
+    unsigned int precision, tsk_flags_t options, tsk_newick_write_func_t *write,
+    void *params);
+
+/* Writes the newick representation of every tree in the tree sequence to the
+ * specified stream, one line per root of each tree. If TSK_NEWICK_SPAN_PREFIX
+ * is specified, each line is prefixed with the span of the tree in square
+ * brackets, as in the output of ms. */
+int tsk_convert_newick_treeseq(const tsk_treeseq_t *ts, unsigned int precision,
+    tsk_flags_t options, FILE *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,7 @@
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <time.h>
 
 #include <kastore.h>
 #include <tskit/core.h>
@@ -364,6 +365,11 @@ tsk_strerror_internal(int err)
             ret = "Table collection indexes inconsistent: do they need to be rebuilt? "
                   "(TSK_ERR_TABLES_BAD_INDEXES)";
             break;
+        case TSK_ERR_TABLE_MAPPED:
+            ret = "Cannot modify a table loaded with TSK_LOAD_MMAP directly; use the "
+                  "table collection functions, which copy the mapped columns first. "
+                  "(TSK_ERR_TABLE_MAPPED)";
+            break;
         case TSK_ERR_TABLE_OVERFLOW:
             ret = "Table too large; cannot allocate more than 2**31 rows. This error "
                   "is often caused by a lack of simplification when simulating. "
@@ -484,6 +490,14 @@ tsk_strerror_internal(int err)
             ret = "Insufficient weights provided (at least 1 required). "
                   "(TSK_ERR_INSUFFICIENT_WEIGHTS)";
             break;
+        case TSK_ERR_BAD_TIME_WINDOWS:
+            ret = "Time windows must be non-empty and strictly increasing. "
+                  "(TSK_ERR_BAD_TIME_WINDOWS)";
+            break;
+        case TSK_ERR_BAD_AFS_PROJECTION:
+            ret = "AFS projection sizes must not be larger than the sample set "
+                  "sizes. (TSK_ERR_BAD_AFS_PROJECTION)";
+            break;
 
         /* Mutation mapping errors */
         case TSK_ERR_GENOTYPES_ALL_MISSING:
@@ -513,6 +527,10 @@ tsk_strerror_internal(int err)
             ret = "Must have at least one allele when specifying an allele map. "
                   "(TSK_ERR_ZERO_ALLELES)";
             break;
+        case TSK_ERR_NOT_BIALLELIC:
+            ret = "Only sites with genotypes 0, 1 or missing can be decoded to a bit "
+                  "array. (TSK_ERR_NOT_BIALLELIC)";
+            break;
 
         /* Distance metric errors */
         case TSK_ERR_SAMPLE_SIZE_MISMATCH:
@@ -729,6 +747,7 @@ tsk_blkalloc_init(tsk_blkalloc_t *self, size_t chunk_size)
     }
     self->num_chunks = 1;
     self->total_size = chunk_size + sizeof(void *);
+    TSK_COUNTER_ADD(blkalloc_chunks, 1);
 out:
     return ret;
 }
@@ -755,6 +774,7 @@ tsk_blkalloc_get(tsk_blkalloc_t *self, size_t size)
             }
             self->mem_chunks[self->num_chunks] = p;
             self->num_chunks++;
+            TSK_COUNTER_ADD(blkalloc_chunks, 1);
             self->total_size += self->chunk_size + sizeof(void *);
         }
         self->current_chunk++;
@@ -967,6 +987,50 @@ tsk_get_debug_stream(void)
     return _tsk_debug_stream;
 }
 
+/* The instrumentation counters. The start times of the timers are stored
+ * in the corresponding fields of a second instance of the struct. */
+
+#ifdef TSK_INSTRUMENT
+
+tsk_counters_t tsk_instrument_counters;
+tsk_counters_t tsk_instrument_timer_starts;
+
+double
+tsk_instrument_cpu_time(void)
+{
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
+int
+tsk_get_counters(tsk_counters_t *counters)
+{
+    tsk_memcpy(counters, &tsk_instrument_counters, sizeof(*counters));
+    return 0;
+}
+
+void
+tsk_reset_counters(void)
+{
+    tsk_memset(&tsk_instrument_counters, 0, sizeof(tsk_instrument_counters));
+    tsk_memset(&tsk_instrument_timer_starts, 0, sizeof(tsk_instrument_timer_starts));
+}
+
+#else
+
+int
+tsk_get_counters(tsk_counters_t *counters)
+{
+    tsk_memset(counters, 0, sizeof(*counters));
+    return TSK_ERR_UNSUPPORTED_OPERATION;
+}
+
+void
+tsk_reset_counters(void)
+{
+}
+
+#endif
+
 /* AVL Tree implementation. This is based directly on Knuth's implementation
  * in TAOCP. See the python/tests/test_avl_tree.py for more information,
  * and equivalent code annotated with the original algorithm listing.
@@ -1189,7 +1253,7 @@ tsk_avl_tree_int_ordered_nodes(const tsk_avl_tree_int_t *self, tsk_avl_node_int_
 }
 
 // Bit Array implementation. Allows us to store unsigned integers in a compact manner.
-// Currently implemented as an array of 32-bit unsigned integers for ease of counting.
+// Currently implemented as an array of 64-bit unsigned integers for ease of counting.
 
 int
 tsk_bit_array_init(tsk_bit_array_t *self, tsk_size_t num_bits, tsk_size_t length)
@@ -1254,28 +1318,49 @@ tsk_bit_array_contains(const tsk_bit_array_t *self, const tsk_bit_array_value_t
            & ((tsk_bit_array_value_t) 1 << (bit - (TSK_BIT_ARRAY_NUM_BITS * i)));
 }
 
+/* Count the set bits in a single 64 bit chunk. GCC and clang compile the builtin
+ * to a single POPCNT (or equivalent) instruction when the target supports it,
+ * e.g. with -mpopcnt or -march=native, and to an efficient software fallback
+ * otherwise. For other compilers we use the SWAR method from
+ *   https://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+ */
+static inline tsk_size_t
+tsk_bit_array_popcount(tsk_bit_array_value_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (tsk_size_t) __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (tsk_size_t)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
 tsk_size_t
 tsk_bit_array_count(const tsk_bit_array_t *self)
 {
-    // Utilizes 12 operations per bit array. NB this only works on 32 bit integers.
-    // Taken from:
-    //   https://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
-    // There's a nice breakdown of this algorithm here:
-    //   https://stackoverflow.com/a/109025
-    // Could probably do better with explicit SIMD (instead of SWAR), but not as
-    // portable: https://arxiv.org/pdf/1611.07612.pdf
-    //
-    // There is one solution to explore further, which uses __builtin_popcountll.
-    // This option is relatively simple, but requires a 64 bit bit array and also
-    // involves some compiler flag plumbing (-mpopcnt)
-
-    tsk_bit_array_value_t tmp;
+    const tsk_bit_array_value_t *restrict data = self->data;
+    tsk_size_t i, count = 0;
+
+    for (i = 0; i < self->size; i++) {
+        count += tsk_bit_array_popcount(data[i]);
+    }
+    return count;
+}
+
+/* Returns the number of bits set in both arrays, equivalent to calling
+ * tsk_bit_array_count on the output of tsk_bit_array_intersect without
+ * writing out the intersection. */
+tsk_size_t
+tsk_bit_array_intersect_count(const tsk_bit_array_t *self, const tsk_bit_array_t *other)
+{
+    const tsk_bit_array_value_t *restrict a = self->data;
+    const tsk_bit_array_value_t *restrict b = other->data;
     tsk_size_t i, count = 0;
 
     for (i = 0; i < self->size; i++) {
-        tmp = self->data[i] - ((self->data[i] >> 1) & 0x55555555);
-        tmp = (tmp & 0x33333333) + ((tmp >> 2) & 0x33333333);
-        count += (((tmp + (tmp >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24;
+        count += tsk_bit_array_popcount(a[i] & b[i]);
     }
     return count;
 }
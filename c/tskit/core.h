@@ -207,6 +207,9 @@ whose representation differs from the NAN generated by computations such as divi
 #define TSK_FILE_FORMAT_NAME_LENGTH   11
 #define TSK_FILE_FORMAT_VERSION_MAJOR 12
 #define TSK_FILE_FORMAT_VERSION_MINOR 7
+/* Files with offset columns written by TSK_DUMP_COMPRESS_OFFSETS are given
+ * this minor version, so that other readers can tell them apart. */
+#define TSK_FILE_FORMAT_VERSION_MINOR_COMPRESSED_OFFSETS 8
 
 /**
 @defgroup GENERIC_FUNCTION_OPTIONS General options flags used in some functions.
@@ -567,6 +570,11 @@ Metadata was attempted to be set on a table where it is disabled.
 There was an error with the table's indexes.
 */
 #define TSK_ERR_TABLES_BAD_INDEXES                                  -707
+/**
+A table was modified directly while its columns are borrowed from a
+file mapping (see TSK_LOAD_MMAP).
+*/
+#define TSK_ERR_TABLE_MAPPED                                        -708
 /** @} */
 
 /**
@@ -694,6 +702,16 @@ not support it.
 Insufficient weights were provided.
 */
 #define TSK_ERR_INSUFFICIENT_WEIGHTS                                -913
+/**
+The time windows were not valid: there must be at least one time window, and
+the breakpoints must be strictly increasing.
+*/
+#define TSK_ERR_BAD_TIME_WINDOWS                                    -914
+/**
+An allele frequency spectrum projection was larger than the size of the
+corresponding sample set.
+*/
+#define TSK_ERR_BAD_AFS_PROJECTION                                  -915
 /** @} */
 
 /**
@@ -740,6 +758,11 @@ More than 2147483647 alleles were specified.
 A user-specified allele map was used, but it contained zero alleles.
 */
 #define TSK_ERR_ZERO_ALLELES                                       -1103
+/**
+A site with more than two distinct genotypes was decoded into a
+one-bit-per-sample representation.
+*/
+#define TSK_ERR_NOT_BIALLELIC                                      -1104
 /** @} */
 
 /**
@@ -1024,15 +1047,92 @@ int tsk_memcmp(const void *s1, const void *s2, tsk_size_t size);
 void tsk_set_debug_stream(FILE *f);
 FILE *tsk_get_debug_stream(void);
 
+/**
+@brief Counts of the work done in the library's hot paths.
+
+@rst
+The counters are only updated when tskit is compiled with ``TSK_INSTRUMENT``
+defined, and the instrumentation has no cost otherwise. The counts are global
+to the process and are **not** threadsafe. Times are in seconds of processor
+time, as measured by ``clock()``. See :c:func:`tsk_get_counters`.
+@endrst
+*/
+typedef struct {
+    /** @brief The number of edges inserted into trees. */
+    uint64_t edges_inserted;
+    /** @brief The number of edges removed from trees. */
+    uint64_t edges_removed;
+    /** @brief The number of trees visited by tree iteration and seeking. */
+    uint64_t trees_visited;
+    /** @brief The number of calls to statistic summary functions. */
+    uint64_t summary_func_calls;
+    /** @brief The number of memory chunks allocated by block allocators. */
+    uint64_t blkalloc_chunks;
+    /** @brief The total size of the files read by load. */
+    uint64_t bytes_read;
+    /** @brief The total size of the files written by dump. */
+    uint64_t bytes_written;
+    /** @brief The time spent loading table collections. */
+    double load_time;
+    /** @brief The time spent dumping table collections. */
+    double dump_time;
+    /** @brief The time spent sorting table collections. */
+    double sort_time;
+    /** @brief The time spent in simplify. */
+    double simplify_time;
+    /** @brief The time spent computing general summary statistics. */
+    double stats_time;
+} tsk_counters_t;
+
+/**
+@brief Get the current values of the instrumentation counters.
+
+@rst
+Copies the current values of the counters into the specified struct. Returns
+:c:macro:`TSK_ERR_UNSUPPORTED_OPERATION` if tskit was not compiled with
+``TSK_INSTRUMENT`` defined, in which case the counters are all zero.
+@endrst
+
+@param counters A pointer to a tsk_counters_t to store the values in.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_get_counters(tsk_counters_t *counters);
+
+/**
+@brief Reset all the instrumentation counters to zero.
+*/
+void tsk_reset_counters(void);
+
+/* Internal macros used to update the counters. These compile to nothing
+ * unless TSK_INSTRUMENT is defined, and the counters themselves only exist
+ * in instrumented builds. Different timers can overlap, but a timer must be
+ * stopped before it is started again. */
+#ifdef TSK_INSTRUMENT
+extern tsk_counters_t tsk_instrument_counters;
+extern tsk_counters_t tsk_instrument_timer_starts;
+double tsk_instrument_cpu_time(void);
+#define TSK_COUNTER_ADD(counter, value)                                                 \
+    (tsk_instrument_counters.counter += (uint64_t) (value))
+#define TSK_TIMER_START(timer)                                                          \
+    (tsk_instrument_timer_starts.timer = tsk_instrument_cpu_time())
+#define TSK_TIMER_STOP(timer)                                                           \
+    (tsk_instrument_counters.timer                                                      \
+        += tsk_instrument_cpu_time() - tsk_instrument_timer_starts.timer)
+#else
+#define TSK_COUNTER_ADD(counter, value) ((void) 0)
+#define TSK_TIMER_START(timer) ((void) 0)
+#define TSK_TIMER_STOP(timer) ((void) 0)
+#endif
+
 /* Bit Array functionality */
 
-typedef uint32_t tsk_bit_array_value_t;
+typedef uint64_t tsk_bit_array_value_t;
 typedef struct {
     tsk_size_t size;             // Number of chunks per row
     tsk_bit_array_value_t *data; // Array data
 } tsk_bit_array_t;
 
-#define TSK_BIT_ARRAY_CHUNK 5U
+#define TSK_BIT_ARRAY_CHUNK 6U
 #define TSK_BIT_ARRAY_NUM_BITS (1U << TSK_BIT_ARRAY_CHUNK)
 
 int tsk_bit_array_init(tsk_bit_array_t *self, tsk_size_t num_bits, tsk_size_t length);
@@ -1047,6 +1147,8 @@ void tsk_bit_array_add_bit(tsk_bit_array_t *self, const tsk_bit_array_value_t bi
 bool tsk_bit_array_contains(
     const tsk_bit_array_t *self, const tsk_bit_array_value_t bit);
 tsk_size_t tsk_bit_array_count(const tsk_bit_array_t *self);
+tsk_size_t tsk_bit_array_intersect_count(
+    const tsk_bit_array_t *self, const tsk_bit_array_t *other);
 
 #ifdef __cplusplus
 }
@@ -574,6 +574,145 @@ out:
     return ret;
 }
 
+int
+tsk_variant_decode_packed(tsk_variant_t *self, tsk_id_t site_id, tsk_flags_t options,
+    tsk_bit_array_t *genotypes, tsk_bit_array_t *missing)
+{
+    int ret = 0;
+    const tsk_size_t num_samples = self->num_samples;
+    const tsk_size_t num_chunks = (num_samples >> TSK_BIT_ARRAY_CHUNK)
+                                  + (num_samples % TSK_BIT_ARRAY_NUM_BITS ? 1 : 0);
+    const int32_t *restrict site_genotypes;
+    tsk_bit_array_value_t genotype_chunk, missing_chunk, bit;
+    tsk_size_t j, k, stop;
+
+    if (genotypes->size < num_chunks
+        || (missing != NULL && missing->size < num_chunks)) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    ret = tsk_variant_decode(self, site_id, options);
+    if (ret != 0) {
+        goto out;
+    }
+    site_genotypes = self->genotypes;
+    for (j = 0; j < num_chunks; j++) {
+        genotype_chunk = 0;
+        missing_chunk = 0;
+        stop = TSK_MIN(num_samples, (j + 1) * TSK_BIT_ARRAY_NUM_BITS);
+        for (k = j * TSK_BIT_ARRAY_NUM_BITS; k < stop; k++) {
+            bit = (tsk_bit_array_value_t) 1 << (k - j * TSK_BIT_ARRAY_NUM_BITS);
+            switch (site_genotypes[k]) {
+                case 0:
+                    break;
+                case 1:
+                    genotype_chunk |= bit;
+                    break;
+                case TSK_MISSING_DATA:
+                    missing_chunk |= bit;
+                    break;
+                default:
+                    ret = TSK_ERR_NOT_BIALLELIC;
+                    goto out;
+            }
+        }
+        genotypes->data[j] = genotype_chunk;
+        if (missing != NULL) {
+            missing->data[j] = missing_chunk;
+        }
+    }
+    for (j = num_chunks; j < genotypes->size; j++) {
+        genotypes->data[j] = 0;
+    }
+    if (missing != NULL) {
+        for (j = num_chunks; j < missing->size; j++) {
+            missing->data[j] = 0;
+        }
+    }
+out:
+    return ret;
+}
+
+/* Decodes the specified range of sites into either a 32 or 8 bit matrix;
+ * exactly one of genotypes32 and genotypes8 must be non-NULL. */
+static int
+tsk_variant_decode_matrix_generic(tsk_variant_t *self, tsk_id_t start, tsk_id_t stop,
+    tsk_size_t stride, tsk_flags_t options, int32_t *genotypes32, int8_t *genotypes8)
+{
+    int ret = 0;
+    bool sample_major = !!(options & TSK_GENOTYPES_SAMPLE_MAJOR);
+    tsk_size_t num_samples = self->num_samples;
+    tsk_size_t num_sites, row_length, row_stride, col_stride, offset, k;
+    const int32_t *restrict site_genotypes;
+    tsk_id_t site_id;
+
+    if (self->tree_sequence == NULL) {
+        ret = TSK_ERR_VARIANT_CANT_DECODE_COPY;
+        goto out;
+    }
+    if (start < 0 || start > stop
+        || stop > (tsk_id_t) tsk_treeseq_get_num_sites(self->tree_sequence)) {
+        ret = TSK_ERR_SITE_OUT_OF_BOUNDS;
+        goto out;
+    }
+    num_sites = (tsk_size_t)(stop - start);
+    row_length = sample_major ? num_sites : num_samples;
+    if (stride == 0) {
+        stride = row_length;
+    }
+    if (stride < row_length) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    /* The offset in the output of genotype k at site j is j * row_stride
+     * + k * col_stride */
+    row_stride = sample_major ? 1 : stride;
+    col_stride = sample_major ? stride : 1;
+
+    for (site_id = start; site_id < stop; site_id++) {
+        ret = tsk_variant_decode(self, site_id, 0);
+        if (ret != 0) {
+            goto out;
+        }
+        site_genotypes = self->genotypes;
+        offset = (tsk_size_t)(site_id - start) * row_stride;
+        if (genotypes8 != NULL) {
+            if (self->num_alleles > INT8_MAX + 1) {
+                ret = TSK_ERR_TOO_MANY_ALLELES;
+                goto out;
+            }
+            for (k = 0; k < num_samples; k++) {
+                genotypes8[offset + k * col_stride] = (int8_t) site_genotypes[k];
+            }
+        } else if (col_stride == 1) {
+            tsk_memcpy(genotypes32 + offset, site_genotypes,
+                num_samples * sizeof(*genotypes32));
+        } else {
+            for (k = 0; k < num_samples; k++) {
+                genotypes32[offset + k * col_stride] = site_genotypes[k];
+            }
+        }
+    }
+out:
+    return ret;
+}
+
+int
+tsk_variant_decode_matrix(tsk_variant_t *self, tsk_id_t start, tsk_id_t stop,
+    tsk_size_t stride, tsk_flags_t options, int32_t *genotypes)
+{
+    return tsk_variant_decode_matrix_generic(
+        self, start, stop, stride, options, genotypes, NULL);
+}
+
+int
+tsk_variant_decode_matrix_int8(tsk_variant_t *self, tsk_id_t start, tsk_id_t stop,
+    tsk_size_t stride, tsk_flags_t options, int8_t *genotypes)
+{
+    return tsk_variant_decode_matrix_generic(
+        self, start, stop, stride, options, NULL, genotypes);
+}
+
 int
 tsk_variant_restricted_copy(const tsk_variant_t *self, tsk_variant_t *other)
 {
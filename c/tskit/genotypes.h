@@ -34,6 +34,9 @@ extern "C" {
 
 #define TSK_ISOLATED_NOT_MISSING (1 << 1)
 
+/* Options for tsk_variant_decode_matrix */
+#define TSK_GENOTYPES_SAMPLE_MAJOR (1 << 0)
+
 /**
 @brief A variant at a specific site.
 
@@ -156,6 +159,101 @@ this variant.
 */
 int tsk_variant_decode(tsk_variant_t *self, tsk_id_t site_id, tsk_flags_t options);
 
+/**
+@brief Decode the genotypes for a contiguous range of sites into a matrix.
+
+@rst
+Decodes the genotypes for this variant's samples at each of the sites
+``start``, ``start + 1``, ..., ``stop - 1`` in turn, as if by calling
+:c:func:`tsk_variant_decode`, and copies them into the specified
+caller-provided matrix. By default the matrix is site-major, so that the
+genotype for the ``k`` th sample at site ``start + j`` is stored at
+``genotypes[j * stride + k]``. If the ``TSK_GENOTYPES_SAMPLE_MAJOR`` option is
+specified the matrix is sample-major instead, and this genotype is stored at
+``genotypes[k * stride + j]``. If ``stride`` is 0, the rows are assumed to be
+contiguous, i.e., ``stride`` is taken to be the number of samples for a
+site-major matrix and ``stop - start`` for a sample-major matrix.
+
+Missing data is encoded as ``TSK_MISSING_DATA`` (-1). Genotypes are
+indexes into the alleles of the variant *at the corresponding site*; if
+alleles are not specified when the variant is initialised, the allele
+ordering may differ between sites and only the alleles for the last
+decoded site are available in the variant when this function returns.
+
+The tree sequence is not modified during decoding, so a site range can be
+split into disjoint chunks that are decoded concurrently, using a separate
+tsk_variant_t for each thread and passing each the appropriate offset into
+a shared output matrix along with the full ``stride``.
+@endrst
+
+@param self A pointer to an initialised tsk_variant_t object.
+@param start The first site to decode.
+@param stop The site after the last site to decode.
+@param stride The number of elements between the starts of consecutive rows
+    in the output matrix, or 0 if the rows are contiguous.
+@param options Bitwise option flags. Either ``0`` or
+    ``TSK_GENOTYPES_SAMPLE_MAJOR``.
+@param genotypes The output matrix, which must be large enough to hold
+    the genotypes for the specified range of sites with the specified stride.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_variant_decode_matrix(tsk_variant_t *self, tsk_id_t start, tsk_id_t stop,
+    tsk_size_t stride, tsk_flags_t options, int32_t *genotypes);
+
+/**
+@brief Decode the genotypes for a contiguous range of sites into an 8 bit matrix.
+
+@rst
+As :c:func:`tsk_variant_decode_matrix`, but the genotypes are stored as
+8 bit integers, so the allele indexes must be at most 127. If a site has more
+than 128 alleles :c:macro:`TSK_ERR_TOO_MANY_ALLELES` is returned.
+@endrst
+
+@param self A pointer to an initialised tsk_variant_t object.
+@param start The first site to decode.
+@param stop The site after the last site to decode.
+@param stride The number of elements between the starts of consecutive rows
+    in the output matrix, or 0 if the rows are contiguous.
+@param options Bitwise option flags. Either ``0`` or
+    ``TSK_GENOTYPES_SAMPLE_MAJOR``.
+@param genotypes The output matrix, which must be large enough to hold
+    the genotypes for the specified range of sites with the specified stride.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_variant_decode_matrix_int8(tsk_variant_t *self, tsk_id_t start,
+    tsk_id_t stop, tsk_size_t stride, tsk_flags_t options, int8_t *genotypes);
+
+/**
+@brief Decode the genotypes at the given site into a packed bit array.
+
+@rst
+Decodes the genotypes at the specified site as :c:func:`tsk_variant_decode`
+does, and then packs them into ``genotypes`` using one bit per sample, in the
+layout used by ``tsk_bit_array_t``: the bit for the ``k`` th sample of the
+variant is set if and only if its genotype is 1. If ``missing`` is not NULL,
+the bit for the ``k`` th sample is set in it if and only if the genotype of
+this sample is missing (missing samples are never set in ``genotypes``).
+The genotypes are also left in the ``genotypes`` member of the variant as
+usual.
+
+Both bit arrays must have room for at least ``num_samples`` bits, e.g.,
+a row of a bit array that was initialised using
+``tsk_bit_array_init(&bits, var.num_samples, num_rows)``. All bits in the
+output bit arrays are overwritten. If any sample has a genotype other
+than 0, 1 or missing then ``TSK_ERR_NOT_BIALLELIC`` is returned.
+@endrst
+
+@param self A pointer to an initialised tsk_variant_t object.
+@param site_id A valid site id for the tree sequence of this variant.
+@param options Bitwise option flags, as for :c:func:`tsk_variant_decode`.
+@param genotypes The bit array in which to store the genotypes.
+@param missing Optional. Either NULL or a bit array in which to store
+    the missing data mask.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_variant_decode_packed(tsk_variant_t *self, tsk_id_t site_id,
+    tsk_flags_t options, tsk_bit_array_t *genotypes, tsk_bit_array_t *missing);
+
 /**
 @brief Free the internal memory for the specified variant.
 
@@ -76,7 +76,7 @@ tsk_ls_hmm_check_state(tsk_ls_hmm_t *self)
             if (T_index[j] != TSK_NULL) {
                 tsk_bug_assert(T[T_index[j]].tree_node == j);
             }
-            tsk_bug_assert(self->tree.parent[j] == self->parent[j]);
+            tsk_bug_assert(self->current_tree->parent[j] == self->parent[j]);
         }
     }
 }
@@ -86,7 +86,7 @@ tsk_ls_hmm_print_state(tsk_ls_hmm_t *self, FILE *out)
 {
     tsk_size_t j, l;
 
-    fprintf(out, "tree_sequence   = %p\n", (void *) self->tree_sequence);
+    fprintf(out, "tree_sequence   = %p\n", (const void *) self->tree_sequence);
     fprintf(out, "num_sites       = %lld\n", (long long) self->num_sites);
     fprintf(out, "num_samples     = %lld\n", (long long) self->num_samples);
     fprintf(out, "num_values      = %lld\n", (long long) self->num_values);
@@ -119,8 +119,8 @@ tsk_ls_hmm_print_state(tsk_ls_hmm_t *self, FILE *out)
 }
 
 int TSK_WARN_UNUSED
-tsk_ls_hmm_init(tsk_ls_hmm_t *self, tsk_treeseq_t *tree_sequence,
-    double *recombination_rate, double *mutation_rate, tsk_flags_t options)
+tsk_ls_hmm_init(tsk_ls_hmm_t *self, const tsk_treeseq_t *tree_sequence,
+    const double *recombination_rate, const double *mutation_rate, tsk_flags_t options)
 {
     int ret = TSK_ERR_GENERIC;
     tsk_size_t l;
@@ -187,6 +187,7 @@ tsk_ls_hmm_init(tsk_ls_hmm_t *self, tsk_treeseq_t *tree_sequence,
     if (ret != 0) {
         goto out;
     }
+    self->current_tree = &self->tree;
     self->num_values = 0;
     self->max_values = 0;
     /* Keep this as a struct variable so that we can test overflow, but this
@@ -264,8 +265,8 @@ tsk_ls_hmm_remove_dead_roots(tsk_ls_hmm_t *self)
 {
     tsk_id_t *restrict T_index = self->transition_index;
     tsk_value_transition_t *restrict T = self->transitions;
-    const tsk_id_t *restrict right_sib = self->tree.right_sib;
-    const tsk_id_t left_root = tsk_tree_get_left_root(&self->tree);
+    const tsk_id_t *restrict right_sib = self->current_tree->right_sib;
+    const tsk_id_t left_root = tsk_tree_get_left_root(self->current_tree);
     const tsk_id_t *restrict parent = self->parent;
     tsk_id_t root, u;
     tsk_size_t j;
@@ -304,7 +305,7 @@ tsk_ls_hmm_update_tree(tsk_ls_hmm_t *self, int direction)
     tsk_value_transition_t *vt;
     tsk_tree_position_t tree_pos;
 
-    tree_pos = self->tree.tree_pos;
+    tree_pos = self->current_tree->tree_pos;
     for (j = tree_pos.out.start; j != tree_pos.out.stop; j += direction) {
         e = tree_pos.out.order[j];
         c = edges_child[e];
@@ -388,7 +389,7 @@ tsk_ls_hmm_update_probabilities(
 {
     int ret = 0;
     tsk_id_t root;
-    tsk_tree_t *tree = &self->tree;
+    const tsk_tree_t *tree = self->current_tree;
     tsk_id_t *restrict parent = self->parent;
     tsk_id_t *restrict T_index = self->transition_index;
     tsk_value_transition_t *restrict T = self->transitions;
@@ -733,8 +734,8 @@ tsk_ls_hmm_build_optimal_value_sets(tsk_ls_hmm_t *self)
 {
     int ret = 0;
     const double *restrict node_time = self->tree_sequence->tables->nodes.time;
-    const tsk_id_t *restrict left_child = self->tree.left_child;
-    const tsk_id_t *restrict right_sib = self->tree.right_sib;
+    const tsk_id_t *restrict left_child = self->current_tree->left_child;
+    const tsk_id_t *restrict right_sib = self->current_tree->right_sib;
     const tsk_id_t *restrict parent = self->parent;
     const tsk_value_transition_t *restrict T = self->transitions;
     const tsk_id_t *restrict T_index = self->transition_index;
@@ -790,8 +791,8 @@ static int
 tsk_ls_hmm_redistribute_transitions(tsk_ls_hmm_t *self)
 {
     int ret = 0;
-    const tsk_id_t *restrict left_child = self->tree.left_child;
-    const tsk_id_t *restrict right_sib = self->tree.right_sib;
+    const tsk_id_t *restrict left_child = self->current_tree->left_child;
+    const tsk_id_t *restrict right_sib = self->current_tree->right_sib;
     const tsk_id_t *restrict parent = self->parent;
     tsk_id_t *restrict T_index = self->transition_index;
     tsk_id_t *restrict T_parent = self->transition_parent;
@@ -812,7 +813,7 @@ tsk_ls_hmm_redistribute_transitions(tsk_ls_hmm_t *self)
     /* TODO refactor this to push the virtual root onto the stack rather then
      * iterating over the roots. See the existing parsimony implementations
      * for an example. */
-    for (root = tsk_tree_get_left_root(&self->tree); root != TSK_NULL;
+    for (root = tsk_tree_get_left_root(self->current_tree); root != TSK_NULL;
          root = right_sib[root]) {
         stack[0].tree_node = root;
         stack[0].old_state = T_old[T_index[root]].value_index;
@@ -949,45 +950,82 @@ out:
     return ret;
 }
 
+/* Run the forward pass for a batch of HMMs, all of which share the tree
+ * of the first. A single haplotype is a batch of size one. */
 static int
-tsk_ls_hmm_run_forward(tsk_ls_hmm_t *self, int32_t *haplotype)
+tsk_ls_hmm_run_forward(
+    tsk_ls_hmm_t *self, tsk_size_t num_haplotypes, int32_t *haplotypes)
 {
     int ret = 0;
     int t_ret;
     const tsk_site_t *sites;
-    tsk_size_t j, num_sites;
-    const double n = (double) self->num_samples;
-
-    ret = tsk_ls_hmm_reset(self, 1 / n);
-    if (ret != 0) {
-        goto out;
-    }
-
-    for (t_ret = tsk_tree_first(&self->tree); t_ret == TSK_TREE_OK;
-         t_ret = tsk_tree_next(&self->tree)) {
-        ret = tsk_ls_hmm_update_tree(self, TSK_DIR_FORWARD);
+    tsk_size_t j, k, num_sites;
+    tsk_tree_t *tree = &self[0].tree;
+    const tsk_size_t L = self[0].num_sites;
+    const double n = (double) self[0].num_samples;
+
+    for (k = 0; k < num_haplotypes; k++) {
+        self[k].current_tree = tree;
+        ret = tsk_ls_hmm_reset(&self[k], 1 / n);
         if (ret != 0) {
             goto out;
         }
+    }
+
+    for (t_ret = tsk_tree_first(tree); t_ret == TSK_TREE_OK;
+         t_ret = tsk_tree_next(tree)) {
+        for (k = 0; k < num_haplotypes; k++) {
+            ret = tsk_ls_hmm_update_tree(&self[k], TSK_DIR_FORWARD);
+            if (ret != 0) {
+                goto out;
+            }
+        }
         /* tsk_ls_hmm_check_state(self); */
-        ret = tsk_tree_get_sites(&self->tree, &sites, &num_sites);
+        ret = tsk_tree_get_sites(tree, &sites, &num_sites);
         if (ret != 0) {
             goto out;
         }
         for (j = 0; j < num_sites; j++) {
-            ret = tsk_ls_hmm_process_site_forward(
-                self, &sites[j], haplotype[sites[j].id]);
-            if (ret != 0) {
-                goto out;
+            for (k = 0; k < num_haplotypes; k++) {
+                ret = tsk_ls_hmm_process_site_forward(
+                    &self[k], &sites[j], haplotypes[k * L + (tsk_size_t) sites[j].id]);
+                if (ret != 0) {
+                    goto out;
+                }
             }
         }
     }
-    /* Set to zero so we can print and check the state OK. */
-    self->num_transitions = 0;
     if (t_ret != 0) {
         ret = t_ret;
         goto out;
     }
+out:
+    for (k = 0; k < num_haplotypes; k++) {
+        /* Set to zero so we can print and check the state OK. */
+        self[k].num_transitions = 0;
+        self[k].current_tree = &self[k].tree;
+    }
+    return ret;
+}
+
+/* Check that all the HMMs in a batch are for the same tree sequence, and
+ * set the algorithm methods */
+static int
+tsk_ls_hmm_batch_setup(tsk_ls_hmm_t *self, tsk_size_t num_haplotypes,
+    int (*next_probability)(tsk_ls_hmm_t *, tsk_id_t, double, bool, tsk_id_t, double *),
+    double (*compute_normalisation_factor)(tsk_ls_hmm_t *))
+{
+    int ret = 0;
+    tsk_size_t k;
+
+    for (k = 0; k < num_haplotypes; k++) {
+        if (self[k].tree_sequence != self[0].tree_sequence) {
+            ret = TSK_ERR_BAD_PARAM_VALUE;
+            goto out;
+        }
+        self[k].next_probability = next_probability;
+        self[k].compute_normalisation_factor = compute_normalisation_factor;
+    }
 out:
     return ret;
 }
@@ -1002,7 +1040,7 @@ tsk_ls_hmm_compute_normalisation_factor_forward(tsk_ls_hmm_t *self)
     tsk_size_t *restrict N = self->num_transition_samples;
     tsk_value_transition_t *restrict T = self->transitions;
     const tsk_id_t *restrict T_parent = self->transition_parent;
-    const tsk_size_t *restrict num_samples = self->tree.num_samples;
+    const tsk_size_t *restrict num_samples = self->current_tree->num_samples;
     const tsk_id_t num_transitions = (tsk_id_t) self->num_transitions;
     double normalisation_factor;
     tsk_id_t j;
@@ -1045,9 +1083,9 @@ tsk_ls_hmm_next_probability_forward(tsk_ls_hmm_t *self, tsk_id_t site_id, double
     return 0;
 }
 
-int
-tsk_ls_hmm_forward(tsk_ls_hmm_t *self, int32_t *haplotype,
-    tsk_compressed_matrix_t *output, tsk_flags_t options)
+static int
+tsk_ls_hmm_setup_forward_output(
+    tsk_ls_hmm_t *self, tsk_compressed_matrix_t *output, tsk_flags_t options)
 {
     int ret = 0;
 
@@ -1066,12 +1104,41 @@ tsk_ls_hmm_forward(tsk_ls_hmm_t *self, int32_t *haplotype,
             goto out;
         }
     }
-
-    self->next_probability = tsk_ls_hmm_next_probability_forward;
-    self->compute_normalisation_factor = tsk_ls_hmm_compute_normalisation_factor_forward;
     self->output = output;
+out:
+    return ret;
+}
+
+int
+tsk_ls_hmm_forward(tsk_ls_hmm_t *self, int32_t *haplotype,
+    tsk_compressed_matrix_t *output, tsk_flags_t options)
+{
+    return tsk_ls_hmm_forward_batch(self, 1, haplotype, output, options);
+}
 
-    ret = tsk_ls_hmm_run_forward(self, haplotype);
+int
+tsk_ls_hmm_forward_batch(tsk_ls_hmm_t *self, tsk_size_t num_haplotypes,
+    int32_t *haplotypes, tsk_compressed_matrix_t *output, tsk_flags_t options)
+{
+    int ret = 0;
+    tsk_size_t k;
+
+    if (num_haplotypes == 0) {
+        goto out;
+    }
+    ret = tsk_ls_hmm_batch_setup(self, num_haplotypes,
+        tsk_ls_hmm_next_probability_forward,
+        tsk_ls_hmm_compute_normalisation_factor_forward);
+    if (ret != 0) {
+        goto out;
+    }
+    for (k = 0; k < num_haplotypes; k++) {
+        ret = tsk_ls_hmm_setup_forward_output(&self[k], &output[k], options);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = tsk_ls_hmm_run_forward(self, num_haplotypes, haplotypes);
 out:
     return ret;
 }
@@ -1286,9 +1353,9 @@ tsk_ls_hmm_next_probability_viterbi(tsk_ls_hmm_t *self, tsk_id_t site, double p_
         self->output, site, node, recombination_required);
 }
 
-int
-tsk_ls_hmm_viterbi(tsk_ls_hmm_t *self, int32_t *haplotype, tsk_viterbi_matrix_t *output,
-    tsk_flags_t options)
+static int
+tsk_ls_hmm_setup_viterbi_output(
+    tsk_ls_hmm_t *self, tsk_viterbi_matrix_t *output, tsk_flags_t options)
 {
     int ret = 0;
 
@@ -1307,12 +1374,41 @@ tsk_ls_hmm_viterbi(tsk_ls_hmm_t *self, int32_t *haplotype, tsk_viterbi_matrix_t
             goto out;
         }
     }
-
-    self->next_probability = tsk_ls_hmm_next_probability_viterbi;
-    self->compute_normalisation_factor = tsk_ls_hmm_compute_normalisation_factor_viterbi;
     self->output = output;
+out:
+    return ret;
+}
+
+int
+tsk_ls_hmm_viterbi(tsk_ls_hmm_t *self, int32_t *haplotype, tsk_viterbi_matrix_t *output,
+    tsk_flags_t options)
+{
+    return tsk_ls_hmm_viterbi_batch(self, 1, haplotype, output, options);
+}
+
+int
+tsk_ls_hmm_viterbi_batch(tsk_ls_hmm_t *self, tsk_size_t num_haplotypes,
+    int32_t *haplotypes, tsk_viterbi_matrix_t *output, tsk_flags_t options)
+{
+    int ret = 0;
+    tsk_size_t k;
 
-    ret = tsk_ls_hmm_run_forward(self, haplotype);
+    if (num_haplotypes == 0) {
+        goto out;
+    }
+    ret = tsk_ls_hmm_batch_setup(self, num_haplotypes,
+        tsk_ls_hmm_next_probability_viterbi,
+        tsk_ls_hmm_compute_normalisation_factor_viterbi);
+    if (ret != 0) {
+        goto out;
+    }
+    for (k = 0; k < num_haplotypes; k++) {
+        ret = tsk_ls_hmm_setup_viterbi_output(&self[k], &output[k], options);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = tsk_ls_hmm_run_forward(self, num_haplotypes, haplotypes);
 out:
     return ret;
 }
@@ -1322,8 +1418,8 @@ out:
  ****************************************************************/
 
 int
-tsk_compressed_matrix_init(tsk_compressed_matrix_t *self, tsk_treeseq_t *tree_sequence,
-    tsk_size_t block_size, tsk_flags_t options)
+tsk_compressed_matrix_init(tsk_compressed_matrix_t *self,
+    const tsk_treeseq_t *tree_sequence, tsk_size_t block_size, tsk_flags_t options)
 {
     int ret = 0;
 
@@ -1380,7 +1476,7 @@ tsk_compressed_matrix_print_state(tsk_compressed_matrix_t *self, FILE *out)
 {
     tsk_size_t l, j;
 
-    fprintf(out, "Compressed matrix for %p\n", (void *) self->tree_sequence);
+    fprintf(out, "Compressed matrix for %p\n", (const void *) self->tree_sequence);
     fprintf(out, "num_sites = %lld\n", (long long) self->num_sites);
     fprintf(out, "num_samples = %lld\n", (long long) self->num_samples);
     for (l = 0; l < self->num_sites; l++) {
@@ -1539,8 +1635,8 @@ out:
 }
 
 int
-tsk_viterbi_matrix_init(tsk_viterbi_matrix_t *self, tsk_treeseq_t *tree_sequence,
-    tsk_size_t block_size, tsk_flags_t options)
+tsk_viterbi_matrix_init(tsk_viterbi_matrix_t *self,
+    const tsk_treeseq_t *tree_sequence, tsk_size_t block_size, tsk_flags_t options)
 {
     int ret = 0;
 
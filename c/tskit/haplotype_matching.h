@@ -61,7 +61,7 @@ typedef struct {
 } tsk_site_probability_t;
 
 typedef struct {
-    tsk_treeseq_t *tree_sequence;
+    const tsk_treeseq_t *tree_sequence;
     tsk_flags_t options;
     tsk_size_t num_sites;
     tsk_size_t num_samples;
@@ -87,7 +87,7 @@ typedef struct {
 
 typedef struct _tsk_ls_hmm_t {
     /* input */
-    tsk_treeseq_t *tree_sequence;
+    const tsk_treeseq_t *tree_sequence;
     double *recombination_rate;
     double *mutation_rate;
     const char ***alleles;
@@ -98,6 +98,10 @@ typedef struct _tsk_ls_hmm_t {
     tsk_size_t num_nodes;
     /* state */
     tsk_tree_t tree;
+    /* The tree that the state is synchronised with. This is the tree above,
+     * except when running a batch of haplotypes, where all the HMMs in the
+     * batch share the tree of the first. */
+    tsk_tree_t *current_tree;
     tsk_id_t *parent;
     /* The probability value transitions on the tree */
     tsk_value_transition_t *transitions;
@@ -130,9 +134,8 @@ typedef struct _tsk_ls_hmm_t {
     void *output;
 } tsk_ls_hmm_t;
 
-/* TODO constify these APIs */
-int tsk_ls_hmm_init(tsk_ls_hmm_t *self, tsk_treeseq_t *tree_sequence,
-    double *recombination_rate, double *mutation_rate, tsk_flags_t options);
+int tsk_ls_hmm_init(tsk_ls_hmm_t *self, const tsk_treeseq_t *tree_sequence,
+    const double *recombination_rate, const double *mutation_rate, tsk_flags_t options);
 int tsk_ls_hmm_set_precision(tsk_ls_hmm_t *self, unsigned int precision);
 int tsk_ls_hmm_free(tsk_ls_hmm_t *self);
 void tsk_ls_hmm_print_state(tsk_ls_hmm_t *self, FILE *out);
@@ -143,8 +146,21 @@ int tsk_ls_hmm_backward(tsk_ls_hmm_t *self, int32_t *haplotype,
 int tsk_ls_hmm_viterbi(tsk_ls_hmm_t *self, int32_t *haplotype,
     tsk_viterbi_matrix_t *output, tsk_flags_t options);
 
+/* Batch versions of the forward and viterbi algorithms, which match a set of
+ * haplotypes in a single pass along the sequence. The self argument is an
+ * array of num_haplotypes HMMs, each initialised for the same tree sequence,
+ * and output is an array of num_haplotypes matrices. The haplotypes array
+ * stores the haplotypes one after the other, each of length num_sites. The
+ * trees are iterated over once, using the tree of the first HMM, and the
+ * state of each HMM is updated in turn for each tree and site.
+ */
+int tsk_ls_hmm_forward_batch(tsk_ls_hmm_t *self, tsk_size_t num_haplotypes,
+    int32_t *haplotypes, tsk_compressed_matrix_t *output, tsk_flags_t options);
+int tsk_ls_hmm_viterbi_batch(tsk_ls_hmm_t *self, tsk_size_t num_haplotypes,
+    int32_t *haplotypes, tsk_viterbi_matrix_t *output, tsk_flags_t options);
+
 int tsk_compressed_matrix_init(tsk_compressed_matrix_t *self,
-    tsk_treeseq_t *tree_sequence, tsk_size_t block_size, tsk_flags_t options);
+    const tsk_treeseq_t *tree_sequence, tsk_size_t block_size, tsk_flags_t options);
 int tsk_compressed_matrix_free(tsk_compressed_matrix_t *self);
 int tsk_compressed_matrix_clear(tsk_compressed_matrix_t *self);
 void tsk_compressed_matrix_print_state(tsk_compressed_matrix_t *self, FILE *out);
@@ -153,8 +169,8 @@ int tsk_compressed_matrix_store_site(tsk_compressed_matrix_t *self, tsk_id_t sit
     const tsk_value_transition_t *transitions);
 int tsk_compressed_matrix_decode(tsk_compressed_matrix_t *self, double *values);
 
-int tsk_viterbi_matrix_init(tsk_viterbi_matrix_t *self, tsk_treeseq_t *tree_sequence,
-    tsk_size_t block_size, tsk_flags_t options);
+int tsk_viterbi_matrix_init(tsk_viterbi_matrix_t *self,
+    const tsk_treeseq_t *tree_sequence, tsk_size_t block_size, tsk_flags_t options);
 int tsk_viterbi_matrix_free(tsk_viterbi_matrix_t *self);
 int tsk_viterbi_matrix_clear(tsk_viterbi_matrix_t *self);
 void tsk_viterbi_matrix_print_state(tsk_viterbi_matrix_t *self, FILE *out);
@@ -303,3 +303,151 @@ tsk_ld_calc_get_r2_array(tsk_ld_calc_t *self, tsk_id_t a, int direction,
 out:
     return ret;
 }
+
+/* State for the banded scan. Each site in the current window has its samples
+ * stored in a row of a ring buffer of bit arrays, so that moving the focal
+ * site forward only requires the samples for the newly added sites. */
+typedef struct {
+    tsk_tree_t tree;
+    tsk_bit_array_t samples;
+    tsk_size_t *num_samples;
+    tsk_size_t ring_size;
+    tsk_id_t next_site;
+} tsk_ld_band_t;
+
+static int
+tsk_ld_calc_load_band_site(tsk_ld_calc_t *self, tsk_ld_band_t *band)
+{
+    int ret = 0;
+    const tsk_id_t *restrict sample_index_map = self->tree_sequence->sample_index_map;
+    const tsk_id_t *restrict next_sample = band->tree.next_sample;
+    tsk_id_t site_id = band->next_site;
+    tsk_size_t row_index = (tsk_size_t) site_id % band->ring_size;
+    tsk_bit_array_t row;
+    tsk_site_t site;
+    tsk_id_t u, sample, stop;
+
+    ret = tsk_treeseq_get_site(self->tree_sequence, site_id, &site);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_ld_calc_check_site(self, &site);
+    if (ret != 0) {
+        goto out;
+    }
+    while (band->tree.interval.right <= site.position) {
+        ret = tsk_tree_next(&band->tree);
+        if (ret < 0) {
+            goto out;
+        }
+    }
+    tsk_bit_array_get_row(&band->samples, row_index, &row);
+    tsk_memset(row.data, 0, row.size * sizeof(*row.data));
+    u = site.mutations[0].node;
+    sample = band->tree.left_sample[u];
+    if (sample != TSK_NULL) {
+        stop = band->tree.right_sample[u];
+        while (true) {
+            tsk_bit_array_add_bit(
+                &row, (tsk_bit_array_value_t) sample_index_map[sample]);
+            if (sample == stop) {
+                break;
+            }
+            sample = next_sample[sample];
+        }
+    }
+    band->num_samples[row_index] = band->tree.num_samples[u];
+    band->next_site++;
+    ret = 0;
+out:
+    return ret;
+}
+
+int
+tsk_ld_calc_get_r2_band(tsk_ld_calc_t *self, tsk_id_t start, tsk_id_t stop,
+    tsk_size_t max_sites, double max_distance, double *r2, tsk_size_t *num_r2_values)
+{
+    int ret = 0;
+    const tsk_id_t num_sites = (tsk_id_t) tsk_treeseq_get_num_sites(self->tree_sequence);
+    const double *restrict position = self->tree_sequence->tables->sites.position;
+    const double n = (double) self->total_samples;
+    tsk_ld_band_t band;
+    tsk_bit_array_t row_a, row_b;
+    tsk_size_t row_a_index, row_b_index, k, num_values;
+    double f_a, f_b, f_ab, D, denom;
+    double *r2_row;
+    tsk_id_t a, b;
+
+    tsk_memset(&band, 0, sizeof(band));
+    ret = tsk_tree_init(&band.tree, self->tree_sequence, TSK_SAMPLE_LISTS);
+    if (ret != 0) {
+        goto out;
+    }
+    if (start < 0 || stop > num_sites || start > stop) {
+        ret = TSK_ERR_SITE_OUT_OF_BOUNDS;
+        goto out;
+    }
+    if (start == stop) {
+        goto out;
+    }
+    /* We never need more than the sites in [start, num_sites) at once */
+    band.ring_size = TSK_MIN(max_sites, (tsk_size_t)(num_sites - start)) + 1;
+    ret = tsk_bit_array_init(&band.samples, self->total_samples, band.ring_size);
+    if (ret != 0) {
+        goto out;
+    }
+    band.num_samples = tsk_malloc(band.ring_size * sizeof(*band.num_samples));
+    if (band.num_samples == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    ret = tsk_tree_seek(&band.tree, position[start], 0);
+    if (ret != 0) {
+        goto out;
+    }
+    band.next_site = start;
+
+    for (a = start; a < stop; a++) {
+        if (band.next_site == a) {
+            ret = tsk_ld_calc_load_band_site(self, &band);
+            if (ret != 0) {
+                goto out;
+            }
+        }
+        row_a_index = (tsk_size_t) a % band.ring_size;
+        tsk_bit_array_get_row(&band.samples, row_a_index, &row_a);
+        f_a = ((double) band.num_samples[row_a_index]) / n;
+        r2_row = r2 + (tsk_size_t)(a - start) * max_sites;
+        num_values = 0;
+        for (k = 0; k < max_sites; k++) {
+            b = a + 1 + (tsk_id_t) k;
+            if (b >= num_sites || fabs(position[a] - position[b]) > max_distance) {
+                break;
+            }
+            if (band.next_site == b) {
+                ret = tsk_ld_calc_load_band_site(self, &band);
+                if (ret != 0) {
+                    goto out;
+                }
+            }
+            row_b_index = (tsk_size_t) b % band.ring_size;
+            tsk_bit_array_get_row(&band.samples, row_b_index, &row_b);
+            /* As in tsk_ld_calc_compute_r2 */
+            f_b = ((double) band.num_samples[row_b_index]) / n;
+            f_ab = ((double) tsk_bit_array_intersect_count(&row_a, &row_b)) / n;
+            D = f_ab - f_a * f_b;
+            denom = f_a * f_b * (1 - f_a) * (1 - f_b);
+            r2_row[k] = (D * D) / denom;
+            num_values++;
+        }
+        for (k = num_values; k < max_sites; k++) {
+            r2_row[k] = NAN;
+        }
+        num_r2_values[a - start] = num_values;
+    }
+out:
+    tsk_tree_free(&band.tree);
+    tsk_bit_array_free(&band.samples);
+    tsk_safe_free(band.num_samples);
+    return ret;
+}
@@ -52,6 +52,19 @@ int tsk_ld_calc_get_r2(tsk_ld_calc_t *self, tsk_id_t a, tsk_id_t b, double *r2);
 int tsk_ld_calc_get_r2_array(tsk_ld_calc_t *self, tsk_id_t a, int direction,
     tsk_size_t max_sites, double max_distance, double *r2, tsk_size_t *num_r2_values);
 
+/* Computes r2 between each focal site a in [start, stop) and the following
+ * sites, for up to max_sites sites within max_distance of a. The results are
+ * returned as a banded matrix: row a - start of r2 (which has max_sites
+ * columns) holds r2 for sites a + 1, a + 2, ..., and num_r2_values[a - start]
+ * is the number of values in the row. Unused entries are set to NaN. The
+ * samples below the mutation at each site are computed once as the focal site
+ * moves forward, rather than once per focal site. This uses memory
+ * proportional to max_sites x the number of samples. Disjoint ranges of
+ * focal sites can be computed concurrently using separate tsk_ld_calc_t
+ * objects. */
+int tsk_ld_calc_get_r2_band(tsk_ld_calc_t *self, tsk_id_t start, tsk_id_t stop,
+    tsk_size_t max_sites, double max_distance, double *r2, tsk_size_t *num_r2_values);
+
 #ifdef __cplusplus
 }
 #endif
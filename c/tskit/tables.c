@@ -23,6 +23,11 @@
  * SOFTWARE.
  */
 
+#if !defined(_WIN32)
+/* Needed for fileno, fstat, mmap and sysconf, used by TSK_LOAD_MMAP */
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include <assert.h>
 #include <stdio.h>
 #include <stddef.h>
@@ -32,11 +37,25 @@
 #include <float.h>
 #include <math.h>
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <tskit/tables.h>
 
 #define TABLE_SEP "-----------------------------------------\n"
 
 #define TSK_COL_OPTIONAL (1 << 0)
+/* Columns and properties that are not read with TSK_LOAD_SKIP_METADATA */
+#define TSK_COL_METADATA (1 << 1)
+
+/* Load options under which only part of the store is read */
+#define TSK_LOAD_PARTIAL_MASK                                                           \
+    (TSK_LOAD_SKIP_TABLES | TSK_LOAD_SKIP_REFERENCE_SEQUENCE | TSK_LOAD_SKIP_METADATA   \
+        | TSK_LOAD_SKIP_PROVENANCES | TSK_LOAD_SKIP_MIGRATIONS | TSK_LOAD_SKIP_SITES    \
+        | TSK_LOAD_SKIP_MUTATIONS)
 
 typedef struct {
     const char *name;
@@ -103,6 +122,278 @@ check_offset_overflow(tsk_size_t current_size, tsk_size_t additional_elements)
 #define TSK_NUM_ROWS_UNSET ((tsk_size_t) -1)
 #define TSK_MAX_COL_NAME_LEN 64
 
+/* Arrays returned by kastore_get are normally owned by the caller. When the
+ * store is backed by a file mapping (TSK_LOAD_MMAP) the store is opened without
+ * KAS_GET_TAKES_OWNERSHIP, and the arrays it returns are still referenced by its
+ * items. These point into the mapping and must not be freed. */
+static void
+free_store_array(const kastore_t *store, void **array)
+{
+    size_t j;
+
+    if (*array != NULL) {
+        for (j = 0; j < store->num_items; j++) {
+            if (store->items[j].array == *array) {
+                *array = NULL;
+                break;
+            }
+        }
+        tsk_safe_free(*array);
+    }
+}
+
+/* Mark the tables whose columns are borrowed from the file mapping, so that
+ * the table-level functions refuse to write to, grow or free them. */
+static void
+tsk_table_collection_set_mapped(tsk_table_collection_t *self, bool mapped)
+{
+    self->individuals.mapped = mapped;
+    self->nodes.mapped = mapped;
+    self->edges.mapped = mapped;
+    self->migrations.mapped = mapped;
+    self->sites.mapped = mapped;
+    self->mutations.mapped = mapped;
+    self->populations.mapped = mapped;
+    self->provenances.mapped = mapped;
+    self->reference_sequence.mapped = mapped;
+}
+
+#if defined(_WIN32)
+
+static int
+check_file_mappable(FILE *TSK_UNUSED(file))
+{
+    return TSK_ERR_UNSUPPORTED_OPERATION;
+}
+
+static int
+tsk_table_collection_map_store(
+    tsk_table_collection_t *TSK_UNUSED(self), kastore_t *TSK_UNUSED(store))
+{
+    return TSK_ERR_UNSUPPORTED_OPERATION;
+}
+
+static bool
+tsk_table_collection_is_mapped(
+    const tsk_table_collection_t *TSK_UNUSED(self), const void *TSK_UNUSED(ptr))
+{
+    return false;
+}
+
+static void
+tsk_table_collection_release_file_map(tsk_table_collection_t *TSK_UNUSED(self))
+{
+}
+
+#else
+
+static int
+check_file_mappable(FILE *file)
+{
+    int ret = 0;
+    struct stat st;
+    int fd = fileno(file);
+
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        ret = TSK_ERR_IO;
+        goto out;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        ret = TSK_ERR_UNSUPPORTED_OPERATION;
+        goto out;
+    }
+out:
+    return ret;
+}
+
+/* Map the part of the file occupied by the specified store (which must have
+ * been opened without KAS_READ_ALL, so that only its descriptors have been read)
+ * and point each of the store's item arrays into the mapping. Subsequent
+ * kastore_get calls then return these borrowed pointers without reading.
+ * Arrays are aligned within the store, but the store itself need not be
+ * aligned within the file (for example, when several stores are written to the
+ * same file). If any array would be misaligned in the mapping, nothing is
+ * mapped and the caller must read the store normally. */
+static int
+tsk_table_collection_map_store(tsk_table_collection_t *self, kastore_t *store)
+{
+    int ret = 0;
+    struct stat st;
+    int fd = fileno(store->file);
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t start, skip, size, j;
+    void *addr;
+    char *base;
+
+    if (self->file_map.addr != NULL) {
+        /* Cannot load over the top of a previously mapped collection */
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    if (fd < 0 || page_size <= 0 || store->file_offset < 0) {
+        ret = TSK_ERR_IO;
+        goto out;
+    }
+    if (fstat(fd, &st) != 0) {
+        ret = TSK_ERR_IO;
+        goto out;
+    }
+    if ((uint64_t) st.st_size
+        < (uint64_t) store->file_offset + (uint64_t) store->file_size) {
+        /* The file is truncated */
+        ret = TSK_ERR_FILE_FORMAT;
+        goto out;
+    }
+    for (j = 0; j < store->num_items; j++) {
+        if (store->items[j].array_len > 0
+            && ((size_t) store->file_offset + store->items[j].array_start)
+                       % KAS_ARRAY_ALIGN
+                   != 0) {
+            goto out;
+        }
+    }
+    start = (size_t) store->file_offset;
+    skip = start % (size_t) page_size;
+    start -= skip;
+    size = skip + store->file_size;
+    addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, (off_t) start);
+    if (addr == MAP_FAILED) {
+        ret = TSK_ERR_IO;
+        goto out;
+    }
+    self->file_map.addr = addr;
+    self->file_map.size = size;
+    base = (char *) addr + skip;
+    for (j = 0; j < store->num_items; j++) {
+        /* Empty arrays may start at the end of the store, so point them at
+         * the start to keep every borrowed pointer inside the mapping */
+        store->items[j].array = base;
+        if (store->items[j].array_len > 0) {
+            store->items[j].array = base + store->items[j].array_start;
+        }
+    }
+    /* Leave the stream positioned after this store, as a full read would,
+     * so that multiple stores can be read sequentially from the file. */
+    if (fseek(store->file, store->file_offset + (long) store->file_size, SEEK_SET)
+        != 0) {
+        ret = TSK_ERR_IO;
+        goto out;
+    }
+out:
+    return ret;
+}
+
+static bool
+tsk_table_collection_is_mapped(const tsk_table_collection_t *self, const void *ptr)
+{
+    const char *start = (const char *) self->file_map.addr;
+    const char *p = (const char *) ptr;
+
+    return p >= start && p < start + self->file_map.size;
+}
+
+/* Detach any columns borrowed from the file mapping, so that they aren't
+ * freed along with the owned memory, and unmap the file. */
+static void
+tsk_table_collection_release_file_map(tsk_table_collection_t *self)
+{
+    size_t j;
+    void **columns[] = {
+        (void **) &self->individuals.flags,
+        (void **) &self->individuals.location,
+        (void **) &self->individuals.location_offset,
+        (void **) &self->individuals.parents,
+        (void **) &self->individuals.parents_offset,
+        (void **) &self->individuals.metadata,
+        (void **) &self->individuals.metadata_offset,
+        (void **) &self->nodes.flags,
+        (void **) &self->nodes.time,
+        (void **) &self->nodes.population,
+        (void **) &self->nodes.individual,
+        (void **) &self->nodes.metadata,
+        (void **) &self->nodes.metadata_offset,
+        (void **) &self->edges.left,
+        (void **) &self->edges.right,
+        (void **) &self->edges.parent,
+        (void **) &self->edges.child,
+        (void **) &self->edges.metadata,
+        (void **) &self->edges.metadata_offset,
+        (void **) &self->migrations.source,
+        (void **) &self->migrations.dest,
+        (void **) &self->migrations.node,
+        (void **) &self->migrations.left,
+        (void **) &self->migrations.right,
+        (void **) &self->migrations.time,
+        (void **) &self->migrations.metadata,
+        (void **) &self->migrations.metadata_offset,
+        (void **) &self->sites.position,
+        (void **) &self->sites.ancestral_state,
+        (void **) &self->sites.ancestral_state_offset,
+        (void **) &self->sites.metadata,
+        (void **) &self->sites.metadata_offset,
+        (void **) &self->mutations.node,
+        (void **) &self->mutations.site,
+        (void **) &self->mutations.parent,
+        (void **) &self->mutations.time,
+        (void **) &self->mutations.derived_state,
+        (void **) &self->mutations.derived_state_offset,
+        (void **) &self->mutations.metadata,
+        (void **) &self->mutations.metadata_offset,
+        (void **) &self->populations.metadata,
+        (void **) &self->populations.metadata_offset,
+        (void **) &self->provenances.timestamp,
+        (void **) &self->provenances.timestamp_offset,
+        (void **) &self->provenances.record,
+        (void **) &self->provenances.record_offset,
+        (void **) &self->reference_sequence.data,
+        (void **) &self->reference_sequence.metadata,
+        (void **) &self->indexes.edge_insertion_order,
+        (void **) &self->indexes.edge_removal_order,
+        (void **) &self->metadata,
+    };
+
+    if (self->file_map.addr != NULL) {
+        for (j = 0; j < sizeof(columns) / sizeof(*columns); j++) {
+            if (tsk_table_collection_is_mapped(self, *columns[j])) {
+                *columns[j] = NULL;
+            }
+        }
+        munmap(self->file_map.addr, self->file_map.size);
+        self->file_map.addr = NULL;
+        self->file_map.size = 0;
+        tsk_table_collection_set_mapped(self, false);
+    }
+}
+
+#endif
+
+/* Copy a collection loaded with TSK_LOAD_MMAP into memory that it owns and
+ * release the mapping, so that its columns can be freed or grown. Operations
+ * that modify the tables call this first. */
+static int
+tsk_table_collection_copy_file_map(tsk_table_collection_t *self)
+{
+    int ret = 0;
+    tsk_table_collection_t copy;
+    tsk_flags_t options = 0;
+
+    if (self->file_map.addr == NULL) {
+        goto out;
+    }
+    if (self->edges.options & TSK_TABLE_NO_METADATA) {
+        options |= TSK_TC_NO_EDGE_METADATA;
+    }
+    ret = tsk_table_collection_copy(self, &copy, options);
+    if (ret != 0) {
+        tsk_table_collection_free(&copy);
+        goto out;
+    }
+    tsk_table_collection_free(self);
+    tsk_memcpy(self, &copy, sizeof(*self));
+out:
+    return ret;
+}
+
 static int
 read_table_cols(kastore_t *store, tsk_size_t *num_rows, read_table_col_t *cols,
     tsk_flags_t TSK_UNUSED(flags))
@@ -165,9 +456,129 @@ out:
     return ret;
 }
 
+/* Offset columns written with TSK_DUMP_COMPRESS_OFFSETS are stored as a
+ * KAS_UINT8 array of the differences between successive offsets (the first
+ * being relative to zero), each encoded as an unsigned LEB128 varint. */
+static size_t
+count_offset_varints(const uint8_t *data, size_t len)
+{
+    size_t j;
+    size_t count = 0;
+
+    for (j = 0; j < len; j++) {
+        count += (data[j] & 0x80) == 0;
+    }
+    return count;
+}
+
+static int
+decode_offset_array(read_table_ragged_col_t *col, const uint8_t *source,
+    size_t source_len, size_t *offset_len)
+{
+    int ret = 0;
+    size_t len = count_offset_varints(source, source_len);
+    size_t j, k;
+    unsigned int shift;
+    uint64_t delta, value;
+    uint64_t *dest;
+
+    if (len == 0 || (source[source_len - 1] & 0x80) != 0) {
+        ret = TSK_ERR_FILE_FORMAT;
+        goto out;
+    }
+    dest = tsk_malloc(len * sizeof(*dest));
+    if (dest == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    *col->offset_array_dest = dest;
+    value = 0;
+    k = 0;
+    for (j = 0; j < len; j++) {
+        delta = 0;
+        shift = 0;
+        do {
+            if (shift > 63 || (shift == 63 && (source[k] & 0x7E) != 0)) {
+                ret = TSK_ERR_FILE_FORMAT;
+                goto out;
+            }
+            delta |= (uint64_t) (source[k] & 0x7F) << shift;
+            shift += 7;
+            k++;
+        } while (source[k - 1] & 0x80);
+        if (delta > UINT64_MAX - value) {
+            ret = TSK_ERR_BAD_OFFSET;
+            goto out;
+        }
+        value += delta;
+        dest[j] = value;
+    }
+    *offset_len = len;
+out:
+    return ret;
+}
+
+static int
+alloc_empty_ragged_column(tsk_size_t num_rows, void **data_col, tsk_size_t **offset_col)
+{
+    int ret = 0;
+
+    *data_col = tsk_malloc(1);
+    *offset_col = tsk_calloc(num_rows + 1, sizeof(tsk_size_t));
+    if (*data_col == NULL || *offset_col == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+out:
+    return ret;
+}
+
+/* Get the number of rows for a table from the offset array of a ragged
+ * column that we are not otherwise reading. */
+static int
+read_skipped_ragged_col_num_rows(
+    kastore_t *store, tsk_size_t *num_rows, const read_table_ragged_col_t *col)
+{
+    int ret = 0;
+    char offset_col_name[TSK_MAX_COL_NAME_LEN];
+    void *offset_array = NULL;
+    size_t offset_len;
+    int type;
+
+    assert(strlen(col->name) + strlen("_offset") + 2 < sizeof(offset_col_name));
+    strcpy(offset_col_name, col->name);
+    strcat(offset_col_name, "_offset");
+
+    ret = kastore_containss(store, offset_col_name);
+    if (ret < 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (ret == 0) {
+        ret = (col->options & TSK_COL_OPTIONAL) ? 0 : TSK_ERR_REQUIRED_COL_NOT_FOUND;
+        goto out;
+    }
+    ret = kastore_gets(store, offset_col_name, &offset_array, &offset_len, &type);
+    if (ret != 0) {
+        ret = tsk_set_kas_error(ret);
+        goto out;
+    }
+    if (type == KAS_UINT8) {
+        offset_len = count_offset_varints(offset_array, offset_len);
+    }
+    if (offset_len == 0) {
+        ret = TSK_ERR_FILE_FORMAT;
+        goto out;
+    }
+    *num_rows = (tsk_size_t) offset_len - 1;
+out:
+    free_store_array(store, &offset_array);
+    return ret;
+}
+
 static int
 read_table_ragged_cols(kastore_t *store, tsk_size_t *num_rows,
-    read_table_ragged_col_t *cols, tsk_flags_t TSK_UNUSED(flags))
+    read_table_ragged_col_t *cols, tsk_flags_t flags)
 {
     int ret = 0;
     size_t data_len = 0; // initial value unused, just to keep the compiler happy.
@@ -180,6 +591,24 @@ read_table_ragged_cols(kastore_t *store, tsk_size_t *num_rows,
     tsk_size_t *offset_array;
 
     for (col = cols; col->name != NULL; col++) {
+        if ((flags & TSK_LOAD_SKIP_METADATA) && (col->options & TSK_COL_METADATA)) {
+            if (*num_rows == TSK_NUM_ROWS_UNSET) {
+                ret = read_skipped_ragged_col_num_rows(store, num_rows, col);
+                if (ret != 0) {
+                    goto out;
+                }
+            }
+            if (*num_rows != TSK_NUM_ROWS_UNSET) {
+                ret = alloc_empty_ragged_column(
+                    *num_rows, col->data_array_dest, col->offset_array_dest);
+                if (ret != 0) {
+                    goto out;
+                }
+                *col->data_len_dest = 0;
+            }
+            ret = 0;
+            continue;
+        }
         ret = kastore_containss(store, col->name);
         if (ret < 0) {
             ret = tsk_set_kas_error(ret);
@@ -224,6 +653,14 @@ read_table_ragged_cols(kastore_t *store, tsk_size_t *num_rows,
                 ret = tsk_set_kas_error(ret);
                 goto out;
             }
+            if (type == KAS_UINT8 && offset_len > 0) {
+                ret = decode_offset_array(
+                    col, store_offset_array, offset_len, &offset_len);
+                if (ret != 0) {
+                    goto out;
+                }
+                free_store_array(store, &store_offset_array);
+            }
             /* A table with zero rows will still have an offset length of 1;
              * catching this here prevents underflows in the logic below */
             if (offset_len == 0) {
@@ -242,13 +679,14 @@ read_table_ragged_cols(kastore_t *store, tsk_size_t *num_rows,
             if (type == KAS_UINT64) {
                 *col->offset_array_dest = (uint64_t *) store_offset_array;
                 store_offset_array = NULL;
+            } else if (type == KAS_UINT8) {
+                /* Already decoded above */
             } else if (type == KAS_UINT32) {
                 ret = cast_offset_array(col, (uint32_t *) store_offset_array, *num_rows);
                 if (ret != 0) {
                     goto out;
                 }
-                tsk_safe_free(store_offset_array);
-                store_offset_array = NULL;
+                free_store_array(store, &store_offset_array);
             } else {
                 ret = TSK_ERR_BAD_COLUMN_TYPE;
                 goto out;
@@ -261,13 +699,13 @@ read_table_ragged_cols(kastore_t *store, tsk_size_t *num_rows,
         }
     }
 out:
-    tsk_safe_free(store_offset_array);
+    free_store_array(store, &store_offset_array);
     return ret;
 }
 
 static int
 read_table_properties(
-    kastore_t *store, read_table_property_t *properties, tsk_flags_t TSK_UNUSED(flags))
+    kastore_t *store, read_table_property_t *properties, tsk_flags_t flags)
 {
     int ret = 0;
     size_t len;
@@ -275,6 +713,9 @@ read_table_properties(
     read_table_property_t *property;
 
     for (property = properties; property->name != NULL; property++) {
+        if ((flags & TSK_LOAD_SKIP_METADATA) && (property->options & TSK_COL_METADATA)) {
+            continue;
+        }
         ret = kastore_containss(store, property->name);
         if (ret < 0) {
             ret = tsk_set_kas_error(ret);
@@ -334,8 +775,8 @@ out:
 }
 
 static void
-free_read_table_mem(read_table_col_t *cols, read_table_ragged_col_t *ragged_cols,
-    read_table_property_t *properties)
+free_read_table_mem(const kastore_t *store, read_table_col_t *cols,
+    read_table_ragged_col_t *ragged_cols, read_table_property_t *properties)
 {
     read_table_col_t *col;
     read_table_ragged_col_t *ragged_col;
@@ -343,22 +784,64 @@ free_read_table_mem(read_table_col_t *cols, read_table_ragged_col_t *ragged_cols
 
     if (cols != NULL) {
         for (col = cols; col->name != NULL; col++) {
-            tsk_safe_free(*(col->array_dest));
+            free_store_array(store, col->array_dest);
         }
     }
     if (ragged_cols != NULL) {
         for (ragged_col = ragged_cols; ragged_col->name != NULL; ragged_col++) {
-            tsk_safe_free(*(ragged_col->data_array_dest));
-            tsk_safe_free(*(ragged_col->offset_array_dest));
+            free_store_array(store, ragged_col->data_array_dest);
+            free_store_array(store, (void **) ragged_col->offset_array_dest);
         }
     }
     if (properties != NULL) {
         for (property = properties; property->name != NULL; property++) {
-            tsk_safe_free(*(property->array_dest));
+            free_store_array(store, property->array_dest);
         }
     }
 }
 
+/* Encode the offsets in the format read by decode_offset_array. */
+static int
+encode_offset_array(
+    const tsk_size_t *offsets, tsk_size_t len, uint8_t **ret_data, size_t *ret_size)
+{
+    int ret = 0;
+    tsk_size_t j;
+    uint64_t delta;
+    size_t size = 0;
+    uint8_t *data = NULL;
+
+    for (j = 0; j < len; j++) {
+        delta = offsets[j] - (j == 0 ? 0 : offsets[j - 1]);
+        do {
+            size++;
+            delta >>= 7;
+        } while (delta != 0);
+    }
+    data = tsk_malloc(size);
+    if (data == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    size = 0;
+    for (j = 0; j < len; j++) {
+        delta = offsets[j] - (j == 0 ? 0 : offsets[j - 1]);
+        while (delta >= 0x80) {
+            data[size] = (uint8_t) ((delta & 0x7F) | 0x80);
+            size++;
+            delta >>= 7;
+        }
+        data[size] = (uint8_t) delta;
+        size++;
+    }
+    *ret_data = data;
+    *ret_size = size;
+    data = NULL;
+out:
+    tsk_safe_free(data);
+    return ret;
+}
+
 static int
 write_offset_col(
     kastore_t *store, const write_table_ragged_col_t *col, tsk_flags_t options)
@@ -366,6 +849,8 @@ write_offset_col(
     int ret = 0;
     char offset_col_name[TSK_MAX_COL_NAME_LEN];
     uint32_t *offset32 = NULL;
+    uint8_t *encoded = NULL;
+    size_t encoded_size;
     tsk_size_t len = col->num_rows + 1;
     tsk_size_t j;
     int32_t put_flags = 0;
@@ -377,7 +862,15 @@ write_offset_col(
     strcpy(offset_col_name, col->name);
     strcat(offset_col_name, "_offset");
 
-    if (options & TSK_DUMP_FORCE_OFFSET_64 || needs_64) {
+    if (options & TSK_DUMP_COMPRESS_OFFSETS) {
+        ret = encode_offset_array(col->offset_array, len, &encoded, &encoded_size);
+        if (ret != 0) {
+            goto out;
+        }
+        type = KAS_UINT8;
+        data = encoded;
+        len = (tsk_size_t) encoded_size;
+    } else if (options & TSK_DUMP_FORCE_OFFSET_64 || needs_64) {
         type = KAS_UINT64;
         data = col->offset_array;
         put_flags = KAS_BORROWS_ARRAY;
@@ -401,6 +894,7 @@ write_offset_col(
     }
 out:
     tsk_safe_free(offset32);
+    tsk_safe_free(encoded);
     return ret;
 }
 
@@ -487,12 +981,49 @@ out:
     return ret;
 }
 
+/* Sets the offsets of num_rows new rows of a ragged column starting at row
+ * start to be empty. */
+static void
+init_appended_offsets(tsk_size_t *offsets, tsk_size_t start, tsk_size_t num_rows)
+{
+    tsk_size_t j;
+
+    for (j = 1; j <= num_rows; j++) {
+        offsets[start + j] = offsets[start];
+    }
+}
+
+/* Checks the offsets of num_rows rows starting at row start that were written
+ * in place after a call to an append_begin function. */
+static int
+check_appended_offsets(const tsk_size_t *offsets, tsk_size_t start,
+    tsk_size_t num_rows, tsk_size_t length, tsk_size_t max_length)
+{
+    int ret = TSK_ERR_BAD_OFFSET;
+    tsk_size_t j;
+
+    if (offsets[start] != length) {
+        goto out;
+    }
+    for (j = start; j < start + num_rows; j++) {
+        if (offsets[j] > offsets[j + 1]) {
+            goto out;
+        }
+    }
+    if (offsets[start + num_rows] > max_length) {
+        goto out;
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
 static int
 calculate_max_rows(tsk_size_t num_rows, tsk_size_t max_rows,
     tsk_size_t max_rows_increment, tsk_size_t additional_rows,
     tsk_size_t *ret_new_max_rows)
 {
-    tsk_size_t new_max_rows;
+    tsk_size_t new_max_rows, max_step;
     int ret = 0;
 
     if (check_table_overflow(num_rows, additional_rows)) {
@@ -510,9 +1041,12 @@ calculate_max_rows(tsk_size_t num_rows, tsk_size_t max_rows,
             if (new_max_rows < 1024) {
                 new_max_rows = 1024;
             }
-            /* Prevent allocating more than ~2 million additional rows unless needed*/
-            if (new_max_rows - max_rows > 2097152) {
-                new_max_rows = max_rows + 2097152;
+            /* Prevent allocating more than ~2 million additional rows unless
+             * needed. Beyond ~8 million rows we grow by 25% instead, so that
+             * the number of reallocations stays logarithmic in the table size. */
+            max_step = TSK_MAX(2097152, max_rows / 4);
+            if (new_max_rows - max_rows > max_step) {
+                new_max_rows = max_rows + max_step;
             }
         } else {
             /* Use user increment value */
@@ -534,7 +1068,7 @@ calculate_max_length(tsk_size_t current_length, tsk_size_t max_length,
     tsk_size_t max_length_increment, tsk_size_t additional_length,
     tsk_size_t *ret_new_max_length)
 {
-    tsk_size_t new_max_length;
+    tsk_size_t new_max_length, max_step;
     int ret = 0;
 
     if (check_offset_overflow(current_length, additional_length)) {
@@ -552,9 +1086,11 @@ calculate_max_length(tsk_size_t current_length, tsk_size_t max_length,
             if (new_max_length < 65536) {
                 new_max_length = 65536;
             }
-            /* Prevent allocating more than 100MB additional unless needed*/
-            if (new_max_length - max_length > 104857600) {
-                new_max_length = max_length + 104857600;
+            /* Prevent allocating more than 100MB additional unless needed,
+             * growing by 25% beyond 400MB as for the rows above. */
+            max_step = TSK_MAX(104857600, max_length / 4);
+            if (new_max_length - max_length > max_step) {
+                new_max_length = max_length + max_step;
             }
             new_max_length = TSK_MAX(new_max_length, current_length + additional_length);
         } else {
@@ -647,21 +1183,6 @@ takeset_string(char **str, tsk_size_t *len, char *new_str, const tsk_size_t new_
     return 0;
 }
 
-static int
-alloc_empty_ragged_column(tsk_size_t num_rows, void **data_col, tsk_size_t **offset_col)
-{
-    int ret = 0;
-
-    *data_col = tsk_malloc(1);
-    *offset_col = tsk_calloc(num_rows + 1, sizeof(tsk_size_t));
-    if (*data_col == NULL || *offset_col == NULL) {
-        ret = TSK_ERR_NO_MEMORY;
-        goto out;
-    }
-out:
-    return ret;
-}
-
 static int
 check_ragged_column(tsk_size_t num_rows, void *data, tsk_size_t *offset)
 {
@@ -1010,6 +1531,9 @@ int
 tsk_reference_sequence_set_data(
     tsk_reference_sequence_t *self, const char *data, tsk_size_t data_length)
 {
+    if (self->mapped) {
+        return TSK_ERR_TABLE_MAPPED;
+    }
     return replace_string(&self->data, &self->data_length, data, data_length);
 }
 
@@ -1024,6 +1548,9 @@ int
 tsk_reference_sequence_set_metadata(
     tsk_reference_sequence_t *self, const char *metadata, tsk_size_t metadata_length)
 {
+    if (self->mapped) {
+        return TSK_ERR_TABLE_MAPPED;
+    }
     return replace_string(
         &self->metadata, &self->metadata_length, metadata, metadata_length);
 }
@@ -1040,6 +1567,9 @@ int
 tsk_reference_sequence_takeset_data(
     tsk_reference_sequence_t *self, char *data, tsk_size_t data_length)
 {
+    if (self->mapped) {
+        return TSK_ERR_TABLE_MAPPED;
+    }
     return takeset_string(&self->data, &self->data_length, data, data_length);
 }
 
@@ -1047,6 +1577,9 @@ int
 tsk_reference_sequence_takeset_metadata(
     tsk_reference_sequence_t *self, char *metadata, tsk_size_t metadata_length)
 {
+    if (self->mapped) {
+        return TSK_ERR_TABLE_MAPPED;
+    }
     return takeset_string(
         &self->metadata, &self->metadata_length, metadata, metadata_length);
 }
@@ -1082,6 +1615,11 @@ tsk_individual_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
         additional_rows, &new_max_rows);
     if (ret != 0) {
@@ -1148,6 +1686,17 @@ tsk_individual_table_set_max_rows_increment(
     return 0;
 }
 
+int
+tsk_individual_table_reserve(tsk_individual_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_individual_table_expand_main_columns(self, num_rows - self->num_rows);
+    }
+    return ret;
+}
+
 int
 tsk_individual_table_set_max_metadata_length_increment(
     tsk_individual_table_t *self, tsk_size_t max_metadata_length_increment)
@@ -1244,6 +1793,11 @@ tsk_individual_table_set_columns(tsk_individual_table_t *self, tsk_size_t num_ro
 {
     int ret;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_individual_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -1261,6 +1815,11 @@ tsk_individual_table_takeset_columns(tsk_individual_table_t *self, tsk_size_t nu
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     /* We need to check all the inputs before we start freeing or taking memory */
     ret = check_ragged_column(num_rows, location, location_offset);
     if (ret != 0) {
@@ -1526,6 +2085,11 @@ tsk_individual_table_update_row(tsk_individual_table_t *self, tsk_id_t index,
     int ret = 0;
     tsk_individual_t current_row;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_individual_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -1816,6 +2380,11 @@ tsk_individual_table_keep_rows(tsk_individual_table_t *self, const tsk_bool_t *k
     tsk_id_t *restrict parents = self->parents;
     tsk_size_t *restrict parents_offset = self->parents_offset;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (ret_id_map == NULL) {
         id_map = tsk_malloc(current_num_rows * sizeof(*id_map));
         if (id_map == NULL) {
@@ -1894,7 +2463,8 @@ tsk_individual_table_dump(
 }
 
 static int
-tsk_individual_table_load(tsk_individual_table_t *self, kastore_t *store)
+tsk_individual_table_load(
+    tsk_individual_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     tsk_flags_t *flags = NULL;
@@ -1918,16 +2488,17 @@ tsk_individual_table_load(tsk_individual_table_t *self, kastore_t *store)
         { "individuals/parents", (void **) &parents, &parents_length,
             TSK_ID_STORAGE_TYPE, &parents_offset, TSK_COL_OPTIONAL },
         { "individuals/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "individuals/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8,
+            TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -1952,7 +2523,7 @@ tsk_individual_table_load(tsk_individual_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -1985,6 +2556,11 @@ tsk_node_table_expand_main_columns(tsk_node_table_t *self, tsk_size_t additional
     int ret = 0;
     tsk_size_t new_max_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
         additional_rows, &new_max_rows);
     if (ret != 0) {
@@ -2035,6 +2611,17 @@ tsk_node_table_set_max_rows_increment(
     return 0;
 }
 
+int
+tsk_node_table_reserve(tsk_node_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_node_table_expand_main_columns(self, num_rows - self->num_rows);
+    }
+    return ret;
+}
+
 int
 tsk_node_table_set_max_metadata_length_increment(
     tsk_node_table_t *self, tsk_size_t max_metadata_length_increment)
@@ -2099,6 +2686,11 @@ tsk_node_table_set_columns(tsk_node_table_t *self, tsk_size_t num_rows,
 {
     int ret;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_node_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -2116,6 +2708,11 @@ tsk_node_table_takeset_columns(tsk_node_table_t *self, tsk_size_t num_rows,
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     /* We need to check all the inputs before we start freeing or taking memory */
     if (flags == NULL || time == NULL) {
         ret = TSK_ERR_BAD_PARAM_VALUE;
@@ -2214,6 +2811,46 @@ out:
     return ret;
 }
 
+tsk_id_t
+tsk_node_table_append_begin(
+    tsk_node_table_t *self, tsk_size_t num_rows, tsk_size_t metadata_length)
+{
+    tsk_id_t ret = 0;
+
+    ret = tsk_node_table_expand_main_columns(self, num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_node_table_expand_metadata(self, metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
+    init_appended_offsets(self->metadata_offset, self->num_rows, num_rows);
+    ret = (tsk_id_t) self->num_rows;
+out:
+    return ret;
+}
+
+int
+tsk_node_table_append_commit(tsk_node_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->max_rows - self->num_rows) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    ret = check_appended_offsets(self->metadata_offset, self->num_rows, num_rows,
+        self->metadata_length, self->max_metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
+    self->num_rows += num_rows;
+    self->metadata_length = self->metadata_offset[self->num_rows];
+out:
+    return ret;
+}
+
 static tsk_id_t
 tsk_node_table_add_row_internal(tsk_node_table_t *self, tsk_flags_t flags, double time,
     tsk_id_t population, tsk_id_t individual, const char *metadata,
@@ -2305,6 +2942,11 @@ tsk_node_table_update_row(tsk_node_table_t *self, tsk_id_t index, tsk_flags_t fl
     int ret = 0;
     tsk_node_t current_row;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_node_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -2525,6 +3167,11 @@ tsk_node_table_keep_rows(tsk_node_table_t *self, const tsk_bool_t *keep,
     int ret = 0;
     tsk_size_t remaining_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -2538,6 +3185,7 @@ tsk_node_table_keep_rows(tsk_node_table_t *self, const tsk_bool_t *keep,
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = remaining_rows;
+out:
     return ret;
 }
 
@@ -2565,7 +3213,7 @@ tsk_node_table_dump(const tsk_node_table_t *self, kastore_t *store, tsk_flags_t
 }
 
 static int
-tsk_node_table_load(tsk_node_table_t *self, kastore_t *store)
+tsk_node_table_load(tsk_node_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *metadata_schema = NULL;
@@ -2585,16 +3233,16 @@ tsk_node_table_load(tsk_node_table_t *self, kastore_t *store)
     };
     read_table_ragged_col_t ragged_cols[] = {
         { "nodes/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "nodes/metadata_schema", (void **) &metadata_schema, &metadata_schema_length,
-            KAS_UINT8, TSK_COL_OPTIONAL },
+            KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -2617,7 +3265,7 @@ tsk_node_table_load(tsk_node_table_t *self, kastore_t *store)
     metadata = NULL;
     metadata_offset = NULL;
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -2656,6 +3304,11 @@ tsk_edge_table_expand_main_columns(tsk_edge_table_t *self, tsk_size_t additional
     int ret = 0;
     tsk_size_t new_max_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
         additional_rows, &new_max_rows);
     if (ret != 0) {
@@ -2707,6 +3360,17 @@ tsk_edge_table_set_max_rows_increment(
     return 0;
 }
 
+int
+tsk_edge_table_reserve(tsk_edge_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_edge_table_expand_main_columns(self, num_rows - self->num_rows);
+    }
+    return ret;
+}
+
 int
 tsk_edge_table_set_max_metadata_length_increment(
     tsk_edge_table_t *self, tsk_size_t max_metadata_length_increment)
@@ -2837,6 +3501,11 @@ tsk_edge_table_update_row(tsk_edge_table_t *self, tsk_id_t index, double left,
     int ret = 0;
     tsk_edge_t current_row;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_edge_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -2907,6 +3576,11 @@ tsk_edge_table_set_columns(tsk_edge_table_t *self, tsk_size_t num_rows,
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_edge_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -2924,6 +3598,11 @@ tsk_edge_table_takeset_columns(tsk_edge_table_t *self, tsk_size_t num_rows, doub
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     /* We need to check all the inputs before we start freeing or taking memory */
     if (left == NULL || right == NULL || parent == NULL || child == NULL) {
         ret = TSK_ERR_BAD_PARAM_VALUE;
@@ -3016,6 +3695,56 @@ out:
     return ret;
 }
 
+tsk_id_t
+tsk_edge_table_append_begin(
+    tsk_edge_table_t *self, tsk_size_t num_rows, tsk_size_t metadata_length)
+{
+    tsk_id_t ret = 0;
+
+    if (metadata_length > 0 && !tsk_edge_table_has_metadata(self)) {
+        ret = TSK_ERR_METADATA_DISABLED;
+        goto out;
+    }
+    ret = tsk_edge_table_expand_main_columns(self, num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    if (tsk_edge_table_has_metadata(self)) {
+        ret = tsk_edge_table_expand_metadata(self, metadata_length);
+        if (ret != 0) {
+            goto out;
+        }
+        init_appended_offsets(self->metadata_offset, self->num_rows, num_rows);
+    }
+    ret = (tsk_id_t) self->num_rows;
+out:
+    return ret;
+}
+
+int
+tsk_edge_table_append_commit(tsk_edge_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->max_rows - self->num_rows) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    if (tsk_edge_table_has_metadata(self)) {
+        ret = check_appended_offsets(self->metadata_offset, self->num_rows, num_rows,
+            self->metadata_length, self->max_metadata_length);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    self->num_rows += num_rows;
+    if (tsk_edge_table_has_metadata(self)) {
+        self->metadata_length = self->metadata_offset[self->num_rows];
+    }
+out:
+    return ret;
+}
+
 int
 tsk_edge_table_clear(tsk_edge_table_t *self)
 {
@@ -3217,6 +3946,11 @@ tsk_edge_table_keep_rows(tsk_edge_table_t *self, const tsk_bool_t *keep,
     int ret = 0;
     tsk_size_t remaining_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -3230,6 +3964,7 @@ tsk_edge_table_keep_rows(tsk_edge_table_t *self, const tsk_bool_t *keep,
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = remaining_rows;
+out:
     return ret;
 }
 
@@ -3270,7 +4005,7 @@ out:
 }
 
 static int
-tsk_edge_table_load(tsk_edge_table_t *self, kastore_t *store)
+tsk_edge_table_load(tsk_edge_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *metadata_schema = NULL;
@@ -3291,16 +4026,16 @@ tsk_edge_table_load(tsk_edge_table_t *self, kastore_t *store)
     };
     read_table_ragged_col_t ragged_cols[] = {
         { "edges/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, TSK_COL_OPTIONAL },
+            &metadata_offset, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "edges/metadata_schema", (void **) &metadata_schema, &metadata_schema_length,
-            KAS_UINT8, TSK_COL_OPTIONAL },
+            KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -3323,7 +4058,7 @@ tsk_edge_table_load(tsk_edge_table_t *self, kastore_t *store)
     metadata = NULL;
     metadata_offset = NULL;
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -3335,6 +4070,11 @@ tsk_edge_table_squash(tsk_edge_table_t *self)
     tsk_edge_t *edges = NULL;
     tsk_size_t num_output_edges;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (self->metadata_length > 0) {
         ret = TSK_ERR_CANT_PROCESS_EDGES_WITH_METADATA;
         goto out;
@@ -3400,6 +4140,11 @@ tsk_site_table_expand_main_columns(tsk_site_table_t *self, tsk_size_t additional
     int ret = 0;
     tsk_size_t new_max_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
         additional_rows, &new_max_rows);
     if (ret != 0) {
@@ -3451,6 +4196,17 @@ tsk_site_table_set_max_rows_increment(
     return 0;
 }
 
+int
+tsk_site_table_reserve(tsk_site_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_site_table_expand_main_columns(self, num_rows - self->num_rows);
+    }
+    return ret;
+}
+
 int
 tsk_site_table_set_max_metadata_length_increment(
     tsk_site_table_t *self, tsk_size_t max_metadata_length_increment)
@@ -3595,6 +4351,11 @@ tsk_site_table_update_row(tsk_site_table_t *self, tsk_id_t index, double positio
     int ret = 0;
     tsk_site_t current_row;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_site_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -3693,6 +4454,57 @@ out:
     return ret;
 }
 
+tsk_id_t
+tsk_site_table_append_begin(tsk_site_table_t *self, tsk_size_t num_rows,
+    tsk_size_t ancestral_state_length, tsk_size_t metadata_length)
+{
+    tsk_id_t ret = 0;
+
+    ret = tsk_site_table_expand_main_columns(self, num_rows);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_site_table_expand_ancestral_state(self, ancestral_state_length);
+    if (ret != 0) {
+        goto out;
+    }
+    init_appended_offsets(self->ancestral_state_offset, self->num_rows, num_rows);
+    ret = tsk_site_table_expand_metadata(self, metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
+    init_appended_offsets(self->metadata_offset, self->num_rows, num_rows);
+    ret = (tsk_id_t) self->num_rows;
+out:
+    return ret;
+}
+
+int
+tsk_site_table_append_commit(tsk_site_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->max_rows - self->num_rows) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    ret = check_appended_offsets(self->ancestral_state_offset, self->num_rows, num_rows,
+        self->ancestral_state_length, self->max_ancestral_state_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = check_appended_offsets(self->metadata_offset, self->num_rows, num_rows,
+        self->metadata_length, self->max_metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
+    self->num_rows += num_rows;
+    self->ancestral_state_length = self->ancestral_state_offset[self->num_rows];
+    self->metadata_length = self->metadata_offset[self->num_rows];
+out:
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_site_table_copy(
     const tsk_site_table_t *self, tsk_site_table_t *dest, tsk_flags_t options)
@@ -3725,6 +4537,11 @@ tsk_site_table_set_columns(tsk_site_table_t *self, tsk_size_t num_rows,
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_site_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -3742,6 +4559,11 @@ tsk_site_table_takeset_columns(tsk_site_table_t *self, tsk_size_t num_rows,
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     /* We need to check all the inputs before we start freeing or taking memory */
     if (position == NULL || ancestral_state == NULL || ancestral_state_offset == NULL) {
         ret = TSK_ERR_BAD_PARAM_VALUE;
@@ -3975,6 +4797,11 @@ tsk_site_table_keep_rows(tsk_site_table_t *self, const tsk_bool_t *keep,
     int ret = 0;
     tsk_size_t remaining_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -3987,6 +4814,7 @@ tsk_site_table_keep_rows(tsk_site_table_t *self, const tsk_bool_t *keep,
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = remaining_rows;
+out:
     return ret;
 }
 
@@ -4012,7 +4840,7 @@ tsk_site_table_dump(const tsk_site_table_t *self, kastore_t *store, tsk_flags_t
 }
 
 static int
-tsk_site_table_load(tsk_site_table_t *self, kastore_t *store)
+tsk_site_table_load(tsk_site_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *metadata_schema = NULL;
@@ -4031,16 +4859,16 @@ tsk_site_table_load(tsk_site_table_t *self, kastore_t *store)
         { "sites/ancestral_state", (void **) &ancestral_state, &ancestral_state_length,
             KAS_UINT8, &ancestral_state_offset, 0 },
         { "sites/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "sites/metadata_schema", (void **) &metadata_schema, &metadata_schema_length,
-            KAS_UINT8, TSK_COL_OPTIONAL },
+            KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -4063,7 +4891,7 @@ tsk_site_table_load(tsk_site_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -4099,6 +4927,11 @@ tsk_mutation_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
         additional_rows, &new_max_rows);
     if (ret != 0) {
@@ -4163,6 +4996,17 @@ tsk_mutation_table_set_max_rows_increment(
     return 0;
 }
 
+int
+tsk_mutation_table_reserve(tsk_mutation_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_mutation_table_expand_main_columns(self, num_rows - self->num_rows);
+    }
+    return ret;
+}
+
 int
 tsk_mutation_table_set_max_metadata_length_increment(
     tsk_mutation_table_t *self, tsk_size_t max_metadata_length_increment)
@@ -4310,6 +5154,11 @@ tsk_mutation_table_update_row(tsk_mutation_table_t *self, tsk_id_t index, tsk_id
     int ret = 0;
     tsk_mutation_t current_row;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_mutation_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -4404,26 +5253,77 @@ tsk_mutation_table_append_columns(tsk_mutation_table_t *self, tsk_size_t num_row
     }
     self->metadata_offset[self->num_rows + num_rows] = self->metadata_length;
 
-    /* Derived state column */
-    ret = check_offsets(num_rows, derived_state_offset, 0, false);
+    /* Derived state column */
+    ret = check_offsets(num_rows, derived_state_offset, 0, false);
+    if (ret != 0) {
+        goto out;
+    }
+    derived_state_length = derived_state_offset[num_rows];
+    ret = tsk_mutation_table_expand_derived_state(self, derived_state_length);
+    if (ret != 0) {
+        goto out;
+    }
+    tsk_memcpy(self->derived_state + self->derived_state_length, derived_state,
+        derived_state_length * sizeof(char));
+    for (j = 0; j < num_rows; j++) {
+        self->derived_state_offset[self->num_rows + j]
+            = self->derived_state_length + derived_state_offset[j];
+    }
+    self->derived_state_length += derived_state_length;
+    self->derived_state_offset[self->num_rows + num_rows] = self->derived_state_length;
+
+    self->num_rows += num_rows;
+out:
+    return ret;
+}
+
+tsk_id_t
+tsk_mutation_table_append_begin(tsk_mutation_table_t *self, tsk_size_t num_rows,
+    tsk_size_t derived_state_length, tsk_size_t metadata_length)
+{
+    tsk_id_t ret = 0;
+
+    ret = tsk_mutation_table_expand_main_columns(self, num_rows);
     if (ret != 0) {
         goto out;
     }
-    derived_state_length = derived_state_offset[num_rows];
     ret = tsk_mutation_table_expand_derived_state(self, derived_state_length);
     if (ret != 0) {
         goto out;
     }
-    tsk_memcpy(self->derived_state + self->derived_state_length, derived_state,
-        derived_state_length * sizeof(char));
-    for (j = 0; j < num_rows; j++) {
-        self->derived_state_offset[self->num_rows + j]
-            = self->derived_state_length + derived_state_offset[j];
+    init_appended_offsets(self->derived_state_offset, self->num_rows, num_rows);
+    ret = tsk_mutation_table_expand_metadata(self, metadata_length);
+    if (ret != 0) {
+        goto out;
     }
-    self->derived_state_length += derived_state_length;
-    self->derived_state_offset[self->num_rows + num_rows] = self->derived_state_length;
+    init_appended_offsets(self->metadata_offset, self->num_rows, num_rows);
+    ret = (tsk_id_t) self->num_rows;
+out:
+    return ret;
+}
+
+int
+tsk_mutation_table_append_commit(tsk_mutation_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
 
+    if (num_rows > self->max_rows - self->num_rows) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    ret = check_appended_offsets(self->derived_state_offset, self->num_rows, num_rows,
+        self->derived_state_length, self->max_derived_state_length);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = check_appended_offsets(self->metadata_offset, self->num_rows, num_rows,
+        self->metadata_length, self->max_metadata_length);
+    if (ret != 0) {
+        goto out;
+    }
     self->num_rows += num_rows;
+    self->derived_state_length = self->derived_state_offset[self->num_rows];
+    self->metadata_length = self->metadata_offset[self->num_rows];
 out:
     return ret;
 }
@@ -4436,6 +5336,11 @@ tsk_mutation_table_takeset_columns(tsk_mutation_table_t *self, tsk_size_t num_ro
     tsk_size_t j;
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (site == NULL || node == NULL || derived_state == NULL
         || derived_state_offset == NULL) {
         ret = TSK_ERR_BAD_PARAM_VALUE;
@@ -4524,6 +5429,11 @@ tsk_mutation_table_set_columns(tsk_mutation_table_t *self, tsk_size_t num_rows,
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_mutation_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -4744,6 +5654,11 @@ tsk_mutation_table_keep_rows(tsk_mutation_table_t *self, const tsk_bool_t *keep,
     tsk_id_t *id_map = ret_id_map;
     tsk_id_t *restrict parent = self->parent;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (ret_id_map == NULL) {
         id_map = tsk_malloc(current_num_rows * sizeof(*id_map));
         if (id_map == NULL) {
@@ -4819,7 +5734,8 @@ tsk_mutation_table_dump(
 }
 
 static int
-tsk_mutation_table_load(tsk_mutation_table_t *self, kastore_t *store)
+tsk_mutation_table_load(
+    tsk_mutation_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     tsk_id_t *node = NULL;
@@ -4844,16 +5760,17 @@ tsk_mutation_table_load(tsk_mutation_table_t *self, kastore_t *store)
         { "mutations/derived_state", (void **) &derived_state, &derived_state_length,
             KAS_UINT8, &derived_state_offset, 0 },
         { "mutations/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "mutations/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8,
+            TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -4879,7 +5796,7 @@ tsk_mutation_table_load(tsk_mutation_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -4915,6 +5832,11 @@ tsk_migration_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
         additional_rows, &new_max_rows);
     if (ret != 0) {
@@ -4974,6 +5896,17 @@ tsk_migration_table_set_max_rows_increment(
     return 0;
 }
 
+int
+tsk_migration_table_reserve(tsk_migration_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_migration_table_expand_main_columns(self, num_rows - self->num_rows);
+    }
+    return ret;
+}
+
 int
 tsk_migration_table_set_max_metadata_length_increment(
     tsk_migration_table_t *self, tsk_size_t max_metadata_length_increment)
@@ -5074,6 +6007,11 @@ tsk_migration_table_takeset_columns(tsk_migration_table_t *self, tsk_size_t num_
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (left == NULL || right == NULL || node == NULL || source == NULL || dest == NULL
         || time == NULL) {
         ret = TSK_ERR_BAD_PARAM_VALUE;
@@ -5137,6 +6075,11 @@ tsk_migration_table_set_columns(tsk_migration_table_t *self, tsk_size_t num_rows
 {
     int ret;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_migration_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -5233,6 +6176,11 @@ tsk_migration_table_update_row(tsk_migration_table_t *self, tsk_id_t index, doub
     int ret = 0;
     tsk_migration_t current_row;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_migration_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -5444,6 +6392,11 @@ tsk_migration_table_keep_rows(tsk_migration_table_t *self, const tsk_bool_t *kee
     int ret = 0;
     tsk_size_t remaining_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -5459,6 +6412,7 @@ tsk_migration_table_keep_rows(tsk_migration_table_t *self, const tsk_bool_t *kee
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = remaining_rows;
+out:
     return ret;
 }
 
@@ -5488,7 +6442,8 @@ tsk_migration_table_dump(
 }
 
 static int
-tsk_migration_table_load(tsk_migration_table_t *self, kastore_t *store)
+tsk_migration_table_load(
+    tsk_migration_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     tsk_id_t *source = NULL;
@@ -5513,16 +6468,17 @@ tsk_migration_table_load(tsk_migration_table_t *self, kastore_t *store)
     };
     read_table_ragged_col_t ragged_cols[] = {
         { "migrations/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, TSK_COL_OPTIONAL },
+            &metadata_offset, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "migrations/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8,
+            TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, cols, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, cols, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -5548,7 +6504,7 @@ tsk_migration_table_load(tsk_migration_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(cols, ragged_cols, properties);
+    free_read_table_mem(store, cols, ragged_cols, properties);
     return ret;
 }
 
@@ -5578,6 +6534,11 @@ tsk_population_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
         additional_rows, &new_max_rows);
     if (ret != 0) {
@@ -5612,6 +6573,17 @@ tsk_population_table_set_max_rows_increment(
     return 0;
 }
 
+int
+tsk_population_table_reserve(tsk_population_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_population_table_expand_main_columns(self, num_rows - self->num_rows);
+    }
+    return ret;
+}
+
 int
 tsk_population_table_set_max_metadata_length_increment(
     tsk_population_table_t *self, tsk_size_t max_metadata_length_increment)
@@ -5675,6 +6647,11 @@ tsk_population_table_set_columns(tsk_population_table_t *self, tsk_size_t num_ro
 {
     int ret;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_population_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -5729,6 +6706,11 @@ tsk_population_table_takeset_columns(tsk_population_table_t *self, tsk_size_t nu
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     /* We need to check all the inputs before we start freeing or taking memory */
     if (metadata == NULL || metadata_offset == NULL) {
         ret = TSK_ERR_BAD_PARAM_VALUE;
@@ -5836,6 +6818,11 @@ tsk_population_table_update_row(tsk_population_table_t *self, tsk_id_t index,
     int ret = 0;
     tsk_population_t current_row;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_population_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -6037,6 +7024,11 @@ tsk_population_table_keep_rows(tsk_population_table_t *self, const tsk_bool_t *k
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -6046,6 +7038,7 @@ tsk_population_table_keep_rows(tsk_population_table_t *self, const tsk_bool_t *k
             self->metadata, self->metadata_offset, self->num_rows, keep);
     }
     self->num_rows = count_true(self->num_rows, keep);
+out:
     return ret;
 }
 
@@ -6068,7 +7061,8 @@ tsk_population_table_dump(
 }
 
 static int
-tsk_population_table_load(tsk_population_table_t *self, kastore_t *store)
+tsk_population_table_load(
+    tsk_population_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *metadata = NULL;
@@ -6078,16 +7072,17 @@ tsk_population_table_load(tsk_population_table_t *self, kastore_t *store)
 
     read_table_ragged_col_t ragged_cols[] = {
         { "populations/metadata", (void **) &metadata, &metadata_length, KAS_UINT8,
-            &metadata_offset, 0 },
+            &metadata_offset, TSK_COL_METADATA },
         { .name = NULL },
     };
     read_table_property_t properties[] = {
         { "populations/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8,
+            TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, NULL, ragged_cols, properties, 0);
+    ret = read_table(store, &num_rows, NULL, ragged_cols, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -6107,7 +7102,7 @@ tsk_population_table_load(tsk_population_table_t *self, kastore_t *store)
     metadata_offset = NULL;
 
 out:
-    free_read_table_mem(NULL, ragged_cols, properties);
+    free_read_table_mem(store, NULL, ragged_cols, properties);
     return ret;
 }
 
@@ -6138,6 +7133,11 @@ tsk_provenance_table_expand_main_columns(
     int ret = 0;
     tsk_size_t new_max_rows;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = calculate_max_rows(self->num_rows, self->max_rows, self->max_rows_increment,
         additional_rows, &new_max_rows);
     if (ret != 0) {
@@ -6186,6 +7186,17 @@ tsk_provenance_table_set_max_rows_increment(
     return 0;
 }
 
+int
+tsk_provenance_table_reserve(tsk_provenance_table_t *self, tsk_size_t num_rows)
+{
+    int ret = 0;
+
+    if (num_rows > self->num_rows) {
+        ret = tsk_provenance_table_expand_main_columns(self, num_rows - self->num_rows);
+    }
+    return ret;
+}
+
 int
 tsk_provenance_table_set_max_timestamp_length_increment(
     tsk_provenance_table_t *self, tsk_size_t max_timestamp_length_increment)
@@ -6259,6 +7270,11 @@ tsk_provenance_table_set_columns(tsk_provenance_table_t *self, tsk_size_t num_ro
 {
     int ret;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_provenance_table_clear(self);
     if (ret != 0) {
         goto out;
@@ -6333,6 +7349,11 @@ tsk_provenance_table_takeset_columns(tsk_provenance_table_t *self, tsk_size_t nu
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     /* We need to check all the inputs before we start freeing or taking memory */
     if (timestamp == NULL || timestamp_offset == NULL || record == NULL
         || record_offset == NULL) {
@@ -6465,6 +7486,11 @@ tsk_provenance_table_update_row(tsk_provenance_table_t *self, tsk_id_t index,
     int ret = 0;
     tsk_provenance_t current_row;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     ret = tsk_provenance_table_get_row(self, index, &current_row);
     if (ret != 0) {
         goto out;
@@ -6667,6 +7693,11 @@ tsk_provenance_table_keep_rows(tsk_provenance_table_t *self, const tsk_bool_t *k
 {
     int ret = 0;
 
+    if (self->mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+
     if (id_map != NULL) {
         keep_mask_to_id_map(self->num_rows, keep, id_map);
     }
@@ -6675,7 +7706,7 @@ tsk_provenance_table_keep_rows(tsk_provenance_table_t *self, const tsk_bool_t *k
     self->record_length = subset_ragged_char_column(
         self->record, self->record_offset, self->num_rows, keep);
     self->num_rows = count_true(self->num_rows, keep);
-
+out:
     return ret;
 }
 
@@ -6695,7 +7726,8 @@ tsk_provenance_table_dump(
 }
 
 static int
-tsk_provenance_table_load(tsk_provenance_table_t *self, kastore_t *store)
+tsk_provenance_table_load(
+    tsk_provenance_table_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret;
     char *timestamp = NULL;
@@ -6712,7 +7744,7 @@ tsk_provenance_table_load(tsk_provenance_table_t *self, kastore_t *store)
         { .name = NULL },
     };
 
-    ret = read_table(store, &num_rows, NULL, ragged_cols, NULL, 0);
+    ret = read_table(store, &num_rows, NULL, ragged_cols, NULL, options);
     if (ret != 0) {
         goto out;
     }
@@ -6727,7 +7759,7 @@ tsk_provenance_table_load(tsk_provenance_table_t *self, kastore_t *store)
     record_offset = NULL;
 
 out:
-    free_read_table_mem(NULL, ragged_cols, NULL);
+    free_read_table_mem(store, NULL, ragged_cols, NULL);
     return ret;
 }
 
@@ -6897,6 +7929,149 @@ cmp_migration(const void *a, const void *b)
     return ret;
 }
 
+/* Edges are sorted using a least-significant-digit radix sort on a compact
+ * array of (key, index) pairs, which is considerably faster than qsort for
+ * large numbers of edges. The sort order is (time, parent, child, left);
+ * since LSD radix sort is stable we sort by the least significant 64 bit
+ * key first (left), then by (parent, child) and finally by time. Passes in
+ * which every key has the same digit are skipped, which is common since
+ * node IDs rarely use their high bits and times and coordinates are often
+ * integers. */
+
+#define TSK_EDGE_RADIX_BITS 8U
+#define TSK_EDGE_RADIX_SIZE (1U << TSK_EDGE_RADIX_BITS)
+#define TSK_EDGE_RADIX_PASSES (64U / TSK_EDGE_RADIX_BITS)
+
+typedef struct {
+    uint64_t key;
+    tsk_size_t index;
+} edge_radix_item_t;
+
+/* Map a double to an unsigned integer with the same ordering. */
+static inline uint64_t
+double_radix_key(double x)
+{
+    uint64_t bits;
+
+    /* Adding zero maps -0.0 to 0.0, so that these compare equal */
+    x += 0.0;
+    tsk_memcpy(&bits, &x, sizeof(bits));
+    if (bits >> 63) {
+        bits = ~bits;
+    } else {
+        bits ^= (uint64_t) 1 << 63;
+    }
+    return bits;
+}
+
+/* Map a signed ID to an unsigned integer with the same ordering. */
+static inline uint64_t
+id_radix_key(tsk_id_t x)
+{
+    return (uint64_t)((uint32_t) x ^ ((uint32_t) 1 << 31));
+}
+
+static inline uint64_t
+edge_radix_key(const edge_sort_t *e, int key)
+{
+    uint64_t ret;
+
+    if (key == 0) {
+        ret = double_radix_key(e->left);
+    } else if (key == 1) {
+        ret = (id_radix_key(e->parent) << 32) | id_radix_key(e->child);
+    } else {
+        ret = double_radix_key(e->time);
+    }
+    return ret;
+}
+
+/* Stably sort the items by key, using the specified buffer as scratch space.
+ * Returns the array in which the sorted items are stored, which is one of
+ * the two input arrays. */
+static edge_radix_item_t *
+edge_radix_sort(edge_radix_item_t *items, edge_radix_item_t *buffer, tsk_size_t n,
+    tsk_size_t *count)
+{
+    edge_radix_item_t *src = items;
+    edge_radix_item_t *dest = buffer;
+    edge_radix_item_t *tmp;
+    tsk_size_t j, total, c;
+    tsk_size_t *pass_count;
+    unsigned int digit, shift, pass;
+
+    if (n == 0) {
+        goto out;
+    }
+    tsk_memset(count, 0, TSK_EDGE_RADIX_PASSES * TSK_EDGE_RADIX_SIZE * sizeof(*count));
+    for (j = 0; j < n; j++) {
+        for (pass = 0; pass < TSK_EDGE_RADIX_PASSES; pass++) {
+            shift = pass * TSK_EDGE_RADIX_BITS;
+            digit = (unsigned int) (src[j].key >> shift) & (TSK_EDGE_RADIX_SIZE - 1);
+            count[pass * TSK_EDGE_RADIX_SIZE + digit]++;
+        }
+    }
+    for (pass = 0; pass < TSK_EDGE_RADIX_PASSES; pass++) {
+        shift = pass * TSK_EDGE_RADIX_BITS;
+        pass_count = count + pass * TSK_EDGE_RADIX_SIZE;
+        digit = (unsigned int) (src[0].key >> shift) & (TSK_EDGE_RADIX_SIZE - 1);
+        if (pass_count[digit] == n) {
+            /* All keys have the same digit, so this pass is a no-op */
+            continue;
+        }
+        /* Convert the counts to starting offsets */
+        total = 0;
+        for (j = 0; j < TSK_EDGE_RADIX_SIZE; j++) {
+            c = pass_count[j];
+            pass_count[j] = total;
+            total += c;
+        }
+        for (j = 0; j < n; j++) {
+            digit = (unsigned int) (src[j].key >> shift) & (TSK_EDGE_RADIX_SIZE - 1);
+            dest[pass_count[digit]] = src[j];
+            pass_count[digit]++;
+        }
+        tmp = src;
+        src = dest;
+        dest = tmp;
+    }
+out:
+    return src;
+}
+
+/* Merge the sorted items for the rows from m to n with the first m rows,
+ * which are already in sorted order, into the output array. Rows from
+ * the sorted prefix come first when edges compare equal. */
+static void
+merge_sorted_edges(const edge_sort_t *sorted_edges, const edge_radix_item_t *items,
+    tsk_size_t m, tsk_size_t n, edge_radix_item_t *output)
+{
+    tsk_size_t j = 0;
+    tsk_size_t k = 0;
+    tsk_size_t l = 0;
+
+    while (j < m && k < n - m) {
+        if (cmp_edge(sorted_edges + items[k].index, sorted_edges + j) < 0) {
+            output[l] = items[k];
+            k++;
+        } else {
+            output[l].index = j;
+            j++;
+        }
+        l++;
+    }
+    while (j < m) {
+        output[l].index = j;
+        j++;
+        l++;
+    }
+    while (k < n - m) {
+        output[l] = items[k];
+        k++;
+        l++;
+    }
+}
+
 static int
 tsk_table_sorter_sort_edges(tsk_table_sorter_t *self, tsk_size_t start)
 {
@@ -6904,20 +8079,32 @@ tsk_table_sorter_sort_edges(tsk_table_sorter_t *self, tsk_size_t start)
     const tsk_edge_table_t *edges = &self->tables->edges;
     const double *restrict node_time = self->tables->nodes.time;
     edge_sort_t *e;
+    edge_radix_item_t *e_items;
     tsk_size_t j, k, metadata_offset;
-    tsk_size_t n = edges->num_rows - start;
+    /* When merging we read in all of the rows, and the first m rows
+     * are the already sorted prefix. */
+    bool merge = (self->options & TSK_SORT_MERGE_EDGES) && start > 0;
+    tsk_size_t offset = merge ? 0 : start;
+    tsk_size_t m = start - offset;
+    tsk_size_t n = edges->num_rows - offset;
     edge_sort_t *sorted_edges = tsk_malloc(n * sizeof(*sorted_edges));
+    edge_radix_item_t *items = tsk_malloc(n * sizeof(*items));
+    edge_radix_item_t *buffer = tsk_malloc(n * sizeof(*buffer));
+    tsk_size_t *count
+        = tsk_malloc(TSK_EDGE_RADIX_PASSES * TSK_EDGE_RADIX_SIZE * sizeof(*count));
     char *old_metadata = tsk_malloc(edges->metadata_length);
     bool has_metadata = tsk_edge_table_has_metadata(edges);
+    int key;
 
-    if (sorted_edges == NULL || old_metadata == NULL) {
+    if (sorted_edges == NULL || items == NULL || buffer == NULL || count == NULL
+        || old_metadata == NULL) {
         ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
     tsk_memcpy(old_metadata, edges->metadata, edges->metadata_length);
     for (j = 0; j < n; j++) {
         e = sorted_edges + j;
-        k = start + j;
+        k = offset + j;
         e->left = edges->left[k];
         e->right = edges->right[k];
         e->parent = edges->parent[k];
@@ -6929,12 +8116,30 @@ tsk_table_sorter_sort_edges(tsk_table_sorter_t *self, tsk_size_t start)
                 = edges->metadata_offset[k + 1] - edges->metadata_offset[k];
         }
     }
-    qsort(sorted_edges, (size_t) n, sizeof(edge_sort_t), cmp_edge);
+    for (j = 0; j < n - m; j++) {
+        items[j].index = m + j;
+    }
+    for (key = 0; key < 3 && n > m; key++) {
+        for (j = 0; j < n - m; j++) {
+            items[j].key = edge_radix_key(sorted_edges + items[j].index, key);
+        }
+        e_items = edge_radix_sort(items, buffer, n - m, count);
+        if (e_items != items) {
+            buffer = items;
+            items = e_items;
+        }
+    }
+    if (m > 0) {
+        merge_sorted_edges(sorted_edges, items, m, n, buffer);
+        e_items = items;
+        items = buffer;
+        buffer = e_items;
+    }
     /* Copy the edges back into the table. */
-    metadata_offset = 0;
+    metadata_offset = has_metadata ? edges->metadata_offset[offset] : 0;
     for (j = 0; j < n; j++) {
-        e = sorted_edges + j;
-        k = start + j;
+        e = sorted_edges + items[j].index;
+        k = offset + j;
         edges->left[k] = e->left;
         edges->right[k] = e->right;
         edges->parent[k] = e->parent;
@@ -6948,6 +8153,9 @@ tsk_table_sorter_sort_edges(tsk_table_sorter_t *self, tsk_size_t start)
     }
 out:
     tsk_safe_free(sorted_edges);
+    tsk_safe_free(items);
+    tsk_safe_free(buffer);
+    tsk_safe_free(count);
     tsk_safe_free(old_metadata);
     return ret;
 }
@@ -6983,7 +8191,7 @@ tsk_table_sorter_sort_migrations(tsk_table_sorter_t *self, tsk_size_t start)
     }
     qsort(sorted_migrations, (size_t) n, sizeof(migration_sort_t), cmp_migration);
     /* Copy the migrations back into the table. */
-    metadata_offset = 0;
+    metadata_offset = migrations->metadata_offset[start];
     for (j = 0; j < n; j++) {
         m = sorted_migrations + j;
         k = start + j;
@@ -7296,6 +8504,10 @@ tsk_table_collection_individual_topological_sort(
     if (ret != 0) {
         goto out;
     }
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
 
     ret_id = tsk_table_collection_check_integrity(self, 0);
     if (ret_id != 0) {
@@ -7525,6 +8737,10 @@ tsk_table_sorter_init(
     tsk_id_t ret_id;
 
     tsk_memset(self, 0, sizeof(tsk_table_sorter_t));
+    ret = tsk_table_collection_copy_file_map(tables);
+    if (ret != 0) {
+        goto out;
+    }
     if (!(options & TSK_NO_CHECK_INTEGRITY)) {
         ret_id = tsk_table_collection_check_integrity(tables, 0);
         if (ret_id != 0) {
@@ -7533,6 +8749,7 @@ tsk_table_sorter_init(
         }
     }
     self->tables = tables;
+    self->options = options;
 
     self->site_id_map = tsk_malloc(self->tables->sites.num_rows * sizeof(tsk_id_t));
     if (self->site_id_map == NULL) {
@@ -7643,6 +8860,57 @@ cmp_segment(const void *a, const void *b)
     return ret;
 }
 
+/* The arrays of segments and node IDs that we sort while simplifying are
+ * usually very small (a handful of elements), and for these insertion sort
+ * is much faster than the overhead of calling qsort. */
+#define TSK_INSERTION_SORT_MAX 16
+
+static int
+cmp_node_id(const void *a, const void *b)
+{
+    const tsk_id_t *ia = (const tsk_id_t *) a;
+    const tsk_id_t *ib = (const tsk_id_t *) b;
+    return (*ia > *ib) - (*ia < *ib);
+}
+
+static void
+sort_segments(tsk_segment_t *segments, tsk_size_t n)
+{
+    tsk_size_t j, k;
+    tsk_segment_t x;
+
+    if (n > TSK_INSERTION_SORT_MAX) {
+        qsort(segments, (size_t) n, sizeof(*segments), cmp_segment);
+    } else {
+        for (j = 1; j < n; j++) {
+            x = segments[j];
+            for (k = j; k > 0 && cmp_segment(&x, segments + k - 1) < 0; k--) {
+                segments[k] = segments[k - 1];
+            }
+            segments[k] = x;
+        }
+    }
+}
+
+static void
+sort_node_ids(tsk_id_t *nodes, tsk_size_t n)
+{
+    tsk_size_t j, k;
+    tsk_id_t x;
+
+    if (n > TSK_INSERTION_SORT_MAX) {
+        qsort(nodes, (size_t) n, sizeof(*nodes), cmp_node_id);
+    } else {
+        for (j = 1; j < n; j++) {
+            x = nodes[j];
+            for (k = j; k > 0 && x < nodes[k - 1]; k--) {
+                nodes[k] = nodes[k - 1];
+            }
+            nodes[k] = x;
+        }
+    }
+}
+
 static int TSK_WARN_UNUSED
 segment_overlapper_alloc(segment_overlapper_t *self)
 {
@@ -7695,8 +8963,7 @@ segment_overlapper_start(
     self->right = DBL_MAX;
 
     /* Sort the segments in the buffer by left coordinate */
-    qsort(
-        self->segments, (size_t) self->num_segments, sizeof(tsk_segment_t), cmp_segment);
+    sort_segments(self->segments, self->num_segments);
     /* NOTE! We are assuming that there's space for another element on the end
      * here. This is to insert a sentinel which simplifies the logic. */
     sentinel = self->segments + self->num_segments;
@@ -7766,14 +9033,6 @@ segment_overlapper_next(segment_overlapper_t *self, double *left, double *right,
     return ret;
 }
 
-static int
-cmp_node_id(const void *a, const void *b)
-{
-    const tsk_id_t *ia = (const tsk_id_t *) a;
-    const tsk_id_t *ib = (const tsk_id_t *) b;
-    return (*ia > *ib) - (*ia < *ib);
-}
-
 /*************************
  * Ancestor mapper
  *************************/
@@ -7853,8 +9112,7 @@ ancestor_mapper_flush_edges(
     interval_list_t *x;
     tsk_size_t num_edges = 0;
 
-    qsort(self->buffered_children, (size_t) self->num_buffered_children,
-        sizeof(tsk_id_t), cmp_node_id);
+    sort_node_ids(self->buffered_children, self->num_buffered_children);
     for (j = 0; j < self->num_buffered_children; j++) {
         child = self->buffered_children[j];
         for (x = self->child_edge_map_head[child]; x != NULL; x = x->next) {
@@ -8345,38 +9603,51 @@ out:
     return ret;
 }
 
-static tsk_identity_segment_t *TSK_WARN_UNUSED
-tsk_identity_segments_alloc_segment(
-    tsk_identity_segments_t *self, double left, double right, tsk_id_t node)
+/* Returns the slot in the pair table for the specified key. This is either
+ * the slot holding the key, or the empty slot where it should be inserted.
+ * Keys are mixed with a multiplicative hash and collisions are resolved by
+ * linear probing; the table is never more than half full. */
+static tsk_size_t
+tsk_identity_segments_find_slot(const tsk_identity_segments_t *self, int64_t key)
 {
-    tsk_identity_segment_t *seg = tsk_blkalloc_get(&self->heap, sizeof(*seg));
-    if (seg == NULL) {
-        goto out;
-    }
-    tsk_bug_assert(left < right);
-    tsk_bug_assert(node >= 0 && node < (tsk_id_t) self->num_nodes);
+    const tsk_size_t mask = self->pair_table_size - 1;
+    uint64_t h = (uint64_t) key * 0x9E3779B97F4A7C15ULL;
+    tsk_size_t slot = (tsk_size_t)(h ^ (h >> 32)) & mask;
+    int64_t index;
 
-    seg->next = NULL;
-    seg->left = left;
-    seg->right = right;
-    seg->node = node;
-out:
-    return seg;
+    while (true) {
+        index = self->pair_table[slot];
+        if (index == TSK_NULL || self->pairs[index].key == key) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
 }
 
-static tsk_avl_node_int_t *
-tsk_identity_segments_alloc_new_pair(tsk_identity_segments_t *self, int64_t key)
+/* Rebuild the pair table with the specified number of slots. */
+static int
+tsk_identity_segments_rehash(tsk_identity_segments_t *self, tsk_size_t size)
 {
-    tsk_avl_node_int_t *avl_node = tsk_blkalloc_get(&self->heap, sizeof(*avl_node));
-    tsk_identity_segment_list_t *list = tsk_blkalloc_get(&self->heap, sizeof(*list));
+    int ret = 0;
+    tsk_size_t j;
+    int64_t *table = tsk_malloc(size * sizeof(*table));
 
-    if (avl_node == NULL || list == NULL) {
-        return NULL;
+    if (table == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    for (j = 0; j < size; j++) {
+        table[j] = TSK_NULL;
     }
-    avl_node->key = key;
-    avl_node->value = list;
-    memset(list, 0, sizeof(*list));
-    return avl_node;
+    tsk_safe_free(self->pair_table);
+    self->pair_table = table;
+    self->pair_table_size = size;
+    for (j = 0; j < self->num_pairs; j++) {
+        table[tsk_identity_segments_find_slot(self, self->pairs[j].key)] = (int64_t) j;
+    }
+out:
+    return ret;
 }
 
 /* Deliberately not making this a part of the public interface for now,
@@ -8400,12 +9671,7 @@ tsk_identity_segments_init(
     } else if (options & TSK_IBD_STORE_PAIRS) {
         self->store_pairs = true;
     }
-    ret = tsk_avl_tree_int_init(&self->pair_map);
-    if (ret != 0) {
-        goto out;
-    }
-    /* Allocate heap memory in 1MiB blocks */
-    ret = tsk_blkalloc_init(&self->heap, 1024 * 1024);
+    ret = tsk_identity_segments_rehash(self, 1024);
     if (ret != 0) {
         goto out;
     }
@@ -8416,26 +9682,23 @@ out:
 void
 tsk_identity_segments_print_state(tsk_identity_segments_t *self, FILE *out)
 {
-    tsk_avl_node_int_t **nodes = tsk_malloc(self->pair_map.size * sizeof(*nodes));
     int64_t key;
     tsk_identity_segment_list_t *value;
     tsk_identity_segment_t *seg;
     tsk_size_t j;
     tsk_id_t a, b;
 
-    tsk_bug_assert(nodes != NULL);
-
     fprintf(out, "===\nIBD Result\n===\n");
     fprintf(out, "total_span     = %f\n", self->total_span);
     fprintf(out, "num_segments   = %lld\n", (unsigned long long) self->num_segments);
     fprintf(out, "store_pairs    = %d\n", self->store_pairs);
     fprintf(out, "store_segments = %d\n", self->store_segments);
+    fprintf(out, "pair_table_size= %lld\n", (unsigned long long) self->pair_table_size);
     if (self->store_pairs) {
-        fprintf(out, "num_keys       = %d\n", (int) self->pair_map.size);
-        tsk_avl_tree_int_ordered_nodes(&self->pair_map, nodes);
-        for (j = 0; j < self->pair_map.size; j++) {
-            key = nodes[j]->key;
-            value = (tsk_identity_segment_list_t *) nodes[j]->value;
+        fprintf(out, "num_keys       = %d\n", (int) self->num_pairs);
+        for (j = 0; j < self->num_pairs; j++) {
+            key = self->pairs[j].key;
+            value = &self->pairs[j].list;
             integer_to_pair(key, self->num_nodes, &a, &b);
             fprintf(out, "%lld\t(%d,%d) n=%d total_span=%f\t", (long long) key, (int) a,
                 (int) b, (int) value->num_segments, value->total_span);
@@ -8448,9 +9711,6 @@ tsk_identity_segments_print_state(tsk_identity_segments_t *self, FILE *out)
             fprintf(out, "\n");
         }
     }
-    fprintf(out, "Segment memory\n");
-    tsk_blkalloc_print_state(&self->heap, out);
-    tsk_safe_free(nodes);
 }
 
 tsk_size_t
@@ -8466,115 +9726,198 @@ tsk_identity_segments_get_total_span(const tsk_identity_segments_t *self)
 }
 
 tsk_size_t
-tsk_identity_segments_get_num_pairs(const tsk_identity_segments_t *self)
-{
-    return self->pair_map.size;
-}
-
-/* Use an inorder traversal on the AVL tree to get the pairs in order.
- * Recursion is safe here because it's a balanced tree (see the AVL tree
- * code for notes on this).
- */
-static int
-get_keys_traverse(tsk_avl_node_int_t *node, int index, tsk_size_t N, tsk_id_t *pairs)
-{
-    tsk_id_t a, b;
-
-    if (node == NULL) {
-        return index;
-    }
-    index = get_keys_traverse(node->llink, index, N, pairs);
-    integer_to_pair(node->key, N, &a, &b);
-    pairs[2 * index] = a;
-    pairs[2 * index + 1] = b;
-    return get_keys_traverse(node->rlink, index + 1, N, pairs);
+tsk_identity_segments_get_num_pairs(const tsk_identity_segments_t *self)
+{
+    return self->num_pairs;
 }
 
+/* The pairs are sorted by key (see tsk_identity_segments_sort_pairs) before
+ * the result is returned to the caller, so they are already in order here. */
 int
 tsk_identity_segments_get_keys(const tsk_identity_segments_t *self, tsk_id_t *pairs)
 {
+    tsk_size_t j;
+
     if (!self->store_pairs) {
         return TSK_ERR_IBD_PAIRS_NOT_STORED;
     }
-    get_keys_traverse(
-        tsk_avl_tree_int_get_root(&self->pair_map), 0, self->num_nodes, pairs);
-    return 0;
-}
-
-static int
-get_items_traverse(tsk_avl_node_int_t *node, int index, tsk_size_t N, tsk_id_t *pairs,
-    tsk_identity_segment_list_t **lists)
-{
-    tsk_id_t a, b;
-
-    if (node == NULL) {
-        return index;
+    for (j = 0; j < self->num_pairs; j++) {
+        integer_to_pair(
+            self->pairs[j].key, self->num_nodes, pairs + 2 * j, pairs + 2 * j + 1);
     }
-    index = get_items_traverse(node->llink, index, N, pairs, lists);
-    integer_to_pair(node->key, N, &a, &b);
-    pairs[2 * index] = a;
-    pairs[2 * index + 1] = b;
-    lists[index] = node->value;
-    return get_items_traverse(node->rlink, index + 1, N, pairs, lists);
+    return 0;
 }
 
 int
 tsk_identity_segments_get_items(const tsk_identity_segments_t *self, tsk_id_t *pairs,
     tsk_identity_segment_list_t **lists)
 {
+    tsk_size_t j;
+
     if (!self->store_pairs) {
         return TSK_ERR_IBD_PAIRS_NOT_STORED;
     }
-    get_items_traverse(
-        tsk_avl_tree_int_get_root(&self->pair_map), 0, self->num_nodes, pairs, lists);
+    for (j = 0; j < self->num_pairs; j++) {
+        integer_to_pair(
+            self->pairs[j].key, self->num_nodes, pairs + 2 * j, pairs + 2 * j + 1);
+        /* Cast away the const here as the lists are part of the public API */
+        lists[j] = (tsk_identity_segment_list_t *) &self->pairs[j].list;
+    }
     return 0;
 }
 
 int
 tsk_identity_segments_free(tsk_identity_segments_t *self)
 {
-    tsk_blkalloc_free(&self->heap);
-    tsk_avl_tree_int_free(&self->pair_map);
+    tsk_size_t j;
+
+    if (self->pairs != NULL) {
+        for (j = 0; j < self->num_pairs; j++) {
+            tsk_safe_free(self->pairs[j].list.head);
+        }
+    }
+    tsk_safe_free(self->pairs);
+    tsk_safe_free(self->pair_table);
     return 0;
 }
 
+/* Sort the pairs by key, so that get_keys and get_items return them in
+ * order. Pairs are appended in the order they are first seen, so we sort
+ * once here rather than keeping an ordered map during the search. Pair
+ * keys are non-negative, so we can reuse the radix sort for edges. */
+static int
+tsk_identity_segments_sort_pairs(tsk_identity_segments_t *self)
+{
+    int ret = 0;
+    tsk_size_t j;
+    const tsk_size_t n = self->num_pairs;
+    edge_radix_item_t *items = NULL;
+    edge_radix_item_t *buffer = NULL;
+    edge_radix_item_t *sorted;
+    tsk_size_t *count = NULL;
+    tsk_identity_pair_t *pairs = NULL;
+
+    if (n < 2) {
+        goto out;
+    }
+    items = tsk_malloc(n * sizeof(*items));
+    buffer = tsk_malloc(n * sizeof(*buffer));
+    count = tsk_malloc(TSK_EDGE_RADIX_PASSES * TSK_EDGE_RADIX_SIZE * sizeof(*count));
+    pairs = tsk_malloc(self->max_pairs * sizeof(*pairs));
+    if (items == NULL || buffer == NULL || count == NULL || pairs == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    for (j = 0; j < n; j++) {
+        items[j].key = (uint64_t) self->pairs[j].key;
+        items[j].index = j;
+    }
+    sorted = edge_radix_sort(items, buffer, n, count);
+    for (j = 0; j < n; j++) {
+        pairs[j] = self->pairs[sorted[j].index];
+    }
+    tsk_safe_free(self->pairs);
+    self->pairs = pairs;
+    pairs = NULL;
+    ret = tsk_identity_segments_rehash(self, self->pair_table_size);
+out:
+    tsk_safe_free(items);
+    tsk_safe_free(buffer);
+    tsk_safe_free(count);
+    tsk_safe_free(pairs);
+    return ret;
+}
+
+/* Returns the pair for the specified key, inserting a new pair with an empty
+ * list if we haven't seen it before. Returns NULL if out of memory.
+ * The returned pointer is invalidated by the next insertion. */
+static tsk_identity_pair_t *
+tsk_identity_segments_get_pair(tsk_identity_segments_t *self, int64_t key)
+{
+    tsk_size_t slot = tsk_identity_segments_find_slot(self, key);
+    tsk_identity_pair_t *pair;
+    void *p;
+
+    if (self->pair_table[slot] == TSK_NULL) {
+        if (self->num_pairs == self->max_pairs) {
+            self->max_pairs = TSK_MAX(1024, 2 * self->max_pairs);
+            p = tsk_realloc(self->pairs, self->max_pairs * sizeof(*self->pairs));
+            if (p == NULL) {
+                return NULL;
+            }
+            self->pairs = p;
+        }
+        pair = self->pairs + self->num_pairs;
+        tsk_memset(pair, 0, sizeof(*pair));
+        pair->key = key;
+        self->pair_table[slot] = (int64_t) self->num_pairs;
+        self->num_pairs++;
+        if (2 * self->num_pairs > self->pair_table_size) {
+            if (tsk_identity_segments_rehash(self, 2 * self->pair_table_size) != 0) {
+                return NULL;
+            }
+        }
+        return pair;
+    }
+    return self->pairs + self->pair_table[slot];
+}
+
 static int TSK_WARN_UNUSED
-tsk_identity_segments_update_pair(tsk_identity_segments_t *self, tsk_id_t a, tsk_id_t b,
-    double left, double right, tsk_id_t node)
+tsk_identity_segments_append_segment(tsk_identity_segments_t *self,
+    tsk_identity_pair_t *pair, double left, double right, tsk_id_t node)
 {
     int ret = 0;
+    tsk_identity_segment_list_t *list = &pair->list;
+    tsk_size_t j, n = list->num_segments;
     tsk_identity_segment_t *x;
-    tsk_identity_segment_list_t *list;
-    /* skip the error checking here since this an internal API */
-    int64_t key = pair_to_integer(a, b, self->num_nodes);
-    tsk_avl_node_int_t *avl_node = tsk_avl_tree_int_search(&self->pair_map, key);
 
-    if (avl_node == NULL) {
-        /* We haven't seen this pair before */
-        avl_node = tsk_identity_segments_alloc_new_pair(self, key);
-        if (avl_node == NULL) {
-            ret = TSK_ERR_NO_MEMORY;
-            goto out;
+    if (self->store_segments) {
+        tsk_bug_assert(left < right);
+        tsk_bug_assert(node >= 0 && node < (tsk_id_t) self->num_nodes);
+        if (n == pair->max_segments) {
+            pair->max_segments = TSK_MAX(1, 2 * pair->max_segments);
+            x = tsk_realloc(list->head, pair->max_segments * sizeof(*x));
+            if (x == NULL) {
+                ret = TSK_ERR_NO_MEMORY;
+                goto out;
+            }
+            /* The segments may have moved, so relink them */
+            for (j = 1; j < n; j++) {
+                x[j - 1].next = x + j;
+            }
+            list->head = x;
+        }
+        x = list->head + n;
+        x->left = left;
+        x->right = right;
+        x->node = node;
+        x->next = NULL;
+        if (n > 0) {
+            x[-1].next = x;
         }
-        ret = tsk_avl_tree_int_insert(&self->pair_map, avl_node);
-        tsk_bug_assert(ret == 0);
+        list->tail = x;
     }
-    list = (tsk_identity_segment_list_t *) avl_node->value;
     list->num_segments++;
     list->total_span += right - left;
-    if (self->store_segments) {
-        x = tsk_identity_segments_alloc_segment(self, left, right, node);
-        if (x == NULL) {
-            goto out;
-        }
-        if (list->tail == NULL) {
-            list->head = x;
-            list->tail = x;
-        } else {
-            list->tail->next = x;
-            list->tail = x;
-        }
+out:
+    return ret;
+}
+
+static int TSK_WARN_UNUSED
+tsk_identity_segments_update_pair(tsk_identity_segments_t *self, tsk_id_t a, tsk_id_t b,
+    double left, double right, tsk_id_t node)
+{
+    int ret = 0;
+    tsk_identity_pair_t *pair;
+    /* skip the error checking here since this an internal API */
+    int64_t key = pair_to_integer(a, b, self->num_nodes);
+
+    pair = tsk_identity_segments_get_pair(self, key);
+    if (pair == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
     }
+    ret = tsk_identity_segments_append_segment(self, pair, left, right, node);
 out:
     return ret;
 }
@@ -8597,13 +9940,67 @@ out:
     return ret;
 }
 
+int TSK_WARN_UNUSED
+tsk_identity_segments_merge(
+    tsk_identity_segments_t *self, const tsk_identity_segments_t *other)
+{
+    int ret = 0;
+    tsk_size_t j;
+    const tsk_identity_segment_list_t *src;
+    tsk_identity_pair_t *dest;
+    const tsk_identity_segment_t *seg;
+
+    if (self == other || self->num_nodes != other->num_nodes) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    if (self->store_pairs && !other->store_pairs) {
+        ret = TSK_ERR_IBD_PAIRS_NOT_STORED;
+        goto out;
+    }
+    if (self->store_segments && !other->store_segments) {
+        ret = TSK_ERR_IBD_SEGMENTS_NOT_STORED;
+        goto out;
+    }
+    if (self->store_pairs) {
+        for (j = 0; j < other->num_pairs; j++) {
+            src = &other->pairs[j].list;
+            dest = tsk_identity_segments_get_pair(self, other->pairs[j].key);
+            if (dest == NULL) {
+                ret = TSK_ERR_NO_MEMORY;
+                goto out;
+            }
+            if (self->store_segments) {
+                for (seg = src->head; seg != NULL; seg = seg->next) {
+                    ret = tsk_identity_segments_append_segment(
+                        self, dest, seg->left, seg->right, seg->node);
+                    if (ret != 0) {
+                        goto out;
+                    }
+                }
+            } else {
+                dest->list.num_segments += src->num_segments;
+                dest->list.total_span += src->total_span;
+            }
+        }
+        ret = tsk_identity_segments_sort_pairs(self);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    self->num_segments += other->num_segments;
+    self->total_span += other->total_span;
+out:
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_identity_segments_get(const tsk_identity_segments_t *self, tsk_id_t sample_a,
     tsk_id_t sample_b, tsk_identity_segment_list_t **ret_list)
 {
     int ret = 0;
     int64_t key = tsk_identity_segments_get_key(self, sample_a, sample_b);
-    tsk_avl_node_int_t *avl_node;
+    int64_t index;
 
     if (key < 0) {
         ret = (int) key;
@@ -8613,10 +10010,11 @@ tsk_identity_segments_get(const tsk_identity_segments_t *self, tsk_id_t sample_a
         ret = TSK_ERR_IBD_PAIRS_NOT_STORED;
         goto out;
     }
-    avl_node = tsk_avl_tree_int_search(&self->pair_map, key);
+    index = self->pair_table[tsk_identity_segments_find_slot(self, key)];
     *ret_list = NULL;
-    if (avl_node != NULL) {
-        *ret_list = (tsk_identity_segment_list_t *) avl_node->value;
+    if (index != TSK_NULL) {
+        /* Cast away the const here as the lists are part of the public API */
+        *ret_list = (tsk_identity_segment_list_t *) &self->pairs[index].list;
     }
 out:
     return ret;
@@ -8628,6 +10026,9 @@ out:
 
 typedef struct {
     tsk_identity_segments_t *result;
+    /* If set, segments are passed to this function rather than stored in result */
+    tsk_identity_segment_func_t *segment_func;
+    void *segment_func_params;
     double min_span;
     double max_time;
     const tsk_table_collection_t *tables;
@@ -8856,8 +10257,14 @@ tsk_ibd_finder_record_ibd(tsk_ibd_finder_t *self, tsk_id_t parent)
             right = TSK_MIN(seg0->right, seg1->right);
             if (tsk_ibd_finder_passes_filters(
                     self, seg0->node, seg1->node, left, right)) {
-                ret = tsk_identity_segments_add_segment(
-                    self->result, seg0->node, seg1->node, left, right, parent);
+                if (self->segment_func != NULL) {
+                    ret = self->segment_func(TSK_MIN(seg0->node, seg1->node),
+                        TSK_MAX(seg0->node, seg1->node), left, right, parent,
+                        self->segment_func_params);
+                } else {
+                    ret = tsk_identity_segments_add_segment(
+                        self->result, seg0->node, seg1->node, left, right, parent);
+                }
                 if (ret != 0) {
                     goto out;
                 }
@@ -8917,7 +10324,9 @@ tsk_ibd_finder_print_state(tsk_ibd_finder_t *self, FILE *out)
         }
         fprintf(out, "\n");
     }
-    tsk_identity_segments_print_state(self->result, out);
+    if (self->result != NULL) {
+        tsk_identity_segments_print_state(self->result, out);
+    }
 }
 
 static int TSK_WARN_UNUSED
@@ -9276,8 +10685,7 @@ simplifier_flush_edges(simplifier_t *self, tsk_id_t parent, tsk_size_t *ret_num_
     interval_list_t *x;
     tsk_size_t num_edges = 0;
 
-    qsort(self->buffered_children, (size_t) self->num_buffered_children,
-        sizeof(tsk_id_t), cmp_node_id);
+    sort_node_ids(self->buffered_children, self->num_buffered_children);
     for (j = 0; j < self->num_buffered_children; j++) {
         child = self->buffered_children[j];
         for (x = self->child_edge_map_head[child]; x != NULL; x = x->next) {
@@ -9859,12 +11267,22 @@ simplifier_extract_ancestry(
 {
     int ret = 0;
     tsk_segment_t *x = self->ancestor_map_head[input_id];
+    tsk_segment_t *tail = self->ancestor_map_tail[input_id];
     tsk_segment_t y; /* y is the segment that has been removed */
     tsk_segment_t *x_head, *x_prev, *seg_left, *seg_right;
 
     x_head = NULL;
     x_prev = NULL;
     while (x != NULL) {
+        if (x->left >= right) {
+            /* The ancestry segments are sorted and non-overlapping, so none of
+             * the remaining segments can overlap and the tail is unchanged. */
+            if (x_prev == NULL) {
+                x_head = x;
+            }
+            x_prev = tail;
+            break;
+        }
         if (x->right > left && right > x->left) {
             y.left = TSK_MAX(x->left, left);
             y.right = TSK_MIN(x->right, right);
@@ -11069,6 +12487,7 @@ tsk_table_collection_print_state(const tsk_table_collection_t *self, FILE *out)
     tsk_provenance_table_print_state(&self->provenances, out);
 }
 
+
 int TSK_WARN_UNUSED
 tsk_table_collection_init(tsk_table_collection_t *self, tsk_flags_t options)
 {
@@ -11130,6 +12549,7 @@ out:
 int
 tsk_table_collection_free(tsk_table_collection_t *self)
 {
+    tsk_table_collection_release_file_map(self);
     tsk_individual_table_free(&self->individuals);
     tsk_node_table_free(&self->nodes);
     tsk_edge_table_free(&self->edges);
@@ -11212,6 +12632,10 @@ int
 tsk_table_collection_set_metadata(
     tsk_table_collection_t *self, const char *metadata, tsk_size_t metadata_length)
 {
+    /* Metadata loaded with TSK_LOAD_MMAP is borrowed from the mapping */
+    if (tsk_table_collection_is_mapped(self, self->metadata)) {
+        self->metadata = NULL;
+    }
     return replace_string(
         &self->metadata, &self->metadata_length, metadata, metadata_length);
 }
@@ -11220,6 +12644,10 @@ int
 tsk_table_collection_takeset_metadata(
     tsk_table_collection_t *self, char *metadata, tsk_size_t metadata_length)
 {
+    /* Metadata loaded with TSK_LOAD_MMAP is borrowed from the mapping */
+    if (tsk_table_collection_is_mapped(self, self->metadata)) {
+        self->metadata = NULL;
+    }
     return takeset_string(
         &self->metadata, &self->metadata_length, metadata, metadata_length);
 }
@@ -11291,41 +12719,93 @@ int
 tsk_table_collection_drop_index(
     tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
 {
-    tsk_safe_free(self->indexes.edge_insertion_order);
-    tsk_safe_free(self->indexes.edge_removal_order);
+    /* Indexes loaded with TSK_LOAD_MMAP are borrowed from the mapping */
+    if (!tsk_table_collection_is_mapped(self, self->indexes.edge_insertion_order)) {
+        tsk_safe_free(self->indexes.edge_insertion_order);
+    }
+    if (!tsk_table_collection_is_mapped(self, self->indexes.edge_removal_order)) {
+        tsk_safe_free(self->indexes.edge_removal_order);
+    }
     self->indexes.edge_insertion_order = NULL;
     self->indexes.edge_removal_order = NULL;
     self->indexes.num_edges = 0;
     return 0;
 }
 
-int TSK_WARN_UNUSED
-tsk_table_collection_build_index(
-    tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+/* Returns true if the edges are sorted by (time[parent], parent, child, left),
+ * which is the case for the output of tsk_table_collection_sort. The edge
+ * ordering requirements only need the edges for each parent to be contiguous,
+ * not to be sorted by parent ID. */
+static bool
+tsk_table_collection_edges_sorted_by_parent(const tsk_table_collection_t *self)
 {
-    int ret = TSK_ERR_GENERIC;
-    tsk_id_t ret_id;
+    const tsk_size_t num_edges = self->edges.num_rows;
+    const tsk_id_t *restrict edge_parent = self->edges.parent;
+    const double *restrict time = self->nodes.time;
     tsk_size_t j;
-    double *time = self->nodes.time;
-    index_sort_t *sort_buff = NULL;
-    tsk_id_t parent;
 
-    /* For build indexes to make sense we must have referential integrity and
-     * sorted edges */
-    ret_id = tsk_table_collection_check_integrity(self, TSK_CHECK_EDGE_ORDERING);
-    if (ret_id != 0) {
-        ret = (int) ret_id;
+    for (j = 1; j < num_edges; j++) {
+        if (time[edge_parent[j - 1]] == time[edge_parent[j]]
+            && edge_parent[j - 1] > edge_parent[j]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* When the edges are sorted by (time[parent], parent, child, left), the
+ * insertion order is a stable sort of the edges by left, and the removal order
+ * a stable sort of the edges in reverse order by right, so we can use a radix
+ * sort on the coordinates alone. */
+static int
+tsk_table_collection_build_index_radix(tsk_table_collection_t *self)
+{
+    int ret = 0;
+    const tsk_size_t num_edges = self->edges.num_rows;
+    edge_radix_item_t *items = tsk_malloc(num_edges * sizeof(*items));
+    edge_radix_item_t *buffer = tsk_malloc(num_edges * sizeof(*buffer));
+    tsk_size_t *count
+        = tsk_malloc(TSK_EDGE_RADIX_PASSES * TSK_EDGE_RADIX_SIZE * sizeof(*count));
+    edge_radix_item_t *sorted;
+    tsk_size_t j;
+
+    if (items == NULL || buffer == NULL || count == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
+    for (j = 0; j < num_edges; j++) {
+        items[j].key = double_radix_key(self->edges.left[j]);
+        items[j].index = j;
+    }
+    sorted = edge_radix_sort(items, buffer, num_edges, count);
+    for (j = 0; j < num_edges; j++) {
+        self->indexes.edge_insertion_order[j] = (tsk_id_t) sorted[j].index;
+    }
+    for (j = 0; j < num_edges; j++) {
+        items[j].key = double_radix_key(self->edges.right[num_edges - j - 1]);
+        items[j].index = num_edges - j - 1;
+    }
+    sorted = edge_radix_sort(items, buffer, num_edges, count);
+    for (j = 0; j < num_edges; j++) {
+        self->indexes.edge_removal_order[j] = (tsk_id_t) sorted[j].index;
+    }
+out:
+    tsk_safe_free(items);
+    tsk_safe_free(buffer);
+    tsk_safe_free(count);
+    return ret;
+}
 
-    tsk_table_collection_drop_index(self, 0);
-    self->indexes.edge_insertion_order
-        = tsk_malloc(self->edges.num_rows * sizeof(tsk_id_t));
-    self->indexes.edge_removal_order
-        = tsk_malloc(self->edges.num_rows * sizeof(tsk_id_t));
-    sort_buff = tsk_malloc(self->edges.num_rows * sizeof(index_sort_t));
-    if (self->indexes.edge_insertion_order == NULL
-        || self->indexes.edge_removal_order == NULL || sort_buff == NULL) {
+static int
+tsk_table_collection_build_index_qsort(tsk_table_collection_t *self)
+{
+    int ret = 0;
+    tsk_size_t j;
+    double *time = self->nodes.time;
+    index_sort_t *sort_buff = tsk_malloc(self->edges.num_rows * sizeof(index_sort_t));
+    tsk_id_t parent;
+
+    if (sort_buff == NULL) {
         ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
@@ -11360,13 +12840,49 @@ tsk_table_collection_build_index(
     for (j = 0; j < self->edges.num_rows; j++) {
         self->indexes.edge_removal_order[j] = sort_buff[j].index;
     }
-    self->indexes.num_edges = self->edges.num_rows;
-    ret = 0;
 out:
     tsk_safe_free(sort_buff);
     return ret;
 }
 
+int TSK_WARN_UNUSED
+tsk_table_collection_build_index(
+    tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+{
+    int ret = TSK_ERR_GENERIC;
+    tsk_id_t ret_id;
+
+    /* For build indexes to make sense we must have referential integrity and
+     * sorted edges */
+    ret_id = tsk_table_collection_check_integrity(self, TSK_CHECK_EDGE_ORDERING);
+    if (ret_id != 0) {
+        ret = (int) ret_id;
+        goto out;
+    }
+
+    tsk_table_collection_drop_index(self, 0);
+    self->indexes.edge_insertion_order
+        = tsk_malloc(self->edges.num_rows * sizeof(tsk_id_t));
+    self->indexes.edge_removal_order
+        = tsk_malloc(self->edges.num_rows * sizeof(tsk_id_t));
+    if (self->indexes.edge_insertion_order == NULL
+        || self->indexes.edge_removal_order == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    if (tsk_table_collection_edges_sorted_by_parent(self)) {
+        ret = tsk_table_collection_build_index_radix(self);
+    } else {
+        ret = tsk_table_collection_build_index_qsort(self);
+    }
+    if (ret != 0) {
+        goto out;
+    }
+    self->indexes.num_edges = self->edges.num_rows;
+out:
+    return ret;
+}
+
 static int TSK_WARN_UNUSED
 tsk_table_collection_set_file_uuid(tsk_table_collection_t *self, const char *uuid)
 {
@@ -11479,7 +12995,8 @@ out:
 }
 
 static int TSK_WARN_UNUSED
-tsk_table_collection_read_format_data(tsk_table_collection_t *self, kastore_t *store)
+tsk_table_collection_read_format_data(
+    tsk_table_collection_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     size_t len;
@@ -11575,6 +13092,11 @@ tsk_table_collection_read_format_data(tsk_table_collection_t *self, kastore_t *s
             goto out;
         }
     }
+    if (options & TSK_LOAD_SKIP_METADATA) {
+        /* The remaining items are the top-level metadata and schema */
+        ret = 0;
+        goto out;
+    }
     ret = kastore_containss(store, "metadata");
     if (ret < 0) {
         ret = tsk_set_kas_error(ret);
@@ -11618,13 +13140,13 @@ out:
     if ((ret ^ (1 << TSK_KAS_ERR_BIT)) == KAS_ERR_KEY_NOT_FOUND) {
         ret = TSK_ERR_REQUIRED_COL_NOT_FOUND;
     }
-    tsk_safe_free(version);
-    tsk_safe_free(format_name);
-    tsk_safe_free(uuid);
-    tsk_safe_free(L);
-    tsk_safe_free(time_units);
-    tsk_safe_free(metadata_schema);
-    tsk_safe_free(metadata);
+    free_store_array(store, (void **) &version);
+    free_store_array(store, (void **) &format_name);
+    free_store_array(store, (void **) &uuid);
+    free_store_array(store, (void **) &L);
+    free_store_array(store, (void **) &time_units);
+    free_store_array(store, (void **) &metadata_schema);
+    free_store_array(store, (void **) &metadata);
     return ret;
 }
 
@@ -11689,14 +13211,14 @@ tsk_table_collection_load_indexes(tsk_table_collection_t *self, kastore_t *store
     edge_insertion_order = NULL;
     edge_removal_order = NULL;
 out:
-    tsk_safe_free(edge_insertion_order);
-    tsk_safe_free(edge_removal_order);
+    free_store_array(store, (void **) &edge_insertion_order);
+    free_store_array(store, (void **) &edge_removal_order);
     return ret;
 }
 
 static int
 tsk_table_collection_load_reference_sequence(
-    tsk_table_collection_t *self, kastore_t *store)
+    tsk_table_collection_t *self, kastore_t *store, tsk_flags_t options)
 {
     int ret = 0;
     char *data = NULL;
@@ -11711,13 +13233,14 @@ tsk_table_collection_load_reference_sequence(
         { "reference_sequence/url", (void **) &url, &url_length, KAS_UINT8,
             TSK_COL_OPTIONAL },
         { "reference_sequence/metadata", (void **) &metadata, &metadata_length,
-            KAS_UINT8, TSK_COL_OPTIONAL },
+            KAS_UINT8, TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { "reference_sequence/metadata_schema", (void **) &metadata_schema,
-            &metadata_schema_length, KAS_UINT8, TSK_COL_OPTIONAL },
+            &metadata_schema_length, KAS_UINT8,
+            TSK_COL_OPTIONAL | TSK_COL_METADATA },
         { .name = NULL },
     };
 
-    ret = read_table_properties(store, properties, 0);
+    ret = read_table_properties(store, properties, options);
     if (ret != 0) {
         goto out;
     }
@@ -11753,23 +13276,49 @@ tsk_table_collection_load_reference_sequence(
     }
 
 out:
-    free_read_table_mem(NULL, NULL, properties);
+    free_read_table_mem(store, NULL, NULL, properties);
     return ret;
 }
 
+/* The item arrays of a mapped store point into the table collection's file
+ * mapping, and so must be detached before the store is closed. */
+static void
+detach_mapped_store_arrays(kastore_t *store)
+{
+    size_t j;
+
+    for (j = 0; j < store->num_items; j++) {
+        store->items[j].array = NULL;
+    }
+}
+
 static int TSK_WARN_UNUSED
 tsk_table_collection_loadf_inited(
     tsk_table_collection_t *self, FILE *file, tsk_flags_t options)
 {
     int ret = 0;
     kastore_t store;
+    bool mmap_store = !!(options & TSK_LOAD_MMAP);
+    long store_offset;
 
+    /* If we're not reading everything, we only read the arrays we need
+     * from the file on demand */
     int kas_flags = KAS_READ_ALL;
-    if ((options & TSK_LOAD_SKIP_TABLES)
-        || (options & TSK_LOAD_SKIP_REFERENCE_SEQUENCE)) {
+
+    TSK_TIMER_START(load_time);
+    if ((options & TSK_LOAD_PARTIAL_MASK) || mmap_store) {
         kas_flags = 0;
     }
-    kas_flags = kas_flags | KAS_GET_TAKES_OWNERSHIP;
+    if (mmap_store) {
+        ret = check_file_mappable(file);
+        if (ret != 0) {
+            /* Make sure the store is safe to close */
+            tsk_memset(&store, 0, sizeof(store));
+            goto out;
+        }
+    } else {
+        kas_flags = kas_flags | KAS_GET_TAKES_OWNERSHIP;
+    }
     ret = kastore_openf(&store, file, "r", kas_flags);
 
     if (ret != 0) {
@@ -11784,42 +13333,76 @@ tsk_table_collection_loadf_inited(
         }
         goto out;
     }
-    ret = tsk_table_collection_read_format_data(self, &store);
+    TSK_COUNTER_ADD(bytes_read, store.file_size);
+    if (mmap_store) {
+        ret = tsk_table_collection_map_store(self, &store);
+        if (ret != 0) {
+            goto out;
+        }
+        if (self->file_map.addr == NULL) {
+            /* The columns would be misaligned in the mapping, so go back to the
+             * start of the store and read it normally. We read the whole store
+             * even for partial loads, so that the file is left at the end of
+             * the store and streaming works as it does for mapped stores. */
+            mmap_store = false;
+            store_offset = store.file_offset;
+            kastore_close(&store);
+            if (fseek(file, store_offset, SEEK_SET) != 0) {
+                ret = TSK_ERR_IO;
+                goto out;
+            }
+            ret = kastore_openf(
+                &store, file, "r", KAS_READ_ALL | KAS_GET_TAKES_OWNERSHIP);
+            if (ret != 0) {
+                ret = tsk_set_kas_error(ret);
+                goto out;
+            }
+        }
+    }
+    ret = tsk_table_collection_read_format_data(self, &store, options);
     if (ret != 0) {
         goto out;
     }
     if (!(options & TSK_LOAD_SKIP_TABLES)) {
-        ret = tsk_node_table_load(&self->nodes, &store);
-        if (ret != 0) {
-            goto out;
-        }
-        ret = tsk_edge_table_load(&self->edges, &store);
+        ret = tsk_node_table_load(&self->nodes, &store, options);
         if (ret != 0) {
             goto out;
         }
-        ret = tsk_site_table_load(&self->sites, &store);
+        ret = tsk_edge_table_load(&self->edges, &store, options);
         if (ret != 0) {
             goto out;
         }
-        ret = tsk_mutation_table_load(&self->mutations, &store);
-        if (ret != 0) {
-            goto out;
+        if (!(options & TSK_LOAD_SKIP_SITES)) {
+            ret = tsk_site_table_load(&self->sites, &store, options);
+            if (ret != 0) {
+                goto out;
+            }
+            if (!(options & TSK_LOAD_SKIP_MUTATIONS)) {
+                ret = tsk_mutation_table_load(&self->mutations, &store, options);
+                if (ret != 0) {
+                    goto out;
+                }
+            }
         }
-        ret = tsk_migration_table_load(&self->migrations, &store);
-        if (ret != 0) {
-            goto out;
+        if (!(options & TSK_LOAD_SKIP_MIGRATIONS)) {
+            ret = tsk_migration_table_load(&self->migrations, &store, options);
+            if (ret != 0) {
+                goto out;
+            }
         }
-        ret = tsk_individual_table_load(&self->individuals, &store);
+        ret = tsk_individual_table_load(&self->individuals, &store, options);
         if (ret != 0) {
             goto out;
         }
-        ret = tsk_population_table_load(&self->populations, &store);
+        ret = tsk_population_table_load(&self->populations, &store, options);
         if (ret != 0) {
             goto out;
         }
-        ret = tsk_provenance_table_load(&self->provenances, &store);
-        if (ret != 0) {
-            goto out;
+        if (!(options & TSK_LOAD_SKIP_PROVENANCES)) {
+            ret = tsk_provenance_table_load(&self->provenances, &store, options);
+            if (ret != 0) {
+                goto out;
+            }
         }
         ret = tsk_table_collection_load_indexes(self, &store);
         if (ret != 0) {
@@ -11832,11 +13415,15 @@ tsk_table_collection_loadf_inited(
         }
     }
     if (!(options & TSK_LOAD_SKIP_REFERENCE_SEQUENCE)) {
-        ret = tsk_table_collection_load_reference_sequence(self, &store);
+        ret = tsk_table_collection_load_reference_sequence(self, &store, options);
         if (ret != 0) {
             goto out;
         }
     }
+    if (mmap_store) {
+        detach_mapped_store_arrays(&store);
+        tsk_table_collection_set_mapped(self, true);
+    }
     ret = kastore_close(&store);
     if (ret != 0) {
         goto out;
@@ -11845,7 +13432,11 @@ out:
     /* If we're exiting on an error, we ignore any further errors that might come
      * from kastore. In the nominal case, closing an already-closed store is a
      * safe noop */
+    if (mmap_store) {
+        detach_mapped_store_arrays(&store);
+    }
     kastore_close(&store);
+    TSK_TIMER_STOP(load_time);
     return ret;
 }
 
@@ -11963,13 +13554,14 @@ tsk_table_collection_dumpf(
     int ret = 0;
     kastore_t store;
     char uuid[TSK_UUID_SIZE + 1]; // Must include space for trailing null.
+    const uint32_t format_version[] = { TSK_FILE_FORMAT_VERSION_MAJOR,
+        (options & TSK_DUMP_COMPRESS_OFFSETS)
+            ? TSK_FILE_FORMAT_VERSION_MINOR_COMPRESSED_OFFSETS
+            : TSK_FILE_FORMAT_VERSION_MINOR };
     write_table_col_t format_columns[] = {
         { "format/name", (const void *) &TSK_FILE_FORMAT_NAME,
             TSK_FILE_FORMAT_NAME_LENGTH, KAS_INT8 },
-        { "format/version",
-            (const void *) &(uint32_t[]){
-                TSK_FILE_FORMAT_VERSION_MAJOR, TSK_FILE_FORMAT_VERSION_MINOR },
-            2, KAS_UINT32 },
+        { "format/version", (const void *) format_version, 2, KAS_UINT32 },
         { "sequence_length", (const void *) &self->sequence_length, 1, KAS_FLOAT64 },
         { "uuid", (void *) uuid, TSK_UUID_SIZE, KAS_INT8 },
         { "time_units", (void *) self->time_units, self->time_units_length, KAS_INT8 },
@@ -11979,6 +13571,12 @@ tsk_table_collection_dumpf(
         { .name = NULL },
     };
 
+#ifdef TSK_INSTRUMENT
+    /* This is -1 if the file isn't seekable, in which case we don't count it */
+    long start_offset = ftell(file);
+#endif
+
+    TSK_TIMER_START(dump_time);
     tsk_memset(&store, 0, sizeof(store));
 
     ret = kastore_openf(&store, file, "w", 0);
@@ -12046,11 +13644,17 @@ tsk_table_collection_dumpf(
         ret = tsk_set_kas_error(ret);
         goto out;
     }
+#ifdef TSK_INSTRUMENT
+    if (start_offset >= 0) {
+        TSK_COUNTER_ADD(bytes_written, ftell(file) - start_offset);
+    }
+#endif
 out:
     /* It's safe to close a kastore twice. */
     if (ret != 0) {
         kastore_close(&store);
     }
+    TSK_TIMER_STOP(dump_time);
     return ret;
 }
 
@@ -12063,9 +13667,14 @@ tsk_table_collection_simplify(tsk_table_collection_t *self, const tsk_id_t *samp
     tsk_id_t *local_samples = NULL;
     tsk_id_t u;
 
+    TSK_TIMER_START(simplify_time);
     /* Avoid calling to simplifier_free with uninit'd memory on error branches */
     tsk_memset(&simplifier, 0, sizeof(simplifier_t));
 
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
     if ((options & TSK_SIMPLIFY_KEEP_UNARY)
         && (options & TSK_SIMPLIFY_KEEP_UNARY_IN_INDIVIDUALS)) {
         ret = TSK_ERR_KEEP_UNARY_MUTUALLY_EXCLUSIVE;
@@ -12111,6 +13720,7 @@ tsk_table_collection_simplify(tsk_table_collection_t *self, const tsk_id_t *samp
 out:
     simplifier_free(&simplifier);
     tsk_safe_free(local_samples);
+    TSK_TIMER_STOP(simplify_time);
     return ret;
 }
 
@@ -12167,6 +13777,10 @@ tsk_table_collection_ibd_within(const tsk_table_collection_t *self,
     if (ret != 0) {
         goto out;
     }
+    ret = tsk_identity_segments_sort_pairs(result);
+    if (ret != 0) {
+        goto out;
+    }
     if (!!(options & TSK_DEBUG)) {
         tsk_ibd_finder_print_state(&ibd_finder, tsk_get_debug_stream());
     }
@@ -12201,6 +13815,80 @@ tsk_table_collection_ibd_between(const tsk_table_collection_t *self,
     if (ret != 0) {
         goto out;
     }
+    ret = tsk_identity_segments_sort_pairs(result);
+    if (ret != 0) {
+        goto out;
+    }
+    if (!!(options & TSK_DEBUG)) {
+        tsk_ibd_finder_print_state(&ibd_finder, tsk_get_debug_stream());
+    }
+out:
+    tsk_ibd_finder_free(&ibd_finder);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_ibd_within_stream(const tsk_table_collection_t *self,
+    const tsk_id_t *samples, tsk_size_t num_samples, double min_span, double max_time,
+    tsk_identity_segment_func_t *f, void *f_params, tsk_flags_t options)
+{
+    int ret = 0;
+    tsk_ibd_finder_t ibd_finder;
+
+    ret = tsk_ibd_finder_init(&ibd_finder, self, NULL, min_span, max_time);
+    if (ret != 0) {
+        goto out;
+    }
+    if (f == NULL) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    ibd_finder.segment_func = f;
+    ibd_finder.segment_func_params = f_params;
+    ret = tsk_ibd_finder_init_within(&ibd_finder, samples, num_samples);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_ibd_finder_run(&ibd_finder);
+    if (ret != 0) {
+        goto out;
+    }
+    if (!!(options & TSK_DEBUG)) {
+        tsk_ibd_finder_print_state(&ibd_finder, tsk_get_debug_stream());
+    }
+out:
+    tsk_ibd_finder_free(&ibd_finder);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_ibd_between_stream(const tsk_table_collection_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, double min_span, double max_time,
+    tsk_identity_segment_func_t *f, void *f_params, tsk_flags_t options)
+{
+    int ret = 0;
+    tsk_ibd_finder_t ibd_finder;
+
+    ret = tsk_ibd_finder_init(&ibd_finder, self, NULL, min_span, max_time);
+    if (ret != 0) {
+        goto out;
+    }
+    if (f == NULL) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    ibd_finder.segment_func = f;
+    ibd_finder.segment_func_params = f_params;
+    ret = tsk_ibd_finder_init_between(
+        &ibd_finder, num_sample_sets, sample_set_sizes, sample_sets);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_ibd_finder_run(&ibd_finder);
+    if (ret != 0) {
+        goto out;
+    }
     if (!!(options & TSK_DEBUG)) {
         tsk_ibd_finder_print_state(&ibd_finder, tsk_get_debug_stream());
     }
@@ -12216,6 +13904,7 @@ tsk_table_collection_sort(
     int ret = 0;
     tsk_table_sorter_t sorter;
 
+    TSK_TIMER_START(sort_time);
     ret = tsk_table_sorter_init(&sorter, self, options);
     if (ret != 0) {
         goto out;
@@ -12226,6 +13915,7 @@ tsk_table_collection_sort(
     }
 out:
     tsk_table_sorter_free(&sorter);
+    TSK_TIMER_STOP(sort_time);
     return ret;
 }
 
@@ -12267,6 +13957,173 @@ out:
     return ret;
 }
 
+/* Compute a preorder of the graph defined by the edges, starting from the
+ * oldest nodes. Each node appears immediately after the first of its
+ * parents to be visited, if any, so that nodes that are close to each
+ * other in the trees tend to be close to each other in the node table. */
+static int
+tsk_table_collection_get_node_preorder(
+    const tsk_table_collection_t *self, tsk_id_t *order)
+{
+    int ret = 0;
+    const tsk_size_t num_nodes = self->nodes.num_rows;
+    const tsk_size_t num_edges = self->edges.num_rows;
+    const tsk_id_t *restrict edge_parent = self->edges.parent;
+    const tsk_id_t *restrict edge_child = self->edges.child;
+    tsk_size_t j, k, num_ordered, stack_top;
+    tsk_id_t u;
+    index_sort_t *sort_buff = tsk_malloc(num_nodes * sizeof(*sort_buff));
+    tsk_size_t *child_offset = tsk_calloc(num_nodes + 1, sizeof(*child_offset));
+    tsk_id_t *children = tsk_malloc(num_edges * sizeof(*children));
+    tsk_id_t *stack = tsk_malloc((num_edges + 1) * sizeof(*stack));
+    bool *visited = tsk_calloc(num_nodes, sizeof(*visited));
+
+    if (sort_buff == NULL || child_offset == NULL || children == NULL || stack == NULL
+        || visited == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    /* Group the children of each parent, in edge table order */
+    for (j = 0; j < num_edges; j++) {
+        child_offset[edge_parent[j] + 1]++;
+    }
+    for (j = 0; j < num_nodes; j++) {
+        child_offset[j + 1] += child_offset[j];
+    }
+    for (j = 0; j < num_edges; j++) {
+        u = edge_parent[j];
+        children[child_offset[u]] = edge_child[j];
+        child_offset[u]++;
+    }
+    for (j = num_nodes; j > 0; j--) {
+        child_offset[j] = child_offset[j - 1];
+    }
+    child_offset[0] = 0;
+
+    /* Start from the oldest nodes, breaking ties by ID */
+    for (j = 0; j < num_nodes; j++) {
+        sort_buff[j].index = (tsk_id_t) j;
+        sort_buff[j].first = -self->nodes.time[j];
+        sort_buff[j].second = 0;
+        sort_buff[j].third = (tsk_id_t) j;
+        sort_buff[j].fourth = 0;
+    }
+    qsort(sort_buff, (size_t) num_nodes, sizeof(*sort_buff), cmp_index_sort);
+
+    num_ordered = 0;
+    for (j = 0; j < num_nodes; j++) {
+        if (visited[sort_buff[j].index]) {
+            continue;
+        }
+        /* Every node pushes each of its children once, when it is visited,
+         * so the stack holds at most num_edges + 1 nodes. */
+        stack[0] = sort_buff[j].index;
+        stack_top = 1;
+        while (stack_top > 0) {
+            stack_top--;
+            u = stack[stack_top];
+            if (visited[u]) {
+                continue;
+            }
+            visited[u] = true;
+            order[num_ordered] = u;
+            num_ordered++;
+            /* Push in reverse so that the first child is visited first */
+            for (k = child_offset[u + 1]; k > child_offset[u]; k--) {
+                if (!visited[children[k - 1]]) {
+                    stack[stack_top] = children[k - 1];
+                    stack_top++;
+                }
+            }
+        }
+    }
+    tsk_bug_assert(num_ordered == num_nodes);
+out:
+    tsk_safe_free(sort_buff);
+    tsk_safe_free(child_offset);
+    tsk_safe_free(children);
+    tsk_safe_free(stack);
+    tsk_safe_free(visited);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_renumber_nodes(
+    tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options), tsk_id_t *node_map)
+{
+    int ret = 0;
+    tsk_id_t ret_id;
+    tsk_size_t j;
+    tsk_node_t node;
+    tsk_node_table_t nodes;
+    tsk_id_t *order = NULL;
+    tsk_id_t *local_node_map = NULL;
+
+    tsk_memset(&nodes, 0, sizeof(nodes));
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
+    /* Not calling TSK_CHECK_TREES so casting to int is safe */
+    ret = (int) tsk_table_collection_check_integrity(self, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    order = tsk_malloc(self->nodes.num_rows * sizeof(*order));
+    local_node_map = tsk_malloc(self->nodes.num_rows * sizeof(*local_node_map));
+    if (order == NULL || local_node_map == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    ret = tsk_table_collection_get_node_preorder(self, order);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_node_table_copy(&self->nodes, &nodes, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_node_table_clear(&self->nodes);
+    if (ret != 0) {
+        goto out;
+    }
+    for (j = 0; j < nodes.num_rows; j++) {
+        tsk_node_table_get_row_unsafe(&nodes, order[j], &node);
+        ret_id = tsk_node_table_add_row(&self->nodes, node.flags, node.time,
+            node.population, node.individual, node.metadata, node.metadata_length);
+        if (ret_id < 0) {
+            ret = (int) ret_id;
+            goto out;
+        }
+        local_node_map[order[j]] = ret_id;
+    }
+
+    for (j = 0; j < self->edges.num_rows; j++) {
+        self->edges.parent[j] = local_node_map[self->edges.parent[j]];
+        self->edges.child[j] = local_node_map[self->edges.child[j]];
+    }
+    for (j = 0; j < self->migrations.num_rows; j++) {
+        self->migrations.node[j] = local_node_map[self->migrations.node[j]];
+    }
+    for (j = 0; j < self->mutations.num_rows; j++) {
+        self->mutations.node[j] = local_node_map[self->mutations.node[j]];
+    }
+    /* The edge order depends on the parent and child IDs, and this also
+     * drops the (now invalid) edge indexes */
+    ret = tsk_table_collection_sort(self, NULL, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (node_map != NULL) {
+        tsk_memcpy(node_map, local_node_map, nodes.num_rows * sizeof(*node_map));
+    }
+out:
+    tsk_node_table_free(&nodes);
+    tsk_safe_free(order);
+    tsk_safe_free(local_node_map);
+    return ret;
+}
+
 /*
  * Remove any sites with duplicate positions, retaining only the *first*
  * one. Assumes the tables have been sorted, throwing an error if not.
@@ -12294,6 +14151,10 @@ tsk_table_collection_deduplicate_sites(
     if (ret != 0) {
         goto out;
     }
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
     ret_id = tsk_table_collection_check_integrity(self, TSK_CHECK_SITE_ORDERING);
     if (ret_id != 0) {
         ret = (int) ret_id;
@@ -12341,9 +14202,107 @@ out:
     return ret;
 }
 
+/* Sets up the parent array for the tree at position x using the edge indexes,
+ * and returns the positions in the insertion and removal orders of the first
+ * edges to be inserted and removed to the right of x. The parent array must
+ * be filled with TSK_NULL on entry. The cost is O(num_edges) wherever x is,
+ * so chunks of the genome can be processed independently without sweeping
+ * through all the trees to their left. */
+static void
+tsk_table_collection_seek_parent_array(const tsk_table_collection_t *self, double x,
+    tsk_id_t *restrict parent, tsk_id_t *tj_out, tsk_id_t *tk_out)
+{
+    const tsk_edge_table_t edges = self->edges;
+    const tsk_id_t *restrict I = self->indexes.edge_insertion_order;
+    const tsk_id_t *restrict O = self->indexes.edge_removal_order;
+    const tsk_id_t M = (tsk_id_t) edges.num_rows;
+    tsk_id_t e, lower, upper, mid;
+
+    for (e = 0; e < M; e++) {
+        if (edges.left[e] <= x && x < edges.right[e]) {
+            parent[edges.child[e]] = edges.parent[e];
+        }
+    }
+    /* The insertion order is sorted by left coordinate, so find the first
+     * edge with left > x */
+    lower = 0;
+    upper = M;
+    while (lower < upper) {
+        mid = lower + (upper - lower) / 2;
+        if (edges.left[I[mid]] <= x) {
+            lower = mid + 1;
+        } else {
+            upper = mid;
+        }
+    }
+    *tj_out = lower;
+    /* Likewise, the removal order is sorted by right coordinate */
+    lower = 0;
+    upper = M;
+    while (lower < upper) {
+        mid = lower + (upper - lower) / 2;
+        if (edges.right[O[mid]] <= x) {
+            lower = mid + 1;
+        } else {
+            upper = mid;
+        }
+    }
+    *tk_out = lower;
+}
+
+/* Returns the first site with position >= x, and the first mutation at or
+ * after that site. */
+static tsk_size_t
+tsk_table_collection_seek_site_mutations(
+    const tsk_table_collection_t *self, double x, tsk_id_t *site_out)
+{
+    const tsk_id_t *restrict mutation_site = self->mutations.site;
+    const tsk_id_t site = (tsk_id_t) tsk_search_sorted(
+        self->sites.position, self->sites.num_rows, x);
+    tsk_size_t lower = 0;
+    tsk_size_t upper = self->mutations.num_rows;
+    tsk_size_t mid;
+
+    while (lower < upper) {
+        mid = lower + (upper - lower) / 2;
+        if (mutation_site[mid] < site) {
+            lower = mid + 1;
+        } else {
+            upper = mid;
+        }
+    }
+    *site_out = site;
+    return lower;
+}
+
+static int
+tsk_table_collection_check_mutation_interval(
+    const tsk_table_collection_t *self, double left, double right)
+{
+    int ret = 0;
+
+    /* Copying the tables out of a file mapping here would race with the
+     * other intervals, so this must be done before the work is split up */
+    if (self->mutations.mapped) {
+        ret = TSK_ERR_TABLE_MAPPED;
+        goto out;
+    }
+    if (!tsk_table_collection_has_index(self, 0)) {
+        ret = TSK_ERR_TABLES_NOT_INDEXED;
+        goto out;
+    }
+    if (!(0 <= left && left < right && right <= self->sequence_length)) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+out:
+    return ret;
+}
+
 int TSK_WARN_UNUSED
-tsk_table_collection_compute_mutation_parents(
-    tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+tsk_table_collection_compute_mutation_parents_interval(
+    tsk_table_collection_t *self, double interval_left, double interval_right,
+    tsk_flags_t options)
 {
     int ret = 0;
     tsk_id_t num_trees;
@@ -12358,18 +14317,30 @@ tsk_table_collection_compute_mutation_parents(
     tsk_id_t *bottom_mutation = NULL;
     tsk_id_t u;
     double left, right;
-    tsk_id_t site;
+    tsk_id_t site, end_site;
     /* Using unsigned values here avoids potentially undefined behaviour */
-    tsk_size_t j, mutation, first_mutation;
+    tsk_size_t j, mutation, first_mutation, end_mutation;
 
-    /* Set the mutation parent to TSK_NULL so that we don't check the
-     * parent values we are about to write over. */
-    tsk_memset(mutations.parent, 0xff, mutations.num_rows * sizeof(*mutations.parent));
-    num_trees = tsk_table_collection_check_integrity(self, TSK_CHECK_TREES);
-    if (num_trees < 0) {
-        ret = (int) num_trees;
+    ret = tsk_table_collection_check_mutation_interval(
+        self, interval_left, interval_right);
+    if (ret != 0) {
         goto out;
     }
+    mutation = tsk_table_collection_seek_site_mutations(self, interval_left, &site);
+    end_mutation
+        = tsk_table_collection_seek_site_mutations(self, interval_right, &end_site);
+    /* Set the mutation parents in the interval to TSK_NULL so that we don't
+     * check the parent values we are about to write over. */
+    for (j = mutation; j < end_mutation; j++) {
+        mutations.parent[j] = TSK_NULL;
+    }
+    if (!(options & TSK_NO_CHECK_INTEGRITY)) {
+        num_trees = tsk_table_collection_check_integrity(self, TSK_CHECK_TREES);
+        if (num_trees < 0) {
+            ret = (int) num_trees;
+            goto out;
+        }
+    }
     parent = tsk_malloc(nodes.num_rows * sizeof(*parent));
     bottom_mutation = tsk_malloc(nodes.num_rows * sizeof(*bottom_mutation));
     if (parent == NULL || bottom_mutation == NULL) {
@@ -12378,16 +14349,12 @@ tsk_table_collection_compute_mutation_parents(
     }
     tsk_memset(parent, 0xff, nodes.num_rows * sizeof(*parent));
     tsk_memset(bottom_mutation, 0xff, nodes.num_rows * sizeof(*bottom_mutation));
-    tsk_memset(mutations.parent, 0xff, self->mutations.num_rows * sizeof(tsk_id_t));
 
     I = self->indexes.edge_insertion_order;
     O = self->indexes.edge_removal_order;
-    tj = 0;
-    tk = 0;
-    site = 0;
-    mutation = 0;
-    left = 0;
-    while (tj < M || left < self->sequence_length) {
+    tsk_table_collection_seek_parent_array(self, interval_left, parent, &tj, &tk);
+    left = interval_left;
+    while (left < interval_right) {
         while (tk < M && edges.right[O[tk]] == left) {
             parent[edges.child[O[tk]]] = TSK_NULL;
             tk++;
@@ -12396,7 +14363,7 @@ tsk_table_collection_compute_mutation_parents(
             parent[edges.child[I[tj]]] = edges.parent[I[tj]];
             tj++;
         }
-        right = self->sequence_length;
+        right = interval_right;
         if (tj < M) {
             right = TSK_MIN(right, edges.left[I[tj]]);
         }
@@ -12458,8 +14425,35 @@ out:
 }
 
 int TSK_WARN_UNUSED
-tsk_table_collection_compute_mutation_times(
-    tsk_table_collection_t *self, double *random, tsk_flags_t TSK_UNUSED(options))
+tsk_table_collection_compute_mutation_parents(
+    tsk_table_collection_t *self, tsk_flags_t TSK_UNUSED(options))
+{
+    int ret = 0;
+    tsk_id_t num_trees;
+
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
+    /* Set the mutation parent to TSK_NULL so that we don't check the
+     * parent values we are about to write over. */
+    tsk_memset(self->mutations.parent, 0xff,
+        self->mutations.num_rows * sizeof(*self->mutations.parent));
+    num_trees = tsk_table_collection_check_integrity(self, TSK_CHECK_TREES);
+    if (num_trees < 0) {
+        ret = (int) num_trees;
+        goto out;
+    }
+    ret = tsk_table_collection_compute_mutation_parents_interval(
+        self, 0, self->sequence_length, TSK_NO_CHECK_INTEGRITY);
+out:
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_compute_mutation_times_interval(
+    tsk_table_collection_t *self, double *random, double interval_left,
+    double interval_right, tsk_flags_t options)
 {
     int ret = 0;
     tsk_id_t num_trees;
@@ -12476,26 +14470,35 @@ tsk_table_collection_compute_mutation_times(
     double *denominator = NULL;
     tsk_id_t u;
     double left, right, parent_time;
-    tsk_id_t site;
+    tsk_id_t site, end_site;
     /* Using unsigned values here avoids potentially undefined behaviour */
-    tsk_size_t j, mutation, first_mutation;
-    tsk_bookmark_t skip_edges = { 0, 0, self->edges.num_rows, 0, 0, 0, 0, 0 };
+    tsk_size_t j, mutation, first_mutation, end_mutation;
 
     /* The random param is for future usage */
     if (random != NULL) {
         ret = TSK_ERR_BAD_PARAM_VALUE;
         goto out;
     }
-
-    /* First set the times to TSK_UNKNOWN_TIME so that check will succeed */
-    for (j = 0; j < mutations.num_rows; j++) {
-        mutations.time[j] = TSK_UNKNOWN_TIME;
-    }
-    num_trees = tsk_table_collection_check_integrity(self, TSK_CHECK_TREES);
-    if (num_trees < 0) {
-        ret = (int) num_trees;
+    ret = tsk_table_collection_check_mutation_interval(
+        self, interval_left, interval_right);
+    if (ret != 0) {
         goto out;
     }
+    mutation = tsk_table_collection_seek_site_mutations(self, interval_left, &site);
+    end_mutation
+        = tsk_table_collection_seek_site_mutations(self, interval_right, &end_site);
+    /* First set the times in the interval to TSK_UNKNOWN_TIME so that check
+     * will succeed */
+    for (j = mutation; j < end_mutation; j++) {
+        mutations.time[j] = TSK_UNKNOWN_TIME;
+    }
+    if (!(options & TSK_NO_CHECK_INTEGRITY)) {
+        num_trees = tsk_table_collection_check_integrity(self, TSK_CHECK_TREES);
+        if (num_trees < 0) {
+            ret = (int) num_trees;
+            goto out;
+        }
+    }
     parent = tsk_malloc(nodes.num_rows * sizeof(*parent));
     numerator = tsk_malloc(nodes.num_rows * sizeof(*numerator));
     denominator = tsk_malloc(nodes.num_rows * sizeof(*denominator));
@@ -12507,12 +14510,9 @@ tsk_table_collection_compute_mutation_times(
     tsk_memset(numerator, 0, nodes.num_rows * sizeof(*numerator));
     tsk_memset(denominator, 0, nodes.num_rows * sizeof(*denominator));
 
-    tj = 0;
-    tk = 0;
-    site = 0;
-    mutation = 0;
-    left = 0;
-    while (tj < M || left < self->sequence_length) {
+    tsk_table_collection_seek_parent_array(self, interval_left, parent, &tj, &tk);
+    left = interval_left;
+    while (left < interval_right) {
         while (tk < M && edges.right[O[tk]] == left) {
             parent[edges.child[O[tk]]] = TSK_NULL;
             tk++;
@@ -12521,7 +14521,7 @@ tsk_table_collection_compute_mutation_times(
             parent[edges.child[I[tj]]] = edges.parent[I[tj]];
             tj++;
         }
-        right = self->sequence_length;
+        right = interval_right;
         if (tj < M) {
             right = TSK_MIN(right, edges.left[I[tj]]);
         }
@@ -12566,6 +14566,47 @@ tsk_table_collection_compute_mutation_times(
         left = right;
     }
 
+out:
+    tsk_safe_free(parent);
+    tsk_safe_free(numerator);
+    tsk_safe_free(denominator);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_table_collection_compute_mutation_times(
+    tsk_table_collection_t *self, double *random, tsk_flags_t TSK_UNUSED(options))
+{
+    int ret = 0;
+    tsk_id_t num_trees;
+    tsk_size_t j;
+    tsk_bookmark_t skip_edges = { 0, 0, self->edges.num_rows, 0, 0, 0, 0, 0 };
+
+    /* The random param is for future usage */
+    if (random != NULL) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
+    /* First set the times to TSK_UNKNOWN_TIME so that check will succeed */
+    for (j = 0; j < self->mutations.num_rows; j++) {
+        self->mutations.time[j] = TSK_UNKNOWN_TIME;
+    }
+    num_trees = tsk_table_collection_check_integrity(self, TSK_CHECK_TREES);
+    if (num_trees < 0) {
+        ret = (int) num_trees;
+        goto out;
+    }
+    ret = tsk_table_collection_compute_mutation_times_interval(
+        self, random, 0, self->sequence_length, TSK_NO_CHECK_INTEGRITY);
+    if (ret != 0) {
+        goto out;
+    }
+
     /* Now that mutations have times their sort order may have been invalidated, so
      * re-sort. Safe to cast the result to an int here because we're not counting
      * trees. */
@@ -12580,9 +14621,6 @@ tsk_table_collection_compute_mutation_times(
     }
 
 out:
-    tsk_safe_free(parent);
-    tsk_safe_free(numerator);
-    tsk_safe_free(denominator);
     return ret;
 }
 
@@ -12597,7 +14635,7 @@ tsk_table_collection_delete_older(
     tsk_edge_table_t edges;
     tsk_mutation_table_t mutations;
     tsk_migration_table_t migrations;
-    const double *restrict node_time = self->nodes.time;
+    const double *restrict node_time;
     tsk_id_t j, ret_id, parent;
     double mutation_time;
     tsk_id_t *mutation_map = NULL;
@@ -12606,6 +14644,11 @@ tsk_table_collection_delete_older(
     memset(&mutations, 0, sizeof(mutations));
     memset(&migrations, 0, sizeof(migrations));
 
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
+    node_time = self->nodes.time;
     ret = tsk_edge_table_copy(&self->edges, &edges, 0);
     if (ret != 0) {
         goto out;
@@ -12716,6 +14759,10 @@ tsk_table_collection_truncate(tsk_table_collection_t *tables, tsk_bookmark_t *po
 {
     int ret = 0;
 
+    ret = tsk_table_collection_copy_file_map(tables);
+    if (ret != 0) {
+        goto out;
+    }
     ret = tsk_table_collection_drop_index(tables, 0);
     if (ret != 0) {
         goto out;
@@ -12756,6 +14803,52 @@ out:
     return ret;
 }
 
+int
+tsk_table_collection_reserve(
+    tsk_table_collection_t *self, const tsk_bookmark_t *num_rows)
+{
+    int ret = 0;
+
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_individual_table_reserve(&self->individuals, num_rows->individuals);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_node_table_reserve(&self->nodes, num_rows->nodes);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_edge_table_reserve(&self->edges, num_rows->edges);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_migration_table_reserve(&self->migrations, num_rows->migrations);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_site_table_reserve(&self->sites, num_rows->sites);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_mutation_table_reserve(&self->mutations, num_rows->mutations);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_population_table_reserve(&self->populations, num_rows->populations);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_provenance_table_reserve(&self->provenances, num_rows->provenances);
+    if (ret != 0) {
+        goto out;
+    }
+out:
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_table_collection_clear(tsk_table_collection_t *self, tsk_flags_t options)
 {
@@ -12885,28 +14978,77 @@ out:
     return ret;
 }
 
+/* Removes references to individuals that are not kept from the parents
+ * column, so that they are dropped rather than remapped by keep_rows. */
+static void
+tsk_individual_table_drop_parents(tsk_individual_table_t *self, const tsk_bool_t *keep)
+{
+    tsk_id_t *restrict parents = self->parents;
+    tsk_size_t *restrict parents_offset = self->parents_offset;
+    tsk_size_t j, k, start, offset;
+    tsk_id_t parent;
+
+    offset = 0;
+    for (j = 0; j < self->num_rows; j++) {
+        start = parents_offset[j];
+        parents_offset[j] = offset;
+        for (k = start; k < parents_offset[j + 1]; k++) {
+            parent = parents[k];
+            if (parent == TSK_NULL || keep[parent]) {
+                parents[offset] = parent;
+                offset++;
+            }
+        }
+    }
+    parents_offset[self->num_rows] = offset;
+    self->parents_length = offset;
+}
+
+static void
+remap_id_column(
+    tsk_id_t *restrict column, tsk_size_t num_rows, const tsk_id_t *restrict id_map)
+{
+    tsk_size_t j;
+
+    for (j = 0; j < num_rows; j++) {
+        if (column[j] != TSK_NULL) {
+            column[j] = id_map[column[j]];
+        }
+    }
+}
+
+/* The rows of all tables apart from nodes and populations keep their relative
+ * order, so they are filtered in place with keep_rows and their references
+ * remapped. Only the node and population tables are copied. */
 int TSK_WARN_UNUSED
 tsk_table_collection_subset(tsk_table_collection_t *self, const tsk_id_t *nodes,
     tsk_size_t num_nodes, tsk_flags_t options)
 {
     int ret = 0;
-    tsk_id_t ret_id, j, k, parent_ind, new_parent, new_child, new_node, site_id;
-    tsk_size_t num_parents;
-    tsk_individual_t ind;
-    tsk_edge_t edge;
+    tsk_id_t ret_id, j, k, pop;
+    tsk_size_t max_rows;
     tsk_id_t *node_map = NULL;
     tsk_id_t *individual_map = NULL;
     tsk_id_t *population_map = NULL;
     tsk_id_t *site_map = NULL;
-    tsk_id_t *mutation_map = NULL;
-    tsk_table_collection_t tables;
-    tsk_population_t pop;
-    tsk_site_t site;
-    tsk_mutation_t mut;
+    tsk_bool_t *keep = NULL;
+    tsk_node_table_t old_nodes;
+    tsk_population_table_t old_populations;
+    tsk_population_t population;
+    tsk_node_table_t *node_table = &self->nodes;
+    tsk_mutation_table_t *mutations = &self->mutations;
+    tsk_edge_table_t *edges = &self->edges;
+    const tsk_id_t num_old_nodes = (tsk_id_t) self->nodes.num_rows;
+    const tsk_id_t num_individuals = (tsk_id_t) self->individuals.num_rows;
+    const tsk_id_t num_populations = (tsk_id_t) self->populations.num_rows;
+    const tsk_id_t num_sites = (tsk_id_t) self->sites.num_rows;
     bool keep_unreferenced = !!(options & TSK_SUBSET_KEEP_UNREFERENCED);
     bool no_change_populations = !!(options & TSK_SUBSET_NO_CHANGE_POPULATIONS);
 
-    ret = tsk_table_collection_copy(self, &tables, 0);
+    tsk_memset(&old_nodes, 0, sizeof(old_nodes));
+    tsk_memset(&old_populations, 0, sizeof(old_populations));
+
+    ret = tsk_table_collection_copy_file_map(self);
     if (ret != 0) {
         goto out;
     }
@@ -12915,204 +15057,162 @@ tsk_table_collection_subset(tsk_table_collection_t *self, const tsk_id_t *nodes,
     if (ret != 0) {
         goto out;
     }
-    ret = tsk_table_collection_clear(self, 0);
-    if (ret != 0) {
+    for (k = 0; k < (tsk_id_t) num_nodes; k++) {
+        if (nodes[k] < 0 || nodes[k] >= num_old_nodes) {
+            ret = TSK_ERR_NODE_OUT_OF_BOUNDS;
+            goto out;
+        }
+    }
+    /* TODO: Subset the migrations table. We would need to make sure
+     * that we don't remove populations that are referenced. */
+    if (self->migrations.num_rows != 0) {
+        ret = TSK_ERR_MIGRATIONS_NOT_SUPPORTED;
         goto out;
     }
 
-    node_map = tsk_malloc(tables.nodes.num_rows * sizeof(*node_map));
-    individual_map = tsk_malloc(tables.individuals.num_rows * sizeof(*individual_map));
-    population_map = tsk_malloc(tables.populations.num_rows * sizeof(*population_map));
-    site_map = tsk_malloc(tables.sites.num_rows * sizeof(*site_map));
-    mutation_map = tsk_malloc(tables.mutations.num_rows * sizeof(*mutation_map));
+    max_rows = TSK_MAX(self->individuals.num_rows, self->sites.num_rows);
+    max_rows = TSK_MAX(max_rows, TSK_MAX(edges->num_rows, mutations->num_rows));
+    node_map = tsk_malloc(self->nodes.num_rows * sizeof(*node_map));
+    individual_map = tsk_malloc(self->individuals.num_rows * sizeof(*individual_map));
+    population_map = tsk_malloc(self->populations.num_rows * sizeof(*population_map));
+    site_map = tsk_malloc(self->sites.num_rows * sizeof(*site_map));
+    keep = tsk_malloc(max_rows * sizeof(*keep));
     if (node_map == NULL || individual_map == NULL || population_map == NULL
-        || site_map == NULL || mutation_map == NULL) {
+        || site_map == NULL || keep == NULL) {
         ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
-    tsk_memset(node_map, 0xff, tables.nodes.num_rows * sizeof(*node_map));
+    tsk_memset(node_map, 0xff, self->nodes.num_rows * sizeof(*node_map));
     tsk_memset(
-        individual_map, 0xff, tables.individuals.num_rows * sizeof(*individual_map));
-    tsk_memset(
-        population_map, 0xff, tables.populations.num_rows * sizeof(*population_map));
-    tsk_memset(site_map, 0xff, tables.sites.num_rows * sizeof(*site_map));
-    tsk_memset(mutation_map, 0xff, tables.mutations.num_rows * sizeof(*mutation_map));
-
-    if (no_change_populations) {
-        ret = tsk_population_table_copy(
-            &tables.populations, &self->populations, TSK_NO_INIT);
-        if (ret < 0) {
-            goto out;
-        }
-        for (k = 0; k < (tsk_id_t) tables.populations.num_rows; k++) {
-            population_map[k] = k;
-        }
+        population_map, 0xff, self->populations.num_rows * sizeof(*population_map));
+    tsk_memset(site_map, 0xff, self->sites.num_rows * sizeof(*site_map));
+    /* If a node is listed more than once, references map to the last copy */
+    for (k = 0; k < (tsk_id_t) num_nodes; k++) {
+        node_map[nodes[k]] = k;
     }
 
-    // First do individuals so they stay in the same order.
-    // So we can remap individual parents and not rely on sortedness,
-    // we first check who to keep; then build the individual map, and
-    // finally populate the tables.
-    if (keep_unreferenced) {
-        for (k = 0; k < (tsk_id_t) tables.individuals.num_rows; k++) {
-            // put a non-NULL value here; fill in the actual order next
-            individual_map[k] = 0;
-        }
-    } else {
-        for (k = 0; k < (tsk_id_t) num_nodes; k++) {
-            if (nodes[k] < 0 || nodes[k] >= (tsk_id_t) tables.nodes.num_rows) {
-                ret = TSK_ERR_NODE_OUT_OF_BOUNDS;
-                goto out;
-            }
-            j = tables.nodes.individual[nodes[k]];
-            if (j != TSK_NULL) {
-                individual_map[j] = 0;
-            }
-        }
-    }
-    j = 0;
-    for (k = 0; k < (tsk_id_t) tables.individuals.num_rows; k++) {
-        if (individual_map[k] != TSK_NULL) {
-            individual_map[k] = j;
-            j++;
+    // Individuals keep their order; parents that aren't kept are dropped.
+    tsk_memset(keep, keep_unreferenced, (tsk_size_t) num_individuals * sizeof(*keep));
+    for (k = 0; k < (tsk_id_t) num_nodes; k++) {
+        j = self->nodes.individual[nodes[k]];
+        if (j != TSK_NULL) {
+            keep[j] = true;
         }
     }
-    for (k = 0; k < (tsk_id_t) tables.individuals.num_rows; k++) {
-        if (individual_map[k] != TSK_NULL) {
-            tsk_individual_table_get_row_unsafe(&tables.individuals, k, &ind);
-            num_parents = 0;
-            for (j = 0; j < (tsk_id_t) ind.parents_length; j++) {
-                parent_ind = ind.parents[j];
-                new_parent = parent_ind;
-                if (parent_ind != TSK_NULL) {
-                    new_parent = individual_map[parent_ind];
-                }
-                if ((parent_ind == TSK_NULL) || (new_parent != TSK_NULL)) {
-                    /* Beware: this modifies the parents column of tables.individuals
-                     * in-place! But it's OK as we don't use it again. */
-                    ind.parents[num_parents] = new_parent;
-                    num_parents++;
-                }
-            }
-            ret_id = tsk_individual_table_add_row(&self->individuals, ind.flags,
-                ind.location, ind.location_length, ind.parents, num_parents,
-                ind.metadata, ind.metadata_length);
-            if (ret_id < 0) {
-                ret = (int) ret_id;
-                goto out;
-            }
-            tsk_bug_assert(individual_map[k] == ret_id);
-        }
+    tsk_individual_table_drop_parents(&self->individuals, keep);
+    ret = tsk_individual_table_keep_rows(&self->individuals, keep, 0, individual_map);
+    if (ret != 0) {
+        goto out;
     }
 
-    // Nodes and populations
-    for (k = 0; k < (tsk_id_t) num_nodes; k++) {
-        ret = tsk_table_collection_add_and_remap_node(
-            self, &tables, nodes[k], individual_map, population_map, node_map, true);
-        if (ret < 0) {
-            goto out;
-        }
+    // Nodes are copied in the listed order, and populations in the order in
+    // which they are first referenced.
+    ret = tsk_node_table_copy(&self->nodes, &old_nodes, 0);
+    if (ret != 0) {
+        goto out;
     }
-
-    /* TODO: Subset the migrations table. We would need to make sure
-     * that we don't remove populations that are referenced, so it would
-     * need to be done before the next code block. */
-    if (tables.migrations.num_rows != 0) {
-        ret = TSK_ERR_MIGRATIONS_NOT_SUPPORTED;
+    ret = tsk_node_table_truncate(node_table, 0);
+    if (ret != 0) {
         goto out;
     }
-
-    if (keep_unreferenced) {
-        // Keep unused populations
-        for (k = 0; k < (tsk_id_t) tables.populations.num_rows; k++) {
-            if (population_map[k] == TSK_NULL) {
-                tsk_population_table_get_row_unsafe(&tables.populations, k, &pop);
+    ret = tsk_node_table_extend(node_table, &old_nodes, num_nodes, nodes, 0);
+    if (ret != 0) {
+        goto out;
+    }
+    if (no_change_populations) {
+        for (k = 0; k < num_populations; k++) {
+            population_map[k] = k;
+        }
+    } else {
+        ret = tsk_population_table_copy(&self->populations, &old_populations, 0);
+        if (ret != 0) {
+            goto out;
+        }
+        ret = tsk_population_table_truncate(&self->populations, 0);
+        if (ret != 0) {
+            goto out;
+        }
+        for (k = 0; k < (tsk_id_t) num_nodes; k++) {
+            pop = node_table->population[k];
+            if (pop != TSK_NULL && population_map[pop] == TSK_NULL) {
+                tsk_population_table_get_row_unsafe(&old_populations, pop, &population);
                 ret_id = tsk_population_table_add_row(
-                    &self->populations, pop.metadata, pop.metadata_length);
+                    &self->populations, population.metadata, population.metadata_length);
                 if (ret_id < 0) {
                     ret = (int) ret_id;
                     goto out;
                 }
+                population_map[pop] = ret_id;
+            }
+        }
+        if (keep_unreferenced) {
+            for (k = 0; k < num_populations; k++) {
+                if (population_map[k] == TSK_NULL) {
+                    tsk_population_table_get_row_unsafe(
+                        &old_populations, k, &population);
+                    ret_id = tsk_population_table_add_row(&self->populations,
+                        population.metadata, population.metadata_length);
+                    if (ret_id < 0) {
+                        ret = (int) ret_id;
+                        goto out;
+                    }
+                }
             }
         }
     }
+    remap_id_column(node_table->population, num_nodes, population_map);
+    remap_id_column(node_table->individual, num_nodes, individual_map);
 
     // Edges
-    for (k = 0; k < (tsk_id_t) tables.edges.num_rows; k++) {
-        tsk_edge_table_get_row_unsafe(&tables.edges, k, &edge);
-        new_parent = node_map[edge.parent];
-        new_child = node_map[edge.child];
-        if ((new_parent != TSK_NULL) && (new_child != TSK_NULL)) {
-            ret_id = tsk_edge_table_add_row(&self->edges, edge.left, edge.right,
-                new_parent, new_child, edge.metadata, edge.metadata_length);
-            if (ret_id < 0) {
-                ret = (int) ret_id;
-                goto out;
-            }
-        }
+    for (k = 0; k < (tsk_id_t) edges->num_rows; k++) {
+        keep[k] = node_map[edges->parent[k]] != TSK_NULL
+                  && node_map[edges->child[k]] != TSK_NULL;
+    }
+    ret = tsk_edge_table_keep_rows(edges, keep, 0, NULL);
+    if (ret != 0) {
+        goto out;
     }
+    remap_id_column(edges->parent, edges->num_rows, node_map);
+    remap_id_column(edges->child, edges->num_rows, node_map);
 
-    // Mutations and sites
-    // Make a first pass through to build the mutation_map so that
-    // mutation parent can be remapped even if the table is not in order.
-    j = 0;
-    for (k = 0; k < (tsk_id_t) tables.mutations.num_rows; k++) {
-        if (node_map[tables.mutations.node[k]] != TSK_NULL) {
-            mutation_map[k] = j;
-            j++;
-            site_id = tables.mutations.site[k];
-            if (site_map[site_id] == TSK_NULL) {
-                // Insert a temporary non-NULL value
-                site_map[site_id] = 1;
-            }
+    // Sites are kept if they have a retained mutation, in their original order.
+    tsk_memset(keep, keep_unreferenced, (tsk_size_t) num_sites * sizeof(*keep));
+    for (k = 0; k < (tsk_id_t) mutations->num_rows; k++) {
+        if (node_map[mutations->node[k]] != TSK_NULL) {
+            keep[mutations->site[k]] = true;
         }
     }
-    // Keep retained sites in their original order
-    j = 0;
-    for (k = 0; k < (tsk_id_t) tables.sites.num_rows; k++) {
-        if (keep_unreferenced || site_map[k] != TSK_NULL) {
-            tsk_site_table_get_row_unsafe(&tables.sites, k, &site);
-            ret_id = tsk_site_table_add_row(&self->sites, site.position,
-                site.ancestral_state, site.ancestral_state_length, site.metadata,
-                site.metadata_length);
-            if (ret_id < 0) {
-                ret = (int) ret_id;
-                goto out;
-            }
-            site_map[k] = j;
-            j++;
-        }
+    ret = tsk_site_table_keep_rows(&self->sites, keep, 0, site_map);
+    if (ret != 0) {
+        goto out;
     }
-    for (k = 0; k < (tsk_id_t) tables.mutations.num_rows; k++) {
-        tsk_mutation_table_get_row_unsafe(&tables.mutations, k, &mut);
-        new_node = node_map[mut.node];
-        if (new_node != TSK_NULL) {
-            new_parent = TSK_NULL;
-            if (mut.parent != TSK_NULL) {
-                new_parent = mutation_map[mut.parent];
-            }
-            ret_id = tsk_mutation_table_add_row(&self->mutations, site_map[mut.site],
-                new_node, new_parent, mut.time, mut.derived_state,
-                mut.derived_state_length, mut.metadata, mut.metadata_length);
-            if (ret_id < 0) {
-                ret = (int) ret_id;
-                goto out;
-            }
-            tsk_bug_assert(mutation_map[mut.id] == ret_id);
-        }
-        if (ret < 0) {
-            goto out;
+
+    // Mutations whose parent is removed get a null parent.
+    for (k = 0; k < (tsk_id_t) mutations->num_rows; k++) {
+        keep[k] = node_map[mutations->node[k]] != TSK_NULL;
+    }
+    for (k = 0; k < (tsk_id_t) mutations->num_rows; k++) {
+        j = mutations->parent[k];
+        if (keep[k] && j != TSK_NULL && !keep[j]) {
+            mutations->parent[k] = TSK_NULL;
         }
     }
+    ret = tsk_mutation_table_keep_rows(mutations, keep, 0, NULL);
+    if (ret != 0) {
+        goto out;
+    }
+    remap_id_column(mutations->site, mutations->num_rows, site_map);
+    remap_id_column(mutations->node, mutations->num_rows, node_map);
 
-    ret = 0;
+    ret = tsk_table_collection_drop_index(self, 0);
 out:
     tsk_safe_free(node_map);
     tsk_safe_free(individual_map);
     tsk_safe_free(population_map);
     tsk_safe_free(site_map);
-    tsk_safe_free(mutation_map);
-    tsk_table_collection_free(&tables);
+    tsk_safe_free(keep);
+    tsk_node_table_free(&old_nodes);
+    tsk_population_table_free(&old_populations);
     return ret;
 }
 
@@ -13185,6 +15285,41 @@ out:
     return ret;
 }
 
+/* Returns true if the edges from start to stop are in the order produced
+ * by tsk_table_collection_sort. */
+static bool
+tsk_table_collection_edges_sorted(
+    const tsk_table_collection_t *self, tsk_size_t start, tsk_size_t stop)
+{
+    const double *restrict time = self->nodes.time;
+    const double *restrict left = self->edges.left;
+    const tsk_id_t *restrict parent = self->edges.parent;
+    const tsk_id_t *restrict child = self->edges.child;
+    tsk_size_t j;
+    double t0, t1;
+
+    for (j = start + 1; j < stop; j++) {
+        t0 = time[parent[j - 1]];
+        t1 = time[parent[j]];
+        if (t0 != t1) {
+            if (t0 > t1) {
+                return false;
+            }
+        } else if (parent[j - 1] != parent[j]) {
+            if (parent[j - 1] > parent[j]) {
+                return false;
+            }
+        } else if (child[j - 1] != child[j]) {
+            if (child[j - 1] > child[j]) {
+                return false;
+            }
+        } else if (left[j - 1] > left[j]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 int TSK_WARN_UNUSED
 tsk_table_collection_union(tsk_table_collection_t *self,
     const tsk_table_collection_t *other, const tsk_id_t *other_node_mapping,
@@ -13194,6 +15329,10 @@ tsk_table_collection_union(tsk_table_collection_t *self,
     tsk_id_t ret_id, k, i, new_parent, new_child;
     tsk_size_t num_shared_nodes = 0;
     tsk_size_t num_individuals_self = self->individuals.num_rows;
+    tsk_size_t num_edges_self = self->edges.num_rows;
+    tsk_size_t num_sites;
+    tsk_flags_t sort_options;
+    tsk_bookmark_t start;
     tsk_edge_t edge;
     tsk_mutation_t mut;
     tsk_site_t site;
@@ -13204,6 +15343,10 @@ tsk_table_collection_union(tsk_table_collection_t *self,
     bool add_populations = !(options & TSK_UNION_NO_ADD_POP);
     bool check_shared_portion = !(options & TSK_UNION_NO_CHECK_SHARED);
 
+    ret = tsk_table_collection_copy_file_map(self);
+    if (ret != 0) {
+        goto out;
+    }
     /* Not calling TSK_CHECK_TREES so casting to int is safe */
     ret = (int) tsk_table_collection_check_integrity(self, 0);
     if (ret != 0) {
@@ -13339,22 +15482,35 @@ tsk_table_collection_union(tsk_table_collection_t *self,
         goto out;
     }
 
-    // sorting, deduplicating, and computing parents
-    ret = tsk_table_collection_sort(self, 0, 0);
+    // sorting, deduplicating, and computing parents. We have only added
+    // valid references, so there's no need to check integrity again. If the
+    // original edges were sorted we sort the new edges and merge them in.
+    tsk_memset(&start, 0, sizeof(start));
+    sort_options = TSK_NO_CHECK_INTEGRITY;
+    if (tsk_table_collection_edges_sorted(self, 0, num_edges_self)) {
+        start.edges = num_edges_self;
+        sort_options |= TSK_SORT_MERGE_EDGES;
+    }
+    ret = tsk_table_collection_sort(self, &start, sort_options);
     if (ret < 0) {
         goto out;
     }
 
+    num_sites = self->sites.num_rows;
     ret = tsk_table_collection_deduplicate_sites(self, 0);
     if (ret < 0) {
         goto out;
     }
 
     // need to sort again since after deduplicating sites, mutations
-    // may not be sorted by time within sites
-    ret = tsk_table_collection_sort(self, 0, 0);
-    if (ret < 0) {
-        goto out;
+    // may not be sorted by time within sites. The edges are already sorted.
+    if (self->sites.num_rows != num_sites) {
+        tsk_memset(&start, 0, sizeof(start));
+        start.edges = self->edges.num_rows;
+        ret = tsk_table_collection_sort(self, &start, TSK_NO_CHECK_INTEGRITY);
+        if (ret < 0) {
+            goto out;
+        }
     }
 
     ret = tsk_table_collection_build_index(self, 0);
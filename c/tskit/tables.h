@@ -302,6 +302,8 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private: the columns are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_individual_table_t;
 
 /**
@@ -336,6 +338,8 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private: the columns are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_node_table_t;
 
 /**
@@ -372,6 +376,8 @@ typedef struct {
     char *metadata_schema;
     /** @brief Flags for this table */
     tsk_flags_t options;
+    /* Private: the columns are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_edge_table_t;
 
 /**
@@ -410,6 +416,8 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private: the columns are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_migration_table_t;
 
 /**
@@ -445,6 +453,8 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private: the columns are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_site_table_t;
 
 /**
@@ -486,6 +496,8 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private: the columns are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_mutation_table_t;
 
 /**
@@ -512,6 +524,8 @@ typedef struct {
     tsk_size_t *metadata_offset;
     /** @brief The metadata schema */
     char *metadata_schema;
+    /* Private: the columns are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_population_table_t;
 
 /**
@@ -543,6 +557,8 @@ typedef struct {
     char *record;
     /** @brief The record_offset column. */
     tsk_size_t *record_offset;
+    /* Private: the columns are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_provenance_table_t;
 
 typedef struct {
@@ -554,6 +570,8 @@ typedef struct {
     tsk_size_t metadata_length;
     char *metadata_schema;
     tsk_size_t metadata_schema_length;
+    /* Private: data and metadata are borrowed from a TSK_LOAD_MMAP file mapping */
+    bool mapped;
 } tsk_reference_sequence_t;
 
 /**
@@ -594,6 +612,12 @@ typedef struct {
         tsk_id_t *edge_removal_order;
         tsk_size_t num_edges;
     } indexes;
+    /* Private: the read-only file mapping that columns borrow their memory
+     * from when the collection is loaded with TSK_LOAD_MMAP. */
+    struct {
+        void *addr;
+        size_t size;
+    } file_map;
 } tsk_table_collection_t;
 
 /**
@@ -634,6 +658,8 @@ typedef struct _tsk_table_sorter_t {
     void *user_data;
     /** @brief Mapping from input site IDs to output site IDs */
     tsk_id_t *site_id_map;
+    /** @brief The options passed to tsk_table_sorter_init */
+    tsk_flags_t options;
 } tsk_table_sorter_t;
 
 /* Structs for IBD finding.
@@ -660,12 +686,33 @@ typedef struct {
     tsk_identity_segment_t *tail;
 } tsk_identity_segment_list_t;
 
+/* Function called for each IBD segment found by the streaming versions of
+ * ibd_within and ibd_between. The pair is always given with a < b. A non-zero
+ * return value stops the search, and is returned to the caller. */
+typedef int tsk_identity_segment_func_t(
+    tsk_id_t a, tsk_id_t b, double left, double right, tsk_id_t node, void *params);
+
+/* The segments for a single pair. When segments are stored they are kept
+ * in a contiguous array, which is linked so that list.head can be traversed
+ * in the usual way. */
+typedef struct {
+    int64_t key;
+    tsk_size_t max_segments;
+    tsk_identity_segment_list_t list;
+} tsk_identity_pair_t;
+
 typedef struct {
     tsk_size_t num_nodes;
-    tsk_avl_tree_int_t pair_map;
+    /* Open addressing hash table mapping pair keys to indexes in pairs,
+     * with TSK_NULL marking empty slots. The size is a power of two. */
+    int64_t *pair_table;
+    tsk_size_t pair_table_size;
+    /* The pairs, sorted by key when a search or merge completes. */
+    tsk_identity_pair_t *pairs;
+    tsk_size_t num_pairs;
+    tsk_size_t max_pairs;
     tsk_size_t num_segments;
     double total_span;
-    tsk_blkalloc_t heap;
     bool store_segments;
     bool store_pairs;
 } tsk_identity_segments_t;
@@ -769,6 +816,22 @@ populations will be placed last, in their original order.
 #define TSK_SUBSET_KEEP_UNREFERENCED (1 << 1)
 /** @} */
 
+/**
+@defgroup API_FLAGS_SORT_GROUP :c:func:`tsk_table_collection_sort` specific flags.
+@{
+*/
+/**
+@rst
+If this flag is provided, the edges after the ``edges`` start position of the
+bookmark are sorted and then merged with the (already sorted) edges before it,
+so that the whole edge table is sorted. The cost is a sort of the new edges plus
+a linear merge of the whole table. See :c:func:`tsk_table_collection_sort`
+for details.
+@endrst
+*/
+#define TSK_SORT_MERGE_EDGES (1 << 0)
+/** @} */
+
 /**
 @defgroup API_FLAGS_CHECK_INTEGRITY_GROUP :c:func:`tsk_table_collection_check_integrity`
 specific flags.
@@ -833,6 +896,65 @@ with error TSK_ERR_METADATA_DISABLED.
 @endrst
 */
 #define TSK_TC_NO_EDGE_METADATA (1 << 3)
+/**
+@rst
+Memory-map the file and have the table columns borrow read-only pointers
+into the mapping rather than reading each column into newly allocated
+memory. The table collection may be queried, copied, dumped or passed to
+:c:func:`tsk_treeseq_init` (with :c:macro:`TSK_TAKE_OWNERSHIP`), and its
+indexes may be dropped and rebuilt. The ``tsk_table_collection_*`` functions
+that modify the tables (such as sort, simplify or reserve) first copy the
+whole collection into owned memory and release the mapping. Until then, the
+functions of the individual tables that would write to, grow or free their
+columns (such as :c:func:`tsk_node_table_add_row`,
+:c:func:`tsk_node_table_update_row` or
+:c:func:`tsk_reference_sequence_set_data`) return
+:c:macro:`TSK_ERR_TABLE_MAPPED` instead; truncating and clearing the tables is
+allowed. The mapping is released by :c:func:`tsk_table_collection_free`.
+If a column would not be suitably aligned in the mapping (for example, when
+several stores have been written to the same file), the store is read
+normally instead. Only supported for regular files on POSIX platforms;
+:c:macro:`TSK_ERR_UNSUPPORTED_OPERATION` is returned otherwise.
+@endrst
+*/
+#define TSK_LOAD_MMAP (1 << 4)
+/**
+Do not load the metadata columns or metadata schemas of any of the tables,
+nor the top-level or reference sequence metadata and schemas. Metadata
+columns are left empty.
+*/
+#define TSK_LOAD_SKIP_METADATA (1 << 5)
+/** Do not load the provenance table. */
+#define TSK_LOAD_SKIP_PROVENANCES (1 << 6)
+/** Do not load the migration table. */
+#define TSK_LOAD_SKIP_MIGRATIONS (1 << 7)
+/**
+Do not load the site table. As mutations refer to sites, the mutation
+table is not loaded either.
+*/
+#define TSK_LOAD_SKIP_SITES (1 << 8)
+/** Do not load the mutation table. */
+#define TSK_LOAD_SKIP_MUTATIONS (1 << 9)
+/** @} */
+
+/**
+@defgroup API_FLAGS_DUMP_GROUP Flags used by :c:func:`tsk_table_collection_dump`.
+@{
+*/
+/**
+@rst
+Store the offset columns of ragged columns such as metadata and mutation
+derived states as delta encoded variable length integers rather than 32 or
+64 bit integers. This typically needs a single byte per row rather than
+four. Files written with this option have file format version 12.8 and
+are read transparently by :c:func:`tsk_table_collection_load`. Earlier
+versions of tskit fail to load them with :c:macro:`TSK_ERR_BAD_COLUMN_TYPE`
+or :c:macro:`TSK_ERR_FILE_FORMAT`, and tools that read the kastore columns directly must decode the offsets
+as described in the :ref:`sec_tree_sequence_file_format` section. Takes
+precedence over ``TSK_DUMP_FORCE_OFFSET_64``.
+@endrst
+*/
+#define TSK_DUMP_COMPRESS_OFFSETS (1 << 0)
 /** @} */
 
 /* Flags for dump tables */
@@ -1285,6 +1407,25 @@ pre-allocation strategy,
 int tsk_individual_table_set_max_rows_increment(
     tsk_individual_table_t *self, tsk_size_t max_rows_increment);
 
+/**
+@brief Pre-allocate space for rows in this table.
+
+@rst
+Ensures that the table has space for at least the specified total number of
+rows without further reallocation of the fixed-size columns. This is useful
+when the final size of a table is known in advance, as it avoids the
+intermediate reallocations of the default pre-allocation strategy
+(see :ref:`sec_c_api_memory_allocation_strategy`). Ragged columns are
+not affected. If the table already has space for this many rows,
+the call has no effect.
+@endrst
+
+@param self A pointer to a tsk_individual_table_t object.
+@param num_rows The total number of rows to reserve space for.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_individual_table_reserve(tsk_individual_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for the metadata column
 
@@ -1644,6 +1785,54 @@ int tsk_node_table_append_columns(tsk_node_table_t *self, tsk_size_t num_rows,
     const tsk_flags_t *flags, const double *time, const tsk_id_t *population,
     const tsk_id_t *individual, const char *metadata, const tsk_size_t *metadata_offset);
 
+/**
+@brief Reserves space for rows to be written directly into the table's columns.
+
+@rst
+Ensures that the table has space for ``num_rows`` more rows and for the specified
+number of bytes in the ``metadata`` column, and returns the ID of the first of the
+new rows, ``start``. The data for the new rows can then be written directly into the
+column arrays of the table, e.g., the values for the ``j``-th new row of the
+``flags``, ``time``, ``population`` and ``individual`` columns are written to index
+``start + j`` of the corresponding arrays. The ``metadata_offset`` column
+for the new rows are initialised to zero-length values, so that the data for the
+``j``-th row of a ragged column is stored between ``offset[start + j]`` and
+``offset[start + j + 1]``, and only the offsets of ragged columns that are used need
+to be written. Offsets are absolute positions in the column, so that
+``offset[start]`` is the current length.
+
+The new rows are not part of the table until :c:func:`tsk_node_table_append_commit`
+is called, and the column pointers may change if the table is modified in the
+meantime.
+@endrst
+
+@param self A pointer to a tsk_node_table_t object.
+@param num_rows The number of rows to reserve.
+@param metadata_length The total number of bytes of metadata to reserve
+    for the new rows.
+@return Return the ID of the first new row on success or a negative value on
+    failure.
+*/
+tsk_id_t tsk_node_table_append_begin(
+    tsk_node_table_t *self, tsk_size_t num_rows, tsk_size_t metadata_length);
+
+/**
+@brief Adds rows written in place after tsk_node_table_append_begin to the table.
+
+@rst
+Adds the first ``num_rows`` rows written directly into the column arrays after a
+call to :c:func:`tsk_node_table_append_begin` to the table. This may be fewer rows
+than were reserved. The offsets of the ragged columns are checked, and
+:c:macro:`TSK_ERR_BAD_OFFSET` returned if they are not non-decreasing or exceed the
+reserved space; the contents of the rows are not otherwise checked.
+@endrst
+
+@param self A pointer to a tsk_node_table_t object.
+@param num_rows The number of new rows to add.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_node_table_append_commit(tsk_node_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for this table
 
@@ -1662,6 +1851,25 @@ pre-allocation strategy,
 int tsk_node_table_set_max_rows_increment(
     tsk_node_table_t *self, tsk_size_t max_rows_increment);
 
+/**
+@brief Pre-allocate space for rows in this table.
+
+@rst
+Ensures that the table has space for at least the specified total number of
+rows without further reallocation of the fixed-size columns. This is useful
+when the final size of a table is known in advance, as it avoids the
+intermediate reallocations of the default pre-allocation strategy
+(see :ref:`sec_c_api_memory_allocation_strategy`). Ragged columns are
+not affected. If the table already has space for this many rows,
+the call has no effect.
+@endrst
+
+@param self A pointer to a tsk_node_table_t object.
+@param num_rows The total number of rows to reserve space for.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_node_table_reserve(tsk_node_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for the metadata column
 
@@ -1990,6 +2198,54 @@ int tsk_edge_table_append_columns(tsk_edge_table_t *self, tsk_size_t num_rows,
     const double *left, const double *right, const tsk_id_t *parent,
     const tsk_id_t *child, const char *metadata, const tsk_size_t *metadata_offset);
 
+/**
+@brief Reserves space for rows to be written directly into the table's columns.
+
+@rst
+Ensures that the table has space for ``num_rows`` more rows and for the specified
+number of bytes in the ``metadata`` column, and returns the ID of the first of the
+new rows, ``start``. The data for the new rows can then be written directly into the
+column arrays of the table, e.g., the values for the ``j``-th new row of the
+``left``, ``right``, ``parent`` and ``child`` columns are written to index
+``start + j`` of the corresponding arrays. The ``metadata_offset`` column
+for the new rows are initialised to zero-length values, so that the data for the
+``j``-th row of a ragged column is stored between ``offset[start + j]`` and
+``offset[start + j + 1]``, and only the offsets of ragged columns that are used need
+to be written. Offsets are absolute positions in the column, so that
+``offset[start]`` is the current length.
+
+The new rows are not part of the table until :c:func:`tsk_edge_table_append_commit`
+is called, and the column pointers may change if the table is modified in the
+meantime.
+@endrst
+
+@param self A pointer to a tsk_edge_table_t object.
+@param num_rows The number of rows to reserve.
+@param metadata_length The total number of bytes of metadata to reserve
+    for the new rows.
+@return Return the ID of the first new row on success or a negative value on
+    failure.
+*/
+tsk_id_t tsk_edge_table_append_begin(
+    tsk_edge_table_t *self, tsk_size_t num_rows, tsk_size_t metadata_length);
+
+/**
+@brief Adds rows written in place after tsk_edge_table_append_begin to the table.
+
+@rst
+Adds the first ``num_rows`` rows written directly into the column arrays after a
+call to :c:func:`tsk_edge_table_append_begin` to the table. This may be fewer rows
+than were reserved. The offsets of the ragged columns are checked, and
+:c:macro:`TSK_ERR_BAD_OFFSET` returned if they are not non-decreasing or exceed the
+reserved space; the contents of the rows are not otherwise checked.
+@endrst
+
+@param self A pointer to a tsk_edge_table_t object.
+@param num_rows The number of new rows to add.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_edge_table_append_commit(tsk_edge_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for this table
 
@@ -2007,6 +2263,25 @@ pre-allocation strategy,
 int tsk_edge_table_set_max_rows_increment(
     tsk_edge_table_t *self, tsk_size_t max_rows_increment);
 
+/**
+@brief Pre-allocate space for rows in this table.
+
+@rst
+Ensures that the table has space for at least the specified total number of
+rows without further reallocation of the fixed-size columns. This is useful
+when the final size of a table is known in advance, as it avoids the
+intermediate reallocations of the default pre-allocation strategy
+(see :ref:`sec_c_api_memory_allocation_strategy`). Ragged columns are
+not affected. If the table already has space for this many rows,
+the call has no effect.
+@endrst
+
+@param self A pointer to a tsk_edge_table_t object.
+@param num_rows The total number of rows to reserve space for.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_edge_table_reserve(tsk_edge_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for the metadata column
 
@@ -2385,6 +2660,25 @@ pre-allocation strategy,
 int tsk_migration_table_set_max_rows_increment(
     tsk_migration_table_t *self, tsk_size_t max_rows_increment);
 
+/**
+@brief Pre-allocate space for rows in this table.
+
+@rst
+Ensures that the table has space for at least the specified total number of
+rows without further reallocation of the fixed-size columns. This is useful
+when the final size of a table is known in advance, as it avoids the
+intermediate reallocations of the default pre-allocation strategy
+(see :ref:`sec_c_api_memory_allocation_strategy`). Ragged columns are
+not affected. If the table already has space for this many rows,
+the call has no effect.
+@endrst
+
+@param self A pointer to a tsk_migration_table_t object.
+@param num_rows The total number of rows to reserve space for.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_migration_table_reserve(tsk_migration_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for the metadata column
 
@@ -2715,6 +3009,56 @@ int tsk_site_table_append_columns(tsk_site_table_t *self, tsk_size_t num_rows,
     const tsk_size_t *ancestral_state_offset, const char *metadata,
     const tsk_size_t *metadata_offset);
 
+/**
+@brief Reserves space for rows to be written directly into the table's columns.
+
+@rst
+Ensures that the table has space for ``num_rows`` more rows and for the specified
+number of bytes in the ``ancestral_state`` and ``metadata`` columns, and returns the
+ID of the first of the new rows, ``start``. The data for the new rows can then be
+written directly into the column arrays of the table, e.g., the values for the
+``j``-th new row of the ``position`` column are written to index ``start + j`` of
+the corresponding arrays. The offset columns ``ancestral_state_offset`` and
+``metadata_offset`` for the new rows are initialised to zero-length values, so that
+the data for the ``j``-th row of a ragged column is stored between
+``offset[start + j]`` and ``offset[start + j + 1]``, and only the offsets of ragged
+columns that are used need to be written. Offsets are absolute positions in the
+column, so that ``offset[start]`` is the current length.
+
+The new rows are not part of the table until :c:func:`tsk_site_table_append_commit`
+is called, and the column pointers may change if the table is modified in the
+meantime.
+@endrst
+
+@param self A pointer to a tsk_site_table_t object.
+@param num_rows The number of rows to reserve.
+@param ancestral_state_length The total number of bytes of ancestral state to reserve
+    for the new rows.
+@param metadata_length The total number of bytes of metadata to reserve
+    for the new rows.
+@return Return the ID of the first new row on success or a negative value on
+    failure.
+*/
+tsk_id_t tsk_site_table_append_begin(tsk_site_table_t *self, tsk_size_t num_rows,
+    tsk_size_t ancestral_state_length, tsk_size_t metadata_length);
+
+/**
+@brief Adds rows written in place after tsk_site_table_append_begin to the table.
+
+@rst
+Adds the first ``num_rows`` rows written directly into the column arrays after a
+call to :c:func:`tsk_site_table_append_begin` to the table. This may be fewer rows
+than were reserved. The offsets of the ragged columns are checked, and
+:c:macro:`TSK_ERR_BAD_OFFSET` returned if they are not non-decreasing or exceed the
+reserved space; the contents of the rows are not otherwise checked.
+@endrst
+
+@param self A pointer to a tsk_site_table_t object.
+@param num_rows The number of new rows to add.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_site_table_append_commit(tsk_site_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for this table
 
@@ -2732,6 +3076,25 @@ pre-allocation strategy,
 int tsk_site_table_set_max_rows_increment(
     tsk_site_table_t *self, tsk_size_t max_rows_increment);
 
+/**
+@brief Pre-allocate space for rows in this table.
+
+@rst
+Ensures that the table has space for at least the specified total number of
+rows without further reallocation of the fixed-size columns. This is useful
+when the final size of a table is known in advance, as it avoids the
+intermediate reallocations of the default pre-allocation strategy
+(see :ref:`sec_c_api_memory_allocation_strategy`). Ragged columns are
+not affected. If the table already has space for this many rows,
+the call has no effect.
+@endrst
+
+@param self A pointer to a tsk_site_table_t object.
+@param num_rows The total number of rows to reserve space for.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_site_table_reserve(tsk_site_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for the metadata column
 
@@ -3108,6 +3471,56 @@ int tsk_mutation_table_append_columns(tsk_mutation_table_t *self, tsk_size_t num
     const tsk_size_t *derived_state_offset, const char *metadata,
     const tsk_size_t *metadata_offset);
 
+/**
+@brief Reserves space for rows to be written directly into the table's columns.
+
+@rst
+Ensures that the table has space for ``num_rows`` more rows and for the specified
+number of bytes in the ``derived_state`` and ``metadata`` columns, and returns the
+ID of the first of the new rows, ``start``. The data for the new rows can then be
+written directly into the column arrays of the table, e.g., the values for the
+``j``-th new row of the ``site``, ``node``, ``parent`` and ``time`` columns are
+written to index ``start + j`` of the corresponding arrays. The offset columns
+``derived_state_offset`` and ``metadata_offset`` for the new rows are initialised to
+zero-length values, so that the data for the ``j``-th row of a ragged column is
+stored between ``offset[start + j]`` and ``offset[start + j + 1]``, and only the
+offsets of ragged columns that are used need to be written. Offsets are absolute
+positions in the column, so that ``offset[start]`` is the current length.
+
+The new rows are not part of the table until
+:c:func:`tsk_mutation_table_append_commit` is called, and the column pointers may
+change if the table is modified in the meantime.
+@endrst
+
+@param self A pointer to a tsk_mutation_table_t object.
+@param num_rows The number of rows to reserve.
+@param derived_state_length The total number of bytes of derived state to reserve
+    for the new rows.
+@param metadata_length The total number of bytes of metadata to reserve
+    for the new rows.
+@return Return the ID of the first new row on success or a negative value on
+    failure.
+*/
+tsk_id_t tsk_mutation_table_append_begin(tsk_mutation_table_t *self, tsk_size_t num_rows,
+    tsk_size_t derived_state_length, tsk_size_t metadata_length);
+
+/**
+@brief Adds rows written in place after tsk_mutation_table_append_begin to the table.
+
+@rst
+Adds the first ``num_rows`` rows written directly into the column arrays after a
+call to :c:func:`tsk_mutation_table_append_begin` to the table. This may be fewer
+rows than were reserved. The offsets of the ragged columns are checked, and
+:c:macro:`TSK_ERR_BAD_OFFSET` returned if they are not non-decreasing or exceed the
+reserved space; the contents of the rows are not otherwise checked.
+@endrst
+
+@param self A pointer to a tsk_mutation_table_t object.
+@param num_rows The number of new rows to add.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_mutation_table_append_commit(tsk_mutation_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for this table
 
@@ -3125,6 +3538,25 @@ pre-allocation strategy,
 int tsk_mutation_table_set_max_rows_increment(
     tsk_mutation_table_t *self, tsk_size_t max_rows_increment);
 
+/**
+@brief Pre-allocate space for rows in this table.
+
+@rst
+Ensures that the table has space for at least the specified total number of
+rows without further reallocation of the fixed-size columns. This is useful
+when the final size of a table is known in advance, as it avoids the
+intermediate reallocations of the default pre-allocation strategy
+(see :ref:`sec_c_api_memory_allocation_strategy`). Ragged columns are
+not affected. If the table already has space for this many rows,
+the call has no effect.
+@endrst
+
+@param self A pointer to a tsk_mutation_table_t object.
+@param num_rows The total number of rows to reserve space for.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_mutation_table_reserve(tsk_mutation_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for the metadata column
 
@@ -3466,6 +3898,25 @@ pre-allocation strategy,
 int tsk_population_table_set_max_rows_increment(
     tsk_population_table_t *self, tsk_size_t max_rows_increment);
 
+/**
+@brief Pre-allocate space for rows in this table.
+
+@rst
+Ensures that the table has space for at least the specified total number of
+rows without further reallocation of the fixed-size columns. This is useful
+when the final size of a table is known in advance, as it avoids the
+intermediate reallocations of the default pre-allocation strategy
+(see :ref:`sec_c_api_memory_allocation_strategy`). Ragged columns are
+not affected. If the table already has space for this many rows,
+the call has no effect.
+@endrst
+
+@param self A pointer to a tsk_population_table_t object.
+@param num_rows The total number of rows to reserve space for.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_population_table_reserve(tsk_population_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for the metadata column
 
@@ -3786,6 +4237,25 @@ pre-allocation strategy,
 int tsk_provenance_table_set_max_rows_increment(
     tsk_provenance_table_t *self, tsk_size_t max_rows_increment);
 
+/**
+@brief Pre-allocate space for rows in this table.
+
+@rst
+Ensures that the table has space for at least the specified total number of
+rows without further reallocation of the fixed-size columns. This is useful
+when the final size of a table is known in advance, as it avoids the
+intermediate reallocations of the default pre-allocation strategy
+(see :ref:`sec_c_api_memory_allocation_strategy`). Ragged columns are
+not affected. If the table already has space for this many rows,
+the call has no effect.
+@endrst
+
+@param self A pointer to a tsk_provenance_table_t object.
+@param num_rows The total number of rows to reserve space for.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_provenance_table_reserve(tsk_provenance_table_t *self, tsk_size_t num_rows);
+
 /**
 @brief Controls the pre-allocation strategy for the timestamp column
 
@@ -3986,6 +4456,19 @@ metadata or schema.
 If the :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE` option is set, the table collection is
 read without loading the reference sequence.
 
+The columns that are read can be further restricted using the
+:c:macro:`TSK_LOAD_SKIP_METADATA`, :c:macro:`TSK_LOAD_SKIP_PROVENANCES`,
+:c:macro:`TSK_LOAD_SKIP_MIGRATIONS`, :c:macro:`TSK_LOAD_SKIP_SITES` and
+:c:macro:`TSK_LOAD_SKIP_MUTATIONS` options. The corresponding tables (or metadata
+columns) are left empty, and the skipped data is not read from the file. This
+is useful for reducing I/O and memory usage when only part of the data is
+needed; for example, branch statistics require only the node and edge tables.
+
+If the :c:macro:`TSK_LOAD_MMAP` option is set, the file is memory-mapped and the
+columns of the table collection point directly into the mapping, so that
+loading does not copy the column data. The table collection must then be
+treated as read-only; see :c:macro:`TSK_LOAD_MMAP` for details.
+
 **Options**
 
 Options can be specified by providing one or more of the following bitwise
@@ -3994,6 +4477,12 @@ flags:
 - :c:macro:`TSK_NO_INIT`
 - :c:macro:`TSK_LOAD_SKIP_TABLES`
 - :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE`
+- :c:macro:`TSK_LOAD_MMAP`
+- :c:macro:`TSK_LOAD_SKIP_METADATA`
+- :c:macro:`TSK_LOAD_SKIP_PROVENANCES`
+- :c:macro:`TSK_LOAD_SKIP_MIGRATIONS`
+- :c:macro:`TSK_LOAD_SKIP_SITES`
+- :c:macro:`TSK_LOAD_SKIP_MUTATIONS`
 
 **Examples**
 
@@ -4046,7 +4535,9 @@ sequentially load tree sequences from a stream.
 
 Please note that this streaming behaviour is not supported if the
 :c:macro:`TSK_LOAD_SKIP_TABLES` or :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE` option is
-set. If the :c:macro:`TSK_LOAD_SKIP_TABLES` option is set, only the non-table information
+set (or any of the other options that skip parts of the file; see
+:c:func:`tsk_table_collection_load`), unless :c:macro:`TSK_LOAD_MMAP` is also set.
+If the :c:macro:`TSK_LOAD_SKIP_TABLES` option is set, only the non-table information
 from the table collection will be read, leaving all tables with zero rows and no metadata
 or schema. If the :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE` option is set, the table
 collection is read without loading the reference sequence. When attempting to read from a
@@ -4054,6 +4545,12 @@ stream with multiple table collection definitions and either of these two option
 the requested information from the first table collection will be read on the first call
 to :c:func:`tsk_table_collection_loadf`, with subsequent calls leading to errors.
 
+The :c:macro:`TSK_LOAD_MMAP` option is only supported if the stream refers to
+a regular file, and :c:macro:`TSK_ERR_UNSUPPORTED_OPERATION` is returned
+otherwise. Multiple table collections can be read from the same file in this
+way, as the stream is left positioned at the end of the table collection
+definition that was mapped.
+
 **Options**
 
 Options can be specified by providing one or more of the following bitwise
@@ -4062,6 +4559,12 @@ flags:
 - :c:macro:`TSK_NO_INIT`
 - :c:macro:`TSK_LOAD_SKIP_TABLES`
 - :c:macro:`TSK_LOAD_SKIP_REFERENCE_SEQUENCE`
+- :c:macro:`TSK_LOAD_MMAP`
+- :c:macro:`TSK_LOAD_SKIP_METADATA`
+- :c:macro:`TSK_LOAD_SKIP_PROVENANCES`
+- :c:macro:`TSK_LOAD_SKIP_MIGRATIONS`
+- :c:macro:`TSK_LOAD_SKIP_SITES`
+- :c:macro:`TSK_LOAD_SKIP_MUTATIONS`
 @endrst
 
 @param self A pointer to an uninitialised tsk_table_collection_t object
@@ -4085,6 +4588,16 @@ Writes the data from this table collection to the specified file.
 If an error occurs the file path is deleted, ensuring that only complete
 and well formed files will be written.
 
+The columns are written to the file directly from the tables, so dumping
+needs little memory beyond the table collection itself.
+
+**Options**
+
+Options can be specified by providing one or more of the following bitwise
+flags:
+
+- :c:macro:`TSK_DUMP_COMPRESS_OFFSETS`
+
 **Examples**
 
 .. code-block:: c
@@ -4103,8 +4616,7 @@ and well formed files will be written.
 
 @param self A pointer to an initialised tsk_table_collection_t object.
 @param filename A NULL terminated string containing the filename.
-@param options Bitwise options. Currently unused; should be
-    set to zero to ensure compatibility with later versions of tskit.
+@param options Bitwise options. See above for details.
 @return Return 0 on success or a negative value on failure.
 */
 int tsk_table_collection_dump(
@@ -4125,8 +4637,8 @@ of how to sequentially dump and load tree sequences from a stream.
 @param self A pointer to an initialised tsk_table_collection_t object.
 @param file A FILE stream opened in an appropriate mode for writing (e.g.
     "w", "a", "r+" or "w+").
-@param options Bitwise options. Currently unused; should be
-    set to zero to ensure compatibility with later versions of tskit.
+@param options Bitwise options. See :c:func:`tsk_table_collection_dump`
+    for details.
 @return Return 0 on success or a negative value on failure.
 */
 int tsk_table_collection_dumpf(
@@ -4160,6 +4672,23 @@ number rows for each table in a table collection at a particular time.
 int tsk_table_collection_truncate(
     tsk_table_collection_t *self, tsk_bookmark_t *bookmark);
 
+/**
+@brief Pre-allocate space for rows in the tables in this collection.
+
+@rst
+Calls the ``tsk_X_table_reserve`` function for each table, so that
+each one has space for at least the number of rows specified in the
+:c:type:`tsk_bookmark_t` without further reallocation of its fixed-size
+columns. Tables that already have enough space are not affected.
+@endrst
+
+@param self A pointer to a tsk_table_collection_t object.
+@param num_rows The total number of rows to reserve space for in each table.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_reserve(
+    tsk_table_collection_t *self, const tsk_bookmark_t *num_rows);
+
 /**
 @brief Sorts the tables in this collection.
 
@@ -4193,6 +4722,17 @@ and ``provenance``) are ignored and can be set to arbitrary values.
     respective tables, allowing these tables to either be fully sorted, or not sorted at
     all.
 
+By default, the rows of the edge table before the bookmark are left as they
+are and only the rows after it are sorted, so the result is only a valid
+edge ordering if the new edges all sort after the existing ones. If the
+:c:macro:`TSK_SORT_MERGE_EDGES` option is specified, the new edges are sorted
+and then merged with the existing edges in a single linear pass, so that the
+whole table is sorted. This is useful in forward simulations, where a batch
+of new edges (which typically have younger parents than the existing edges)
+is appended to an already sorted table before each simplify. The cost is then
+a sort of the new edges plus a linear merge, rather than a sort of the whole
+table, although the merge still copies every row of the edge table.
+
 The table collection will always be unindexed after sort successfully completes.
 
 For more control over the sorting process, see the :ref:`sec_c_api_low_level_sorting`
@@ -4203,6 +4743,11 @@ section.
 Options can be specified by providing one or more of the following bitwise
 flags:
 
+:c:macro:`TSK_SORT_MERGE_EDGES`
+    Merge the newly sorted edges after the bookmark with the previously
+    sorted edges before it, rather than leaving the edges before the
+    bookmark in place. The edges before the bookmark must be sorted.
+
 :c:macro:`TSK_NO_CHECK_INTEGRITY`
     Do not run integrity checks using
     :c:func:`tsk_table_collection_check_integrity` before sorting,
@@ -4262,6 +4807,39 @@ flags:
 */
 int tsk_table_collection_canonicalise(tsk_table_collection_t *self, tsk_flags_t options);
 
+/**
+@brief Renumbers the nodes to improve the locality of tree traversals.
+
+@rst
+Reorders the node table so that nodes that are close to each other in the
+trees tend to have nearby IDs, which reduces the cache misses incurred when
+following ``parent`` and child pointers in the trees of large tree sequences.
+Nodes are put in a preorder of the graph defined by the edges: starting with
+the oldest remaining node, each node is followed by its children in edge table
+order, recursively, and each node appears only once, after the first of its
+parents to be visited. The node references in the edge, migration and mutation
+tables are then remapped, and the tables sorted (see
+:c:func:`tsk_table_collection_sort`). As for sorting, the edge indexes are
+dropped and must be rebuilt before creating a tree sequence.
+
+Sample nodes are renumbered along with all other nodes, and so their order in
+the list of samples of the resulting tree sequence may change.
+
+If ``node_map`` is not NULL, it must point to an array of length equal to the
+number of nodes, and on return ``node_map[u]`` is the new ID of the node with
+ID ``u`` in the original tables.
+@endrst
+
+@param self A pointer to a tsk_table_collection_t object.
+@param options Bitwise options. Currently unused; should be
+    set to zero to ensure compatibility with later versions of tskit.
+@param node_map An optional array in which to store the mapping from
+    original node IDs to new node IDs.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_table_collection_renumber_nodes(
+    tsk_table_collection_t *self, tsk_flags_t options, tsk_id_t *node_map);
+
 /**
 @brief Simplify the tables to remove redundant information.
 
@@ -4612,6 +5190,18 @@ int tsk_table_collection_ibd_between(const tsk_table_collection_t *self,
     const tsk_size_t *sample_set_sizes, const tsk_id_t *sample_sets, double min_span,
     double max_time, tsk_flags_t options);
 
+/* As ibd_within and ibd_between, but each segment passing the min_span and
+ * max_time filters is passed to f as soon as it is found rather than being
+ * stored, so that memory use does not grow with the size of the output.
+ * Returns TSK_ERR_BAD_PARAM_VALUE if f is NULL. */
+int tsk_table_collection_ibd_within_stream(const tsk_table_collection_t *self,
+    const tsk_id_t *samples, tsk_size_t num_samples, double min_span, double max_time,
+    tsk_identity_segment_func_t *f, void *f_params, tsk_flags_t options);
+int tsk_table_collection_ibd_between_stream(const tsk_table_collection_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, double min_span, double max_time,
+    tsk_identity_segment_func_t *f, void *f_params, tsk_flags_t options);
+
 int tsk_table_collection_link_ancestors(tsk_table_collection_t *self, tsk_id_t *samples,
     tsk_size_t num_samples, tsk_id_t *ancestors, tsk_size_t num_ancestors,
     tsk_flags_t options, tsk_edge_table_t *result);
@@ -4621,6 +5211,24 @@ int tsk_table_collection_compute_mutation_parents(
     tsk_table_collection_t *self, tsk_flags_t options);
 int tsk_table_collection_compute_mutation_times(
     tsk_table_collection_t *self, double *random, tsk_flags_t options);
+
+/* As compute_mutation_parents and compute_mutation_times, but only the
+ * mutations at sites with left <= position < right are updated, so disjoint
+ * intervals can be processed concurrently from different threads. Each call
+ * positions its own tree at left using the edge indexes. Threaded callers
+ * should check the integrity of the tables once beforehand (with all parents
+ * set to TSK_NULL, or all times set to TSK_UNKNOWN_TIME) and then pass
+ * TSK_NO_CHECK_INTEGRITY, since the check reads every row. Unlike
+ * compute_mutation_times, the interval version does not re-sort the
+ * mutations, which may be needed once all intervals are done. The interval
+ * versions don't copy a collection loaded with TSK_LOAD_MMAP out of its
+ * mapping, and return TSK_ERR_TABLE_MAPPED for one; threaded callers must
+ * copy it (for example, with tsk_table_collection_copy) before splitting up
+ * the work. */
+int tsk_table_collection_compute_mutation_parents_interval(
+    tsk_table_collection_t *self, double left, double right, tsk_flags_t options);
+int tsk_table_collection_compute_mutation_times_interval(tsk_table_collection_t *self,
+    double *random, double left, double right, tsk_flags_t options);
 int tsk_table_collection_delete_older(
     tsk_table_collection_t *self, double time, tsk_flags_t options);
 
@@ -4696,7 +5304,7 @@ int tsk_reference_sequence_takeset_metadata(
 @rst
 This must be called before any operations are performed on the
 table sorter and initialises all fields. The ``edge_sort`` function
-is set to the default method using qsort. The ``user_data``
+is set to the default method using a radix sort. The ``user_data``
 field is set to NULL.
 This method supports the same options as
 :c:func:`tsk_table_collection_sort`.
@@ -4768,6 +5376,14 @@ int tsk_identity_segments_get_items(const tsk_identity_segments_t *self, tsk_id_
     tsk_identity_segment_list_t **lists);
 int tsk_identity_segments_get(const tsk_identity_segments_t *self, tsk_id_t a,
     tsk_id_t b, tsk_identity_segment_list_t **ret_list);
+/* Add the pairs and segments in other to self. Both must have been computed
+ * on the same node table, and other must store at least the information
+ * that self does. Since ibd_within and ibd_between only read the input tables,
+ * a large search can be split into independent runs over subsets of the samples
+ * (which may run concurrently, each with its own result), and these results
+ * then merged into one. */
+int tsk_identity_segments_merge(
+    tsk_identity_segments_t *self, const tsk_identity_segments_t *other);
 void tsk_identity_segments_print_state(tsk_identity_segments_t *self, FILE *out);
 int tsk_identity_segments_free(tsk_identity_segments_t *self);
 
@@ -121,6 +121,10 @@ tsk_treeseq_free(tsk_treeseq_t *self)
     tsk_safe_free(self->individual_nodes_mem);
     tsk_safe_free(self->individual_nodes_length);
     tsk_safe_free(self->individual_nodes);
+    tsk_safe_free(self->seek_index.in_stop);
+    tsk_safe_free(self->seek_index.out_stop);
+    tsk_safe_free(self->seek_index.edges_offset);
+    tsk_safe_free(self->seek_index.edges);
     return 0;
 }
 
@@ -423,6 +427,52 @@ out:
     return ret;
 }
 
+/* Counts the trees using the edge indexes. This is only needed when the
+ * integrity checks, which also count the trees, are skipped. */
+static int
+tsk_treeseq_count_trees(tsk_treeseq_t *self)
+{
+    int ret = 0;
+    const tsk_table_collection_t *tables = self->tables;
+    const tsk_size_t num_edges = tables->edges.num_rows;
+    const double sequence_length = tables->sequence_length;
+    const tsk_id_t *restrict I = tables->indexes.edge_insertion_order;
+    const tsk_id_t *restrict O = tables->indexes.edge_removal_order;
+    const double *restrict edge_right = tables->edges.right;
+    const double *restrict edge_left = tables->edges.left;
+    double tree_left, tree_right;
+    tsk_size_t j, k, num_trees;
+
+    if (!tsk_table_collection_has_index(tables, 0)) {
+        ret = TSK_ERR_TABLES_NOT_INDEXED;
+        goto out;
+    }
+    tree_left = 0;
+    num_trees = 0;
+    j = 0;
+    k = 0;
+    while (j < num_edges || tree_left < sequence_length) {
+        while (k < num_edges && edge_right[O[k]] == tree_left) {
+            k++;
+        }
+        while (j < num_edges && edge_left[I[j]] == tree_left) {
+            j++;
+        }
+        tree_right = sequence_length;
+        if (j < num_edges) {
+            tree_right = TSK_MIN(tree_right, edge_left[I[j]]);
+        }
+        if (k < num_edges) {
+            tree_right = TSK_MIN(tree_right, edge_right[O[k]]);
+        }
+        tree_left = tree_right;
+        num_trees++;
+    }
+    self->num_trees = num_trees;
+out:
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_treeseq_init(
     tsk_treeseq_t *self, tsk_table_collection_t *tables, tsk_flags_t options)
@@ -458,12 +508,20 @@ tsk_treeseq_init(
             goto out;
         }
     }
-    num_trees = tsk_table_collection_check_integrity(self->tables, TSK_CHECK_TREES);
-    if (num_trees < 0) {
-        ret = (int) num_trees;
-        goto out;
+    if (options & TSK_NO_CHECK_INTEGRITY) {
+        ret = tsk_treeseq_count_trees(self);
+        if (ret != 0) {
+            goto out;
+        }
+    } else {
+        num_trees
+            = tsk_table_collection_check_integrity(self->tables, TSK_CHECK_TREES);
+        if (num_trees < 0) {
+            ret = (int) num_trees;
+            goto out;
+        }
+        self->num_trees = (tsk_size_t) num_trees;
     }
-    self->num_trees = (tsk_size_t) num_trees;
     self->discrete_genome = true;
     self->discrete_time = true;
     self->min_time = INFINITY;
@@ -486,6 +544,12 @@ tsk_treeseq_init(
     }
     tsk_treeseq_init_migrations(self);
     tsk_treeseq_init_mutations(self);
+    if (options & TSK_TS_INIT_SEEK_INDEX) {
+        ret = tsk_treeseq_build_seek_index(self, 0, 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
 
     if (tsk_treeseq_get_time_units_length(self) == strlen(TSK_TIME_UNITS_UNCALIBRATED)
         && !strncmp(tsk_treeseq_get_time_units(self), TSK_TIME_UNITS_UNCALIBRATED,
@@ -496,6 +560,113 @@ out:
     return ret;
 }
 
+int TSK_WARN_UNUSED
+tsk_treeseq_build_seek_index(
+    tsk_treeseq_t *self, tsk_size_t interval, tsk_flags_t TSK_UNUSED(options))
+{
+    int ret = 0;
+    const tsk_id_t M = (tsk_id_t) self->tables->edges.num_rows;
+    const tsk_size_t num_trees = self->num_trees;
+    /* The edges in the current tree form a doubly linked list in insertion
+     * order, with M as the sentinel. Edges are always appended to the end,
+     * so the list stays sorted. */
+    tsk_id_t *next = tsk_malloc(((tsk_size_t) M + 1) * sizeof(*next));
+    tsk_id_t *prev = tsk_malloc(((tsk_size_t) M + 1) * sizeof(*prev));
+    tsk_tree_position_t tree_pos;
+    tsk_size_t num_checkpoints, checkpoint, num_stored, max_stored;
+    tsk_id_t *edges = NULL;
+    tsk_id_t *tmp;
+    tsk_id_t j, e;
+    bool valid;
+
+    tsk_memset(&tree_pos, 0, sizeof(tree_pos));
+    tsk_safe_free(self->seek_index.in_stop);
+    tsk_safe_free(self->seek_index.out_stop);
+    tsk_safe_free(self->seek_index.edges_offset);
+    tsk_safe_free(self->seek_index.edges);
+    tsk_memset(&self->seek_index, 0, sizeof(self->seek_index));
+
+    if (interval == 0) {
+        interval = (tsk_size_t) ceil(sqrt((double) num_trees));
+        interval = TSK_MAX(interval, 1);
+    }
+    num_checkpoints = (num_trees + interval - 1) / interval;
+    self->seek_index.in_stop = tsk_malloc(num_checkpoints * sizeof(tsk_id_t));
+    self->seek_index.out_stop = tsk_malloc(num_checkpoints * sizeof(tsk_id_t));
+    self->seek_index.edges_offset
+        = tsk_malloc((num_checkpoints + 1) * sizeof(tsk_size_t));
+    max_stored = TSK_MAX(1, (tsk_size_t) M);
+    edges = tsk_malloc(max_stored * sizeof(*edges));
+    if (next == NULL || prev == NULL || self->seek_index.in_stop == NULL
+        || self->seek_index.out_stop == NULL || self->seek_index.edges_offset == NULL
+        || edges == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    ret = tsk_tree_position_init(&tree_pos, self, 0);
+    if (ret != 0) {
+        goto out;
+    }
+
+    next[M] = M;
+    prev[M] = M;
+    num_stored = 0;
+    checkpoint = 0;
+    valid = tsk_tree_position_next(&tree_pos);
+    while (valid) {
+        for (j = tree_pos.out.start; j != tree_pos.out.stop; j++) {
+            e = tree_pos.out.order[j];
+            next[prev[e]] = next[e];
+            prev[next[e]] = prev[e];
+        }
+        for (j = tree_pos.in.start; j != tree_pos.in.stop; j++) {
+            e = tree_pos.in.order[j];
+            prev[e] = prev[M];
+            next[e] = M;
+            next[prev[M]] = e;
+            prev[M] = e;
+        }
+        if ((tsk_size_t) tree_pos.index == checkpoint * interval) {
+            self->seek_index.in_stop[checkpoint] = tree_pos.in.stop;
+            self->seek_index.out_stop[checkpoint] = tree_pos.out.stop;
+            self->seek_index.edges_offset[checkpoint] = num_stored;
+            for (e = next[M]; e != M; e = next[e]) {
+                if (num_stored == max_stored) {
+                    max_stored *= 2;
+                    tmp = tsk_realloc(edges, max_stored * sizeof(*edges));
+                    if (tmp == NULL) {
+                        ret = TSK_ERR_NO_MEMORY;
+                        goto out;
+                    }
+                    edges = tmp;
+                }
+                edges[num_stored] = e;
+                num_stored++;
+            }
+            checkpoint++;
+        }
+        valid = tsk_tree_position_next(&tree_pos);
+    }
+    tsk_bug_assert(checkpoint == num_checkpoints);
+    self->seek_index.edges_offset[checkpoint] = num_stored;
+    self->seek_index.interval = interval;
+    self->seek_index.num_checkpoints = num_checkpoints;
+    self->seek_index.edges = edges;
+    edges = NULL;
+out:
+    if (ret != 0) {
+        tsk_safe_free(self->seek_index.in_stop);
+        tsk_safe_free(self->seek_index.out_stop);
+        tsk_safe_free(self->seek_index.edges_offset);
+        tsk_memset(&self->seek_index, 0, sizeof(self->seek_index));
+    }
+    tsk_tree_position_free(&tree_pos);
+    tsk_safe_free(next);
+    tsk_safe_free(prev);
+    tsk_safe_free(edges);
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_treeseq_copy_tables(
     const tsk_treeseq_t *self, tsk_table_collection_t *tables, tsk_flags_t options)
@@ -525,7 +696,8 @@ tsk_treeseq_load(tsk_treeseq_t *self, const char *filename, tsk_flags_t options)
     }
     /* TSK_TAKE_OWNERSHIP takes immediate ownership of the tables, regardless
      * of error conditions. */
-    ret = tsk_treeseq_init(self, tables, TSK_TAKE_OWNERSHIP);
+    ret = tsk_treeseq_init(
+        self, tables, TSK_TAKE_OWNERSHIP | (options & TSK_NO_CHECK_INTEGRITY));
     if (ret != 0) {
         goto out;
     }
@@ -555,7 +727,8 @@ tsk_treeseq_loadf(tsk_treeseq_t *self, FILE *file, tsk_flags_t options)
     }
     /* TSK_TAKE_OWNERSHIP takes immediate ownership of the tables, regardless
      * of error conditions. */
-    ret = tsk_treeseq_init(self, tables, TSK_TAKE_OWNERSHIP);
+    ret = tsk_treeseq_init(
+        self, tables, TSK_TAKE_OWNERSHIP | (options & TSK_NO_CHECK_INTEGRITY));
     if (ret != 0) {
         goto out;
     }
@@ -840,10 +1013,10 @@ increment_nd_array_value(double *array, tsk_size_t n, const tsk_size_t *shape,
 /* TODO flatten the reference sets input here and follow the same pattern used
  * in diversity, divergence, etc. */
 int TSK_WARN_UNUSED
-tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
+tsk_treeseq_genealogical_nearest_neighbours_interval(const tsk_treeseq_t *self,
     const tsk_id_t *focal, tsk_size_t num_focal, const tsk_id_t *const *reference_sets,
-    const tsk_size_t *reference_set_size, tsk_size_t num_reference_sets,
-    tsk_flags_t TSK_UNUSED(options), double *ret_array)
+    const tsk_size_t *reference_set_size, tsk_size_t num_reference_sets, double left,
+    double right, tsk_flags_t TSK_UNUSED(options), double *ret_array, double *ret_length)
 {
     int ret = 0;
     tsk_id_t u, v, p;
@@ -862,9 +1035,8 @@ tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
     const tsk_id_t *restrict edge_child = self->tables->edges.child;
     const double sequence_length = self->tables->sequence_length;
     tsk_id_t tj, tk, h;
-    double left, right, *A_row, scale, tree_length;
+    double tree_left, tree_right, *A_row, scale, tree_length;
     tsk_id_t *restrict parent = tsk_malloc(num_nodes * sizeof(*parent));
-    double *restrict length = tsk_calloc(num_focal, sizeof(*length));
     uint32_t *restrict ref_count
         = tsk_calloc(((tsk_size_t) K) * num_nodes, sizeof(*ref_count));
     int16_t *restrict reference_set_map
@@ -879,8 +1051,11 @@ tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
         ret = TSK_ERR_BAD_PARAM_VALUE;
         goto out;
     }
-    if (parent == NULL || ref_count == NULL || reference_set_map == NULL
-        || length == NULL) {
+    if (left < 0 || right <= left || right > sequence_length) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    if (parent == NULL || ref_count == NULL || reference_set_map == NULL) {
         ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
@@ -888,6 +1063,7 @@ tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
     tsk_memset(parent, 0xff, num_nodes * sizeof(*parent));
     tsk_memset(reference_set_map, 0xff, num_nodes * sizeof(*reference_set_map));
     tsk_memset(ret_array, 0, num_focal * num_reference_sets * sizeof(*ret_array));
+    tsk_memset(ret_length, 0, num_focal * sizeof(*ret_length));
 
     total = 0; /* keep the compiler happy */
 
@@ -919,12 +1095,36 @@ tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
         }
     }
 
-    /* Iterate over the trees */
+    /* Insert the edges of the tree at left. Edges ending at or before left
+     * are skipped, so the main loop starts with this tree. */
     tj = 0;
     tk = 0;
-    left = 0;
-    while (tj < num_edges || left < sequence_length) {
-        while (tk < num_edges && edge_right[O[tk]] == left) {
+    while (tk < num_edges && edge_right[O[tk]] <= left) {
+        tk++;
+    }
+    while (tj < num_edges && edge_left[I[tj]] <= left) {
+        h = I[tj];
+        tj++;
+        if (edge_right[h] <= left) {
+            continue;
+        }
+        u = edge_child[h];
+        v = edge_parent[h];
+        parent[u] = v;
+        child_row = GET_2D_ROW(ref_count, K, u);
+        while (v != TSK_NULL) {
+            row = GET_2D_ROW(ref_count, K, v);
+            for (k = 0; k < K; k++) {
+                row[k] += child_row[k];
+            }
+            v = parent[v];
+        }
+    }
+
+    /* Iterate over the trees */
+    tree_left = left;
+    while (tree_left < right) {
+        while (tk < num_edges && edge_right[O[tk]] == tree_left) {
             h = O[tk];
             tk++;
             u = edge_child[h];
@@ -939,7 +1139,7 @@ tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
                 v = parent[v];
             }
         }
-        while (tj < num_edges && edge_left[I[tj]] == left) {
+        while (tj < num_edges && edge_left[I[tj]] == tree_left) {
             h = I[tj];
             tj++;
             u = edge_child[h];
@@ -954,15 +1154,15 @@ tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
                 v = parent[v];
             }
         }
-        right = sequence_length;
+        tree_right = right;
         if (tj < num_edges) {
-            right = TSK_MIN(right, edge_left[I[tj]]);
+            tree_right = TSK_MIN(tree_right, edge_left[I[tj]]);
         }
         if (tk < num_edges) {
-            right = TSK_MIN(right, edge_right[O[tk]]);
+            tree_right = TSK_MIN(tree_right, edge_right[O[tk]]);
         }
 
-        tree_length = right - left;
+        tree_length = tree_right - tree_left;
         /* Process this tree */
         for (j = 0; j < num_focal; j++) {
             u = focal[j];
@@ -978,7 +1178,7 @@ tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
                 p = parent[p];
             }
             if (p != TSK_NULL) {
-                length[j] += tree_length;
+                ret_length[j] += tree_length;
                 scale = tree_length / (total - delta);
                 A_row = GET_2D_ROW(ret_array, num_reference_sets, j);
                 for (k = 0; k < K - 1; k++) {
@@ -995,17 +1195,7 @@ tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
         }
 
         /* Move on to the next tree */
-        left = right;
-    }
-
-    /* Divide by the accumulated length for each node to normalise */
-    for (j = 0; j < num_focal; j++) {
-        A_row = GET_2D_ROW(ret_array, num_reference_sets, j);
-        if (length[j] > 0) {
-            for (k = 0; k < K - 1; k++) {
-                A_row[k] /= length[j];
-            }
-        }
+        tree_left = tree_right;
     }
 out:
     /* Can't use msp_safe_free here because of restrict */
@@ -1018,16 +1208,49 @@ out:
     if (reference_set_map != NULL) {
         free(reference_set_map);
     }
-    if (length != NULL) {
-        free(length);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
+    const tsk_id_t *focal, tsk_size_t num_focal, const tsk_id_t *const *reference_sets,
+    const tsk_size_t *reference_set_size, tsk_size_t num_reference_sets,
+    tsk_flags_t options, double *ret_array)
+{
+    int ret = 0;
+    tsk_size_t j, k;
+    double *A_row;
+    double *length = tsk_calloc(num_focal, sizeof(*length));
+
+    if (length == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    ret = tsk_treeseq_genealogical_nearest_neighbours_interval(self, focal, num_focal,
+        reference_sets, reference_set_size, num_reference_sets, 0,
+        self->tables->sequence_length, options, ret_array, length);
+    if (ret != 0) {
+        goto out;
+    }
+    /* Divide by the accumulated length for each node to normalise */
+    for (j = 0; j < num_focal; j++) {
+        A_row = GET_2D_ROW(ret_array, num_reference_sets, j);
+        if (length[j] > 0) {
+            for (k = 0; k < num_reference_sets; k++) {
+                A_row[k] /= length[j];
+            }
+        }
     }
+out:
+    tsk_safe_free(length);
     return ret;
 }
 
 int TSK_WARN_UNUSED
-tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
+tsk_treeseq_mean_descendants_interval(const tsk_treeseq_t *self,
     const tsk_id_t *const *reference_sets, const tsk_size_t *reference_set_size,
-    tsk_size_t num_reference_sets, tsk_flags_t TSK_UNUSED(options), double *ret_array)
+    tsk_size_t num_reference_sets, double left, double right,
+    tsk_flags_t TSK_UNUSED(options), double *ret_array, double *ret_length)
 {
     int ret = 0;
     tsk_id_t u, v;
@@ -1045,12 +1268,11 @@ tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
     const tsk_id_t *restrict edge_child = self->tables->edges.child;
     const double sequence_length = self->tables->sequence_length;
     tsk_id_t tj, tk, h;
-    double left, right, length, *restrict C_row;
+    double tree_left, tree_right, length, *restrict C_row;
     tsk_id_t *restrict parent = tsk_malloc(num_nodes * sizeof(*parent));
     uint32_t *restrict ref_count
         = tsk_calloc(num_nodes * ((size_t) K), sizeof(*ref_count));
-    double *restrict last_update = tsk_calloc(num_nodes, sizeof(*last_update));
-    double *restrict total_length = tsk_calloc(num_nodes, sizeof(*total_length));
+    double *restrict last_update = tsk_malloc(num_nodes * sizeof(*last_update));
     uint32_t *restrict row, *restrict child_row;
 
     if (num_reference_sets == 0 || num_reference_sets > (INT32_MAX - 1)) {
@@ -1058,8 +1280,11 @@ tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
         ret = TSK_ERR_BAD_PARAM_VALUE;
         goto out;
     }
-    if (parent == NULL || ref_count == NULL || last_update == NULL
-        || total_length == NULL) {
+    if (left < 0 || right <= left || right > sequence_length) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    if (parent == NULL || ref_count == NULL || last_update == NULL) {
         ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
@@ -1067,6 +1292,10 @@ tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
 
     tsk_memset(parent, 0xff, num_nodes * sizeof(*parent));
     tsk_memset(ret_array, 0, num_nodes * num_reference_sets * sizeof(*ret_array));
+    tsk_memset(ret_length, 0, num_nodes * sizeof(*ret_length));
+    for (j = 0; j < num_nodes; j++) {
+        last_update[j] = left;
+    }
 
     /* Set the initial conditions and check the input. */
     for (k = 0; k < (int32_t) num_reference_sets; k++) {
@@ -1083,12 +1312,37 @@ tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
         }
     }
 
-    /* Iterate over the trees */
+    /* Insert the edges of the tree at left. Edges ending at or before left
+     * are skipped, so the main loop starts with this tree. Nothing has been
+     * accumulated yet, so there is no need to update the node lengths. */
     tj = 0;
     tk = 0;
-    left = 0;
-    while (tj < num_edges || left < sequence_length) {
-        while (tk < num_edges && edge_right[O[tk]] == left) {
+    while (tk < num_edges && edge_right[O[tk]] <= left) {
+        tk++;
+    }
+    while (tj < num_edges && edge_left[I[tj]] <= left) {
+        h = I[tj];
+        tj++;
+        if (edge_right[h] <= left) {
+            continue;
+        }
+        u = edge_child[h];
+        v = edge_parent[h];
+        parent[u] = v;
+        child_row = GET_2D_ROW(ref_count, K, u);
+        while (v != TSK_NULL) {
+            row = GET_2D_ROW(ref_count, K, v);
+            for (k = 0; k < K; k++) {
+                row[k] += child_row[k];
+            }
+            v = parent[v];
+        }
+    }
+
+    /* Iterate over the trees */
+    tree_left = left;
+    while (tree_left < right) {
+        while (tk < num_edges && edge_right[O[tk]] == tree_left) {
             h = O[tk];
             tk++;
             u = edge_child[h];
@@ -1097,16 +1351,16 @@ tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
             child_row = GET_2D_ROW(ref_count, K, u);
             while (v != TSK_NULL) {
                 row = GET_2D_ROW(ref_count, K, v);
-                if (last_update[v] != left) {
+                if (last_update[v] != tree_left) {
                     if (row[K - 1] > 0) {
-                        length = left - last_update[v];
+                        length = tree_left - last_update[v];
                         C_row = GET_2D_ROW(ret_array, num_reference_sets, v);
                         for (k = 0; k < (int32_t) num_reference_sets; k++) {
                             C_row[k] += length * row[k];
                         }
-                        total_length[v] += length;
+                        ret_length[v] += length;
                     }
-                    last_update[v] = left;
+                    last_update[v] = tree_left;
                 }
                 for (k = 0; k < K; k++) {
                     row[k] -= child_row[k];
@@ -1114,7 +1368,7 @@ tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
                 v = parent[v];
             }
         }
-        while (tj < num_edges && edge_left[I[tj]] == left) {
+        while (tj < num_edges && edge_left[I[tj]] == tree_left) {
             h = I[tj];
             tj++;
             u = edge_child[h];
@@ -1123,16 +1377,16 @@ tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
             child_row = GET_2D_ROW(ref_count, K, u);
             while (v != TSK_NULL) {
                 row = GET_2D_ROW(ref_count, K, v);
-                if (last_update[v] != left) {
+                if (last_update[v] != tree_left) {
                     if (row[K - 1] > 0) {
-                        length = left - last_update[v];
+                        length = tree_left - last_update[v];
                         C_row = GET_2D_ROW(ret_array, num_reference_sets, v);
                         for (k = 0; k < (int32_t) num_reference_sets; k++) {
                             C_row[k] += length * row[k];
                         }
-                        total_length[v] += length;
+                        ret_length[v] += length;
                     }
-                    last_update[v] = left;
+                    last_update[v] = tree_left;
                 }
                 for (k = 0; k < K; k++) {
                     row[k] += child_row[k];
@@ -1140,34 +1394,27 @@ tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
                 v = parent[v];
             }
         }
-        right = sequence_length;
+        tree_right = right;
         if (tj < num_edges) {
-            right = TSK_MIN(right, edge_left[I[tj]]);
+            tree_right = TSK_MIN(tree_right, edge_left[I[tj]]);
         }
         if (tk < num_edges) {
-            right = TSK_MIN(right, edge_right[O[tk]]);
+            tree_right = TSK_MIN(tree_right, edge_right[O[tk]]);
         }
-        left = right;
+        tree_left = tree_right;
     }
 
-    /* Add the stats for the last tree and divide by the total length that
-     * each node was an ancestor to > 0 of the reference nodes. */
+    /* Add the stats for the last tree */
     for (v = 0; v < (tsk_id_t) num_nodes; v++) {
         row = GET_2D_ROW(ref_count, K, v);
         C_row = GET_2D_ROW(ret_array, num_reference_sets, v);
         if (row[K - 1] > 0) {
-            length = sequence_length - last_update[v];
-            total_length[v] += length;
+            length = right - last_update[v];
+            ret_length[v] += length;
             for (k = 0; k < (int32_t) num_reference_sets; k++) {
                 C_row[k] += length * row[k];
             }
         }
-        if (total_length[v] > 0) {
-            length = total_length[v];
-            for (k = 0; k < (int32_t) num_reference_sets; k++) {
-                C_row[k] /= length;
-            }
-        }
     }
 
 out:
@@ -1181,9 +1428,42 @@ out:
     if (last_update != NULL) {
         free(last_update);
     }
-    if (total_length != NULL) {
-        free(total_length);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
+    const tsk_id_t *const *reference_sets, const tsk_size_t *reference_set_size,
+    tsk_size_t num_reference_sets, tsk_flags_t options, double *ret_array)
+{
+    int ret = 0;
+    tsk_size_t j, k;
+    const tsk_size_t num_nodes = self->tables->nodes.num_rows;
+    double *C_row;
+    double *total_length = tsk_calloc(num_nodes, sizeof(*total_length));
+
+    if (total_length == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    ret = tsk_treeseq_mean_descendants_interval(self, reference_sets,
+        reference_set_size, num_reference_sets, 0, self->tables->sequence_length,
+        options, ret_array, total_length);
+    if (ret != 0) {
+        goto out;
+    }
+    /* Divide by the total length that each node was an ancestor to > 0 of the
+     * reference nodes. */
+    for (j = 0; j < num_nodes; j++) {
+        C_row = GET_2D_ROW(ret_array, num_reference_sets, j);
+        if (total_length[j] > 0) {
+            for (k = 0; k < num_reference_sets; k++) {
+                C_row[k] /= total_length[j];
+            }
+        }
     }
+out:
+    tsk_safe_free(total_length);
     return ret;
 }
 
@@ -1205,7 +1485,7 @@ tsk_treeseq_check_windows(const tsk_treeseq_t *self, tsk_size_t num_windows,
         goto out;
     }
     if (options & TSK_REQUIRE_FULL_SPAN) {
-        /* TODO the general stat code currently requires that we include the
+        /* TODO the AFS code currently requires that we include the
          * entire tree sequence span. This should be relaxed, so hopefully
          * this branch (and the option) can be removed at some point */
         if (windows[0] != 0) {
@@ -1232,6 +1512,26 @@ out:
     return ret;
 }
 
+static int
+tsk_treeseq_check_time_windows(tsk_size_t num_time_windows, const double *time_windows)
+{
+    int ret = TSK_ERR_BAD_TIME_WINDOWS;
+    tsk_size_t j;
+
+    if (num_time_windows < 1) {
+        goto out;
+    }
+    for (j = 0; j < num_time_windows; j++) {
+        /* Written so that NaN values fail the check */
+        if (!(time_windows[j] < time_windows[j + 1])) {
+            goto out;
+        }
+    }
+    ret = 0;
+out:
+    return ret;
+}
+
 /* TODO make these functions more consistent in how the arguments are ordered */
 
 static inline void
@@ -1253,26 +1553,52 @@ update_node_summary(tsk_id_t u, tsk_size_t result_dim, double *node_summary, dou
     double *X_u = GET_2D_ROW(X, state_dim, u);
     double *summary_u = GET_2D_ROW(node_summary, result_dim, u);
 
+    TSK_COUNTER_ADD(summary_func_calls, 1);
     return f(state_dim, X_u, result_dim, summary_u, f_params);
 }
 
+/* The running sum has one row of result_dim values for each time window, and
+ * branch_length has one value for each time window for each node: the length
+ * of the intersection of the branch above the node with that time window. */
 static inline void
 update_running_sum(tsk_id_t u, double sign, const double *restrict branch_length,
-    const double *summary, tsk_size_t result_dim, double *running_sum)
+    const double *summary, tsk_size_t result_dim, tsk_size_t num_time_windows,
+    double *running_sum)
 {
     const double *summary_u = GET_2D_ROW(summary, result_dim, u);
-    const double x = sign * branch_length[u];
-    tsk_size_t m;
+    const double *branch_length_u = GET_2D_ROW(branch_length, num_time_windows, u);
+    double *running_sum_row;
+    double x;
+    tsk_size_t m, t;
 
-    for (m = 0; m < result_dim; m++) {
-        running_sum[m] += x * summary_u[m];
+    for (t = 0; t < num_time_windows; t++) {
+        x = sign * branch_length_u[t];
+        running_sum_row = GET_2D_ROW(running_sum, result_dim, t);
+        for (m = 0; m < result_dim; m++) {
+            running_sum_row[m] += x * summary_u[m];
+        }
+    }
+}
+
+static inline void
+set_branch_length(double *restrict branch_length_u, double child_time,
+    double parent_time, tsk_size_t num_time_windows, const double *time_windows)
+{
+    double lower, upper;
+    tsk_size_t t;
+
+    for (t = 0; t < num_time_windows; t++) {
+        lower = TSK_MAX(child_time, time_windows[t]);
+        upper = TSK_MIN(parent_time, time_windows[t + 1]);
+        branch_length_u[t] = upper > lower ? upper - lower : 0;
     }
 }
 
 static int
 tsk_treeseq_branch_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     const double *sample_weights, tsk_size_t result_dim, general_stat_func_t *f,
-    void *f_params, tsk_size_t num_windows, const double *windows, tsk_flags_t options,
+    void *f_params, tsk_size_t num_windows, const double *windows,
+    tsk_size_t num_time_windows, const double *time_windows, tsk_flags_t options,
     double *result)
 {
     int ret = 0;
@@ -1287,16 +1613,18 @@ tsk_treeseq_branch_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     const tsk_id_t *restrict edge_parent = self->tables->edges.parent;
     const tsk_id_t *restrict edge_child = self->tables->edges.child;
     const double *restrict time = self->tables->nodes.time;
-    const double sequence_length = self->tables->sequence_length;
+    const double stop = windows[num_windows];
     tsk_id_t *restrict parent = tsk_malloc(num_nodes * sizeof(*parent));
-    double *restrict branch_length = tsk_calloc(num_nodes, sizeof(*branch_length));
+    double *restrict branch_length
+        = tsk_calloc(num_nodes * num_time_windows, sizeof(*branch_length));
     tsk_id_t tj, tk, h;
     double t_left, t_right, w_left, w_right, left, right, scale;
     const double *weight_u;
     double *state_u, *result_row, *summary_u;
     double *state = tsk_calloc(num_nodes * state_dim, sizeof(*state));
     double *summary = tsk_calloc(num_nodes * result_dim, sizeof(*summary));
-    double *running_sum = tsk_calloc(result_dim, sizeof(*running_sum));
+    double *running_sum = tsk_calloc(num_time_windows * result_dim, sizeof(*running_sum));
+    const tsk_size_t row_size = num_time_windows * result_dim;
 
     if (self->time_uncalibrated && !(options & TSK_STAT_ALLOW_TIME_UNCALIBRATED)) {
         ret = TSK_ERR_TIME_UNCALIBRATED;
@@ -1317,71 +1645,85 @@ tsk_treeseq_branch_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
         weight_u = GET_2D_ROW(sample_weights, state_dim, j);
         tsk_memcpy(state_u, weight_u, state_dim * sizeof(*state_u));
         summary_u = GET_2D_ROW(summary, result_dim, u);
+        TSK_COUNTER_ADD(summary_func_calls, 1);
         ret = f(state_dim, state_u, result_dim, summary_u, f_params);
         if (ret != 0) {
             goto out;
         }
     }
-    tsk_memset(result, 0, num_windows * result_dim * sizeof(*result));
+    tsk_memset(result, 0, num_windows * row_size * sizeof(*result));
 
-    /* Iterate over the trees */
+    /* Iterate over the trees. The windows need not start at zero, so we skip
+     * over edges that end before the first window and then, on the first
+     * iteration, insert all edges that intersect it. After that, edges are
+     * inserted/removed exactly as they would be when starting from zero. */
     tj = 0;
     tk = 0;
-    t_left = 0;
+    t_left = windows[0];
+    while (tk < num_edges && edge_right[O[tk]] <= t_left) {
+        tk++;
+    }
     window_index = 0;
-    while (tj < num_edges || t_left < sequence_length) {
+    while (t_left < stop) {
         while (tk < num_edges && edge_right[O[tk]] == t_left) {
             h = O[tk];
             tk++;
 
             u = edge_child[h];
-            update_running_sum(u, -1, branch_length, summary, result_dim, running_sum);
+            update_running_sum(u, -1, branch_length, summary, result_dim,
+                num_time_windows, running_sum);
             parent[u] = TSK_NULL;
-            branch_length[u] = 0;
+            tsk_memset(GET_2D_ROW(branch_length, num_time_windows, u), 0,
+                num_time_windows * sizeof(*branch_length));
 
             u = edge_parent[h];
             while (u != TSK_NULL) {
-                update_running_sum(
-                    u, -1, branch_length, summary, result_dim, running_sum);
+                update_running_sum(u, -1, branch_length, summary, result_dim,
+                    num_time_windows, running_sum);
                 update_state(state, state_dim, u, edge_child[h], -1);
                 ret = update_node_summary(
                     u, result_dim, summary, state, state_dim, f, f_params);
                 if (ret != 0) {
                     goto out;
                 }
-                update_running_sum(
-                    u, +1, branch_length, summary, result_dim, running_sum);
+                update_running_sum(u, +1, branch_length, summary, result_dim,
+                    num_time_windows, running_sum);
                 u = parent[u];
             }
         }
 
-        while (tj < num_edges && edge_left[I[tj]] == t_left) {
+        while (tj < num_edges && edge_left[I[tj]] <= t_left) {
             h = I[tj];
             tj++;
+            if (edge_right[h] <= t_left) {
+                continue;
+            }
 
             u = edge_child[h];
             v = edge_parent[h];
             parent[u] = v;
-            branch_length[u] = time[v] - time[u];
-            update_running_sum(u, +1, branch_length, summary, result_dim, running_sum);
+            set_branch_length(GET_2D_ROW(branch_length, num_time_windows, u), time[u],
+                time[v], num_time_windows, time_windows);
+            update_running_sum(u, +1, branch_length, summary, result_dim,
+                num_time_windows, running_sum);
 
             u = v;
             while (u != TSK_NULL) {
-                update_running_sum(
-                    u, -1, branch_length, summary, result_dim, running_sum);
+                update_running_sum(u, -1, branch_length, summary, result_dim,
+                    num_time_windows, running_sum);
                 update_state(state, state_dim, u, edge_child[h], +1);
                 ret = update_node_summary(
                     u, result_dim, summary, state, state_dim, f, f_params);
                 if (ret != 0) {
                     goto out;
                 }
-                update_running_sum(
-                    u, +1, branch_length, summary, result_dim, running_sum);
+                update_running_sum(u, +1, branch_length, summary, result_dim,
+                    num_time_windows, running_sum);
                 u = parent[u];
             }
         }
 
-        t_right = sequence_length;
+        t_right = stop;
         if (tj < num_edges) {
             t_right = TSK_MIN(t_right, edge_left[I[tj]]);
         }
@@ -1397,8 +1739,8 @@ tsk_treeseq_branch_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
             right = TSK_MIN(t_right, w_right);
             scale = (right - left);
             tsk_bug_assert(scale > 0);
-            result_row = GET_2D_ROW(result, result_dim, window_index);
-            for (k = 0; k < result_dim; k++) {
+            result_row = GET_2D_ROW(result, row_size, window_index);
+            for (k = 0; k < row_size; k++) {
                 result_row[k] += running_sum[k] * scale;
             }
 
@@ -1542,6 +1884,7 @@ compute_general_stat_site_result(tsk_site_t *site, double *state, tsk_size_t sta
     /* Sum over the allele weights. Skip the ancestral state if this is a polarised stat
      */
     for (allele = polarised ? 1 : 0; allele < num_alleles; allele++) {
+        TSK_COUNTER_ADD(summary_func_calls, 1);
         ret = f(state_dim, GET_2D_ROW(allele_states, state_dim, allele), result_dim,
             result_tmp, f_params);
         if (ret != 0) {
@@ -1574,7 +1917,7 @@ tsk_treeseq_site_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     const double *restrict edge_right = self->tables->edges.right;
     const tsk_id_t *restrict edge_parent = self->tables->edges.parent;
     const tsk_id_t *restrict edge_child = self->tables->edges.child;
-    const double sequence_length = self->tables->sequence_length;
+    const double stop = windows[num_windows];
     tsk_id_t *restrict parent = tsk_malloc(num_nodes * sizeof(*parent));
     tsk_site_t *site;
     tsk_id_t tj, tk, h;
@@ -1608,13 +1951,20 @@ tsk_treeseq_site_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     }
     tsk_memset(result, 0, num_windows * result_dim * sizeof(*result));
 
-    /* Iterate over the trees */
+    /* Iterate over the trees, starting from the one containing windows[0]
+     * (see tsk_treeseq_branch_general_stat for details) */
     tj = 0;
     tk = 0;
-    t_left = 0;
-    tree_index = 0;
+    t_left = windows[0];
+    while (tk < num_edges && edge_right[O[tk]] <= t_left) {
+        tk++;
+    }
+    tree_index = tsk_search_sorted(self->breakpoints, self->num_trees + 1, t_left);
+    if (self->breakpoints[tree_index] > t_left) {
+        tree_index--;
+    }
     window_index = 0;
-    while (tj < num_edges || t_left < sequence_length) {
+    while (t_left < stop) {
         while (tk < num_edges && edge_right[O[tk]] == t_left) {
             h = O[tk];
             tk++;
@@ -1627,9 +1977,12 @@ tsk_treeseq_site_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
             parent[u] = TSK_NULL;
         }
 
-        while (tj < num_edges && edge_left[I[tj]] == t_left) {
+        while (tj < num_edges && edge_left[I[tj]] <= t_left) {
             h = I[tj];
             tj++;
+            if (edge_right[h] <= t_left) {
+                continue;
+            }
             u = edge_child[h];
             v = edge_parent[h];
             parent[u] = v;
@@ -1638,7 +1991,7 @@ tsk_treeseq_site_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
                 v = parent[v];
             }
         }
-        t_right = sequence_length;
+        t_right = stop;
         if (tj < num_edges) {
             t_right = TSK_MIN(t_right, edge_left[I[tj]]);
         }
@@ -1650,6 +2003,9 @@ tsk_treeseq_site_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
         for (tree_site = 0; tree_site < self->tree_sites_length[tree_index];
              tree_site++) {
             site = self->tree_sites[tree_index] + tree_site;
+            if (site->position < windows[0] || site->position >= stop) {
+                continue;
+            }
             ret = compute_general_stat_site_result(site, state, state_dim, result_dim, f,
                 f_params, total_weight, polarised, site_result);
             if (ret != 0) {
@@ -1708,7 +2064,7 @@ tsk_treeseq_node_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     const double *restrict edge_right = self->tables->edges.right;
     const tsk_id_t *restrict edge_parent = self->tables->edges.parent;
     const tsk_id_t *restrict edge_child = self->tables->edges.child;
-    const double sequence_length = self->tables->sequence_length;
+    const double stop = windows[num_windows];
     tsk_id_t *restrict parent = tsk_malloc(num_nodes * sizeof(*parent));
     tsk_id_t tj, tk, h;
     const double *weight_u;
@@ -1724,6 +2080,9 @@ tsk_treeseq_node_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     }
     tsk_memset(parent, 0xff, num_nodes * sizeof(*parent));
     tsk_memset(result, 0, num_windows * num_nodes * result_dim * sizeof(*result));
+    for (u = 0; u < (tsk_id_t) num_nodes; u++) {
+        last_update[u] = windows[0];
+    }
 
     /* Set the initial conditions */
     for (j = 0; j < self->num_samples; j++) {
@@ -1740,12 +2099,16 @@ tsk_treeseq_node_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
         }
     }
 
-    /* Iterate over the trees */
+    /* Iterate over the trees, starting from the one containing windows[0]
+     * (see tsk_treeseq_branch_general_stat for details) */
     tj = 0;
     tk = 0;
-    t_left = 0;
+    t_left = windows[0];
+    while (tk < num_edges && edge_right[O[tk]] <= t_left) {
+        tk++;
+    }
     window_index = 0;
-    while (tj < num_edges || t_left < sequence_length) {
+    while (t_left < stop) {
         tsk_bug_assert(window_index < num_windows);
         while (tk < num_edges && edge_right[O[tk]] == t_left) {
             h = O[tk];
@@ -1768,9 +2131,12 @@ tsk_treeseq_node_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
             parent[u] = TSK_NULL;
         }
 
-        while (tj < num_edges && edge_left[I[tj]] == t_left) {
+        while (tj < num_edges && edge_left[I[tj]] <= t_left) {
             h = I[tj];
             tj++;
+            if (edge_right[h] <= t_left) {
+                continue;
+            }
             u = edge_child[h];
             v = edge_parent[h];
             parent[u] = v;
@@ -1789,7 +2155,7 @@ tsk_treeseq_node_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
             }
         }
 
-        t_right = sequence_length;
+        t_right = stop;
         if (tj < num_edges) {
             t_right = TSK_MIN(t_right, edge_left[I[tj]]);
         }
@@ -1885,7 +2251,8 @@ out:
 static int
 tsk_polarisable_func_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     const double *sample_weights, tsk_size_t result_dim, general_stat_func_t *f,
-    void *f_params, tsk_size_t num_windows, const double *windows, tsk_flags_t options,
+    void *f_params, tsk_size_t num_windows, const double *windows,
+    tsk_size_t num_time_windows, const double *time_windows, tsk_flags_t options,
     double *result)
 {
     int ret = 0;
@@ -1925,8 +2292,8 @@ tsk_polarisable_func_general_stat(const tsk_treeseq_t *self, tsk_size_t state_di
 
     if (stat_branch) {
         ret = tsk_treeseq_branch_general_stat(self, state_dim, sample_weights,
-            result_dim, wrapped_f, wrapped_f_params, num_windows, windows, options,
-            result);
+            result_dim, wrapped_f, wrapped_f_params, num_windows, windows,
+            num_time_windows, time_windows, options, result);
     } else {
         ret = tsk_treeseq_node_general_stat(self, state_dim, sample_weights, result_dim,
             wrapped_f, wrapped_f_params, num_windows, windows, options, result);
@@ -1939,9 +2306,10 @@ out:
 }
 
 int
-tsk_treeseq_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
+tsk_treeseq_general_stat_time_windows(const tsk_treeseq_t *self, tsk_size_t state_dim,
     const double *sample_weights, tsk_size_t result_dim, general_stat_func_t *f,
-    void *f_params, tsk_size_t num_windows, const double *windows, tsk_flags_t options,
+    void *f_params, tsk_size_t num_windows, const double *windows,
+    tsk_size_t num_time_windows, const double *time_windows, tsk_flags_t options,
     double *result)
 {
     int ret = 0;
@@ -1949,8 +2317,11 @@ tsk_treeseq_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     bool stat_branch = !!(options & TSK_STAT_BRANCH);
     bool stat_node = !!(options & TSK_STAT_NODE);
     double default_windows[] = { 0, self->tables->sequence_length };
+    /* Without time windows, branches are counted over their whole length */
+    double default_time_windows[] = { -INFINITY, INFINITY };
     tsk_size_t row_size;
 
+    TSK_TIMER_START(stats_time);
     /* If no mode is specified, we default to site mode */
     if (!(stat_site || stat_branch || stat_node)) {
         stat_site = true;
@@ -1973,8 +2344,21 @@ tsk_treeseq_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
         num_windows = 1;
         windows = default_windows;
     } else {
-        ret = tsk_treeseq_check_windows(
-            self, num_windows, windows, TSK_REQUIRE_FULL_SPAN);
+        ret = tsk_treeseq_check_windows(self, num_windows, windows, 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    if (time_windows == NULL) {
+        num_time_windows = 1;
+        time_windows = default_time_windows;
+    } else {
+        /* Only branch lengths can be divided up by time */
+        if (!stat_branch) {
+            ret = TSK_ERR_UNSUPPORTED_STAT_MODE;
+            goto out;
+        }
+        ret = tsk_treeseq_check_time_windows(num_time_windows, time_windows);
         if (ret != 0) {
             goto out;
         }
@@ -1985,11 +2369,12 @@ tsk_treeseq_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
             f, f_params, num_windows, windows, options, result);
     } else {
         ret = tsk_polarisable_func_general_stat(self, state_dim, sample_weights,
-            result_dim, f, f_params, num_windows, windows, options, result);
+            result_dim, f, f_params, num_windows, windows, num_time_windows,
+            time_windows, options, result);
     }
 
     if (options & TSK_STAT_SPAN_NORMALISE) {
-        row_size = result_dim;
+        row_size = result_dim * num_time_windows;
         if (stat_node) {
             row_size = result_dim * tsk_treeseq_get_num_nodes(self);
         }
@@ -1997,16 +2382,27 @@ tsk_treeseq_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     }
 
 out:
+    TSK_TIMER_STOP(stats_time);
     return ret;
 }
 
-static int
-check_set_indexes(
-    tsk_size_t num_sets, tsk_size_t num_set_indexes, const tsk_id_t *set_indexes)
-{
-    int ret = 0;
-    tsk_size_t j;
-
+int
+tsk_treeseq_general_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
+    const double *sample_weights, tsk_size_t result_dim, general_stat_func_t *f,
+    void *f_params, tsk_size_t num_windows, const double *windows, tsk_flags_t options,
+    double *result)
+{
+    return tsk_treeseq_general_stat_time_windows(self, state_dim, sample_weights,
+        result_dim, f, f_params, num_windows, windows, 0, NULL, options, result);
+}
+
+static int
+check_set_indexes(
+    tsk_size_t num_sets, tsk_size_t num_set_indexes, const tsk_id_t *set_indexes)
+{
+    int ret = 0;
+    tsk_size_t j;
+
     for (j = 0; j < num_set_indexes; j++) {
         if (set_indexes[j] < 0 || set_indexes[j] >= (tsk_id_t) num_sets) {
             ret = TSK_ERR_BAD_SAMPLE_SET_INDEX;
@@ -2077,10 +2473,12 @@ typedef struct {
 } indexed_weight_stat_params_t;
 
 static int
-tsk_treeseq_sample_count_stat(const tsk_treeseq_t *self, tsk_size_t num_sample_sets,
-    const tsk_size_t *sample_set_sizes, const tsk_id_t *sample_sets,
-    tsk_size_t result_dim, const tsk_id_t *set_indexes, general_stat_func_t *f,
-    tsk_size_t num_windows, const double *windows, tsk_flags_t options, double *result)
+tsk_treeseq_sample_count_stat_time_windows(const tsk_treeseq_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, tsk_size_t result_dim, const tsk_id_t *set_indexes,
+    general_stat_func_t *f, tsk_size_t num_windows, const double *windows,
+    tsk_size_t num_time_windows, const double *time_windows, tsk_flags_t options,
+    double *result)
 {
     int ret = 0;
     const tsk_size_t num_samples = self->num_samples;
@@ -2117,17 +2515,33 @@ tsk_treeseq_sample_count_stat(const tsk_treeseq_t *self, tsk_size_t num_sample_s
             j++;
         }
     }
-    ret = tsk_treeseq_general_stat(self, num_sample_sets, weights, result_dim, f, &args,
-        num_windows, windows, options, result);
+    ret = tsk_treeseq_general_stat_time_windows(self, num_sample_sets, weights,
+        result_dim, f, &args, num_windows, windows, num_time_windows, time_windows,
+        options, result);
 out:
     tsk_safe_free(weights);
     return ret;
 }
 
+static int
+tsk_treeseq_sample_count_stat(const tsk_treeseq_t *self, tsk_size_t num_sample_sets,
+    const tsk_size_t *sample_set_sizes, const tsk_id_t *sample_sets,
+    tsk_size_t result_dim, const tsk_id_t *set_indexes, general_stat_func_t *f,
+    tsk_size_t num_windows, const double *windows, tsk_flags_t options, double *result)
+{
+    return tsk_treeseq_sample_count_stat_time_windows(self, num_sample_sets,
+        sample_set_sizes, sample_sets, result_dim, set_indexes, f, num_windows, windows,
+        0, NULL, options, result);
+}
+
 /***********************************
  * Two Locus Statistics
  ***********************************/
 
+/* The target size in bytes of the per-tile working set of site bit arrays
+ * when computing two-site statistics; roughly the size of a typical L2 cache. */
+#define TSK_TWO_SITE_TILE_BYTES (256 * 1024)
+
 static int
 get_allele_samples(const tsk_site_t *site, const tsk_bit_array_t *state,
     tsk_bit_array_t *out_allele_samples, tsk_size_t *out_num_alleles)
@@ -2251,19 +2665,58 @@ get_all_samples_bits(tsk_bit_array_t *all_samples, tsk_size_t n)
 typedef int norm_func_t(tsk_size_t state_dim, const double *hap_weights, tsk_size_t n_a,
     tsk_size_t n_b, double *result, void *params);
 
+/* Scratch memory used when computing the statistic for a pair of sites.
+ * This is allocated once per call, sized for the largest number of alleles
+ * among the sites, so that we don't allocate for every pair of sites. */
+typedef struct {
+    tsk_bit_array_t AB_samples;
+    double *weights;
+    double *norm;
+    double *result_tmp;
+} two_site_stat_workspace_t;
+
+static int
+two_site_stat_workspace_init(two_site_stat_workspace_t *self, tsk_size_t num_samples,
+    tsk_size_t state_dim, tsk_size_t max_alleles)
+{
+    int ret = 0;
+
+    tsk_memset(self, 0, sizeof(*self));
+    self->weights = tsk_malloc(3 * state_dim * sizeof(*self->weights));
+    self->norm = tsk_malloc(state_dim * sizeof(*self->norm));
+    self->result_tmp = tsk_malloc(
+        max_alleles * max_alleles * state_dim * sizeof(*self->result_tmp));
+    if (self->weights == NULL || self->norm == NULL || self->result_tmp == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    ret = tsk_bit_array_init(&self->AB_samples, num_samples, 1);
+out:
+    return ret;
+}
+
+static void
+two_site_stat_workspace_free(two_site_stat_workspace_t *self)
+{
+    tsk_safe_free(self->weights);
+    tsk_safe_free(self->norm);
+    tsk_safe_free(self->result_tmp);
+    tsk_bit_array_free(&self->AB_samples);
+}
+
 static int
 compute_general_two_site_stat_result(const tsk_bit_array_t *site_a_state,
     const tsk_bit_array_t *site_b_state, tsk_size_t num_a_alleles,
-    tsk_size_t num_b_alleles, tsk_size_t num_samples, tsk_size_t state_dim,
-    const tsk_bit_array_t *sample_sets, tsk_size_t result_dim, general_stat_func_t *f,
-    sample_count_stat_params_t *f_params, norm_func_t *norm_f, bool polarised,
+    tsk_size_t num_b_alleles, tsk_size_t state_dim, const tsk_bit_array_t *sample_sets,
+    tsk_size_t result_dim, general_stat_func_t *f, sample_count_stat_params_t *f_params,
+    norm_func_t *norm_f, bool polarised, two_site_stat_workspace_t *workspace,
     double *result)
 {
     int ret = 0;
     tsk_bit_array_t A_samples, B_samples;
     // ss_ prefix refers to a sample set
     tsk_bit_array_t ss_row;
-    tsk_bit_array_t ss_A_samples, ss_B_samples, ss_AB_samples, AB_samples;
+    tsk_bit_array_t *AB_samples = &workspace->AB_samples;
     // Sample sets and b sites are rows, a sites are columns
     //       b1           b2           b3
     // a1   [s1, s2, s3] [s1, s2, s3] [s1, s2, s3]
@@ -2275,59 +2728,29 @@ compute_general_two_site_stat_result(const tsk_bit_array_t *site_a_state,
     uint8_t polarised_val = polarised ? 1 : 0;
     double *hap_weight_row;
     double *result_tmp_row;
-    double *weights = tsk_malloc(3 * state_dim * sizeof(*weights));
-    double *norm = tsk_malloc(state_dim * sizeof(*norm));
-    double *result_tmp = tsk_malloc(row_len * num_a_alleles * sizeof(*result_tmp));
-
-    tsk_memset(&ss_A_samples, 0, sizeof(ss_A_samples));
-    tsk_memset(&ss_B_samples, 0, sizeof(ss_B_samples));
-    tsk_memset(&ss_AB_samples, 0, sizeof(ss_AB_samples));
-    tsk_memset(&AB_samples, 0, sizeof(AB_samples));
-
-    if (weights == NULL || norm == NULL || result_tmp == NULL) {
-        ret = TSK_ERR_NO_MEMORY;
-        goto out;
-    }
-
-    ret = tsk_bit_array_init(&ss_A_samples, num_samples, 1);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_bit_array_init(&ss_B_samples, num_samples, 1);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_bit_array_init(&ss_AB_samples, num_samples, 1);
-    if (ret != 0) {
-        goto out;
-    }
-    ret = tsk_bit_array_init(&AB_samples, num_samples, 1);
-    if (ret != 0) {
-        goto out;
-    }
+    double *weights = workspace->weights;
+    double *norm = workspace->norm;
+    double *result_tmp = workspace->result_tmp;
 
     for (mut_a = polarised_val; mut_a < num_a_alleles; mut_a++) {
         result_tmp_row = GET_2D_ROW(result_tmp, row_len, mut_a);
         for (mut_b = polarised_val; mut_b < num_b_alleles; mut_b++) {
             tsk_bit_array_get_row(site_a_state, mut_a, &A_samples);
             tsk_bit_array_get_row(site_b_state, mut_b, &B_samples);
-            tsk_bit_array_intersect(&A_samples, &B_samples, &AB_samples);
+            tsk_bit_array_intersect(&A_samples, &B_samples, AB_samples);
             for (k = 0; k < state_dim; k++) {
                 tsk_bit_array_get_row(sample_sets, k, &ss_row);
                 hap_weight_row = GET_2D_ROW(weights, 3, k);
 
-                tsk_bit_array_intersect(&A_samples, &ss_row, &ss_A_samples);
-                tsk_bit_array_intersect(&B_samples, &ss_row, &ss_B_samples);
-                tsk_bit_array_intersect(&AB_samples, &ss_row, &ss_AB_samples);
-
-                w_AB = tsk_bit_array_count(&ss_AB_samples);
-                w_A = tsk_bit_array_count(&ss_A_samples);
-                w_B = tsk_bit_array_count(&ss_B_samples);
+                w_AB = tsk_bit_array_intersect_count(AB_samples, &ss_row);
+                w_A = tsk_bit_array_intersect_count(&A_samples, &ss_row);
+                w_B = tsk_bit_array_intersect_count(&B_samples, &ss_row);
 
                 hap_weight_row[0] = (double) w_AB;
                 hap_weight_row[1] = (double) (w_A - w_AB); // w_Ab
                 hap_weight_row[2] = (double) (w_B - w_AB); // w_aB
             }
+            TSK_COUNTER_ADD(summary_func_calls, 1);
             ret = f(state_dim, weights, result_dim, result_tmp_row, f_params);
             if (ret != 0) {
                 goto out;
@@ -2343,15 +2766,7 @@ compute_general_two_site_stat_result(const tsk_bit_array_t *site_a_state,
             result_tmp_row += state_dim; // Advance to the next column
         }
     }
-
 out:
-    tsk_safe_free(weights);
-    tsk_safe_free(norm);
-    tsk_safe_free(result_tmp);
-    tsk_bit_array_free(&ss_A_samples);
-    tsk_bit_array_free(&ss_B_samples);
-    tsk_bit_array_free(&ss_AB_samples);
-    tsk_bit_array_free(&AB_samples);
     return ret;
 }
 
@@ -2498,15 +2913,18 @@ tsk_treeseq_two_site_count_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
 
     int ret = 0;
     tsk_bit_array_t allele_samples, c_state, r_state;
+    two_site_stat_workspace_t workspace;
     bool polarised = false;
     tsk_id_t *sites;
     tsk_size_t r, c, s, n_alleles, n_sites, *row_idx, *col_idx;
+    tsk_size_t max_alleles, tile_size, r_start, r_stop, c_start, c_stop;
     double *result_row;
     const tsk_size_t num_samples = self->num_samples;
     tsk_size_t *num_alleles = NULL, *site_offsets = NULL;
     tsk_size_t result_row_len = n_cols * result_dim;
 
     tsk_memset(&allele_samples, 0, sizeof(allele_samples));
+    tsk_memset(&workspace, 0, sizeof(workspace));
 
     sites = tsk_malloc(self->tables->sites.num_rows * sizeof(*sites));
     row_idx = tsk_malloc(self->tables->sites.num_rows * sizeof(*row_idx));
@@ -2544,24 +2962,51 @@ tsk_treeseq_two_site_count_stat(const tsk_treeseq_t *self, tsk_size_t state_dim,
     if (options & TSK_STAT_POLARISED) {
         polarised = true;
     }
+    /* Results are accumulated over pairs of alleles */
+    tsk_memset(result, 0, n_rows * n_cols * result_dim * sizeof(*result));
 
-    // For each row/column pair, fill in the sample set in the result matrix.
-    for (r = 0; r < n_rows; r++) {
-        result_row = GET_2D_ROW(result, result_row_len, r);
-        for (c = 0; c < n_cols; c++) {
-            tsk_bit_array_get_row(&allele_samples, site_offsets[row_idx[r]], &r_state);
-            tsk_bit_array_get_row(&allele_samples, site_offsets[col_idx[c]], &c_state);
-            ret = compute_general_two_site_stat_result(&r_state, &c_state,
-                num_alleles[row_idx[r]], num_alleles[col_idx[c]], num_samples, state_dim,
-                sample_sets, result_dim, f, f_params, norm_f, polarised,
-                &(result_row[c * result_dim]));
-            if (ret != 0) {
-                goto out;
+    max_alleles = 0;
+    for (s = 0; s < n_sites; s++) {
+        max_alleles = TSK_MAX(max_alleles, num_alleles[s]);
+    }
+    ret = two_site_stat_workspace_init(&workspace, num_samples, state_dim, max_alleles);
+    if (ret != 0) {
+        goto out;
+    }
+
+    /* For each row/column pair, fill in the sample set in the result matrix.
+     * We work through the matrix in square tiles, chosen so that the allele
+     * bit arrays for the row and column sites in a tile (assuming biallelic
+     * sites) fit in TSK_TWO_SITE_TILE_BYTES. The column bit arrays are then
+     * still in cache when we revisit them for the next row in the tile. */
+    tile_size = TSK_TWO_SITE_TILE_BYTES
+                / (4 * TSK_MAX(1, allele_samples.size) * sizeof(tsk_bit_array_value_t));
+    tile_size = TSK_MAX(1, tile_size);
+    for (r_start = 0; r_start < n_rows; r_start += tile_size) {
+        r_stop = TSK_MIN(n_rows, r_start + tile_size);
+        for (c_start = 0; c_start < n_cols; c_start += tile_size) {
+            c_stop = TSK_MIN(n_cols, c_start + tile_size);
+            for (r = r_start; r < r_stop; r++) {
+                result_row = GET_2D_ROW(result, result_row_len, r);
+                tsk_bit_array_get_row(
+                    &allele_samples, site_offsets[row_idx[r]], &r_state);
+                for (c = c_start; c < c_stop; c++) {
+                    tsk_bit_array_get_row(
+                        &allele_samples, site_offsets[col_idx[c]], &c_state);
+                    ret = compute_general_two_site_stat_result(&r_state, &c_state,
+                        num_alleles[row_idx[r]], num_alleles[col_idx[c]], state_dim,
+                        sample_sets, result_dim, f, f_params, norm_f, polarised,
+                        &workspace, &(result_row[c * result_dim]));
+                    if (ret != 0) {
+                        goto out;
+                    }
+                }
             }
         }
     }
 
 out:
+    two_site_stat_workspace_free(&workspace);
     tsk_safe_free(sites);
     tsk_safe_free(row_idx);
     tsk_safe_free(col_idx);
@@ -2656,6 +3101,7 @@ tsk_treeseq_two_locus_count_stat(const tsk_treeseq_t *self, tsk_size_t num_sampl
         .sample_set_sizes = sample_set_sizes,
         .set_indexes = set_indexes };
 
+    TSK_TIMER_START(stats_time);
     tsk_memset(&sample_sets_bits, 0, sizeof(sample_sets_bits));
 
     // If no mode is specified, we default to site mode
@@ -2702,6 +3148,7 @@ tsk_treeseq_two_locus_count_stat(const tsk_treeseq_t *self, tsk_size_t num_sampl
 
 out:
     tsk_bit_array_free(&sample_sets_bits);
+    TSK_TIMER_STOP(stats_time);
     return ret;
 }
 
@@ -2738,16 +3185,322 @@ fold(tsk_size_t *restrict coordinate, const tsk_size_t *restrict dims,
     }
 }
 
+/* Accumulates a sparse AFS one window at a time. The entries for the current
+ * window are the tail of the result arrays, starting at
+ * result->window_offset[window_index], and are found through an open
+ * addressing table of entry indexes. If a projection is used, each allele count
+ * is spread over the projected counts with hypergeometric weights. */
+typedef struct {
+    tsk_size_t num_dims;
+    tsk_size_t window_index;
+    const double *windows;
+    const tsk_size_t *sample_set_sizes;
+    bool polarised;
+    bool span_normalise;
+    bool project;
+    tsk_size_t max_dim;
+    double *log_factorial;
+    double *weights;
+    tsk_size_t *lower;
+    tsk_size_t *upper;
+    tsk_size_t *coordinate;
+    tsk_size_t *folded;
+    int64_t *table;
+    tsk_size_t table_size;
+    tsk_sparse_afs_t *result;
+} tsk_sparse_afs_builder_t;
+
+static tsk_size_t
+tsk_sparse_afs_builder_find_slot(
+    const tsk_sparse_afs_builder_t *self, const tsk_size_t *coordinate)
+{
+    const tsk_size_t mask = self->table_size - 1;
+    const tsk_size_t n = self->num_dims;
+    const tsk_size_t *coordinates = self->result->coordinates;
+    uint64_t h = 0;
+    tsk_size_t k, slot;
+    int64_t index;
+
+    for (k = 0; k < n; k++) {
+        h = (h ^ (uint64_t) coordinate[k]) * 0x9E3779B97F4A7C15ULL;
+    }
+    slot = (tsk_size_t)(h ^ (h >> 32)) & mask;
+    while (true) {
+        index = self->table[slot];
+        if (index == TSK_NULL
+            || memcmp(coordinates + ((tsk_size_t) index) * n, coordinate,
+                   n * sizeof(*coordinate))
+                   == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/* Rebuild the table for the current window's entries with the specified
+ * number of slots. */
+static int
+tsk_sparse_afs_builder_rehash(tsk_sparse_afs_builder_t *self, tsk_size_t size)
+{
+    int ret = 0;
+    tsk_size_t j, slot;
+    const tsk_size_t n = self->num_dims;
+    const tsk_sparse_afs_t *result = self->result;
+    int64_t *table = tsk_malloc(size * sizeof(*table));
+
+    if (table == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    for (j = 0; j < size; j++) {
+        table[j] = TSK_NULL;
+    }
+    tsk_safe_free(self->table);
+    self->table = table;
+    self->table_size = size;
+    for (j = result->window_offset[self->window_index]; j < result->num_entries; j++) {
+        slot = tsk_sparse_afs_builder_find_slot(self, result->coordinates + j * n);
+        table[slot] = (int64_t) j;
+    }
+out:
+    return ret;
+}
+
+static int
+tsk_sparse_afs_builder_init(tsk_sparse_afs_builder_t *self, tsk_sparse_afs_t *result,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_size_t *projection, tsk_size_t num_windows, const double *windows,
+    tsk_flags_t options)
+{
+    int ret = 0;
+    tsk_size_t j, k, max_sample_set_size;
+
+    tsk_memset(self, 0, sizeof(*self));
+    self->num_dims = num_sample_sets;
+    self->windows = windows;
+    self->sample_set_sizes = sample_set_sizes;
+    self->polarised = !!(options & TSK_STAT_POLARISED);
+    self->span_normalise = !!(options & TSK_STAT_SPAN_NORMALISE);
+    self->result = result;
+
+    result->num_sample_sets = num_sample_sets;
+    result->num_windows = num_windows;
+    result->shape = tsk_malloc(num_sample_sets * sizeof(*result->shape));
+    result->window_offset = tsk_calloc(num_windows + 1, sizeof(*result->window_offset));
+    self->lower = tsk_malloc(num_sample_sets * sizeof(*self->lower));
+    self->upper = tsk_malloc(num_sample_sets * sizeof(*self->upper));
+    self->coordinate = tsk_malloc(num_sample_sets * sizeof(*self->coordinate));
+    self->folded = tsk_malloc(num_sample_sets * sizeof(*self->folded));
+    if (result->shape == NULL || result->window_offset == NULL || self->lower == NULL
+        || self->upper == NULL || self->coordinate == NULL || self->folded == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+
+    max_sample_set_size = 0;
+    for (k = 0; k < num_sample_sets; k++) {
+        result->shape[k] = sample_set_sizes[k] + 1;
+        if (projection != NULL) {
+            if (projection[k] > sample_set_sizes[k]) {
+                ret = TSK_ERR_BAD_AFS_PROJECTION;
+                goto out;
+            }
+            result->shape[k] = projection[k] + 1;
+            self->project = self->project || projection[k] < sample_set_sizes[k];
+        }
+        self->max_dim = TSK_MAX(self->max_dim, result->shape[k]);
+        max_sample_set_size = TSK_MAX(max_sample_set_size, sample_set_sizes[k]);
+    }
+    if (self->project) {
+        self->log_factorial
+            = tsk_malloc((max_sample_set_size + 1) * sizeof(*self->log_factorial));
+        self->weights
+            = tsk_malloc(num_sample_sets * self->max_dim * sizeof(*self->weights));
+        if (self->log_factorial == NULL || self->weights == NULL) {
+            ret = TSK_ERR_NO_MEMORY;
+            goto out;
+        }
+        for (j = 0; j <= max_sample_set_size; j++) {
+            self->log_factorial[j] = lgamma((double) j + 1);
+        }
+    }
+    ret = tsk_sparse_afs_builder_rehash(self, 1024);
+out:
+    return ret;
+}
+
+static void
+tsk_sparse_afs_builder_free(tsk_sparse_afs_builder_t *self)
+{
+    tsk_safe_free(self->log_factorial);
+    tsk_safe_free(self->weights);
+    tsk_safe_free(self->lower);
+    tsk_safe_free(self->upper);
+    tsk_safe_free(self->coordinate);
+    tsk_safe_free(self->folded);
+    tsk_safe_free(self->table);
+}
+
+/* Close windows until the specified window is the current one. */
+static void
+tsk_sparse_afs_builder_set_window(
+    tsk_sparse_afs_builder_t *self, tsk_size_t window_index)
+{
+    tsk_sparse_afs_t *result = self->result;
+    const tsk_size_t n = self->num_dims;
+    tsk_size_t j, start, slot;
+    double span;
+
+    while (self->window_index < window_index) {
+        start = result->window_offset[self->window_index];
+        span = self->windows[self->window_index + 1] - self->windows[self->window_index];
+        /* Each entry's probe sequence only passes over entries inserted
+         * before it, so we remove them in reverse order. */
+        for (j = result->num_entries; j > start; j--) {
+            slot = tsk_sparse_afs_builder_find_slot(
+                self, result->coordinates + (j - 1) * n);
+            self->table[slot] = TSK_NULL;
+            if (self->span_normalise) {
+                result->values[j - 1] /= span;
+            }
+        }
+        self->window_index++;
+        result->window_offset[self->window_index] = result->num_entries;
+    }
+}
+
+static int TSK_WARN_UNUSED
+tsk_sparse_afs_builder_insert(
+    tsk_sparse_afs_builder_t *self, const tsk_size_t *coordinate, double value)
+{
+    int ret = 0;
+    tsk_sparse_afs_t *result = self->result;
+    const tsk_size_t n = self->num_dims;
+    tsk_size_t slot = tsk_sparse_afs_builder_find_slot(self, coordinate);
+    tsk_size_t num_window_entries;
+    void *p;
+
+    if (self->table[slot] != TSK_NULL) {
+        result->values[self->table[slot]] += value;
+        goto out;
+    }
+    if (result->num_entries == result->max_entries) {
+        result->max_entries = TSK_MAX(1024, 2 * result->max_entries);
+        p = tsk_realloc(
+            result->coordinates, result->max_entries * n * sizeof(*result->coordinates));
+        if (p == NULL) {
+            ret = TSK_ERR_NO_MEMORY;
+            goto out;
+        }
+        result->coordinates = p;
+        p = tsk_realloc(result->values, result->max_entries * sizeof(*result->values));
+        if (p == NULL) {
+            ret = TSK_ERR_NO_MEMORY;
+            goto out;
+        }
+        result->values = p;
+    }
+    tsk_memcpy(result->coordinates + result->num_entries * n, coordinate,
+        n * sizeof(*coordinate));
+    result->values[result->num_entries] = value;
+    self->table[slot] = (int64_t) result->num_entries;
+    result->num_entries++;
+    num_window_entries
+        = result->num_entries - result->window_offset[self->window_index];
+    if (2 * num_window_entries > self->table_size) {
+        ret = tsk_sparse_afs_builder_rehash(self, 2 * self->table_size);
+    }
+out:
+    return ret;
+}
+
+/* Adds the specified value to the cell for the specified allele counts in each
+ * sample set, projecting and folding as required. */
+static int TSK_WARN_UNUSED
+tsk_sparse_afs_builder_add(tsk_sparse_afs_builder_t *self, tsk_size_t window_index,
+    const double *allele_count, double value)
+{
+    int ret = 0;
+    const tsk_size_t n = self->num_dims;
+    const tsk_size_t *shape = self->result->shape;
+    const double *log_factorial = self->log_factorial;
+    tsk_size_t k, a, b, N, m;
+    double w, log_denominator;
+    bool done;
+
+    tsk_sparse_afs_builder_set_window(self, window_index);
+    if (!self->project) {
+        for (k = 0; k < n; k++) {
+            self->coordinate[k] = (tsk_size_t) allele_count[k];
+        }
+        if (!self->polarised) {
+            fold(self->coordinate, shape, n);
+        }
+        ret = tsk_sparse_afs_builder_insert(self, self->coordinate, value);
+        goto out;
+    }
+
+    /* The probability of seeing b copies of the allele in a sample of m
+     * without replacement from N containing a copies is
+     * C(a, b) C(N - a, m - b) / C(N, m). */
+    for (k = 0; k < n; k++) {
+        a = (tsk_size_t) allele_count[k];
+        N = self->sample_set_sizes[k];
+        m = shape[k] - 1;
+        self->lower[k] = m > N - a ? m - (N - a) : 0;
+        self->upper[k] = TSK_MIN(a, m);
+        log_denominator = log_factorial[N] - log_factorial[m] - log_factorial[N - m];
+        for (b = self->lower[k]; b <= self->upper[k]; b++) {
+            self->weights[k * self->max_dim + b]
+                = exp(log_factorial[a] - log_factorial[b] - log_factorial[a - b]
+                      + log_factorial[N - a] - log_factorial[m - b]
+                      - log_factorial[N - a - m + b] - log_denominator);
+        }
+        self->coordinate[k] = self->lower[k];
+    }
+    /* Visit every combination of projected counts */
+    done = false;
+    while (!done) {
+        w = value;
+        for (k = 0; k < n; k++) {
+            w *= self->weights[k * self->max_dim + self->coordinate[k]];
+            self->folded[k] = self->coordinate[k];
+        }
+        if (!self->polarised) {
+            fold(self->folded, shape, n);
+        }
+        ret = tsk_sparse_afs_builder_insert(self, self->folded, w);
+        if (ret != 0) {
+            goto out;
+        }
+        done = true;
+        for (k = 0; k < n; k++) {
+            if (self->coordinate[k] < self->upper[k]) {
+                self->coordinate[k]++;
+                done = false;
+                break;
+            }
+            self->coordinate[k] = self->lower[k];
+        }
+    }
+out:
+    return ret;
+}
+
+/* If sparse is not NULL the counts are added to it rather than to the dense
+ * result array. */
 static int
 tsk_treeseq_update_site_afs(const tsk_treeseq_t *self, const tsk_site_t *site,
     const double *total_counts, const double *counts, tsk_size_t num_sample_sets,
     tsk_size_t window_index, tsk_size_t *result_dims, tsk_flags_t options,
-    double *result)
+    double *result, tsk_sparse_afs_builder_t *sparse)
 {
     int ret = 0;
     tsk_size_t afs_size;
     tsk_size_t k, allele, num_alleles, all_samples;
-    double increment, *afs, *allele_counts, *allele_count;
+    double increment, *allele_counts, *allele_count;
+    double *afs = NULL;
     tsk_size_t *coordinate = tsk_malloc(num_sample_sets * sizeof(*coordinate));
     bool polarised = !!(options & TSK_STAT_POLARISED);
     const tsk_size_t K = num_sample_sets + 1;
@@ -2762,8 +3515,10 @@ tsk_treeseq_update_site_afs(const tsk_treeseq_t *self, const tsk_site_t *site,
         goto out;
     }
 
-    afs_size = result_dims[num_sample_sets];
-    afs = result + afs_size * window_index;
+    if (sparse == NULL) {
+        afs_size = result_dims[num_sample_sets];
+        afs = result + afs_size * window_index;
+    }
 
     increment = polarised ? 1 : 0.5;
     /* Sum over the allele weights. Skip the ancestral state if polarised. */
@@ -2771,6 +3526,14 @@ tsk_treeseq_update_site_afs(const tsk_treeseq_t *self, const tsk_site_t *site,
         allele_count = GET_2D_ROW(allele_counts, K, allele);
         all_samples = (tsk_size_t) allele_count[num_sample_sets];
         if (all_samples > 0 && all_samples < self->num_samples) {
+            if (sparse != NULL) {
+                ret = tsk_sparse_afs_builder_add(
+                    sparse, window_index, allele_count, increment);
+                if (ret != 0) {
+                    goto out;
+                }
+                continue;
+            }
             for (k = 0; k < num_sample_sets; k++) {
                 coordinate[k] = (tsk_size_t) allele_count[k];
             }
@@ -2791,7 +3554,7 @@ static int
 tsk_treeseq_site_allele_frequency_spectrum(const tsk_treeseq_t *self,
     tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes, double *counts,
     tsk_size_t num_windows, const double *windows, tsk_size_t *result_dims,
-    tsk_flags_t options, double *result)
+    tsk_flags_t options, double *result, tsk_sparse_afs_builder_t *sparse)
 {
     int ret = 0;
     tsk_id_t u, v;
@@ -2871,7 +3634,7 @@ tsk_treeseq_site_allele_frequency_spectrum(const tsk_treeseq_t *self,
                 tsk_bug_assert(window_index < num_windows);
             }
             ret = tsk_treeseq_update_site_afs(self, site, total_counts, counts,
-                num_sample_sets, window_index, result_dims, options, result);
+                num_sample_sets, window_index, result_dims, options, result, sparse);
             if (ret != 0) {
                 goto out;
             }
@@ -2894,7 +3657,8 @@ static int TSK_WARN_UNUSED
 tsk_treeseq_update_branch_afs(const tsk_treeseq_t *self, tsk_id_t u, double right,
     const double *restrict branch_length, double *restrict last_update,
     const double *counts, tsk_size_t num_sample_sets, tsk_size_t window_index,
-    const tsk_size_t *result_dims, tsk_flags_t options, double *result)
+    const tsk_size_t *result_dims, tsk_flags_t options, double *result,
+    tsk_sparse_afs_builder_t *sparse)
 {
     int ret = 0;
     tsk_size_t afs_size;
@@ -2912,15 +3676,24 @@ tsk_treeseq_update_branch_afs(const tsk_treeseq_t *self, tsk_id_t u, double righ
     }
 
     if (0 < all_samples && all_samples < self->num_samples) {
-        afs_size = result_dims[num_sample_sets];
-        afs = result + afs_size * window_index;
-        for (k = 0; k < num_sample_sets; k++) {
-            coordinate[k] = (tsk_size_t) count_row[k];
-        }
-        if (!polarised) {
-            fold(coordinate, result_dims, num_sample_sets);
+        if (sparse != NULL) {
+            if (x != 0) {
+                ret = tsk_sparse_afs_builder_add(sparse, window_index, count_row, x);
+                if (ret != 0) {
+                    goto out;
+                }
+            }
+        } else {
+            afs_size = result_dims[num_sample_sets];
+            afs = result + afs_size * window_index;
+            for (k = 0; k < num_sample_sets; k++) {
+                coordinate[k] = (tsk_size_t) count_row[k];
+            }
+            if (!polarised) {
+                fold(coordinate, result_dims, num_sample_sets);
+            }
+            increment_nd_array_value(afs, num_sample_sets, result_dims, coordinate, x);
         }
-        increment_nd_array_value(afs, num_sample_sets, result_dims, coordinate, x);
     }
     last_update[u] = right;
 out:
@@ -2932,7 +3705,7 @@ static int
 tsk_treeseq_branch_allele_frequency_spectrum(const tsk_treeseq_t *self,
     tsk_size_t num_sample_sets, double *counts, tsk_size_t num_windows,
     const double *windows, const tsk_size_t *result_dims, tsk_flags_t options,
-    double *result)
+    double *result, tsk_sparse_afs_builder_t *sparse)
 {
     int ret = 0;
     tsk_id_t u, v;
@@ -2979,14 +3752,14 @@ tsk_treeseq_branch_allele_frequency_spectrum(const tsk_treeseq_t *self,
             v = edge_parent[h];
             ret = tsk_treeseq_update_branch_afs(self, u, t_left, branch_length,
                 last_update, counts, num_sample_sets, window_index, result_dims, options,
-                result);
+                result, sparse);
             if (ret != 0) {
                 goto out;
             }
             while (v != TSK_NULL) {
                 ret = tsk_treeseq_update_branch_afs(self, v, t_left, branch_length,
                     last_update, counts, num_sample_sets, window_index, result_dims,
-                    options, result);
+                    options, result, sparse);
                 if (ret != 0) {
                     goto out;
                 }
@@ -3007,7 +3780,7 @@ tsk_treeseq_branch_allele_frequency_spectrum(const tsk_treeseq_t *self,
             while (v != TSK_NULL) {
                 ret = tsk_treeseq_update_branch_afs(self, v, t_left, branch_length,
                     last_update, counts, num_sample_sets, window_index, result_dims,
-                    options, result);
+                    options, result, sparse);
                 if (ret != 0) {
                     goto out;
                 }
@@ -3031,7 +3804,7 @@ tsk_treeseq_branch_allele_frequency_spectrum(const tsk_treeseq_t *self,
                 tsk_bug_assert(last_update[u] < w_right);
                 ret = tsk_treeseq_update_branch_afs(self, u, w_right, branch_length,
                     last_update, counts, num_sample_sets, window_index, result_dims,
-                    options, result);
+                    options, result, sparse);
                 if (ret != 0) {
                     goto out;
                 }
@@ -3055,11 +3828,14 @@ out:
     return ret;
 }
 
-int
-tsk_treeseq_allele_frequency_spectrum(const tsk_treeseq_t *self,
+/* Computes the dense AFS into result if sparse_result is NULL, and the sparse
+ * AFS, optionally projected, into sparse_result otherwise. */
+static int
+tsk_treeseq_allele_frequency_spectrum_general(const tsk_treeseq_t *self,
     tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
-    const tsk_id_t *sample_sets, tsk_size_t num_windows, const double *windows,
-    tsk_flags_t options, double *result)
+    const tsk_id_t *sample_sets, const tsk_size_t *projection, tsk_size_t num_windows,
+    const double *windows, tsk_flags_t options, double *result,
+    tsk_sparse_afs_t *sparse_result)
 {
     int ret = 0;
     bool stat_site = !!(options & TSK_STAT_SITE);
@@ -3075,7 +3851,10 @@ tsk_treeseq_allele_frequency_spectrum(const tsk_treeseq_t *self,
      * reuse code from the general_stats code paths. */
     double *counts = NULL;
     double *count_row;
+    tsk_sparse_afs_builder_t sparse_builder;
+    tsk_sparse_afs_builder_t *sparse = NULL;
 
+    tsk_memset(&sparse_builder, 0, sizeof(sparse_builder));
     if (stat_node) {
         ret = TSK_ERR_UNSUPPORTED_STAT_MODE;
         goto out;
@@ -3135,25 +3914,97 @@ tsk_treeseq_allele_frequency_spectrum(const tsk_treeseq_t *self,
     }
     result_dims[num_sample_sets] = (tsk_size_t) afs_size;
 
-    tsk_memset(result, 0, num_windows * afs_size * sizeof(*result));
+    if (sparse_result != NULL) {
+        /* The dense size may overflow here, but it isn't used */
+        sparse = &sparse_builder;
+        ret = tsk_sparse_afs_builder_init(sparse, sparse_result, num_sample_sets,
+            sample_set_sizes, projection, num_windows, windows, options);
+        if (ret != 0) {
+            goto out;
+        }
+    } else {
+        tsk_memset(result, 0, num_windows * afs_size * sizeof(*result));
+    }
     if (stat_site) {
         ret = tsk_treeseq_site_allele_frequency_spectrum(self, num_sample_sets,
             sample_set_sizes, counts, num_windows, windows, result_dims, options,
-            result);
+            result, sparse);
     } else {
         ret = tsk_treeseq_branch_allele_frequency_spectrum(self, num_sample_sets, counts,
-            num_windows, windows, result_dims, options, result);
+            num_windows, windows, result_dims, options, result, sparse);
+    }
+    if (ret != 0) {
+        goto out;
     }
 
-    if (options & TSK_STAT_SPAN_NORMALISE) {
+    if (sparse != NULL) {
+        tsk_sparse_afs_builder_set_window(sparse, num_windows);
+    } else if (options & TSK_STAT_SPAN_NORMALISE) {
         span_normalise(num_windows, windows, afs_size, result);
     }
 out:
+    tsk_sparse_afs_builder_free(&sparse_builder);
     tsk_safe_free(counts);
     tsk_safe_free(result_dims);
     return ret;
 }
 
+int
+tsk_treeseq_allele_frequency_spectrum(const tsk_treeseq_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, tsk_size_t num_windows, const double *windows,
+    tsk_flags_t options, double *result)
+{
+    return tsk_treeseq_allele_frequency_spectrum_general(self, num_sample_sets,
+        sample_set_sizes, sample_sets, NULL, num_windows, windows, options, result,
+        NULL);
+}
+
+int
+tsk_treeseq_sparse_allele_frequency_spectrum(const tsk_treeseq_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, const tsk_size_t *projection, tsk_size_t num_windows,
+    const double *windows, tsk_flags_t options, tsk_sparse_afs_t *result)
+{
+    tsk_memset(result, 0, sizeof(*result));
+    return tsk_treeseq_allele_frequency_spectrum_general(self, num_sample_sets,
+        sample_set_sizes, sample_sets, projection, num_windows, windows, options, NULL,
+        result);
+}
+
+int
+tsk_sparse_afs_free(tsk_sparse_afs_t *self)
+{
+    tsk_safe_free(self->shape);
+    tsk_safe_free(self->window_offset);
+    tsk_safe_free(self->coordinates);
+    tsk_safe_free(self->values);
+    return 0;
+}
+
+void
+tsk_sparse_afs_print_state(const tsk_sparse_afs_t *self, FILE *out)
+{
+    tsk_size_t j, k, e;
+
+    fprintf(out, "Sparse AFS state\n");
+    fprintf(out, "num_sample_sets = %lld\n", (long long) self->num_sample_sets);
+    fprintf(out, "num_windows = %lld\n", (long long) self->num_windows);
+    fprintf(out, "num_entries = %lld\n", (long long) self->num_entries);
+    for (j = 0; j < self->num_windows; j++) {
+        fprintf(out, "window %lld:\n", (long long) j);
+        for (e = self->window_offset[j]; e < self->window_offset[j + 1]; e++) {
+            fprintf(out, "\t(");
+            for (k = 0; k < self->num_sample_sets; k++) {
+                fprintf(out, "%lld%s",
+                    (long long) self->coordinates[e * self->num_sample_sets + k],
+                    k < self->num_sample_sets - 1 ? ", " : "");
+            }
+            fprintf(out, ") = %f\n", self->values[e]);
+        }
+    }
+}
+
 /***********************************
  * One way stats
  ***********************************/
@@ -3184,6 +4035,18 @@ tsk_treeseq_diversity(const tsk_treeseq_t *self, tsk_size_t num_sample_sets,
         options, result);
 }
 
+int
+tsk_treeseq_diversity_time_windows(const tsk_treeseq_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, tsk_size_t num_windows, const double *windows,
+    tsk_size_t num_time_windows, const double *time_windows, tsk_flags_t options,
+    double *result)
+{
+    return tsk_treeseq_sample_count_stat_time_windows(self, num_sample_sets,
+        sample_set_sizes, sample_sets, num_sample_sets, NULL, diversity_summary_func,
+        num_windows, windows, num_time_windows, time_windows, options, result);
+}
+
 static int
 trait_covariance_summary_func(tsk_size_t state_dim, const double *state,
     tsk_size_t TSK_UNUSED(result_dim), double *result, void *params)
@@ -3828,6 +4691,27 @@ out:
     return ret;
 }
 
+int
+tsk_treeseq_divergence_time_windows(const tsk_treeseq_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, tsk_size_t num_index_tuples,
+    const tsk_id_t *index_tuples, tsk_size_t num_windows, const double *windows,
+    tsk_size_t num_time_windows, const double *time_windows, tsk_flags_t options,
+    double *result)
+{
+    int ret = 0;
+    ret = check_sample_stat_inputs(num_sample_sets, 2, num_index_tuples, index_tuples);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_treeseq_sample_count_stat_time_windows(self, num_sample_sets,
+        sample_set_sizes, sample_sets, num_index_tuples, index_tuples,
+        divergence_summary_func, num_windows, windows, num_time_windows, time_windows,
+        options, result);
+out:
+    return ret;
+}
+
 static int
 genetic_relatedness_summary_func(tsk_size_t state_dim, const double *state,
     tsk_size_t result_dim, double *result, void *params)
@@ -3947,9 +4831,306 @@ out:
     return ret;
 }
 
-static int
-Y2_summary_func(tsk_size_t TSK_UNUSED(state_dim), const double *state,
-    tsk_size_t result_dim, double *result, void *params)
+/* State for the genetic relatedness matrix-vector product. For each node u we
+ * keep the total of the weights of the samples below u, along with the number
+ * of samples below u, in a contiguous row of num_weights + 1 values. The
+ * product for a sample i is the sum over the nodes on the path from i to the
+ * root of the accumulated values for those nodes. These are accumulated
+ * lazily, and are pushed down into the detached subtree when an edge is
+ * removed (and pulled back out when an edge is inserted) so that the path
+ * sums stay correct as the trees change. */
+typedef struct {
+    tsk_size_t num_weights;
+    double num_samples;
+    const double *node_time;
+    tsk_id_t *parent;
+    double *branch_length;
+    double *last_update;
+    double *state;
+    double *value;
+    double *total_weight;
+    double *centre;
+    double *path_sum;
+} relatedness_vector_t;
+
+static int
+relatedness_vector_init(relatedness_vector_t *self, const tsk_treeseq_t *ts,
+    tsk_size_t num_weights, const double *weights, double position)
+{
+    int ret = 0;
+    tsk_size_t j, k;
+    tsk_id_t u;
+    const tsk_size_t num_nodes = ts->tables->nodes.num_rows;
+    const tsk_size_t row_size = num_weights + 1;
+    const double *weight_row;
+    double *state_row;
+
+    tsk_memset(self, 0, sizeof(*self));
+    self->num_weights = num_weights;
+    self->num_samples = (double) ts->num_samples;
+    self->node_time = ts->tables->nodes.time;
+    self->parent = tsk_malloc(num_nodes * sizeof(*self->parent));
+    self->branch_length = tsk_calloc(num_nodes, sizeof(*self->branch_length));
+    self->last_update = tsk_malloc(num_nodes * sizeof(*self->last_update));
+    self->state = tsk_calloc(num_nodes * row_size, sizeof(*self->state));
+    self->value = tsk_calloc(num_nodes * num_weights, sizeof(*self->value));
+    self->total_weight = tsk_calloc(row_size, sizeof(*self->total_weight));
+    self->centre = tsk_calloc(num_weights, sizeof(*self->centre));
+    self->path_sum = tsk_calloc(num_weights, sizeof(*self->path_sum));
+    if (self->parent == NULL || self->branch_length == NULL || self->last_update == NULL
+        || self->state == NULL || self->value == NULL || self->total_weight == NULL
+        || self->centre == NULL || self->path_sum == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    tsk_memset(self->parent, 0xff, num_nodes * sizeof(*self->parent));
+    for (j = 0; j < num_nodes; j++) {
+        self->last_update[j] = position;
+    }
+    for (j = 0; j < ts->num_samples; j++) {
+        u = ts->samples[j];
+        weight_row = GET_2D_ROW(weights, num_weights, j);
+        state_row = GET_2D_ROW(self->state, row_size, u);
+        for (k = 0; k < num_weights; k++) {
+            state_row[k] = weight_row[k];
+            self->total_weight[k] += weight_row[k];
+        }
+        state_row[num_weights] = 1;
+    }
+out:
+    return ret;
+}
+
+static void
+relatedness_vector_free(relatedness_vector_t *self)
+{
+    tsk_safe_free(self->parent);
+    tsk_safe_free(self->branch_length);
+    tsk_safe_free(self->last_update);
+    tsk_safe_free(self->state);
+    tsk_safe_free(self->value);
+    tsk_safe_free(self->total_weight);
+    tsk_safe_free(self->centre);
+    tsk_safe_free(self->path_sum);
+}
+
+/* Add the contribution of the branch above u since it was last updated */
+static inline void
+relatedness_vector_flush(relatedness_vector_t *self, tsk_id_t u, double position)
+{
+    const tsk_size_t K = self->num_weights;
+    const double *restrict state_u = GET_2D_ROW(self->state, K + 1, u);
+    double *restrict value_u = GET_2D_ROW(self->value, K, u);
+    const double *restrict total_weight = self->total_weight;
+    const double count = state_u[K];
+    const double scale = self->branch_length[u] * (position - self->last_update[u]);
+    double x;
+    tsk_size_t k;
+
+    if (scale != 0) {
+        for (k = 0; k < K; k++) {
+            x = scale * (state_u[k] - count * total_weight[k] / self->num_samples);
+            value_u[k] += x;
+            self->centre[k] += count * x;
+        }
+    }
+    self->last_update[u] = position;
+}
+
+static inline void
+relatedness_vector_update_path(relatedness_vector_t *self, tsk_id_t c, double sign,
+    double position)
+{
+    const tsk_size_t K = self->num_weights;
+    const double *restrict state_c = GET_2D_ROW(self->state, K + 1, c);
+    double *restrict value_c = GET_2D_ROW(self->value, K, c);
+    double *restrict path_sum = self->path_sum;
+    double *restrict state_u, *restrict value_u;
+    tsk_size_t k;
+    tsk_id_t u;
+
+    tsk_memset(path_sum, 0, K * sizeof(*path_sum));
+    for (u = self->parent[c]; u != TSK_NULL; u = self->parent[u]) {
+        relatedness_vector_flush(self, u, position);
+        state_u = GET_2D_ROW(self->state, K + 1, u);
+        value_u = GET_2D_ROW(self->value, K, u);
+        for (k = 0; k < K; k++) {
+            path_sum[k] += value_u[k];
+        }
+        for (k = 0; k <= K; k++) {
+            state_u[k] += sign * state_c[k];
+        }
+    }
+    /* When removing an edge the subtree below c takes with it the values
+     * for its former ancestors; when inserting it we subtract the values
+     * for its new ancestors, which were accumulated before it joined. */
+    for (k = 0; k < K; k++) {
+        value_c[k] -= sign * path_sum[k];
+    }
+}
+
+static void
+relatedness_vector_remove_edge(
+    relatedness_vector_t *self, tsk_id_t p, tsk_id_t c, double position)
+{
+    tsk_bug_assert(self->parent[c] == p);
+    relatedness_vector_flush(self, c, position);
+    relatedness_vector_update_path(self, c, -1, position);
+    self->parent[c] = TSK_NULL;
+    self->branch_length[c] = 0;
+}
+
+static void
+relatedness_vector_insert_edge(
+    relatedness_vector_t *self, tsk_id_t p, tsk_id_t c, double position)
+{
+    relatedness_vector_flush(self, c, position);
+    self->parent[c] = p;
+    self->branch_length[c] = self->node_time[p] - self->node_time[c];
+    relatedness_vector_update_path(self, c, +1, position);
+}
+
+/* Write out the product for each sample accumulated up to the specified
+ * position, and reset the accumulated values for the next window. */
+static void
+relatedness_vector_finalise_window(relatedness_vector_t *self, const tsk_treeseq_t *ts,
+    double position, double scale, double *result)
+{
+    const tsk_size_t K = self->num_weights;
+    const tsk_size_t num_nodes = ts->tables->nodes.num_rows;
+    const double *value_u;
+    double *row;
+    tsk_size_t j, k;
+    tsk_id_t u;
+
+    for (u = 0; u < (tsk_id_t) num_nodes; u++) {
+        relatedness_vector_flush(self, u, position);
+    }
+    for (j = 0; j < ts->num_samples; j++) {
+        row = GET_2D_ROW(result, K, j);
+        for (k = 0; k < K; k++) {
+            row[k] = -self->centre[k] / self->num_samples;
+        }
+        for (u = ts->samples[j]; u != TSK_NULL; u = self->parent[u]) {
+            value_u = GET_2D_ROW(self->value, K, u);
+            for (k = 0; k < K; k++) {
+                row[k] += value_u[k];
+            }
+        }
+        for (k = 0; k < K; k++) {
+            row[k] *= scale;
+        }
+    }
+    tsk_memset(self->value, 0, num_nodes * K * sizeof(*self->value));
+    tsk_memset(self->centre, 0, K * sizeof(*self->centre));
+}
+
+int
+tsk_treeseq_genetic_relatedness_vector(const tsk_treeseq_t *self,
+    tsk_size_t num_weights, const double *weights, tsk_size_t num_windows,
+    const double *windows, double *result, tsk_flags_t options)
+{
+    int ret = 0;
+    const tsk_size_t num_samples = self->num_samples;
+    const tsk_id_t num_edges = (tsk_id_t) self->tables->edges.num_rows;
+    const tsk_id_t *restrict I = self->tables->indexes.edge_insertion_order;
+    const tsk_id_t *restrict O = self->tables->indexes.edge_removal_order;
+    const double *restrict edge_left = self->tables->edges.left;
+    const double *restrict edge_right = self->tables->edges.right;
+    const tsk_id_t *restrict edge_parent = self->tables->edges.parent;
+    const tsk_id_t *restrict edge_child = self->tables->edges.child;
+    double default_windows[] = { 0, self->tables->sequence_length };
+    bool polarised = !!(options & TSK_STAT_POLARISED);
+    bool span_normalise = !!(options & TSK_STAT_SPAN_NORMALISE);
+    tsk_id_t tj, tk, h;
+    tsk_size_t window_index;
+    double t_left, t_right, w_right, scale, stop;
+    relatedness_vector_t state;
+
+    tsk_memset(&state, 0, sizeof(state));
+    /* Only branch mode is implemented, and unlike the other stats there is no
+     * default mode, so it must be requested explicitly */
+    if (!(options & TSK_STAT_BRANCH) || (options & (TSK_STAT_SITE | TSK_STAT_NODE))) {
+        ret = TSK_ERR_UNSUPPORTED_STAT_MODE;
+        goto out;
+    }
+    if (self->time_uncalibrated && !(options & TSK_STAT_ALLOW_TIME_UNCALIBRATED)) {
+        ret = TSK_ERR_TIME_UNCALIBRATED;
+        goto out;
+    }
+    if (num_weights == 0) {
+        ret = TSK_ERR_INSUFFICIENT_WEIGHTS;
+        goto out;
+    }
+    if (windows == NULL) {
+        num_windows = 1;
+        windows = default_windows;
+    } else {
+        ret = tsk_treeseq_check_windows(self, num_windows, windows, 0);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+    ret = relatedness_vector_init(&state, self, num_weights, weights, windows[0]);
+    if (ret != 0) {
+        goto out;
+    }
+
+    /* Iterate over the trees as in tsk_treeseq_branch_general_stat */
+    stop = windows[num_windows];
+    tj = 0;
+    tk = 0;
+    t_left = windows[0];
+    while (tk < num_edges && edge_right[O[tk]] <= t_left) {
+        tk++;
+    }
+    window_index = 0;
+    while (t_left < stop) {
+        while (tk < num_edges && edge_right[O[tk]] == t_left) {
+            h = O[tk];
+            tk++;
+            relatedness_vector_remove_edge(
+                &state, edge_parent[h], edge_child[h], t_left);
+        }
+        while (tj < num_edges && edge_left[I[tj]] <= t_left) {
+            h = I[tj];
+            tj++;
+            if (edge_right[h] <= t_left) {
+                continue;
+            }
+            relatedness_vector_insert_edge(
+                &state, edge_parent[h], edge_child[h], t_left);
+        }
+
+        t_right = stop;
+        if (tj < num_edges) {
+            t_right = TSK_MIN(t_right, edge_left[I[tj]]);
+        }
+        if (tk < num_edges) {
+            t_right = TSK_MIN(t_right, edge_right[O[tk]]);
+        }
+        while (window_index < num_windows && windows[window_index + 1] <= t_right) {
+            w_right = windows[window_index + 1];
+            /* Branches are counted on both sides unless polarised */
+            scale = polarised ? 0.5 : 1.0;
+            if (span_normalise) {
+                scale /= w_right - windows[window_index];
+            }
+            relatedness_vector_finalise_window(&state, self, w_right, scale,
+                GET_2D_ROW(result, num_samples * num_weights, window_index));
+            window_index++;
+        }
+        t_left = t_right;
+    }
+    tsk_bug_assert(window_index == num_windows);
+out:
+    relatedness_vector_free(&state);
+    return ret;
+}
+
+static int
+Y2_summary_func(tsk_size_t TSK_UNUSED(state_dim), const double *state,
+    tsk_size_t result_dim, double *result, void *params)
 {
     sample_count_stat_params_t args = *(sample_count_stat_params_t *) params;
     const double *x = state;
@@ -4685,20 +5866,6 @@ tsk_tree_position_seek_backward(tsk_tree_position_t *self, tsk_id_t index)
  * Tree
  * ======================================================== */
 
-/* Return the root for the specified node.
- * NOTE: no bounds checking is done here.
- */
-static tsk_id_t
-tsk_tree_get_node_root(const tsk_tree_t *self, tsk_id_t u)
-{
-    const tsk_id_t *restrict parent = self->parent;
-
-    while (parent[u] != TSK_NULL) {
-        u = parent[u];
-    }
-    return u;
-}
-
 int TSK_WARN_UNUSED
 tsk_tree_init(tsk_tree_t *self, const tsk_treeseq_t *tree_sequence, tsk_flags_t options)
 {
@@ -4734,9 +5901,9 @@ tsk_tree_init(tsk_tree_t *self, const tsk_treeseq_t *tree_sequence, tsk_flags_t
         goto out;
     }
     if (!(self->options & TSK_NO_SAMPLE_COUNTS)) {
+        /* The tracked sample counts are allocated when they are first set */
         self->num_samples = tsk_calloc(N, sizeof(*self->num_samples));
-        self->num_tracked_samples = tsk_calloc(N, sizeof(*self->num_tracked_samples));
-        if (self->num_samples == NULL || self->num_tracked_samples == NULL) {
+        if (self->num_samples == NULL) {
             goto out;
         }
     }
@@ -4827,8 +5994,17 @@ tsk_tree_reset_tracked_samples(tsk_tree_t *self)
         ret = TSK_ERR_UNSUPPORTED_OPERATION;
         goto out;
     }
-    tsk_memset(self->num_tracked_samples, 0,
-        (self->num_nodes + 1) * sizeof(*self->num_tracked_samples));
+    if (self->num_tracked_samples == NULL) {
+        self->num_tracked_samples
+            = tsk_calloc(self->num_nodes + 1, sizeof(*self->num_tracked_samples));
+        if (self->num_tracked_samples == NULL) {
+            ret = TSK_ERR_NO_MEMORY;
+            goto out;
+        }
+    } else {
+        tsk_memset(self->num_tracked_samples, 0,
+            (self->num_nodes + 1) * sizeof(*self->num_tracked_samples));
+    }
 out:
     return ret;
 }
@@ -4838,7 +6014,7 @@ tsk_tree_set_tracked_samples(
     tsk_tree_t *self, tsk_size_t num_tracked_samples, const tsk_id_t *tracked_samples)
 {
     int ret = TSK_ERR_GENERIC;
-    tsk_size_t *tree_num_tracked_samples = self->num_tracked_samples;
+    tsk_size_t *tree_num_tracked_samples;
     const tsk_id_t *parent = self->parent;
     tsk_size_t j;
     tsk_id_t u;
@@ -4850,6 +6026,7 @@ tsk_tree_set_tracked_samples(
     if (ret != 0) {
         goto out;
     }
+    tree_num_tracked_samples = self->num_tracked_samples;
     self->num_tracked_samples[self->virtual_root] = num_tracked_samples;
     for (j = 0; j < num_tracked_samples; j++) {
         u = tracked_samples[j];
@@ -4884,7 +6061,7 @@ tsk_tree_track_descendant_samples(tsk_tree_t *self, tsk_id_t node)
     const tsk_id_t *restrict left_child = self->left_child;
     const tsk_id_t *restrict right_sib = self->right_sib;
     const tsk_flags_t *restrict flags = self->tree_sequence->tables->nodes.flags;
-    tsk_size_t *num_tracked_samples = self->num_tracked_samples;
+    tsk_size_t *num_tracked_samples;
     tsk_size_t n, j, num_nodes;
     tsk_id_t u, v;
 
@@ -4900,6 +6077,7 @@ tsk_tree_track_descendant_samples(tsk_tree_t *self, tsk_id_t node)
     if (ret != 0) {
         goto out;
     }
+    num_tracked_samples = self->num_tracked_samples;
     u = 0; /* keep the compiler happy */
     for (j = 0; j < num_nodes; j++) {
         u = nodes[j];
@@ -4960,8 +6138,20 @@ tsk_tree_copy(const tsk_tree_t *self, tsk_tree_t *dest, tsk_flags_t options)
             goto out;
         }
         tsk_memcpy(dest->num_samples, self->num_samples, N * sizeof(*self->num_samples));
-        tsk_memcpy(dest->num_tracked_samples, self->num_tracked_samples,
-            N * sizeof(*self->num_tracked_samples));
+        if (self->num_tracked_samples == NULL) {
+            tsk_safe_free(dest->num_tracked_samples);
+        } else {
+            if (dest->num_tracked_samples == NULL) {
+                dest->num_tracked_samples
+                    = tsk_malloc(N * sizeof(*dest->num_tracked_samples));
+                if (dest->num_tracked_samples == NULL) {
+                    ret = TSK_ERR_NO_MEMORY;
+                    goto out;
+                }
+            }
+            tsk_memcpy(dest->num_tracked_samples, self->num_tracked_samples,
+                N * sizeof(*self->num_tracked_samples));
+        }
     }
     if (dest->options & TSK_SAMPLE_LISTS) {
         if (!(self->options & TSK_SAMPLE_LISTS)) {
@@ -5126,7 +6316,8 @@ tsk_tree_get_num_tracked_samples(
         ret = TSK_ERR_UNSUPPORTED_OPERATION;
         goto out;
     }
-    *num_tracked_samples = self->num_tracked_samples[u];
+    *num_tracked_samples
+        = self->num_tracked_samples == NULL ? 0 : self->num_tracked_samples[u];
 out:
     return ret;
 }
@@ -5352,7 +6543,6 @@ tsk_tree_check_state(const tsk_tree_t *self)
 
     if (!(self->options & TSK_NO_SAMPLE_COUNTS)) {
         tsk_bug_assert(self->num_samples != NULL);
-        tsk_bug_assert(self->num_tracked_samples != NULL);
         for (u = 0; u < (tsk_id_t) self->num_nodes; u++) {
             err = tsk_tree_get_num_samples_by_traversal(self, u, &num_samples);
             tsk_bug_assert(err == 0);
@@ -5405,7 +6595,9 @@ tsk_tree_print_state(const tsk_tree_t *self, FILE *out)
         }
         if (!(self->options & TSK_NO_SAMPLE_COUNTS)) {
             fprintf(out, "\t%lld\t%lld", (long long) self->num_samples[j],
-                (long long) self->num_tracked_samples[j]);
+                self->num_tracked_samples == NULL
+                    ? 0LL
+                    : (long long) self->num_tracked_samples[j]);
         }
         fprintf(out, "\n");
     }
@@ -5542,15 +6734,25 @@ tsk_tree_remove_edge(tsk_tree_t *self, tsk_id_t p, tsk_id_t c)
     tsk_tree_remove_branch(self, p, c, parent);
     self->num_edges--;
     edge[c] = TSK_NULL;
+    TSK_COUNTER_ADD(edges_removed, 1);
 
     if (!(self->options & TSK_NO_SAMPLE_COUNTS)) {
         u = p;
-        while (u != TSK_NULL) {
-            path_end = u;
-            path_end_was_root = POTENTIAL_ROOT(u);
-            num_samples[u] -= num_samples[c];
-            num_tracked_samples[u] -= num_tracked_samples[c];
-            u = parent[u];
+        if (num_tracked_samples == NULL) {
+            while (u != TSK_NULL) {
+                path_end = u;
+                path_end_was_root = POTENTIAL_ROOT(u);
+                num_samples[u] -= num_samples[c];
+                u = parent[u];
+            }
+        } else {
+            while (u != TSK_NULL) {
+                path_end = u;
+                path_end_was_root = POTENTIAL_ROOT(u);
+                num_samples[u] -= num_samples[c];
+                num_tracked_samples[u] -= num_tracked_samples[c];
+                u = parent[u];
+            }
         }
 
         if (path_end_was_root && !POTENTIAL_ROOT(path_end)) {
@@ -5582,12 +6784,21 @@ tsk_tree_insert_edge(tsk_tree_t *self, tsk_id_t p, tsk_id_t c, tsk_id_t edge_id)
 
     if (!(self->options & TSK_NO_SAMPLE_COUNTS)) {
         u = p;
-        while (u != TSK_NULL) {
-            path_end = u;
-            path_end_was_root = POTENTIAL_ROOT(u);
-            num_samples[u] += num_samples[c];
-            num_tracked_samples[u] += num_tracked_samples[c];
-            u = parent[u];
+        if (num_tracked_samples == NULL) {
+            while (u != TSK_NULL) {
+                path_end = u;
+                path_end_was_root = POTENTIAL_ROOT(u);
+                num_samples[u] += num_samples[c];
+                u = parent[u];
+            }
+        } else {
+            while (u != TSK_NULL) {
+                path_end = u;
+                path_end_was_root = POTENTIAL_ROOT(u);
+                num_samples[u] += num_samples[c];
+                num_tracked_samples[u] += num_tracked_samples[c];
+                u = parent[u];
+            }
         }
 
         if (POTENTIAL_ROOT(c)) {
@@ -5601,6 +6812,7 @@ tsk_tree_insert_edge(tsk_tree_t *self, tsk_id_t p, tsk_id_t c, tsk_id_t edge_id)
     tsk_tree_insert_branch(self, p, c, parent);
     self->num_edges++;
     edge[c] = edge_id;
+    TSK_COUNTER_ADD(edges_inserted, 1);
 
     if (self->options & TSK_SAMPLE_LISTS) {
         tsk_tree_update_sample_lists(self, p, parent);
@@ -5643,6 +6855,7 @@ tsk_tree_update_index_and_interval(tsk_tree_t *self)
     self->index = self->tree_pos.index;
     self->interval.left = self->tree_pos.interval.left;
     self->interval.right = self->tree_pos.interval.right;
+    TSK_COUNTER_ADD(trees_visited, 1);
 
     if (tables->sites.num_rows > 0) {
         self->sites = self->tree_sequence->tree_sites[self->index];
@@ -5830,17 +7043,94 @@ out:
     return ret;
 }
 
+/* Seek from the null tree to the tree with the specified index by restoring
+ * the nearest preceding checkpoint in the seek index, and then moving the
+ * tree position forward. As in tsk_tree_seek_from_null, we only insert the
+ * edges in the final tree. We always insert them in insertion order, which
+ * is what tsk_tree_seek_from_null does when seeking forward, but it seeks
+ * backward for trees in the second half of the sequence and inserts in
+ * reverse removal order. The topology is the same either way, but the order
+ * of siblings can differ. */
+static int
+tsk_tree_seek_from_checkpoint(tsk_tree_t *self, tsk_id_t index)
+{
+    int ret = 0;
+    const tsk_treeseq_t *ts = self->tree_sequence;
+    const tsk_id_t *restrict edge_parent = ts->tables->edges.parent;
+    const tsk_id_t *restrict edge_child = ts->tables->edges.child;
+    const double *restrict edge_right = ts->tables->edges.right;
+    const tsk_size_t checkpoint = (tsk_size_t) index / ts->seek_index.interval;
+    const tsk_id_t *restrict checkpoint_edges
+        = ts->seek_index.edges + ts->seek_index.edges_offset[checkpoint];
+    const tsk_size_t num_checkpoint_edges
+        = ts->seek_index.edges_offset[checkpoint + 1]
+          - ts->seek_index.edges_offset[checkpoint];
+    const double left = ts->breakpoints[index];
+    tsk_tree_position_t *tree_pos = &self->tree_pos;
+    tsk_size_t k;
+    tsk_id_t j, e;
+
+    tree_pos->index = (tsk_id_t) (checkpoint * ts->seek_index.interval);
+    tree_pos->interval.left = ts->breakpoints[tree_pos->index];
+    tree_pos->interval.right = ts->breakpoints[tree_pos->index + 1];
+    tree_pos->in.stop = ts->seek_index.in_stop[checkpoint];
+    tree_pos->out.stop = ts->seek_index.out_stop[checkpoint];
+    tree_pos->direction = TSK_DIR_FORWARD;
+    ret = tsk_tree_position_seek_forward(tree_pos, index);
+    if (ret != 0) {
+        goto out;
+    }
+    for (k = 0; k < num_checkpoint_edges; k++) {
+        e = checkpoint_edges[k];
+        if (edge_right[e] > left) {
+            tsk_tree_insert_edge(self, edge_parent[e], edge_child[e], e);
+        }
+    }
+    /* All of these edges start after the checkpoint and at or before left */
+    for (j = tree_pos->in.start; j != tree_pos->in.stop; j++) {
+        e = tree_pos->in.order[j];
+        if (edge_right[e] > left) {
+            tsk_tree_insert_edge(self, edge_parent[e], edge_child[e], e);
+        }
+    }
+    tsk_tree_update_index_and_interval(self);
+out:
+    return ret;
+}
+
 int TSK_WARN_UNUSED
 tsk_tree_seek(tsk_tree_t *self, double x, tsk_flags_t options)
 {
     int ret = 0;
-    const double L = tsk_treeseq_get_sequence_length(self->tree_sequence);
+    const tsk_treeseq_t *ts = self->tree_sequence;
+    const double L = tsk_treeseq_get_sequence_length(ts);
+    const tsk_size_t interval = ts->seek_index.interval;
+    tsk_id_t index;
 
     if (x < 0 || x >= L) {
         ret = TSK_ERR_SEEK_OUT_OF_BOUNDS;
         goto out;
     }
 
+    if (interval > 0 && !tsk_tree_position_in_interval(self, x)) {
+        index = (tsk_id_t) tsk_search_sorted(ts->breakpoints, ts->num_trees + 1, x);
+        if (ts->breakpoints[index] > x) {
+            index--;
+        }
+        if (self->index == -1) {
+            ret = tsk_tree_seek_from_checkpoint(self, index);
+            goto out;
+        }
+        if ((tsk_size_t) llabs((long long) index - (long long) self->index) > interval) {
+            ret = tsk_tree_clear(self);
+            if (ret != 0) {
+                goto out;
+            }
+            ret = tsk_tree_seek_from_checkpoint(self, index);
+            goto out;
+        }
+    }
+
     if (self->index == -1) {
         ret = tsk_tree_seek_from_null(self, x, options);
     } else {
@@ -5884,9 +7174,11 @@ tsk_tree_clear(tsk_tree_t *self)
         /* We can't reset the tracked samples via memset because we don't
          * know where the tracked samples are.
          */
-        for (j = 0; j < self->num_nodes; j++) {
-            if (!(flags[j] & TSK_NODE_IS_SAMPLE)) {
-                self->num_tracked_samples[j] = 0;
+        if (self->num_tracked_samples != NULL) {
+            for (j = 0; j < self->num_nodes; j++) {
+                if (!(flags[j] & TSK_NODE_IS_SAMPLE)) {
+                    self->num_tracked_samples[j] = 0;
+                }
             }
         }
         /* The total tracked_samples gets set in set_tracked_samples */
@@ -6442,161 +7734,275 @@ get_smallest_set_bit(uint64_t v)
  * use a general cost matrix, in which case we'll use the Sankoff algorithm. For
  * now this is unused.
  *
- * We should also vectorise the function so that several sites can be processed
- * at once.
- *
  * The algorithm used here is Hartigan parsimony, "Minimum Mutation Fits to a
  * Given Tree", Biometrics 1973.
+ *
+ * The traversal orders are computed once for all sites, and the optimal
+ * sets are stored with the sites for each node contiguous in memory so that
+ * the inner loops over sites can be vectorised by the compiler. Nodes are
+ * visited in the same order as a stack-based preorder traversal that pushes
+ * the children in left-to-right order, so that the transitions for each site
+ * are in the same order as they would be for the site on its own.
  */
 int TSK_WARN_UNUSED
-tsk_tree_map_mutations(tsk_tree_t *self, int32_t *genotypes,
-    double *TSK_UNUSED(cost_matrix), tsk_flags_t options, int32_t *r_ancestral_state,
-    tsk_size_t *r_num_transitions, tsk_state_transition_t **r_transitions)
+tsk_tree_map_mutations_batch(tsk_tree_t *self, tsk_size_t num_sites,
+    const int32_t *genotypes, double *TSK_UNUSED(cost_matrix), tsk_flags_t options,
+    int32_t *ancestral_states, tsk_size_t *transitions_offset,
+    tsk_state_transition_t **r_transitions)
 {
     int ret = 0;
-    struct stack_elem {
-        tsk_id_t node;
-        tsk_id_t transition_parent;
-        int32_t state;
-    };
     const tsk_size_t num_samples = self->tree_sequence->num_samples;
+    const tsk_id_t *restrict samples = self->tree_sequence->samples;
+    const tsk_id_t *restrict parent = self->parent;
     const tsk_id_t *restrict left_child = self->left_child;
     const tsk_id_t *restrict right_sib = self->right_sib;
+    const tsk_id_t virtual_root = self->virtual_root;
     const tsk_size_t N = tsk_treeseq_get_num_nodes(self->tree_sequence);
     const tsk_flags_t *restrict node_flags = self->tree_sequence->tables->nodes.flags;
-    tsk_id_t *nodes = tsk_malloc(tsk_tree_get_size_bound(self) * sizeof(*nodes));
-    /* Note: to use less memory here and to improve cache performance we should
-     * probably change to allocating exactly the number of nodes returned by
-     * a preorder traversal, and then lay the memory out in this order. So, we'd
-     * need a map from node ID to its index in the preorder traversal, but this
-     * is trivial to compute. Probably doesn't matter so much at the moment
-     * when we're doing a single site, but it would make a big difference if
-     * we were vectorising over lots of sites. */
-    uint64_t *restrict optimal_set = tsk_calloc(N + 1, sizeof(*optimal_set));
-    struct stack_elem *restrict preorder_stack
-        = tsk_malloc(tsk_tree_get_size_bound(self) * sizeof(*preorder_stack));
-    tsk_id_t u, v;
-    /* The largest possible number of transitions is one over every sample */
-    tsk_state_transition_t *transitions = tsk_malloc(num_samples * sizeof(*transitions));
-    int32_t allele, ancestral_state;
+    const tsk_size_t size_bound = tsk_tree_get_size_bound(self);
+    tsk_id_t *restrict order = tsk_malloc(size_bound * sizeof(*order));
+    tsk_id_t *restrict parent_pos = tsk_malloc(size_bound * sizeof(*parent_pos));
+    tsk_id_t *restrict node_pos = tsk_malloc((N + 1) * sizeof(*node_pos));
+    tsk_id_t *restrict stack = tsk_malloc(size_bound * sizeof(*stack));
+    int32_t *restrict state = tsk_malloc(size_bound * sizeof(*state));
+    tsk_id_t *restrict transition_parent
+        = tsk_malloc(size_bound * sizeof(*transition_parent));
+    uint64_t *restrict site_mask = tsk_malloc(num_sites * sizeof(*site_mask));
+    tsk_size_t *restrict max_allele_count
+        = tsk_malloc(num_sites * sizeof(*max_allele_count));
+    tsk_size_t *restrict allele_count
+        = tsk_malloc(HARTIGAN_MAX_ALLELES * num_sites * sizeof(*allele_count));
+    uint64_t *restrict optimal_set = NULL;
+    uint64_t *restrict node_set;
+    const uint64_t *restrict child_set;
+    tsk_state_transition_t *transitions = NULL;
+    tsk_state_transition_t *tmp_transitions;
+    tsk_size_t max_transitions = 0;
+    tsk_size_t num_transitions = 0;
+    tsk_size_t j, k, num_nodes, non_missing;
+    tsk_size_t *restrict count;
+    tsk_size_t max_count;
+    tsk_id_t u, v, pos;
+    int32_t genotype, allele, site_alleles, num_alleles, st;
     int stack_top;
-    struct stack_elem s;
-    tsk_size_t j, num_transitions, max_allele_count, num_nodes;
-    tsk_size_t allele_count[HARTIGAN_MAX_ALLELES];
-    tsk_size_t non_missing = 0;
-    int32_t num_alleles = 0;
-
-    if (optimal_set == NULL || preorder_stack == NULL || transitions == NULL
-        || nodes == NULL) {
+
+    if (order == NULL || parent_pos == NULL || node_pos == NULL || stack == NULL
+        || state == NULL || transition_parent == NULL || site_mask == NULL
+        || max_allele_count == NULL || allele_count == NULL) {
         ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
-    for (j = 0; j < num_samples; j++) {
-        if (genotypes[j] >= HARTIGAN_MAX_ALLELES || genotypes[j] < TSK_MISSING_DATA) {
-            ret = TSK_ERR_BAD_GENOTYPE;
-            goto out;
-        }
-        u = self->tree_sequence->samples[j];
-        if (genotypes[j] == TSK_MISSING_DATA) {
-            /* All bits set */
-            optimal_set[u] = UINT64_MAX;
+
+    /* Do a preorder traversal, recording the position of each node's parent */
+    num_nodes = 0;
+    stack[0] = virtual_root;
+    stack_top = 0;
+    while (stack_top >= 0) {
+        u = stack[stack_top];
+        stack_top--;
+        order[num_nodes] = u;
+        node_pos[u] = (tsk_id_t) num_nodes;
+        if (u == virtual_root) {
+            parent_pos[num_nodes] = TSK_NULL;
+        } else if (parent[u] == TSK_NULL) {
+            parent_pos[num_nodes] = node_pos[virtual_root];
         } else {
-            optimal_set[u] = set_bit(optimal_set[u], genotypes[j]);
-            num_alleles = TSK_MAX(genotypes[j], num_alleles);
-            non_missing++;
+            parent_pos[num_nodes] = node_pos[parent[u]];
+        }
+        num_nodes++;
+        for (v = left_child[u]; v != TSK_NULL; v = right_sib[v]) {
+            stack_top++;
+            stack[stack_top] = v;
         }
     }
 
-    if (non_missing == 0) {
-        ret = TSK_ERR_GENOTYPES_ALL_MISSING;
+    optimal_set = tsk_calloc(num_nodes * num_sites, sizeof(*optimal_set));
+    if (optimal_set == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
-    num_alleles++;
-
-    ancestral_state = 0; /* keep compiler happy */
-    if (options & TSK_MM_FIXED_ANCESTRAL_STATE) {
-        ancestral_state = *r_ancestral_state;
-        if ((ancestral_state < 0) || (ancestral_state >= HARTIGAN_MAX_ALLELES)) {
-            ret = TSK_ERR_BAD_ANCESTRAL_STATE;
+    num_alleles = 0;
+    for (k = 0; k < num_sites; k++) {
+        non_missing = 0;
+        site_alleles = 0;
+        for (j = 0; j < num_samples; j++) {
+            genotype = genotypes[k * num_samples + j];
+            if (genotype >= HARTIGAN_MAX_ALLELES || genotype < TSK_MISSING_DATA) {
+                ret = TSK_ERR_BAD_GENOTYPE;
+                goto out;
+            }
+            node_set = optimal_set + ((tsk_size_t) node_pos[samples[j]]) * num_sites;
+            if (genotype == TSK_MISSING_DATA) {
+                /* All bits set */
+                node_set[k] = UINT64_MAX;
+            } else {
+                node_set[k] = set_bit(node_set[k], genotype);
+                site_alleles = TSK_MAX(genotype, site_alleles);
+                non_missing++;
+            }
+        }
+        if (non_missing == 0) {
+            ret = TSK_ERR_GENOTYPES_ALL_MISSING;
             goto out;
-        } else if (ancestral_state >= num_alleles) {
-            num_alleles = (int32_t)(ancestral_state + 1);
         }
+        site_alleles++;
+        if (options & TSK_MM_FIXED_ANCESTRAL_STATE) {
+            allele = ancestral_states[k];
+            if ((allele < 0) || (allele >= HARTIGAN_MAX_ALLELES)) {
+                ret = TSK_ERR_BAD_ANCESTRAL_STATE;
+                goto out;
+            }
+            site_alleles = TSK_MAX(site_alleles, allele + 1);
+        }
+        /* Only alleles less than the number of alleles at the site are counted */
+        site_mask[k] = site_alleles == HARTIGAN_MAX_ALLELES
+                           ? UINT64_MAX
+                           : (1ULL << site_alleles) - 1;
+        num_alleles = TSK_MAX(num_alleles, site_alleles);
     }
 
-    ret = tsk_tree_postorder_from(self, self->virtual_root, nodes, &num_nodes);
-    if (ret != 0) {
-        goto out;
-    }
-    for (j = 0; j < num_nodes; j++) {
-        u = nodes[j];
-        tsk_memset(allele_count, 0, ((size_t) num_alleles) * sizeof(*allele_count));
+    /* Children come before their parents in the reverse of the preorder */
+    for (j = num_nodes; j > 0; j--) {
+        u = order[j - 1];
+        node_set = optimal_set + (j - 1) * num_sites;
+        tsk_memset(allele_count, 0,
+            ((size_t) num_alleles) * num_sites * sizeof(*allele_count));
         for (v = left_child[u]; v != TSK_NULL; v = right_sib[v]) {
+            child_set = optimal_set + ((tsk_size_t) node_pos[v]) * num_sites;
             for (allele = 0; allele < num_alleles; allele++) {
-                allele_count[allele] += bit_is_set(optimal_set[v], allele);
+                count = allele_count + ((tsk_size_t) allele) * num_sites;
+                for (k = 0; k < num_sites; k++) {
+                    count[k] += ((child_set[k] & site_mask[k]) >> allele) & 1;
+                }
             }
         }
         /* the virtual root has no flags defined */
-        if (u == (tsk_id_t) N || !(node_flags[u] & TSK_NODE_IS_SAMPLE)) {
-            max_allele_count = 0;
+        if (u == virtual_root || !(node_flags[u] & TSK_NODE_IS_SAMPLE)) {
+            tsk_memset(max_allele_count, 0, num_sites * sizeof(*max_allele_count));
             for (allele = 0; allele < num_alleles; allele++) {
-                max_allele_count = TSK_MAX(max_allele_count, allele_count[allele]);
+                count = allele_count + ((tsk_size_t) allele) * num_sites;
+                for (k = 0; k < num_sites; k++) {
+                    max_count = max_allele_count[k];
+                    max_allele_count[k] = count[k] > max_count ? count[k] : max_count;
+                }
             }
             for (allele = 0; allele < num_alleles; allele++) {
-                if (allele_count[allele] == max_allele_count) {
-                    optimal_set[u] = set_bit(optimal_set[u], allele);
+                count = allele_count + ((tsk_size_t) allele) * num_sites;
+                for (k = 0; k < num_sites; k++) {
+                    node_set[k] |= ((uint64_t) (count[k] == max_allele_count[k]))
+                                   << allele;
                 }
             }
+            for (k = 0; k < num_sites; k++) {
+                node_set[k] &= site_mask[k];
+            }
         }
     }
-    if (!(options & TSK_MM_FIXED_ANCESTRAL_STATE)) {
-        ancestral_state = get_smallest_set_bit(optimal_set[self->virtual_root]);
-    } else {
-        optimal_set[self->virtual_root] = UINT64_MAX;
-    }
 
-    num_transitions = 0;
-
-    /* Do a preorder traversal */
-    preorder_stack[0].node = self->virtual_root;
-    preorder_stack[0].state = ancestral_state;
-    preorder_stack[0].transition_parent = TSK_NULL;
-    stack_top = 0;
-    while (stack_top >= 0) {
-        s = preorder_stack[stack_top];
-        stack_top--;
+    /* The virtual root is at position 0 */
+    for (k = 0; k < num_sites; k++) {
+        if (!(options & TSK_MM_FIXED_ANCESTRAL_STATE)) {
+            ancestral_states[k] = get_smallest_set_bit(optimal_set[k]);
+        } else {
+            optimal_set[k] = UINT64_MAX;
+        }
+    }
 
-        if (!bit_is_set(optimal_set[s.node], s.state)) {
-            s.state = get_smallest_set_bit(optimal_set[s.node]);
-            transitions[num_transitions].node = s.node;
-            transitions[num_transitions].parent = s.transition_parent;
-            transitions[num_transitions].state = s.state;
-            s.transition_parent = (tsk_id_t) num_transitions;
-            num_transitions++;
+    for (k = 0; k < num_sites; k++) {
+        transitions_offset[k] = num_transitions;
+        /* The largest possible number of transitions is one over every sample */
+        if (num_transitions + num_samples > max_transitions) {
+            max_transitions
+                = TSK_MAX(2 * max_transitions, num_transitions + num_samples);
+            tmp_transitions
+                = tsk_realloc(transitions, max_transitions * sizeof(*transitions));
+            if (tmp_transitions == NULL) {
+                ret = TSK_ERR_NO_MEMORY;
+                goto out;
+            }
+            transitions = tmp_transitions;
+        }
+        state[0] = ancestral_states[k];
+        transition_parent[0] = TSK_NULL;
+        for (j = 1; j < num_nodes; j++) {
+            pos = parent_pos[j];
+            st = state[pos];
+            transition_parent[j] = transition_parent[pos];
+            node_set = optimal_set + j * num_sites;
+            if (!bit_is_set(node_set[k], st)) {
+                st = get_smallest_set_bit(node_set[k]);
+                transitions[num_transitions].node = order[j];
+                transitions[num_transitions].parent = transition_parent[pos];
+                transitions[num_transitions].state = st;
+                transition_parent[j]
+                    = (tsk_id_t) (num_transitions - transitions_offset[k]);
+                num_transitions++;
+            }
+            state[j] = st;
         }
-        for (v = left_child[s.node]; v != TSK_NULL; v = right_sib[v]) {
-            stack_top++;
-            s.node = v;
-            preorder_stack[stack_top] = s;
+    }
+    transitions_offset[num_sites] = num_transitions;
+    if (transitions == NULL) {
+        /* Make sure we always return a pointer that can be freed */
+        transitions = tsk_malloc(sizeof(*transitions));
+        if (transitions == NULL) {
+            ret = TSK_ERR_NO_MEMORY;
+            goto out;
         }
     }
-
     *r_transitions = transitions;
-    *r_num_transitions = num_transitions;
-    *r_ancestral_state = ancestral_state;
     transitions = NULL;
 out:
     tsk_safe_free(transitions);
     /* Cannot safe_free because of 'restrict' */
+    if (order != NULL) {
+        free(order);
+    }
+    if (parent_pos != NULL) {
+        free(parent_pos);
+    }
+    if (node_pos != NULL) {
+        free(node_pos);
+    }
+    if (stack != NULL) {
+        free(stack);
+    }
+    if (state != NULL) {
+        free(state);
+    }
+    if (transition_parent != NULL) {
+        free(transition_parent);
+    }
+    if (site_mask != NULL) {
+        free(site_mask);
+    }
+    if (max_allele_count != NULL) {
+        free(max_allele_count);
+    }
+    if (allele_count != NULL) {
+        free(allele_count);
+    }
     if (optimal_set != NULL) {
         free(optimal_set);
     }
-    if (preorder_stack != NULL) {
-        free(preorder_stack);
-    }
-    if (nodes != NULL) {
-        free(nodes);
+    return ret;
+}
+
+int TSK_WARN_UNUSED
+tsk_tree_map_mutations(tsk_tree_t *self, int32_t *genotypes, double *cost_matrix,
+    tsk_flags_t options, int32_t *r_ancestral_state, tsk_size_t *r_num_transitions,
+    tsk_state_transition_t **r_transitions)
+{
+    int ret;
+    tsk_size_t transitions_offset[2];
+
+    ret = tsk_tree_map_mutations_batch(self, 1, genotypes, cost_matrix, options,
+        r_ancestral_state, transitions_offset, r_transitions);
+    if (ret != 0) {
+        goto out;
     }
+    *r_num_transitions = transitions_offset[1];
+out:
     return ret;
 }
 
@@ -6612,6 +8018,145 @@ tsk_diff_iter_init_from_ts(
         self, tree_sequence->tables, (tsk_id_t) tree_sequence->num_trees, options);
 }
 
+/* Walks the edge indexes over trees [start_tree, stop_tree), writing the edge
+ * IDs and offsets if the output arrays are not NULL. With NULL arrays this
+ * just counts the edges, so that we can allocate exactly. */
+static void
+tsk_edge_diffs_fill(const tsk_treeseq_t *tree_sequence, tsk_id_t start_tree,
+    tsk_id_t stop_tree, tsk_id_t *edges_in, tsk_size_t *edges_in_offset,
+    tsk_id_t *edges_out, tsk_size_t *edges_out_offset, tsk_size_t *num_edges_in,
+    tsk_size_t *num_edges_out)
+{
+    const tsk_table_collection_t *tables = tree_sequence->tables;
+    const tsk_id_t M = (tsk_id_t) tables->edges.num_rows;
+    const tsk_id_t *restrict I = tables->indexes.edge_insertion_order;
+    const tsk_id_t *restrict O = tables->indexes.edge_removal_order;
+    const double *restrict edge_left = tables->edges.left;
+    const double *restrict edge_right = tables->edges.right;
+    const double *restrict breakpoints = tree_sequence->breakpoints;
+    const bool fill = edges_in != NULL;
+    tsk_size_t n_in = 0;
+    tsk_size_t n_out = 0;
+    tsk_id_t tj, tk, j;
+    double x;
+
+    if (start_tree < stop_tree) {
+        /* The first tree inserts every edge that intersects its left coordinate */
+        x = breakpoints[start_tree];
+        for (tj = 0; tj < M && edge_left[I[tj]] <= x; tj++) {
+            if (edge_right[I[tj]] > x) {
+                if (fill) {
+                    edges_in[n_in] = I[tj];
+                }
+                n_in++;
+            }
+        }
+        tk = 0;
+        while (tk < M && edge_right[O[tk]] <= x) {
+            tk++;
+        }
+        if (fill) {
+            edges_in_offset[0] = 0;
+            edges_out_offset[0] = 0;
+            edges_in_offset[1] = n_in;
+            edges_out_offset[1] = 0;
+        }
+        for (j = start_tree + 1; j < stop_tree; j++) {
+            x = breakpoints[j];
+            for (; tk < M && edge_right[O[tk]] == x; tk++) {
+                if (fill) {
+                    edges_out[n_out] = O[tk];
+                }
+                n_out++;
+            }
+            for (; tj < M && edge_left[I[tj]] == x; tj++) {
+                if (fill) {
+                    edges_in[n_in] = I[tj];
+                }
+                n_in++;
+            }
+            if (fill) {
+                edges_in_offset[j - start_tree + 1] = n_in;
+                edges_out_offset[j - start_tree + 1] = n_out;
+            }
+        }
+    } else if (fill) {
+        edges_in_offset[0] = 0;
+        edges_out_offset[0] = 0;
+    }
+    *num_edges_in = n_in;
+    *num_edges_out = n_out;
+}
+
+int TSK_WARN_UNUSED
+tsk_edge_diffs_init(tsk_edge_diffs_t *self, const tsk_treeseq_t *tree_sequence,
+    tsk_id_t start_tree, tsk_id_t stop_tree, tsk_flags_t TSK_UNUSED(options))
+{
+    int ret = 0;
+    tsk_size_t num_trees;
+
+    tsk_memset(self, 0, sizeof(*self));
+    if (start_tree < 0 || start_tree > stop_tree
+        || stop_tree > (tsk_id_t) tree_sequence->num_trees) {
+        ret = TSK_ERR_SEEK_OUT_OF_BOUNDS;
+        goto out;
+    }
+    num_trees = (tsk_size_t)(stop_tree - start_tree);
+    self->start_tree = start_tree;
+    self->num_trees = num_trees;
+
+    tsk_edge_diffs_fill(tree_sequence, start_tree, stop_tree, NULL, NULL, NULL, NULL,
+        &self->num_edges_in, &self->num_edges_out);
+    /* Allocate at least one element so that we don't get NULL for empty arrays */
+    self->edges_in = tsk_malloc(TSK_MAX(1, self->num_edges_in) * sizeof(tsk_id_t));
+    self->edges_out = tsk_malloc(TSK_MAX(1, self->num_edges_out) * sizeof(tsk_id_t));
+    self->edges_in_offset = tsk_malloc((num_trees + 1) * sizeof(tsk_size_t));
+    self->edges_out_offset = tsk_malloc((num_trees + 1) * sizeof(tsk_size_t));
+    if (self->edges_in == NULL || self->edges_out == NULL
+        || self->edges_in_offset == NULL || self->edges_out_offset == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    tsk_edge_diffs_fill(tree_sequence, start_tree, stop_tree, self->edges_in,
+        self->edges_in_offset, self->edges_out, self->edges_out_offset,
+        &self->num_edges_in, &self->num_edges_out);
+out:
+    return ret;
+}
+
+int
+tsk_edge_diffs_free(tsk_edge_diffs_t *self)
+{
+    tsk_safe_free(self->edges_in);
+    tsk_safe_free(self->edges_out);
+    tsk_safe_free(self->edges_in_offset);
+    tsk_safe_free(self->edges_out_offset);
+    return 0;
+}
+
+void
+tsk_edge_diffs_print_state(const tsk_edge_diffs_t *self, FILE *out)
+{
+    tsk_size_t j, k;
+
+    fprintf(out, "Edge diffs state\n");
+    fprintf(out, "start_tree = %lld\n", (long long) self->start_tree);
+    fprintf(out, "num_trees = %lld\n", (long long) self->num_trees);
+    fprintf(out, "num_edges_in = %lld\n", (long long) self->num_edges_in);
+    fprintf(out, "num_edges_out = %lld\n", (long long) self->num_edges_out);
+    for (j = 0; j < self->num_trees; j++) {
+        fprintf(out, "%lld\tout:", (long long) self->start_tree + (long long) j);
+        for (k = self->edges_out_offset[j]; k < self->edges_out_offset[j + 1]; k++) {
+            fprintf(out, " %lld", (long long) self->edges_out[k]);
+        }
+        fprintf(out, "\tin:");
+        for (k = self->edges_in_offset[j]; k < self->edges_in_offset[j + 1]; k++) {
+            fprintf(out, " %lld", (long long) self->edges_in[k]);
+        }
+        fprintf(out, "\n");
+    }
+}
+
 /* ======================================================== *
  * KC Distance
  * ======================================================== */
@@ -7002,33 +8547,78 @@ out:
     return ret;
 }
 
-int
-tsk_treeseq_kc_distance(const tsk_treeseq_t *self, const tsk_treeseq_t *other,
-    double lambda_, double *result)
+/* Set the KC vectors and node depths from scratch for the current tree,
+ * so that we can start the incremental updates from any position. */
+static int
+init_kc_state(const tsk_tree_t *tree, kc_vectors *kc, tsk_size_t *depths)
 {
-    int i;
-    tsk_id_t n;
-    tsk_size_t num_nodes;
-    double left, span, total;
-    const tsk_treeseq_t *treeseqs[2] = { self, other };
-    tsk_tree_t trees[2];
-    kc_vectors kcs[2];
-    tsk_size_t *depths[2];
     int ret = 0;
+    tsk_size_t j, num_nodes;
+    tsk_id_t u, p;
+    tsk_id_t *nodes = tsk_malloc(tsk_tree_get_size_bound(tree) * sizeof(*nodes));
 
-    for (i = 0; i < 2; i++) {
-        tsk_memset(&trees[i], 0, sizeof(trees[i]));
-        tsk_memset(&kcs[i], 0, sizeof(kcs[i]));
-        depths[i] = NULL;
+    if (nodes == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
     }
-
-    ret = check_kc_distance_tree_sequence_inputs(self, other);
+    ret = check_kc_distance_tree_inputs(tree);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = fill_kc_vectors(tree, kc);
+    if (ret != 0) {
+        goto out;
+    }
+    ret = tsk_tree_preorder(tree, nodes, &num_nodes);
     if (ret != 0) {
         goto out;
     }
+    for (j = 0; j < num_nodes; j++) {
+        u = nodes[j];
+        p = tree->parent[u];
+        depths[u] = p == TSK_NULL ? 0 : depths[p] + 1;
+    }
+out:
+    tsk_safe_free(nodes);
+    return ret;
+}
 
-    n = (tsk_id_t) self->num_samples;
-    for (i = 0; i < 2; i++) {
+/* Computes the integral of the KC distance between all pairs of tree
+ * sequences over [left, right). Each tree sequence's KC vectors are updated
+ * once per tree, however many other tree sequences it is compared with. */
+static int
+kc_distance_matrix(const tsk_treeseq_t *const *treeseqs, tsk_size_t num_treeseqs,
+    double lambda_, double left, double right, double *result)
+{
+    int ret = 0;
+    tsk_size_t i, j;
+    tsk_id_t n;
+    double x, next_x, distance;
+    tsk_tree_t *trees = NULL;
+    kc_vectors *kcs = NULL;
+    tsk_size_t **depths = NULL;
+
+    if (num_treeseqs == 0 || left < 0 || right <= left
+        || right > treeseqs[0]->tables->sequence_length) {
+        ret = TSK_ERR_BAD_PARAM_VALUE;
+        goto out;
+    }
+    trees = tsk_calloc(num_treeseqs, sizeof(*trees));
+    kcs = tsk_calloc(num_treeseqs, sizeof(*kcs));
+    depths = tsk_calloc(num_treeseqs, sizeof(*depths));
+    if (trees == NULL || kcs == NULL || depths == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    for (i = 1; i < num_treeseqs; i++) {
+        ret = check_kc_distance_tree_sequence_inputs(treeseqs[0], treeseqs[i]);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+
+    n = (tsk_id_t) treeseqs[0]->num_samples;
+    for (i = 0; i < num_treeseqs; i++) {
         ret = tsk_tree_init(&trees[i], treeseqs[i], TSK_SAMPLE_LISTS);
         if (ret != 0) {
             goto out;
@@ -7037,71 +8627,108 @@ tsk_treeseq_kc_distance(const tsk_treeseq_t *self, const tsk_treeseq_t *other,
         if (ret != 0) {
             goto out;
         }
-        num_nodes = tsk_treeseq_get_num_nodes(treeseqs[i]);
-        depths[i] = tsk_calloc(num_nodes, sizeof(*depths[i]));
+        depths[i] = tsk_calloc(tsk_treeseq_get_num_nodes(treeseqs[i]), sizeof(**depths));
         if (depths[i] == NULL) {
             ret = TSK_ERR_NO_MEMORY;
             goto out;
         }
-    }
-
-    total = 0;
-    left = 0;
-
-    ret = tsk_tree_first(&trees[0]);
-    if (ret != TSK_TREE_OK) {
-        goto out;
-    }
-    ret = check_kc_distance_tree_inputs(&trees[0]);
-    if (ret != 0) {
-        goto out;
-    }
-
-    ret = update_kc_incremental(&trees[0], &kcs[0], depths[0]);
-    if (ret != 0) {
-        goto out;
-    }
-    while ((ret = tsk_tree_next(&trees[1])) == TSK_TREE_OK) {
-        ret = check_kc_distance_tree_inputs(&trees[1]);
+        ret = tsk_tree_seek(&trees[i], left, 0);
         if (ret != 0) {
             goto out;
         }
-
-        ret = update_kc_incremental(&trees[1], &kcs[1], depths[1]);
+        ret = init_kc_state(&trees[i], &kcs[i], depths[i]);
         if (ret != 0) {
             goto out;
         }
-        while (trees[0].interval.right < trees[1].interval.right) {
-            span = trees[0].interval.right - left;
-            total += norm_kc_vectors(&kcs[0], &kcs[1], lambda_) * span;
+    }
 
-            left = trees[0].interval.right;
-            ret = tsk_tree_next(&trees[0]);
-            tsk_bug_assert(ret == TSK_TREE_OK);
-            ret = check_kc_distance_tree_inputs(&trees[0]);
-            if (ret != 0) {
-                goto out;
+    tsk_memset(result, 0, num_treeseqs * num_treeseqs * sizeof(*result));
+    x = left;
+    while (true) {
+        next_x = right;
+        for (i = 0; i < num_treeseqs; i++) {
+            next_x = TSK_MIN(next_x, trees[i].interval.right);
+        }
+        for (i = 0; i < num_treeseqs; i++) {
+            for (j = i + 1; j < num_treeseqs; j++) {
+                distance = norm_kc_vectors(&kcs[i], &kcs[j], lambda_) * (next_x - x);
+                result[i * num_treeseqs + j] += distance;
+                result[j * num_treeseqs + i] += distance;
             }
-            ret = update_kc_incremental(&trees[0], &kcs[0], depths[0]);
-            if (ret != 0) {
-                goto out;
+        }
+        x = next_x;
+        if (x == right) {
+            break;
+        }
+        for (i = 0; i < num_treeseqs; i++) {
+            if (trees[i].interval.right == x) {
+                ret = tsk_tree_next(&trees[i]);
+                tsk_bug_assert(ret == TSK_TREE_OK);
+                ret = check_kc_distance_tree_inputs(&trees[i]);
+                if (ret != 0) {
+                    goto out;
+                }
+                ret = update_kc_incremental(&trees[i], &kcs[i], depths[i]);
+                if (ret != 0) {
+                    goto out;
+                }
             }
         }
-        span = trees[1].interval.right - left;
-        left = trees[1].interval.right;
-        total += norm_kc_vectors(&kcs[0], &kcs[1], lambda_) * span;
     }
+out:
+    if (trees != NULL && kcs != NULL && depths != NULL) {
+        for (i = 0; i < num_treeseqs; i++) {
+            tsk_tree_free(&trees[i]);
+            kc_vectors_free(&kcs[i]);
+            tsk_safe_free(depths[i]);
+        }
+    }
+    tsk_safe_free(trees);
+    tsk_safe_free(kcs);
+    tsk_safe_free(depths);
+    return ret;
+}
+
+int
+tsk_treeseq_kc_distance(const tsk_treeseq_t *self, const tsk_treeseq_t *other,
+    double lambda_, double *result)
+{
+    return tsk_treeseq_kc_distance_interval(
+        self, other, lambda_, 0, self->tables->sequence_length, result);
+}
+
+int
+tsk_treeseq_kc_distance_interval(const tsk_treeseq_t *self, const tsk_treeseq_t *other,
+    double lambda_, double left, double right, double *result)
+{
+    int ret = 0;
+    const tsk_treeseq_t *treeseqs[2] = { self, other };
+    double matrix[4];
+
+    ret = kc_distance_matrix(treeseqs, 2, lambda_, left, right, matrix);
     if (ret != 0) {
         goto out;
     }
-
-    *result = total / self->tables->sequence_length;
+    *result = matrix[1] / (right - left);
 out:
-    for (i = 0; i < 2; i++) {
-        tsk_tree_free(&trees[i]);
-        kc_vectors_free(&kcs[i]);
-        tsk_safe_free(depths[i]);
+    return ret;
+}
+
+int
+tsk_treeseq_kc_distance_matrix(const tsk_treeseq_t *const *treeseqs,
+    tsk_size_t num_treeseqs, double lambda_, double left, double right, double *result)
+{
+    int ret = 0;
+    tsk_size_t j;
+
+    ret = kc_distance_matrix(treeseqs, num_treeseqs, lambda_, left, right, result);
+    if (ret != 0) {
+        goto out;
     }
+    for (j = 0; j < num_treeseqs * num_treeseqs; j++) {
+        result[j] /= right - left;
+    }
+out:
     return ret;
 }
 
@@ -7325,6 +8952,151 @@ sv_tables_mrca(const sv_tables_t *self, tsk_id_t x, tsk_id_t y)
     return sv_tables_mrca_one_based(self, x + 1, y + 1) - 1;
 }
 
+static tsk_id_t
+sv_tables_get_root(const sv_tables_t *self, tsk_id_t u)
+{
+    const tsk_id_t *restrict parent = self->parent;
+    tsk_id_t v = u + 1;
+
+    while (parent[v] != LAMBDA) {
+        v = parent[v];
+    }
+    return v - 1;
+}
+
+/* Returns the branch length divergence between u and v in the tree indexed
+ * by the specified sv_tables. */
+static double
+sv_tables_branch_divergence(
+    const sv_tables_t *self, const double *restrict nodes_time, tsk_id_t u, tsk_id_t v)
+{
+    tsk_id_t w = sv_tables_mrca(self, u, v);
+    tsk_id_t u_root = w;
+    tsk_id_t v_root = w;
+
+    if (w == TSK_NULL) {
+        /* Slow path - only happens for nodes in disconnected
+         * subtrees in a tree with multiple roots */
+        u_root = sv_tables_get_root(self, u);
+        v_root = sv_tables_get_root(self, v);
+    }
+    return (nodes_time[u_root] - nodes_time[u]) + (nodes_time[v_root] - nodes_time[v]);
+}
+
+static void
+update_branch_divergence_all_pairs(const sv_tables_t *sv, const double *nodes_time,
+    tsk_size_t N, const tsk_size_t *restrict ss_offsets,
+    const tsk_id_t *restrict sample_sets, double span, double *restrict D)
+{
+    tsk_size_t j, k, sj, sk;
+    tsk_id_t u, v;
+
+    for (sj = 0; sj < N; sj++) {
+        for (j = ss_offsets[sj]; j < ss_offsets[sj + 1]; j++) {
+            u = sample_sets[j];
+            for (sk = sj; sk < N; sk++) {
+                for (k = ss_offsets[sk]; k < ss_offsets[sk + 1]; k++) {
+                    v = sample_sets[k];
+                    if (u == v) {
+                        /* This case contributes zero to divergence, so
+                         * short-circuit to save time.
+                         * TODO is there a better way to do this? */
+                        continue;
+                    }
+                    D[sj * N + sk]
+                        += sv_tables_branch_divergence(sv, nodes_time, u, v) * span;
+                }
+            }
+        }
+    }
+}
+
+/* Update the pairs involving at least one of the affected sample positions
+ * by the change in divergence between the trees indexed by sv_prev and sv_cur.
+ * Pairs within a sample set are counted in both orders, as in
+ * update_branch_divergence_all_pairs. */
+static void
+update_branch_divergence_affected_pairs(const sv_tables_t *sv_prev,
+    const sv_tables_t *sv_cur, const double *nodes_time, tsk_size_t N,
+    tsk_size_t num_samples, const tsk_id_t *restrict sample_sets,
+    const tsk_id_t *restrict sample_set_index, tsk_size_t num_affected,
+    const tsk_size_t *restrict affected, const bool *restrict is_affected, double span,
+    double *restrict D)
+{
+    tsk_size_t j, k, p;
+    tsk_id_t u, v, sj, sk;
+    double d;
+
+    for (j = 0; j < num_affected; j++) {
+        p = affected[j];
+        u = sample_sets[p];
+        sj = sample_set_index[p];
+        for (k = 0; k < num_samples; k++) {
+            /* Visit pairs of affected samples only once */
+            if (k == p || (is_affected[k] && k < p)) {
+                continue;
+            }
+            v = sample_sets[k];
+            sk = sample_set_index[k];
+            d = sv_tables_branch_divergence(sv_prev, nodes_time, u, v)
+                - sv_tables_branch_divergence(sv_cur, nodes_time, u, v);
+            if (sj == sk) {
+                D[(tsk_size_t) sj * N + (tsk_size_t) sj] += 2 * d * span;
+            } else {
+                D[(tsk_size_t) TSK_MIN(sj, sk) * N + (tsk_size_t) TSK_MAX(sj, sk)]
+                    += d * span;
+            }
+        }
+    }
+}
+
+/* Appends the positions of the samples in the subtree rooted at c to the
+ * affected list, skipping subtrees already visited in the current tree. */
+static tsk_size_t
+collect_affected_samples(const tsk_tree_t *tree, tsk_id_t c,
+    const tsk_id_t *restrict node_position, tsk_id_t *restrict last_visit,
+    tsk_id_t *restrict stack, tsk_size_t *restrict affected, bool *restrict is_affected,
+    tsk_size_t num_affected)
+{
+    const tsk_id_t *restrict left_child = tree->left_child;
+    const tsk_id_t *restrict right_sib = tree->right_sib;
+    tsk_id_t u, v;
+    int stack_top;
+
+    if (last_visit[c] == tree->index) {
+        return num_affected;
+    }
+    last_visit[c] = tree->index;
+    stack_top = 0;
+    stack[0] = c;
+    while (stack_top >= 0) {
+        u = stack[stack_top];
+        stack_top--;
+        if (node_position[u] != TSK_NULL) {
+            affected[num_affected] = (tsk_size_t) node_position[u];
+            is_affected[node_position[u]] = true;
+            num_affected++;
+        }
+        for (v = left_child[u]; v != TSK_NULL; v = right_sib[v]) {
+            if (last_visit[v] != tree->index) {
+                last_visit[v] = tree->index;
+                stack_top++;
+                stack[stack_top] = v;
+            }
+        }
+    }
+    return num_affected;
+}
+
+/* The branch divergence matrix is updated incrementally along the genome.
+ * Writing d(u, v) for the divergence of u and v in a given tree, the value
+ * for the window [left, right) is the integral of d over the window. We
+ * accumulate this as d(u, v) * (right - left) in the last tree of the window,
+ * plus (d_before(u, v) - d_after(u, v)) * (x - left) for each tree transition
+ * at x within the window. The path between u and v can only change at x if
+ * one of them is below the child of an edge removed or inserted at x, and any
+ * such sample is below one of these children in the tree after the transition
+ * too. So, we only visit the pairs involving samples under these children. */
 static int
 tsk_treeseq_divergence_matrix_branch(const tsk_treeseq_t *self,
     tsk_size_t num_sample_sets, const tsk_size_t *restrict sample_set_sizes,
@@ -7334,24 +9106,38 @@ tsk_treeseq_divergence_matrix_branch(const tsk_treeseq_t *self,
     int ret = 0;
     tsk_tree_t tree;
     const double *restrict nodes_time = self->tables->nodes.time;
+    const tsk_id_t *restrict edges_child = self->tables->edges.child;
+    const tsk_size_t num_nodes = self->tables->nodes.num_rows;
     const tsk_size_t N = num_sample_sets;
-    tsk_size_t i, j, k, offset, sj, sk;
-    tsk_id_t u, v, w, u_root, v_root;
-    double tu, tv, d, span, left, right, span_left, span_right;
-    double *restrict D;
-    sv_tables_t sv;
+    tsk_size_t i, j, k, offset, num_samples, num_affected;
+    tsk_id_t e;
+    tsk_tree_position_t tree_pos;
+    double x;
+    sv_tables_t sv[2];
+    sv_tables_t *sv_cur = &sv[0];
+    sv_tables_t *sv_prev = &sv[1];
+    sv_tables_t *sv_tmp;
     tsk_size_t *ss_offsets = tsk_malloc((num_sample_sets + 1) * sizeof(*ss_offsets));
+    tsk_id_t *node_position = tsk_malloc(num_nodes * sizeof(*node_position));
+    tsk_id_t *last_visit = tsk_malloc(num_nodes * sizeof(*last_visit));
+    tsk_id_t *stack = tsk_malloc(num_nodes * sizeof(*stack));
+    tsk_id_t *sample_set_index = NULL;
+    tsk_size_t *affected = NULL;
+    bool *is_affected = NULL;
 
     memset(&sv, 0, sizeof(sv));
     ret = tsk_tree_init(&tree, self, 0);
     if (ret != 0) {
         goto out;
     }
-    ret = sv_tables_init(&sv, self->tables->nodes.num_rows + 1);
-    if (ret != 0) {
-        goto out;
+    for (j = 0; j < 2; j++) {
+        ret = sv_tables_init(&sv[j], num_nodes + 1);
+        if (ret != 0) {
+            goto out;
+        }
     }
-    if (ss_offsets == NULL) {
+    if (ss_offsets == NULL || node_position == NULL || last_visit == NULL
+        || stack == NULL) {
         ret = TSK_ERR_NO_MEMORY;
         goto out;
     }
@@ -7366,61 +9152,88 @@ tsk_treeseq_divergence_matrix_branch(const tsk_treeseq_t *self,
         offset += sample_set_sizes[j];
         ss_offsets[j + 1] = offset;
     }
+    num_samples = offset;
+    sample_set_index = tsk_malloc(num_samples * sizeof(*sample_set_index));
+    affected = tsk_malloc(num_samples * sizeof(*affected));
+    is_affected = tsk_calloc(num_samples, sizeof(*is_affected));
+    if (sample_set_index == NULL || affected == NULL || is_affected == NULL) {
+        ret = TSK_ERR_NO_MEMORY;
+        goto out;
+    }
+    for (j = 0; j < num_nodes; j++) {
+        node_position[j] = TSK_NULL;
+        last_visit[j] = TSK_NULL;
+    }
+    for (j = 0; j < N; j++) {
+        for (k = ss_offsets[j]; k < ss_offsets[j + 1]; k++) {
+            /* Sample sets are disjoint, as checked by get_sample_set_index_map */
+            node_position[sample_sets[k]] = (tsk_id_t) k;
+            sample_set_index[k] = (tsk_id_t) j;
+        }
+    }
 
-    for (i = 0; i < num_windows; i++) {
-        left = windows[i];
-        right = windows[i + 1];
-        D = result + i * N * N;
-        ret = tsk_tree_seek(&tree, left, 0);
-        if (ret != 0) {
+    ret = tsk_tree_seek(&tree, windows[0], 0);
+    if (ret != 0) {
+        goto out;
+    }
+    sv_tables_build(sv_cur, &tree);
+    i = 0;
+    while (true) {
+        /* Finish off the windows that end within this tree */
+        while (i < num_windows && windows[i + 1] <= tree.interval.right) {
+            update_branch_divergence_all_pairs(sv_cur, nodes_time, N, ss_offsets,
+                sample_sets, windows[i + 1] - windows[i], result + i * N * N);
+            i++;
+        }
+        if (i == num_windows) {
+            break;
+        }
+        ret = tsk_tree_next(&tree);
+        if (ret < 0) {
             goto out;
         }
-        while (tree.interval.left < right && tree.index != -1) {
-            span_left = TSK_MAX(tree.interval.left, left);
-            span_right = TSK_MIN(tree.interval.right, right);
-            span = span_right - span_left;
-            sv_tables_build(&sv, &tree);
-            for (sj = 0; sj < N; sj++) {
-                for (j = ss_offsets[sj]; j < ss_offsets[sj + 1]; j++) {
-                    u = sample_sets[j];
-                    for (sk = sj; sk < N; sk++) {
-                        for (k = ss_offsets[sk]; k < ss_offsets[sk + 1]; k++) {
-                            v = sample_sets[k];
-                            if (u == v) {
-                                /* This case contributes zero to divergence, so
-                                 * short-circuit to save time.
-                                 * TODO is there a better way to do this? */
-                                continue;
-                            }
-                            w = sv_tables_mrca(&sv, u, v);
-                            if (w != TSK_NULL) {
-                                u_root = w;
-                                v_root = w;
-                            } else {
-                                /* Slow path - only happens for nodes in disconnected
-                                 * subtrees in a tree with multiple roots */
-                                u_root = tsk_tree_get_node_root(&tree, u);
-                                v_root = tsk_tree_get_node_root(&tree, v);
-                            }
-                            tu = nodes_time[u_root] - nodes_time[u];
-                            tv = nodes_time[v_root] - nodes_time[v];
-                            d = (tu + tv) * span;
-                            D[sj * N + sk] += d;
-                        }
-                    }
-                }
-            }
-            ret = tsk_tree_next(&tree);
-            if (ret < 0) {
-                goto out;
-            }
+        tsk_bug_assert(ret == TSK_TREE_OK);
+        sv_tmp = sv_prev;
+        sv_prev = sv_cur;
+        sv_cur = sv_tmp;
+        sv_tables_build(sv_cur, &tree);
+        x = tree.interval.left;
+        if (x == windows[i]) {
+            /* Transitions at the start of a window contribute nothing */
+            continue;
+        }
+
+        num_affected = 0;
+        tree_pos = tree.tree_pos;
+        for (e = tree_pos.out.start; e != tree_pos.out.stop; e++) {
+            num_affected = collect_affected_samples(&tree,
+                edges_child[tree_pos.out.order[e]], node_position, last_visit, stack,
+                affected, is_affected, num_affected);
+        }
+        for (e = tree_pos.in.start; e != tree_pos.in.stop; e++) {
+            num_affected = collect_affected_samples(&tree,
+                edges_child[tree_pos.in.order[e]], node_position, last_visit, stack,
+                affected, is_affected, num_affected);
+        }
+        update_branch_divergence_affected_pairs(sv_prev, sv_cur, nodes_time, N,
+            num_samples, sample_sets, sample_set_index, num_affected, affected,
+            is_affected, x - windows[i], result + i * N * N);
+        for (j = 0; j < num_affected; j++) {
+            is_affected[affected[j]] = false;
         }
     }
     ret = 0;
 out:
     tsk_tree_free(&tree);
-    sv_tables_free(&sv);
+    sv_tables_free(&sv[0]);
+    sv_tables_free(&sv[1]);
     tsk_safe_free(ss_offsets);
+    tsk_safe_free(node_position);
+    tsk_safe_free(last_visit);
+    tsk_safe_free(stack);
+    tsk_safe_free(sample_set_index);
+    tsk_safe_free(affected);
+    tsk_safe_free(is_affected);
     return ret;
 }
 
@@ -69,12 +69,29 @@ when the tree sequence is initialised. Indexes are required for a valid
 tree sequence, and are not built by default for performance reasons.
 */
 #define TSK_TS_INIT_BUILD_INDEXES (1 << 0)
+/**
+If specified, build a checkpoint index at the default interval so that
+:c:func:`tsk_tree_seek` takes time proportional to the interval rather than
+to the distance being seeked. See :c:func:`tsk_treeseq_build_seek_index`.
+*/
+#define TSK_TS_INIT_SEEK_INDEX (1 << 1)
 /** @} */
 
 // clang-format on
 
 /**
 @brief The tree sequence object.
+
+@rst
+A tree sequence is immutable once :c:func:`tsk_treeseq_init` (or
+:c:func:`tsk_treeseq_load`) has returned successfully: none of the fields
+below, including the derived arrays such as ``breakpoints``, ``tree_sites``,
+``site_mutations`` and ``sample_index_map``, are modified by any library
+function other than :c:func:`tsk_treeseq_build_seek_index` and
+:c:func:`tsk_treeseq_free`. A tree sequence can
+therefore be shared by any number of threads; see
+:ref:`sec_c_api_thread_safety` for details.
+@endrst
 */
 typedef struct {
     tsk_size_t num_trees;
@@ -105,6 +122,19 @@ typedef struct {
     tsk_mutation_t *site_mutations_mem;
     tsk_mutation_t **site_mutations;
     tsk_size_t *site_mutations_length;
+    /* Optional checkpoints used to seek to arbitrary trees quickly. Checkpoint
+     * c is the tree with index c * interval; we store the tree position's
+     * in.stop and out.stop values in the forward direction, and the edges in
+     * the tree in insertion order (edges[edges_offset[c]: edges_offset[c + 1]])
+     */
+    struct {
+        tsk_size_t interval;
+        tsk_size_t num_checkpoints;
+        tsk_id_t *in_stop;
+        tsk_id_t *out_stop;
+        tsk_size_t *edges_offset;
+        tsk_id_t *edges;
+    } seek_index;
     /** @brief  The table collection underlying this tree sequence, This table
      *  collection must be treated as read-only, and any changes to it will
      *  lead to undefined behaviour. */
@@ -133,6 +163,39 @@ typedef struct {
     const tsk_treeseq_t *tree_sequence;
 } tsk_tree_position_t;
 
+/* The edge differences for a range of trees, stored in flat arrays. The
+ * edges inserted to get tree start_tree + j are edges_in[edges_in_offset[j]],
+ * ..., edges_in[edges_in_offset[j + 1] - 1], and similarly for the edges
+ * removed. The first tree in the range inserts all of its edges and
+ * removes none, so that the trees can be built without any other state. */
+typedef struct {
+    tsk_id_t start_tree;
+    tsk_size_t num_trees;
+    tsk_size_t num_edges_in;
+    tsk_size_t num_edges_out;
+    tsk_id_t *edges_in;
+    tsk_id_t *edges_out;
+    tsk_size_t *edges_in_offset;
+    tsk_size_t *edges_out_offset;
+} tsk_edge_diffs_t;
+
+/* A joint allele frequency spectrum stored in coordinate format, holding only
+ * the cells that were incremented. The entries for window j are
+ * window_offset[j], ..., window_offset[j + 1] - 1, in the order they were first
+ * seen. Entry e is at coordinates[e * num_sample_sets], ...,
+ * coordinates[(e + 1) * num_sample_sets - 1] and has value values[e]. The
+ * size of each dimension is given by shape. */
+typedef struct {
+    tsk_size_t num_sample_sets;
+    tsk_size_t num_windows;
+    tsk_size_t num_entries;
+    tsk_size_t *shape;
+    tsk_size_t *window_offset;
+    tsk_size_t *coordinates;
+    double *values;
+    tsk_size_t max_entries;
+} tsk_sparse_afs_t;
+
 /**
 @brief A single tree in a tree sequence.
 
@@ -263,7 +326,10 @@ typedef struct {
     all samples below a give node, and num_tracked_samples counts those
     from a specific subset. By default sample counts are tracked and roots
     maintained. If ``TSK_NO_SAMPLE_COUNTS`` is specified, then neither sample
-    counts or roots are available.
+    counts or roots are available. num_tracked_samples is only allocated when
+    tracked samples are first set by tsk_tree_set_tracked_samples or
+    tsk_tree_track_descendant_samples, and is NULL until then; use
+    tsk_tree_get_num_tracked_samples rather than reading it directly.
     */
     tsk_size_t *num_samples;
     tsk_size_t *num_tracked_samples;
@@ -307,7 +373,19 @@ of error conditions.
 **Options**
 
 - :c:macro:`TSK_TS_INIT_BUILD_INDEXES`
+- :c:macro:`TSK_TS_INIT_SEEK_INDEX`
 - :c:macro:`TSK_TAKE_OWNERSHIP` (applies to the table collection).
+- :c:macro:`TSK_NO_CHECK_INTEGRITY`
+
+If :c:macro:`TSK_NO_CHECK_INTEGRITY` is specified, the table collection is not
+checked with :c:func:`tsk_table_collection_check_integrity`, which is a
+substantial part of the time taken to initialise a large tree sequence. The
+tables must be indexed (or :c:macro:`TSK_TS_INIT_BUILD_INDEXES` specified), and
+the number of trees is computed from the indexes instead. This performance
+optimisation should only be used when the tables are known to describe a valid
+tree sequence (for example, because they were written by
+:c:func:`tsk_treeseq_dump` from a tree sequence that was itself checked); an
+invalid table collection will result in undefined behaviour.
 @endrst
 
 @param self A pointer to an uninitialised tsk_table_collection_t object.
@@ -318,6 +396,34 @@ of error conditions.
 int tsk_treeseq_init(
     tsk_treeseq_t *self, tsk_table_collection_t *tables, tsk_flags_t options);
 
+/**
+@brief Build the checkpoint index used to seek along the tree sequence.
+
+@rst
+Stores the edges of every ``interval``-th tree, so that
+:c:func:`tsk_tree_seek` can restore the nearest preceding checkpoint
+and then move forward by at most ``interval - 1`` trees, rather than
+moving tree-by-tree from the current position (or from the start of the
+sequence). Memory use is approximately the number of edges in a tree times
+``num_trees / interval`` edge IDs, so larger intervals trade seek time for
+memory. If ``interval`` is zero, the square root of the number of trees
+(rounded up) is used, as it is for :c:macro:`TSK_TS_INIT_SEEK_INDEX`. Any
+existing index is replaced.
+
+.. warning:: This function modifies the tree sequence, and so must not be
+    called while any other threads are using it, or while any
+    :c:type:`tsk_tree_t` objects are seeking along it.
+@endrst
+
+@param self A pointer to an initialised tsk_treeseq_t object.
+@param interval The number of trees between checkpoints, or 0 for the default.
+@param options Bitwise option flags. Currently unused; should be
+    set to zero to ensure compatibility with later versions of tskit.
+@return Return 0 on success or a negative value on failure.
+*/
+int tsk_treeseq_build_seek_index(
+    tsk_treeseq_t *self, tsk_size_t interval, tsk_flags_t options);
+
 /**
 @brief Load a tree sequence from a file path.
 
@@ -328,7 +434,10 @@ The resources allocated must be freed using
 :c:func:`tsk_treeseq_free` even in error conditions.
 
 Works similarly to :c:func:`tsk_table_collection_load` please see
-that function's documentation for details and options.
+that function's documentation for details and options. In addition, the
+:c:macro:`TSK_NO_CHECK_INTEGRITY` option can be specified to skip the
+integrity checks when the tree sequence is initialised; see
+:c:func:`tsk_treeseq_init` for details.
 
 **Examples**
 
@@ -360,7 +469,9 @@ is also initialised. The resources allocated must be freed using
 :c:func:`tsk_treeseq_free` even in error conditions.
 
 Works similarly to :c:func:`tsk_table_collection_loadf` please
-see that function's documentation for details and options.
+see that function's documentation for details and options. As for
+:c:func:`tsk_treeseq_load`, :c:macro:`TSK_NO_CHECK_INTEGRITY` can also
+be specified.
 
 @endrst
 
@@ -385,8 +496,8 @@ and well formed files will be written.
 
 @param self A pointer to an initialised tsk_treeseq_t object.
 @param filename A NULL terminated string containing the filename.
-@param options Bitwise options. Currently unused; should be
-    set to zero to ensure compatibility with later versions of tskit.
+@param options Bitwise options. See :c:func:`tsk_table_collection_dump`
+    for details.
 @return Return 0 on success or a negative value on failure.
 */
 int tsk_treeseq_dump(
@@ -406,8 +517,8 @@ of how to sequentially dump and load tree sequences from a stream.
 @param self A pointer to an initialised tsk_treeseq_t object.
 @param file A FILE stream opened in an appropriate mode for writing (e.g.
     "w", "a", "r+" or "w+").
-@param options Bitwise options. Currently unused; should be
-    set to zero to ensure compatibility with later versions of tskit.
+@param options Bitwise options. See :c:func:`tsk_table_collection_dump`
+    for details.
 @return Return 0 on success or a negative value on failure.
 */
 int tsk_treeseq_dumpf(const tsk_treeseq_t *self, FILE *file, tsk_flags_t options);
@@ -966,6 +1077,19 @@ int tsk_treeseq_get_individuals_time(const tsk_treeseq_t *self, double *output);
 
 int tsk_treeseq_kc_distance(const tsk_treeseq_t *self, const tsk_treeseq_t *other,
     double lambda_, double *result);
+/* The KC distance averaged over the interval [left, right). Since the full
+ * distance is the span-weighted mean of the distances over any partition of
+ * the genome into intervals, these can be computed independently (and
+ * concurrently) and combined. */
+int tsk_treeseq_kc_distance_interval(const tsk_treeseq_t *self,
+    const tsk_treeseq_t *other, double lambda_, double left, double right,
+    double *result);
+/* Compute the num_treeseqs x num_treeseqs matrix of KC distances over
+ * [left, right) between all pairs of the specified tree sequences, updating
+ * the KC vectors for each tree of each sequence only once. This requires
+ * storing the KC vectors for all of the tree sequences at the same time. */
+int tsk_treeseq_kc_distance_matrix(const tsk_treeseq_t *const *treeseqs,
+    tsk_size_t num_treeseqs, double lambda_, double left, double right, double *result);
 
 int tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
     const tsk_id_t *focal, tsk_size_t num_focal, const tsk_id_t *const *reference_sets,
@@ -974,13 +1098,47 @@ int tsk_treeseq_genealogical_nearest_neighbours(const tsk_treeseq_t *self,
 int tsk_treeseq_mean_descendants(const tsk_treeseq_t *self,
     const tsk_id_t *const *reference_sets, const tsk_size_t *reference_set_size,
     tsk_size_t num_reference_sets, tsk_flags_t options, double *ret_array);
+/* Versions of the above restricted to the interval [left, right), which
+ * return the span weighted sums in ret_array and the lengths they are to be
+ * divided by in ret_length (one per focal node for GNN, and one per node for
+ * mean descendants) rather than normalising. The results for a partition of
+ * the genome into intervals can therefore be computed independently (and
+ * concurrently, each with its own output arrays) and then summed, in a fixed
+ * order if the result must not depend on the partition. */
+int tsk_treeseq_genealogical_nearest_neighbours_interval(const tsk_treeseq_t *self,
+    const tsk_id_t *focal, tsk_size_t num_focal, const tsk_id_t *const *reference_sets,
+    const tsk_size_t *reference_set_size, tsk_size_t num_reference_sets, double left,
+    double right, tsk_flags_t options, double *ret_array, double *ret_length);
+int tsk_treeseq_mean_descendants_interval(const tsk_treeseq_t *self,
+    const tsk_id_t *const *reference_sets, const tsk_size_t *reference_set_size,
+    tsk_size_t num_reference_sets, double left, double right, tsk_flags_t options,
+    double *ret_array, double *ret_length);
 
 typedef int general_stat_func_t(tsk_size_t state_dim, const double *state,
     tsk_size_t result_dim, double *result, void *params);
 
+/* The windows need not cover the whole sequence: only the trees and sites
+ * between windows[0] and windows[num_windows] are visited. The tree sequence
+ * is not modified, so a set of windows can be split into contiguous chunks
+ * that are computed concurrently (with separate result buffers), and the
+ * results for each chunk are identical to the corresponding rows from a
+ * single call over all the windows. */
+
 int tsk_treeseq_general_stat(const tsk_treeseq_t *self, tsk_size_t K, const double *W,
     tsk_size_t M, general_stat_func_t *f, void *f_params, tsk_size_t num_windows,
     const double *windows, tsk_flags_t options, double *result);
+
+/* As tsk_treeseq_general_stat in branch mode, but the branch lengths are also
+ * divided among the intervals [time_windows[j], time_windows[j + 1]) of
+ * node time, so a single pass gives a result of shape num_windows x
+ * num_time_windows x M. Only the part of each branch within a time window
+ * contributes to it. The time windows need not cover all node times, and
+ * the last breakpoint may be INFINITY. Passing NULL for time_windows
+ * gives the same result as tsk_treeseq_general_stat. */
+int tsk_treeseq_general_stat_time_windows(const tsk_treeseq_t *self, tsk_size_t K,
+    const double *W, tsk_size_t M, general_stat_func_t *f, void *f_params,
+    tsk_size_t num_windows, const double *windows, tsk_size_t num_time_windows,
+    const double *time_windows, tsk_flags_t options, double *result);
 // TODO: expose this externally?
 /* int tsk_treeseq_two_locus_general_stat(const tsk_treeseq_t *self, */
 /*     tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes, */
@@ -1025,6 +1183,15 @@ int tsk_treeseq_genetic_relatedness_weighted(const tsk_treeseq_t *self,
     const tsk_id_t *index_tuples, tsk_size_t num_windows, const double *windows,
     double *result, tsk_flags_t options);
 
+/* Computes the product of the branch mode genetic relatedness matrix of the
+ * samples with the num_samples x num_weights matrix of weights in one pass
+ * over the trees, without forming the matrix. The result for each window is a
+ * num_samples x num_weights matrix. Only branch mode is supported, and
+ * TSK_STAT_BRANCH must be specified in the options. */
+int tsk_treeseq_genetic_relatedness_vector(const tsk_treeseq_t *self,
+    tsk_size_t num_weights, const double *weights, tsk_size_t num_windows,
+    const double *windows, double *result, tsk_flags_t options);
+
 /* One way sample set stats */
 
 typedef int one_way_sample_stat_method(const tsk_treeseq_t *self,
@@ -1035,6 +1202,13 @@ typedef int one_way_sample_stat_method(const tsk_treeseq_t *self,
 int tsk_treeseq_diversity(const tsk_treeseq_t *self, tsk_size_t num_sample_sets,
     const tsk_size_t *sample_set_sizes, const tsk_id_t *sample_sets,
     tsk_size_t num_windows, const double *windows, tsk_flags_t options, double *result);
+/* Branch mode diversity divided among time windows, as in
+ * tsk_treeseq_general_stat_time_windows */
+int tsk_treeseq_diversity_time_windows(const tsk_treeseq_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, tsk_size_t num_windows, const double *windows,
+    tsk_size_t num_time_windows, const double *time_windows, tsk_flags_t options,
+    double *result);
 int tsk_treeseq_segregating_sites(const tsk_treeseq_t *self, tsk_size_t num_sample_sets,
     const tsk_size_t *sample_set_sizes, const tsk_id_t *sample_sets,
     tsk_size_t num_windows, const double *windows, tsk_flags_t options, double *result);
@@ -1045,6 +1219,19 @@ int tsk_treeseq_allele_frequency_spectrum(const tsk_treeseq_t *self,
     tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
     const tsk_id_t *sample_sets, tsk_size_t num_windows, const double *windows,
     tsk_flags_t options, double *result);
+/* As tsk_treeseq_allele_frequency_spectrum, but only the nonzero cells are
+ * stored, so the memory needed is bounded by the number of distinct
+ * frequency combinations seen rather than the product of the sample set
+ * sizes. If projection is not NULL, the counts in sample set k are projected
+ * down to projection[k] samples by hypergeometric sampling. The result is
+ * initialised by this function and must be freed with tsk_sparse_afs_free,
+ * even on error. */
+int tsk_treeseq_sparse_allele_frequency_spectrum(const tsk_treeseq_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, const tsk_size_t *projection, tsk_size_t num_windows,
+    const double *windows, tsk_flags_t options, tsk_sparse_afs_t *result);
+int tsk_sparse_afs_free(tsk_sparse_afs_t *self);
+void tsk_sparse_afs_print_state(const tsk_sparse_afs_t *self, FILE *out);
 
 typedef int general_sample_stat_method(const tsk_treeseq_t *self,
     tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
@@ -1055,6 +1242,14 @@ int tsk_treeseq_divergence(const tsk_treeseq_t *self, tsk_size_t num_sample_sets
     const tsk_size_t *sample_set_sizes, const tsk_id_t *sample_sets,
     tsk_size_t num_index_tuples, const tsk_id_t *index_tuples, tsk_size_t num_windows,
     const double *windows, tsk_flags_t options, double *result);
+/* Branch mode divergence divided among time windows, as in
+ * tsk_treeseq_general_stat_time_windows */
+int tsk_treeseq_divergence_time_windows(const tsk_treeseq_t *self,
+    tsk_size_t num_sample_sets, const tsk_size_t *sample_set_sizes,
+    const tsk_id_t *sample_sets, tsk_size_t num_index_tuples,
+    const tsk_id_t *index_tuples, tsk_size_t num_windows, const double *windows,
+    tsk_size_t num_time_windows, const double *time_windows, tsk_flags_t options,
+    double *result);
 int tsk_treeseq_Y2(const tsk_treeseq_t *self, tsk_size_t num_sample_sets,
     const tsk_size_t *sample_set_sizes, const tsk_id_t *sample_sets,
     tsk_size_t num_index_tuples, const tsk_id_t *index_tuples, tsk_size_t num_windows,
@@ -1311,7 +1506,13 @@ we will have ``tree.interval.left <= position`` and
 we will have ``position < tree.interval.right``.
 
 Seeking to a position currently covered by the tree is
-a constant time operation.
+a constant time operation. If the tree sequence has a checkpoint index
+(see :c:func:`tsk_treeseq_build_seek_index`) and the target tree is more
+than the checkpoint interval away from the current tree, the tree is
+restored from the nearest preceding checkpoint. The resulting tree has the
+same topology either way, but the order of siblings can depend on the path
+taken to reach it, and so may differ depending on whether a checkpoint
+index is present.
 @endrst
 
 @param self A pointer to an initialised tsk_tree_t object.
@@ -1814,6 +2015,21 @@ int tsk_tree_map_mutations(tsk_tree_t *self, int32_t *genotypes, double *cost_ma
     tsk_flags_t options, int32_t *ancestral_state, tsk_size_t *num_transitions,
     tsk_state_transition_t **transitions);
 
+/* Maps the mutations for a block of sites on the same tree in a single traversal.
+ * The genotypes for site k are genotypes[k * num_samples + j], and the transitions
+ * for site k are written to positions transitions_offset[k] to
+ * transitions_offset[k + 1] of the returned transitions array, which must be
+ * freed by the caller. The parent of a transition is an index relative to the
+ * start of the transitions for its site, so that the results for each site are
+ * the same as returned by tsk_tree_map_mutations. The ancestral_states and
+ * transitions_offset arrays must have space for num_sites and num_sites + 1
+ * values. Memory usage is proportional to the number of nodes times num_sites.
+ */
+int tsk_tree_map_mutations_batch(tsk_tree_t *self, tsk_size_t num_sites,
+    const int32_t *genotypes, double *cost_matrix, tsk_flags_t options,
+    int32_t *ancestral_states, tsk_size_t *transitions_offset,
+    tsk_state_transition_t **transitions);
+
 int tsk_tree_kc_distance(
     const tsk_tree_t *self, const tsk_tree_t *other, double lambda, double *result);
 
@@ -1844,6 +2060,11 @@ bool tsk_tree_equals(const tsk_tree_t *self, const tsk_tree_t *other);
 int tsk_diff_iter_init_from_ts(
     tsk_diff_iter_t *self, const tsk_treeseq_t *tree_sequence, tsk_flags_t options);
 
+int tsk_edge_diffs_init(tsk_edge_diffs_t *self, const tsk_treeseq_t *tree_sequence,
+    tsk_id_t start_tree, tsk_id_t stop_tree, tsk_flags_t options);
+int tsk_edge_diffs_free(tsk_edge_diffs_t *self);
+void tsk_edge_diffs_print_state(const tsk_edge_diffs_t *self, FILE *out);
+
 int tsk_tree_position_init(
     tsk_tree_position_t *self, const tsk_treeseq_t *tree_sequence, tsk_flags_t options);
 int tsk_tree_position_free(tsk_tree_position_t *self);
@@ -64,10 +64,13 @@ static PyObject *TskitNoSampleListsError;
  * allocate memory dynamically, we cannot guarantee safety otherwise.
  * The locks are set before the GIL is released and unset afterwards.
  * Because C code executed here represents atomic Python operations
- * (while the GIL is held), this should be safe */
+ * (while the GIL is held), this should be safe. The TableCollection
+ * has a lock with the same meaning, which also applies to the
+ * XTable objects that refer to its tables. */
 
 typedef struct _TableCollection {
     PyObject_HEAD
+    bool locked;
     tsk_table_collection_t *tables;
 } TableCollection;
 
@@ -1036,7 +1039,7 @@ IndividualTable_check_state(IndividualTable *self)
         PyErr_SetString(PyExc_SystemError, "IndividualTable not initialised");
         goto out;
     }
-    if (self->locked) {
+    if (self->locked || (self->tables != NULL && self->tables->locked)) {
         PyErr_SetString(PyExc_RuntimeError, "IndividualTable in use by other thread.");
         goto out;
     }
@@ -1700,7 +1703,7 @@ NodeTable_check_state(NodeTable *self)
         PyErr_SetString(PyExc_SystemError, "NodeTable not initialised");
         goto out;
     }
-    if (self->locked) {
+    if (self->locked || (self->tables != NULL && self->tables->locked)) {
         PyErr_SetString(PyExc_RuntimeError, "NodeTable in use by other thread.");
         goto out;
     }
@@ -2286,7 +2289,7 @@ EdgeTable_check_state(EdgeTable *self)
         PyErr_SetString(PyExc_SystemError, "EdgeTable not initialised");
         goto out;
     }
-    if (self->locked) {
+    if (self->locked || (self->tables != NULL && self->tables->locked)) {
         PyErr_SetString(PyExc_RuntimeError, "EdgeTable in use by other thread.");
         goto out;
     }
@@ -2883,7 +2886,7 @@ MigrationTable_check_state(MigrationTable *self)
         PyErr_SetString(PyExc_SystemError, "MigrationTable not initialised");
         goto out;
     }
-    if (self->locked) {
+    if (self->locked || (self->tables != NULL && self->tables->locked)) {
         PyErr_SetString(PyExc_RuntimeError, "MigrationTable in use by other thread.");
         goto out;
     }
@@ -3494,7 +3497,7 @@ SiteTable_check_state(SiteTable *self)
         PyErr_SetString(PyExc_SystemError, "SiteTable not initialised");
         goto out;
     }
-    if (self->locked) {
+    if (self->locked || (self->tables != NULL && self->tables->locked)) {
         PyErr_SetString(PyExc_RuntimeError, "SiteTable in use by other thread.");
         goto out;
     }
@@ -4060,7 +4063,7 @@ MutationTable_check_state(MutationTable *self)
         PyErr_SetString(PyExc_SystemError, "MutationTable not initialised");
         goto out;
     }
-    if (self->locked) {
+    if (self->locked || (self->tables != NULL && self->tables->locked)) {
         PyErr_SetString(PyExc_RuntimeError, "MutationTable in use by other thread.");
         goto out;
     }
@@ -4681,7 +4684,7 @@ PopulationTable_check_state(PopulationTable *self)
         PyErr_SetString(PyExc_SystemError, "PopulationTable not initialised");
         goto out;
     }
-    if (self->locked) {
+    if (self->locked || (self->tables != NULL && self->tables->locked)) {
         PyErr_SetString(PyExc_RuntimeError, "PopulationTable in use by other thread.");
         goto out;
     }
@@ -5193,7 +5196,7 @@ ProvenanceTable_check_state(ProvenanceTable *self)
         PyErr_SetString(PyExc_SystemError, "ProvenanceTable not initialised");
         goto out;
     }
-    if (self->locked) {
+    if (self->locked || (self->tables != NULL && self->tables->locked)) {
         PyErr_SetString(PyExc_RuntimeError, "ProvenanceTable in use by other thread.");
         goto out;
     }
@@ -6424,6 +6427,9 @@ TableCollection_check_state(TableCollection *self)
     if (self->tables == NULL) {
         PyErr_SetString(PyExc_SystemError, "TableCollection not initialised");
         ret = -1;
+    } else if (self->locked) {
+        PyErr_SetString(PyExc_RuntimeError, "TableCollection in use by other thread.");
+        ret = -1;
     }
     return ret;
 }
@@ -6467,6 +6473,7 @@ TableCollection_init(TableCollection *self, PyObject *args, PyObject *kwds)
     static char *kwlist[] = { "sequence_length", NULL };
     double sequence_length = -1;
 
+    self->locked = false;
     self->tables = NULL;
     if (!PyArg_ParseTupleAndKeywords(args, kwds, "|d", kwlist, &sequence_length)) {
         goto out;
@@ -6918,8 +6925,14 @@ TableCollection_simplify(TableCollection *self, PyObject *args, PyObject *kwds)
     if (node_map_array == NULL) {
         goto out;
     }
+    self->locked = true;
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_table_collection_simplify(self->tables, PyArray_DATA(samples_array),
         num_samples, options, PyArray_DATA(node_map_array));
+    Py_END_ALLOW_THREADS
+    // clang-format on
+    self->locked = false;
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -6978,8 +6991,14 @@ TableCollection_link_ancestors(TableCollection *self, PyObject *args, PyObject *
     if (result == NULL) {
         goto out;
     }
+    self->locked = true;
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_table_collection_link_ancestors(self->tables, PyArray_DATA(samples_array),
         num_samples, PyArray_DATA(ancestors_array), num_ancestors, 0, result->table);
+    Py_END_ALLOW_THREADS
+    // clang-format on
+    self->locked = false;
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -7030,8 +7049,14 @@ TableCollection_subset(TableCollection *self, PyObject *args, PyObject *kwds)
         options |= TSK_SUBSET_KEEP_UNREFERENCED;
     }
 
+    self->locked = true;
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_table_collection_subset(
         self->tables, PyArray_DATA(nodes_array), num_nodes, options);
+    Py_END_ALLOW_THREADS
+    // clang-format on
+    self->locked = false;
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -7067,6 +7092,9 @@ TableCollection_union(TableCollection *self, PyObject *args, PyObject *kwds)
             &other, &other_node_mapping, &check_shared, &add_populations)) {
         goto out;
     }
+    if (TableCollection_check_state(other) != 0) {
+        goto out;
+    }
     nmap_array = (PyArrayObject *) PyArray_FROMANY(
         other_node_mapping, NPY_INT32, 1, 1, NPY_ARRAY_IN_ARRAY);
     if (nmap_array == NULL) {
@@ -7085,8 +7113,16 @@ TableCollection_union(TableCollection *self, PyObject *args, PyObject *kwds)
     if (!add_populations) {
         options |= TSK_UNION_NO_ADD_POP;
     }
+    self->locked = true;
+    other->locked = true;
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_table_collection_union(
         self->tables, other->tables, PyArray_DATA(nmap_array), options);
+    Py_END_ALLOW_THREADS
+    // clang-format on
+    self->locked = false;
+    other->locked = false;
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -7244,7 +7280,13 @@ TableCollection_sort(TableCollection *self, PyObject *args, PyObject *kwds)
     start.edges = (tsk_size_t) edge_start;
     start.sites = (tsk_size_t) site_start;
     start.mutations = (tsk_size_t) mutation_start;
+    self->locked = true;
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_table_collection_sort(self->tables, &start, 0);
+    Py_END_ALLOW_THREADS
+    // clang-format on
+    self->locked = false;
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -7626,7 +7668,13 @@ TableCollection_dump(TableCollection *self, PyObject *args, PyObject *kwds)
         goto out;
     }
 
+    self->locked = true;
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_table_collection_dumpf(self->tables, file, 0);
+    Py_END_ALLOW_THREADS
+    // clang-format on
+    self->locked = false;
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -7661,6 +7709,10 @@ TableCollection_load(TableCollection *self, PyObject *args, PyObject *kwds)
     if (skip_reference_sequence) {
         options |= TSK_LOAD_SKIP_REFERENCE_SEQUENCE;
     }
+    if (self->locked) {
+        PyErr_SetString(PyExc_RuntimeError, "TableCollection in use by other thread.");
+        goto out;
+    }
     file = make_file(py_file, "rb");
     if (file == NULL) {
         goto out;
@@ -7678,7 +7730,13 @@ TableCollection_load(TableCollection *self, PyObject *args, PyObject *kwds)
     if (err != 0) {
         goto out;
     }
+    self->locked = true;
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_table_collection_loadf(self->tables, file, options);
+    Py_END_ALLOW_THREADS
+    // clang-format on
+    self->locked = false;
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -7927,23 +7985,17 @@ TreeSequence_dealloc(TreeSequence *self)
     Py_TYPE(self)->tp_free((PyObject *) self);
 }
 
+/* A TreeSequence can only be loaded once. Other threads may be using the
+ * tsk_treeseq_t without holding the GIL, so we can never free and replace it
+ * while the object is alive. */
 static int
-TreeSequence_alloc(TreeSequence *self)
+TreeSequence_check_uninitialised(TreeSequence *self)
 {
-    int ret = -1;
-
+    int ret = 0;
     if (self->tree_sequence != NULL) {
-        tsk_treeseq_free(self->tree_sequence);
-        PyMem_Free(self->tree_sequence);
-    }
-    self->tree_sequence = PyMem_Malloc(sizeof(tsk_treeseq_t));
-    if (self->tree_sequence == NULL) {
-        PyErr_NoMemory();
-        goto out;
+        PyErr_SetString(PyExc_ValueError, "tree_sequence already initialised");
+        ret = -1;
     }
-    memset(self->tree_sequence, 0, sizeof(*self->tree_sequence));
-    ret = 0;
-out:
     return ret;
 }
 
@@ -7975,7 +8027,11 @@ TreeSequence_dump(TreeSequence *self, PyObject *args, PyObject *kwds)
         goto out;
     }
 
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_treeseq_dumpf(self->tree_sequence, file, 0);
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -7994,28 +8050,55 @@ TreeSequence_load_tables(TreeSequence *self, PyObject *args, PyObject *kwds)
     int err;
     PyObject *ret = NULL;
     TableCollection *tables = NULL;
+    tsk_treeseq_t *tree_sequence = NULL;
     static char *kwlist[] = { "tables", "build_indexes", NULL };
     int build_indexes = false;
     tsk_flags_t options = 0;
 
+    if (TreeSequence_check_uninitialised(self) != 0) {
+        goto out;
+    }
     if (!PyArg_ParseTupleAndKeywords(
             args, kwds, "O!|i", kwlist, &TableCollectionType, &tables, &build_indexes)) {
         goto out;
     }
-    err = TreeSequence_alloc(self);
-    if (err != 0) {
+    if (TableCollection_check_state(tables) != 0) {
         goto out;
     }
     if (build_indexes) {
         options |= TSK_TS_INIT_BUILD_INDEXES;
     }
-    err = tsk_treeseq_init(self->tree_sequence, tables->tables, options);
+    /* Initialise a new tree sequence without holding the GIL, so that other
+     * threads don't see it before it's ready */
+    tree_sequence = PyMem_Malloc(sizeof(*tree_sequence));
+    if (tree_sequence == NULL) {
+        PyErr_NoMemory();
+        goto out;
+    }
+    memset(tree_sequence, 0, sizeof(*tree_sequence));
+    tables->locked = true;
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
+    err = tsk_treeseq_init(tree_sequence, tables->tables, options);
+    Py_END_ALLOW_THREADS
+    // clang-format on
+    tables->locked = false;
     if (err != 0) {
         handle_library_error(err);
         goto out;
     }
+    /* Another thread may have loaded this object while we released the GIL */
+    if (TreeSequence_check_uninitialised(self) != 0) {
+        goto out;
+    }
+    self->tree_sequence = tree_sequence;
+    tree_sequence = NULL;
     ret = Py_BuildValue("");
 out:
+    if (tree_sequence != NULL) {
+        tsk_treeseq_free(tree_sequence);
+        PyMem_Free(tree_sequence);
+    }
     return ret;
 }
 
@@ -8034,6 +8117,9 @@ TreeSequence_dump_tables(TreeSequence *self, PyObject *args, PyObject *kwds)
             args, kwds, "O!", kwlist, &TableCollectionType, &tables)) {
         goto out;
     }
+    if (TableCollection_check_state(tables) != 0) {
+        goto out;
+    }
     err = tsk_treeseq_copy_tables(self->tree_sequence, tables->tables, TSK_NO_INIT);
     if (err != 0) {
         handle_library_error(err);
@@ -8051,11 +8137,15 @@ TreeSequence_load(TreeSequence *self, PyObject *args, PyObject *kwds)
     PyObject *ret = NULL;
     PyObject *py_file;
     FILE *file = NULL;
+    tsk_treeseq_t *tree_sequence = NULL;
     tsk_flags_t options = 0;
     int skip_tables = false;
     int skip_reference_sequence = false;
     static char *kwlist[] = { "file", "skip_tables", "skip_reference_sequence", NULL };
 
+    if (TreeSequence_check_uninitialised(self) != 0) {
+        goto out;
+    }
     if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|ii", kwlist, &py_file, &skip_tables,
             &skip_reference_sequence)) {
         goto out;
@@ -8079,17 +8169,35 @@ TreeSequence_load(TreeSequence *self, PyObject *args, PyObject *kwds)
         PyErr_SetFromErrno(PyExc_OSError);
         goto out;
     }
-    err = TreeSequence_alloc(self);
-    if (err != 0) {
+    /* Load into a new tree sequence without holding the GIL, so that other
+     * threads don't see it before it's ready */
+    tree_sequence = PyMem_Malloc(sizeof(*tree_sequence));
+    if (tree_sequence == NULL) {
+        PyErr_NoMemory();
         goto out;
     }
-    err = tsk_treeseq_loadf(self->tree_sequence, file, options);
+    memset(tree_sequence, 0, sizeof(*tree_sequence));
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
+    err = tsk_treeseq_loadf(tree_sequence, file, options);
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err != 0) {
         handle_library_error(err);
         goto out;
     }
+    /* Another thread may have loaded this object while we released the GIL */
+    if (TreeSequence_check_uninitialised(self) != 0) {
+        goto out;
+    }
+    self->tree_sequence = tree_sequence;
+    tree_sequence = NULL;
     ret = Py_BuildValue("");
 out:
+    if (tree_sequence != NULL) {
+        tsk_treeseq_free(tree_sequence);
+        PyMem_Free(tree_sequence);
+    }
     if (file != NULL) {
         (void) fclose(file);
     }
@@ -8844,8 +8952,12 @@ TreeSequence_get_kc_distance(TreeSequence *self, PyObject *args, PyObject *kwds)
             args, kwds, "O!d", kwlist, &TreeSequenceType, &other, &lambda)) {
         goto out;
     }
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_treeseq_kc_distance(
         self->tree_sequence, other->tree_sequence, lambda, &result);
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -9260,8 +9372,12 @@ TreeSequence_one_way_weighted_method(
         goto out;
     }
 
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = method(self->tree_sequence, w_shape[1], PyArray_DATA(weights_array),
         num_windows, PyArray_DATA(windows_array), options, PyArray_DATA(result_array));
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err == TSK_PYTHON_CALLBACK_ERROR) {
         goto out;
     } else if (err != 0) {
@@ -9347,9 +9463,13 @@ TreeSequence_one_way_covariates_method(TreeSequence *self, PyObject *args,
         goto out;
     }
 
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = method(self->tree_sequence, w_shape[1], PyArray_DATA(weights_array),
         z_shape[1], PyArray_DATA(covariates_array), num_windows,
         PyArray_DATA(windows_array), options, PyArray_DATA(result_array));
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err == TSK_PYTHON_CALLBACK_ERROR) {
         goto out;
     } else if (err != 0) {
@@ -9417,9 +9537,13 @@ TreeSequence_one_way_stat_method(TreeSequence *self, PyObject *args, PyObject *k
     if (result_array == NULL) {
         goto out;
     }
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = method(self->tree_sequence, num_sample_sets,
         PyArray_DATA(sample_set_sizes_array), PyArray_DATA(sample_sets_array),
         num_windows, PyArray_DATA(windows_array), options, PyArray_DATA(result_array));
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -9496,9 +9620,13 @@ TreeSequence_allele_frequency_spectrum(
     if (result_array == NULL) {
         goto out;
     }
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = tsk_treeseq_allele_frequency_spectrum(self->tree_sequence, num_sample_sets,
         PyArray_DATA(sample_set_sizes_array), PyArray_DATA(sample_sets_array),
         num_windows, PyArray_DATA(windows_array), options, PyArray_DATA(result_array));
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -9621,10 +9749,14 @@ TreeSequence_k_way_stat_method(TreeSequence *self, PyObject *args, PyObject *kwd
     if (result_array == NULL) {
         goto out;
     }
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = method(self->tree_sequence, num_sample_sets,
         PyArray_DATA(sample_set_sizes_array), PyArray_DATA(sample_sets_array),
         num_set_index_tuples, PyArray_DATA(indexes_array), num_windows,
         PyArray_DATA(windows_array), options, PyArray_DATA(result_array));
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -9710,9 +9842,13 @@ TreeSequence_k_way_weighted_stat_method(TreeSequence *self, PyObject *args,
     if (result_array == NULL) {
         goto out;
     }
+    // clang-format off
+    Py_BEGIN_ALLOW_THREADS
     err = method(self->tree_sequence, w_shape[1], PyArray_DATA(weights_array),
         num_index_tuples, PyArray_DATA(indexes_array), num_windows,
         PyArray_DATA(windows_array), PyArray_DATA(result_array), options);
+    Py_END_ALLOW_THREADS
+    // clang-format on
     if (err != 0) {
         handle_library_error(err);
         goto out;
@@ -13617,6 +13753,40 @@ tskit_get_tskit_version(PyObject *self)
     return Py_BuildValue("iii", TSK_VERSION_MAJOR, TSK_VERSION_MINOR, TSK_VERSION_PATCH);
 }
 
+static PyObject *
+tskit_get_counters(PyObject *self)
+{
+    PyObject *ret = NULL;
+    tsk_counters_t counters;
+    int err;
+
+    err = tsk_get_counters(&counters);
+    if (err != 0) {
+        handle_library_error(err);
+        goto out;
+    }
+    ret = Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:d,s:d,s:d,s:d,s:d}",
+        "edges_inserted", (unsigned long long) counters.edges_inserted,
+        "edges_removed", (unsigned long long) counters.edges_removed,
+        "trees_visited", (unsigned long long) counters.trees_visited,
+        "summary_func_calls", (unsigned long long) counters.summary_func_calls,
+        "blkalloc_chunks", (unsigned long long) counters.blkalloc_chunks,
+        "bytes_read", (unsigned long long) counters.bytes_read,
+        "bytes_written", (unsigned long long) counters.bytes_written,
+        "load_time", counters.load_time, "dump_time", counters.dump_time,
+        "sort_time", counters.sort_time, "simplify_time", counters.simplify_time,
+        "stats_time", counters.stats_time);
+out:
+    return ret;
+}
+
+static PyObject *
+tskit_reset_counters(PyObject *self)
+{
+    tsk_reset_counters();
+    Py_RETURN_NONE;
+}
+
 static PyMethodDef tskit_methods[] = {
     { .ml_name = "get_kastore_version",
         .ml_meth = (PyCFunction) tskit_get_kastore_version,
@@ -13626,6 +13796,14 @@ static PyMethodDef tskit_methods[] = {
         .ml_meth = (PyCFunction) tskit_get_tskit_version,
         .ml_flags = METH_NOARGS,
         .ml_doc = "Returns the version of the tskit C API we have built in." },
+    { .ml_name = "get_counters",
+        .ml_meth = (PyCFunction) tskit_get_counters,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = "Returns a dict of the C library's instrumentation counters." },
+    { .ml_name = "reset_counters",
+        .ml_meth = (PyCFunction) tskit_reset_counters,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = "Resets the C library's instrumentation counters to zero." },
     { NULL } /* Sentinel */
 };
 
@@ -46,6 +46,9 @@ if IS_WINDOWS:
     # Needed for generating UUIDs
     libraries.append("Advapi32")
     defines.append(("WIN32", None))
+if os.environ.get("TSKIT_INSTRUMENT", "0") != "0":
+    # Count the work done in the C library; see _tskit.get_counters()
+    defines.append(("TSK_INSTRUMENT", None))
 
 _tskit_module = Extension(
     "_tskit",
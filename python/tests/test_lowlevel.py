@@ -1254,6 +1254,20 @@ class TestTreeSequence(LowLevelTestCase, MetadataTestMixin):
                 with pytest.raises(TypeError):
                     ts_skip.load(f, skip_reference_sequence=bad_bool)
 
+    def test_load_initialised(self, tmp_path):
+        ts = self.get_example_tree_sequence()
+        tables = _tskit.TableCollection(sequence_length=ts.get_sequence_length())
+        ts.dump_tables(tables)
+        with open(tmp_path / "temp.trees", "wb") as f:
+            ts.dump(f)
+        num_nodes = ts.get_num_nodes()
+        with pytest.raises(ValueError, match="already initialised"):
+            ts.load_tables(tables)
+        with open(tmp_path / "temp.trees", "rb") as f:
+            with pytest.raises(ValueError, match="already initialised"):
+                ts.load(f)
+        assert ts.get_num_nodes() == num_nodes
+
     def test_file_errors(self):
         ts1 = self.get_example_tree_sequence()
 
@@ -1862,6 +1876,9 @@ class StatsInterfaceMixin:
     Tests for the interface on specific stats.
     """
 
+    # Stats that must be computed over windows covering the whole sequence.
+    requires_full_span = False
+
     def test_mode_errors(self):
         _, f, params = self.get_example()
         for bad_mode in ["", "not a mode", "SITE", "x" * 8192]:
@@ -1885,7 +1902,6 @@ class StatsInterfaceMixin:
         L = ts.get_sequence_length()
         bad_windows = [
             [L, 0],
-            [0.1, L],
             [-1, L],
             [0, L + 0.1],
             [0, 0.1, 0.1, L],
@@ -1895,6 +1911,18 @@ class StatsInterfaceMixin:
         for bad_window in bad_windows:
             with pytest.raises(_tskit.LibraryError):
                 f(windows=bad_window, **params)
+        if self.requires_full_span:
+            with pytest.raises(_tskit.LibraryError):
+                f(windows=[0.1, L], **params)
+
+    def test_partial_windows(self):
+        ts, f, params = self.get_example()
+        if self.requires_full_span:
+            pytest.skip("Stat requires windows spanning the whole sequence")
+        del params["windows"]
+        L = ts.get_sequence_length()
+        x = f(windows=[0.1, L / 2], **params)
+        assert x.shape[0] == 1
 
     def test_polarisation(self):
         ts, f, params = self.get_example()
@@ -2152,6 +2180,8 @@ class TestAlleleFrequencySpectrum(LowLevelTestCase, OneWaySampleStatsMixin):
     Tests for the diversity method.
     """
 
+    requires_full_span = True
+
     def get_method(self):
         ts = self.get_example_tree_sequence()
         return ts, ts.allele_frequency_spectrum
@@ -4171,6 +4201,24 @@ class TestModuleFunctions:
         with open(f"{tskit.__path__[0]}/../../c/VERSION.txt") as f:
             assert f.read() == f"{maj}.{min_}.{patch}"
 
+    def test_counters(self):
+        _tskit.reset_counters()
+        try:
+            counters = _tskit.get_counters()
+        except _tskit.LibraryError:
+            # The C library was not compiled with TSK_INSTRUMENT defined
+            return
+        assert all(value == 0 for value in counters.values())
+        ts = msprime.simulate(10, recombination_rate=1, random_seed=1)
+        _tskit.reset_counters()
+        for _ in ts.trees():
+            pass
+        counters = _tskit.get_counters()
+        assert counters["trees_visited"] == ts.num_trees
+        assert counters["edges_inserted"] == ts.num_edges
+        _tskit.reset_counters()
+        assert _tskit.get_counters()["trees_visited"] == 0
+
 
 def test_uninitialised():
     # These methods work from an instance that has a NULL ref so don't check
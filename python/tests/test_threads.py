@@ -279,3 +279,72 @@ class TestTables:
 
     def test_sort_access_mutations(self):
         self.run_sort_access_table("mutations", "site")
+
+    def run_dump_access_table(self, table_name, col_name, tmp_path):
+        tables = self.get_tables()
+
+        def writer():
+            for _ in range(10):
+                tables.dump(tmp_path / "tables.trees")
+
+        table = getattr(tables, table_name)
+
+        def reader(thread_index, results):
+            for _ in range(100):
+                x = getattr(table, col_name)
+                assert x.shape[0] == len(table)
+
+        self.run_failing_reader(writer, reader)
+        assert tables == tskit.TableCollection.load(tmp_path / "tables.trees")
+
+    def test_dump_access_nodes(self, tmp_path):
+        self.run_dump_access_table("nodes", "time", tmp_path)
+
+    def test_dump_access_edges(self, tmp_path):
+        self.run_dump_access_table("edges", "left", tmp_path)
+
+
+class TestStatsReplicates:
+    """
+    Tests that statistics computed concurrently from threads sharing a tree
+    sequence give the same results as when computed serially.
+    """
+
+    def get_tree_sequence(self):
+        return msprime.simulate(
+            50, mutation_rate=10, recombination_rate=10, random_seed=12
+        )
+
+    @pytest.mark.parametrize("mode", ["site", "branch", "node"])
+    def test_diversity(self, mode):
+        ts = self.get_tree_sequence()
+        windows = np.linspace(0, ts.sequence_length, 11)
+        expected = ts.diversity(windows=windows, mode=mode)
+
+        def worker(thread_index, results):
+            results[thread_index] = ts.diversity(windows=windows, mode=mode)
+
+        for result in run_threads(worker, 8):
+            np.testing.assert_array_equal(result, expected)
+
+    def test_divergence(self):
+        ts = self.get_tree_sequence()
+        sample_sets = [range(10), range(10, 20), range(20, 50)]
+        indexes = [(0, 1), (1, 2), (0, 2)]
+        expected = ts.divergence(sample_sets, indexes=indexes)
+
+        def worker(thread_index, results):
+            results[thread_index] = ts.divergence(sample_sets, indexes=indexes)
+
+        for result in run_threads(worker, 8):
+            np.testing.assert_array_equal(result, expected)
+
+    def test_load(self, tmp_path):
+        ts = self.get_tree_sequence()
+        ts.dump(tmp_path / "ts.trees")
+
+        def worker(thread_index, results):
+            results[thread_index] = tskit.load(tmp_path / "ts.trees")
+
+        for result in run_threads(worker, 8):
+            assert result.equals(ts)